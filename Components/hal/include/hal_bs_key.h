@@ -40,6 +40,16 @@ extern "C"
 #define HAL_BS_KEY_BTN2                 0x02
 #define HAL_BS_KEY_BTN3                 0x04
 #define HAL_BS_KEY_BTN4                 0x08
+
+/* Key events - passed in the state parameter of the callback, one key at a time */
+#define HAL_BS_KEY_EVT_PRESS            0x10  /* Debounced key down */
+#define HAL_BS_KEY_EVT_RELEASE          0x20  /* Debounced key up */
+#define HAL_BS_KEY_EVT_LONG             0x40  /* Key held for its long-press time, sent once per press */
+#define HAL_BS_KEY_EVT_DOUBLE           0x80  /* Second press within HAL_BS_KEY_DOUBLE_TIME of a short click */
+
+/* Default long-press time and double-click window in msecs */
+#define HAL_BS_KEY_LONG_TIME            1000
+#define HAL_BS_KEY_DOUBLE_TIME          400
   
 /**************************************************************************************************
  * TYPEDEFS
@@ -65,6 +75,11 @@ extern void HalBsKeyInit( void );
  */
 extern void HalBsKeyConfig( bool interruptEnable, const halBsKeyCBack_t cback);
 
+/*
+ * Set the long-press time of one or more keys
+ */
+extern void HalBsKeySetLongPress( uint8 keys, uint16 msecs );
+
 /*
  * Read the Key status
  */
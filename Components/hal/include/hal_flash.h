@@ -94,6 +94,27 @@ void HalFlashRead(uint8 pg, uint16 offset, uint8 *buf, uint16 cnt);
  */
 void HalFlashWrite(uint16 addr, uint8 *buf, uint16 cnt);
 
+/**************************************************************************************************
+ * @fn          HalFlashWriteStart
+ *
+ * @brief       This function starts writing 'cnt' 4-byte blocks to the internal flash by DMA and
+ *              returns without waiting: the write is done once FCTL.BUSY (bit 7) clears.
+ *
+ * input parameters
+ *
+ * @param       addr - Valid HAL flash write address: actual addr / 4 and quad-aligned.
+ * @param       buf - Valid buffer space at least as big as 'cnt' X 4, untouched until written.
+ * @param       cnt - Number of 4-byte blocks to write: a write cannot cross into the next 32KB bank.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ **************************************************************************************************
+ */
+void HalFlashWriteStart(uint16 addr, uint8 *buf, uint16 cnt);
+
 /**************************************************************************************************
  * @fn          HalFlashErase
  *
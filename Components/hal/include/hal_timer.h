@@ -230,6 +230,28 @@ void HalTimer1Init (halTimerCBack_t cBack);
  */
 void halTimer1SetChannelDuty (uint8 channel, uint16 promill);
 
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE)
+/* PWM dimming on Timer1 (HAL_TIMER_3), one compare channel per output */
+#define HAL_TIMER_PWM_MAX_CH      4       // Timer1 channels 1-4, channel 0 sets the frame
+#define HAL_TIMER_PWM_LEVEL_MAX   255     // Fully on
+#define HAL_TIMER_PWM_FRAME_MS    5       // 200Hz PWM frame, fades advance once per frame
+
+/*
+ * Take over Timer1 to dim the given Port 1 pins, all starting off
+ */
+extern uint8 HalTimerPwmInit (const uint8 *pins, uint8 numCh);
+
+/*
+ * Fade a PWM output to level (gamma corrected) within fadeMs, 0 switches at the next frame
+ */
+extern uint8 HalTimerPwmSet (uint8 channel, uint8 level, uint16 fadeMs);
+
+/*
+ * Level a PWM output is at or fading to
+ */
+extern uint8 HalTimerPwmGet (uint8 channel);
+#endif
+
 /***************************************************************************************************
 ***************************************************************************************************/
 
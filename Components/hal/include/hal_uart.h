@@ -151,6 +151,23 @@ typedef union
   bool flushControl;
 }halUARTIoctl_t;
 
+#if HAL_UART_STATS
+/* Run-time counters kept by the DMA and ISR drivers, used to size the Rx/Tx queues and the
+ * flow control thresholds against a real peer.
+ */
+typedef struct
+{
+  uint32 rxBytes;      // Bytes handed to the application by HalUARTRead().
+  uint32 txBytes;      // Bytes accepted by HalUARTWrite().
+  uint16 txRefused;    // Writes refused by the all-or-none policy because the Tx queue was full.
+  uint16 rxOverruns;   // Times the Rx queue wrapped onto unread data.
+  uint16 rxFlowOffs;   // Times the Rx flow was stopped at the high-water threshold (DMA only).
+  uint16 rxHighWater;  // Deepest Rx queue seen by the poll.
+  uint16 txHighWater;  // Deepest Tx queue seen after a write.
+  uint16 txDrainMax;   // Worst-case msecs from a write into an empty Tx queue until it drained.
+} halUARTStats_t;
+#endif
+
 
 /***************************************************************************************************
  *                                           GLOBAL VARIABLES
@@ -225,6 +242,13 @@ extern void HalUARTSuspend(void);
  */
 extern void HalUARTResume(void);
 
+#if HAL_UART_STATS
+/*
+ * Copy the run-time counters of a port and optionally clear them
+ */
+extern void HalUARTGetStats(uint8 port, halUARTStats_t *pStats, bool clear);
+#endif
+
 /***************************************************************************************************
 ***************************************************************************************************/
 
@@ -277,6 +277,12 @@ typedef struct
   volatile uint8 txSel;
 #endif
 
+#if HAL_UART_STATS
+  halUARTStats_t stats;
+  uint32 txStart;  // OSAL clock when a write was queued onto an empty Tx queue.
+  uint8 txTimed;   // Flag indicating that txStart is valid and the drain time is being measured.
+#endif
+
   halUARTCBack_t uartCB;
 } uartDMACfg_t;
 
@@ -322,6 +328,27 @@ typedef struct
   (dmaCfg.txHead - dmaCfg.txTail - 1) : \
   (HAL_UART_DMA_TX_MAX - dmaCfg.txTail + dmaCfg.txHead - 1))
 
+#if HAL_UART_TX_BY_ISR
+#define HAL_UART_DMA_TX_MT()           (dmaCfg.txHead == dmaCfg.txTail)
+#define HAL_UART_DMA_TX_DEPTH()        (HAL_UART_DMA_TX_MAX - 1 - HAL_UART_DMA_TX_AVAIL())
+#else
+#define HAL_UART_DMA_TX_MT()           ((dmaCfg.txIdx[0] == 0) && (dmaCfg.txIdx[1] == 0))
+#define HAL_UART_DMA_TX_DEPTH()        (dmaCfg.txIdx[0] + dmaCfg.txIdx[1])
+#endif
+
+#if HAL_UART_STATS
+#define HAL_UART_DMA_STAT_ADD(FIELD, CNT)  (dmaCfg.stats.FIELD += (CNT))
+#define HAL_UART_DMA_STAT_MAX(FIELD, VAL) st ( \
+  if ((VAL) > dmaCfg.stats.FIELD) \
+  { \
+    dmaCfg.stats.FIELD = (VAL); \
+  } \
+)
+#else
+#define HAL_UART_DMA_STAT_ADD(FIELD, CNT)
+#define HAL_UART_DMA_STAT_MAX(FIELD, VAL)
+#endif
+
 /* ------------------------------------------------------------------------------------------------
  *                                           Local Variables
  * ------------------------------------------------------------------------------------------------
@@ -357,6 +384,10 @@ static uint8 HalUARTBusyDMA(void);
 static void HalUARTPollTxTrigDMA(void);
 static void HalUARTArmTxDMA(void);
 #endif
+#if HAL_UART_STATS
+static void HalUARTStatsDMA(halUARTStats_t *pStats, bool clear);
+static void HalUARTStatTxDMA(bool wasMT);
+#endif
 
 /******************************************************************************
  * @fn      HalUARTInitDMA
@@ -470,7 +501,7 @@ static void HalUARTInitDMA(void)
   // DMA has highest priority for memory access.
   HAL_DMA_SET_PRIORITY( ch, HAL_DMA_PRI_HIGH);
 
-  volatile uint8 dummy = *(volatile uint8 *)DMA_UxDBUF;  // Clear the DMA Rx trigger.
+  volatile uint8 dummy = UxDBUF;  // Clear the DMA Rx trigger.
   HAL_DMA_CLEAR_IRQ(HAL_DMA_CH_RX);
   HAL_DMA_ARM_CH(HAL_DMA_CH_RX);
   (void)memset(dmaCfg.rxBuf, (DMA_PAD ^ 0xFF), HAL_UART_DMA_RX_MAX * sizeof(uint16));
@@ -582,6 +613,7 @@ static uint16 HalUARTReadDMA(uint8 *buf, uint16 len)
 
   /* Update pointers after reading the bytes */
   dmaCfg.rxTail = dmaCfg.rxHead;
+  HAL_UART_DMA_STAT_ADD(rxBytes, cnt);
 
   if (!DMA_PM && (UxUCR & UCR_FLOW))
   {
@@ -604,10 +636,14 @@ static uint16 HalUARTReadDMA(uint8 *buf, uint16 len)
  *****************************************************************************/
 static uint16 HalUARTWriteDMA(uint8 *buf, uint16 len)
 {
+#if HAL_UART_STATS
+  bool wasMT = HAL_UART_DMA_TX_MT();
+#endif
 #if HAL_UART_TX_BY_ISR
   // Enforce all or none.
   if (HAL_UART_DMA_TX_AVAIL() < len)
   {
+    HAL_UART_DMA_STAT_ADD(txRefused, 1);
     return 0;
   } 
 
@@ -641,6 +677,7 @@ static uint16 HalUARTWriteDMA(uint8 *buf, uint16 len)
   // Enforce all or none.
   if ((len + txIdx) > HAL_UART_DMA_TX_MAX)
   {
+    HAL_UART_DMA_STAT_ADD(txRefused, 1);
     return 0;
   }
 
@@ -678,6 +715,10 @@ static uint16 HalUARTWriteDMA(uint8 *buf, uint16 len)
   }
 #endif
 
+#if HAL_UART_STATS
+  HAL_UART_DMA_STAT_ADD(txBytes, len);
+  HalUARTStatTxDMA(wasMT);
+#endif
   return len;
 }
 
@@ -763,6 +804,8 @@ static void HalUARTPollDMA(void)
   }
 #endif
 
+  HAL_UART_DMA_STAT_MAX(rxHighWater, cnt);
+
   if (cnt >= HAL_UART_DMA_FULL)
   {
     evt |= HAL_UART_RX_FULL;
@@ -774,6 +817,7 @@ static void HalUARTPollDMA(void)
     if (!DMA_PM && (UxUCR & UCR_FLOW))
     {
       HAL_UART_DMA_CLR_RDY_OUT();  // Disable Rx flow.
+      HAL_UART_DMA_STAT_ADD(rxFlowOffs, 1);
     }
   }
 
@@ -781,6 +825,16 @@ static void HalUARTPollDMA(void)
   {
     dmaCfg.txMT = FALSE;
     evt |= HAL_UART_TX_EMPTY;
+
+#if HAL_UART_STATS
+    if (dmaCfg.txTimed && HAL_UART_DMA_TX_MT())
+    {
+      uint32 drain = osal_GetSystemClock() - dmaCfg.txStart;
+
+      dmaCfg.txTimed = FALSE;
+      HAL_UART_DMA_STAT_MAX(txDrainMax, ((drain > 0xFFFF) ? 0xFFFF : (uint16)drain));
+    }
+#endif
   }
 
   if ((evt != 0) && (dmaCfg.uartCB != NULL))
@@ -841,6 +895,13 @@ static uint16 HalUARTRxAvailDMA(void)
     {
       if (HAL_UART_DMA_NEW_RX_BYTE(sweepIdx))
       {
+#if HAL_UART_STATS
+        // A byte that landed at the head since the count above is not an overrun.
+        if (sweepIdx != dmaCfg.rxHead)
+        {
+          HAL_UART_DMA_STAT_ADD(rxOverruns, 1);
+        }
+#endif
         dmaCfg.rxTail = sweepIdx;
         dmaCfg.rxHead = sweepIdx;
         cnt = 0;
@@ -888,6 +949,53 @@ static uint8 HalUARTBusyDMA( void )
 #endif
 }
 
+#if HAL_UART_STATS
+/******************************************************************************
+ * @fn      HalUARTStatsDMA
+ *
+ * @brief   Copy the run-time counters and optionally clear them.
+ *
+ * @param   pStats - pointer to the counters to fill in
+ *          clear - TRUE to restart the counting from zero
+ *
+ * @return  None
+ *****************************************************************************/
+static void HalUARTStatsDMA(halUARTStats_t *pStats, bool clear)
+{
+  halIntState_t his;
+
+  HAL_ENTER_CRITICAL_SECTION(his);
+  *pStats = dmaCfg.stats;
+  if (clear)
+  {
+    (void)memset(&dmaCfg.stats, 0, sizeof(halUARTStats_t));
+  }
+  HAL_EXIT_CRITICAL_SECTION(his);
+}
+
+/******************************************************************************
+ * @fn      HalUARTStatTxDMA
+ *
+ * @brief   Account for an accepted write: Tx queue depth and the start of a drain time.
+ *
+ * @param   wasMT - TRUE if the Tx queue was empty before the write
+ *
+ * @return  None
+ *****************************************************************************/
+static void HalUARTStatTxDMA(bool wasMT)
+{
+  uint16 depth = HAL_UART_DMA_TX_DEPTH();
+
+  HAL_UART_DMA_STAT_MAX(txHighWater, depth);
+
+  if (wasMT && !dmaCfg.txTimed)
+  {
+    dmaCfg.txStart = osal_GetSystemClock();
+    dmaCfg.txTimed = TRUE;
+  }
+}
+#endif
+
 #if !HAL_UART_TX_BY_ISR
 /******************************************************************************
  * @fn      HalUARTPollTxTrigDMA
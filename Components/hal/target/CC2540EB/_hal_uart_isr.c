@@ -68,6 +68,19 @@
   (isrCfg.txHead - isrCfg.txTail - 1) : \
   (HAL_UART_ISR_TX_MAX - isrCfg.txTail + isrCfg.txHead - 1))
 
+#if HAL_UART_STATS
+#define HAL_UART_ISR_STAT_ADD(FIELD, CNT)  (isrCfg.stats.FIELD += (CNT))
+#define HAL_UART_ISR_STAT_MAX(FIELD, VAL) st ( \
+  if ((VAL) > isrCfg.stats.FIELD) \
+  { \
+    isrCfg.stats.FIELD = (VAL); \
+  } \
+)
+#else
+#define HAL_UART_ISR_STAT_ADD(FIELD, CNT)
+#define HAL_UART_ISR_STAT_MAX(FIELD, VAL)
+#endif
+
 /*********************************************************************
  * CONSTANTS
  */
@@ -225,6 +238,12 @@ typedef struct
   txIdx_t txTail;
   uint8 txMT;
 
+#if HAL_UART_STATS
+  halUARTStats_t stats;
+  uint32 txStart;  // OSAL clock when a write was queued onto an empty Tx queue.
+  uint8 txTimed;   // Flag indicating that txStart is valid and the drain time is being measured.
+#endif
+
   halUARTCBack_t uartCB;
 } uartISRCfg_t;
 
@@ -247,6 +266,9 @@ static uint16 HalUARTRxAvailISR(void);
 static uint8 HalUARTBusyISR(void);
 static void HalUARTSuspendISR(void);
 static void HalUARTResumeISR(void);
+#if HAL_UART_STATS
+static void HalUARTStatsISR(halUARTStats_t *pStats, bool clear);
+#endif
 
 /******************************************************************************
  * @fn      HalUARTInitISR
@@ -362,6 +384,7 @@ static uint16 HalUARTReadISR(uint8 *buf, uint16 len)
     }
     cnt++;
   }
+  HAL_UART_ISR_STAT_ADD(rxBytes, cnt);
 
   return cnt;
 }
@@ -383,9 +406,18 @@ static uint16 HalUARTWriteISR(uint8 *buf, uint16 len)
   // Enforce all or none.
   if (HAL_UART_ISR_TX_AVAIL() < len)
   {
+    HAL_UART_ISR_STAT_ADD(txRefused, 1);
     return 0;
   }
 
+#if HAL_UART_STATS
+  if ((isrCfg.txHead == isrCfg.txTail) && !isrCfg.txTimed)
+  {
+    isrCfg.txStart = osal_GetSystemClock();
+    isrCfg.txTimed = TRUE;
+  }
+#endif
+
   for (cnt = 0; cnt < len; cnt++)
   {
     isrCfg.txBuf[isrCfg.txTail] = *buf++;
@@ -404,6 +436,14 @@ static uint16 HalUARTWriteISR(uint8 *buf, uint16 len)
     IEN2 |= UTXxIE;
   }
 
+#if HAL_UART_STATS
+  HAL_UART_ISR_STAT_ADD(txBytes, cnt);
+  {
+    uint16 depth = HAL_UART_ISR_TX_MAX - 1 - HAL_UART_ISR_TX_AVAIL();
+    HAL_UART_ISR_STAT_MAX(txHighWater, depth);
+  }
+#endif
+
   return cnt;
 }
 
@@ -437,6 +477,8 @@ static void HalUARTPollISR(void)
   }
   isrCfg.rxShdw = ST0;
 
+  HAL_UART_ISR_STAT_MAX(rxHighWater, cnt);
+
   if (cnt >= HAL_UART_ISR_RX_MAX-1)
   {
     evt = HAL_UART_RX_FULL;
@@ -454,6 +496,16 @@ static void HalUARTPollISR(void)
   {
     isrCfg.txMT = 0;
     evt |= HAL_UART_TX_EMPTY;
+
+#if HAL_UART_STATS
+    if (isrCfg.txTimed)
+    {
+      uint32 drain = osal_GetSystemClock() - isrCfg.txStart;
+
+      isrCfg.txTimed = FALSE;
+      HAL_UART_ISR_STAT_MAX(txDrainMax, ((drain > 0xFFFF) ? 0xFFFF : (uint16)drain));
+    }
+#endif
   }
 
   if (evt && (isrCfg.uartCB != NULL))
@@ -556,6 +608,31 @@ static void HalUARTResumeISR( void )
 #endif
 }
 
+#if HAL_UART_STATS
+/******************************************************************************
+ * @fn      HalUARTStatsISR
+ *
+ * @brief   Copy the run-time counters and optionally clear them.
+ *
+ * @param   pStats - pointer to the counters to fill in
+ *          clear - TRUE to restart the counting from zero
+ *
+ * @return  None
+ *****************************************************************************/
+static void HalUARTStatsISR(halUARTStats_t *pStats, bool clear)
+{
+  halIntState_t his;
+
+  HAL_ENTER_CRITICAL_SECTION(his);
+  *pStats = isrCfg.stats;
+  if (clear)
+  {
+    (void)memset(&isrCfg.stats, 0, sizeof(halUARTStats_t));
+  }
+  HAL_EXIT_CRITICAL_SECTION(his);
+}
+#endif
+
 /***************************************************************************************************
  * @fn      halUartRxIsr
  *
@@ -587,6 +664,14 @@ HAL_ISR_FUNCTION( halUart1RxIsr, URX1_VECTOR )
     isrCfg.rxTail = 0;
   }
 
+#if HAL_UART_STATS
+  // The queue wrapped onto unread data: the oldest bytes are lost.
+  if (isrCfg.rxTail == isrCfg.rxHead)
+  {
+    isrCfg.stats.rxOverruns++;
+  }
+#endif
+
   isrCfg.rxTick = HAL_UART_ISR_IDLE;
 
   HAL_EXIT_ISR();
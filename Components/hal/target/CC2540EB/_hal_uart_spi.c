@@ -102,6 +102,17 @@
 #define HAL_SPI_ON_UART_BUFS       FALSE
 #endif
 
+/* Stream the queued Tx frames back-to-back by DMA while the Rx DMA keeps running, so that frames
+ * from the master are received during the same transfer. SRDY is only de-asserted, and therefore
+ * a new MRDY/SRDY handshake only required, when the Tx queue drains. SPI Slave only.
+ */
+#if !defined HAL_SPI_STREAM
+#define HAL_SPI_STREAM             FALSE
+#endif
+#if (HAL_SPI_STREAM && defined HAL_SPI_MASTER)
+#error "HAL_SPI_STREAM is only supported by the SPI Slave"
+#endif
+
 #define SPI_MAX_PKT_LEN            256
 #define SPI_MAX_DAT_LEN           (SPI_MAX_PKT_LEN - SPI_FRM_LEN)
 
@@ -343,7 +354,15 @@ typedef enum
  * but only using one at a time with a run-time choice */
 static __no_init uint16 spiRxBuf[SPI_MAX_PKT_LEN];
 static __no_init uint8  spiRxDat[SPI_MAX_PKT_LEN];
+#if HAL_SPI_STREAM
+/* One Tx buffer is streamed by the DMA while frames are appended to the other; the extra byte
+ * holds the pad after a buffer filled with frames */
+static __no_init uint8  spiTxStrm[2][SPI_MAX_PKT_LEN + 1];
+static uint16 spiTxIdx[2];          /* Bytes of whole frames queued in each Tx buffer */
+static volatile uint8 spiTxSel;     /* Tx buffer to which HalUARTWriteSPI() appends frames */
+#else
 static __no_init uint8  spiTxPkt[SPI_MAX_PKT_LEN]; /* Can be trimmed as per requirement*/
+#endif
 
 static spiRxSte_t spiRxPktState;  /* State of SPI packet parsing from spiRxBuf[] */
 static spiLen_t spiRxIdx;    /* Index in spiRxBuf[] for SPI packet parsing */
@@ -381,6 +400,11 @@ void HalUART_DMAIsrSPI(void);
 static void HalUARTPollSPI(void);
 static uint8 spiCalcFcs(uint8 *pBuf);
 static void spiParseRx(void);
+#if HAL_SPI_STREAM
+static spiLen_t spiStreamTx(uint8 *buf, spiLen_t len);
+static void spiStreamFrame(uint8 *pBuf, uint8 *buf, spiLen_t len);
+static void spiStreamArm(void);
+#endif
 /**************************************************************************************************
  * @fn          HalUARTInitSPI
  *
@@ -446,7 +470,11 @@ static void HalUARTInitSPI(void)
 
   /* The source address is incremented by 1 byte after each transfer */
   HAL_DMA_SET_SRC_INC( ch, HAL_DMA_SRCINC_1 );
+#if HAL_SPI_STREAM
+  HAL_DMA_SET_SOURCE( ch, spiTxStrm[0] );
+#else
   HAL_DMA_SET_SOURCE( ch, spiTxPkt );
+#endif
 
   /* The destination address is constant - the Tx Data Buffer */
   HAL_DMA_SET_DST_INC( ch, HAL_DMA_DSTINC_0 );
@@ -502,7 +530,7 @@ static void HalUARTInitSPI(void)
   /* DMA has highest priority for memory access */
   HAL_DMA_SET_PRIORITY( ch, HAL_DMA_PRI_HIGH );
 
-  volatile uint8 dummy = *(volatile uint8 *)DMA_UxDBUF;  /* Clear the DMA Rx trigger */
+  volatile uint8 dummy = UxDBUF;  /* Clear the DMA Rx trigger */
   HAL_DMA_CLEAR_IRQ(HAL_SPI_CH_RX);
   HAL_DMA_ARM_CH(HAL_SPI_CH_RX);
   (void)memset(spiRxBuf, (DMA_PAD ^ 0xFF), SPI_MAX_PKT_LEN * sizeof(uint16));
@@ -587,6 +615,9 @@ static spiLen_t HalUARTReadSPI(uint8 *buf, spiLen_t len)
  */
 static spiLen_t HalUARTWriteSPI(uint8 *buf, spiLen_t len)
 {  
+#if HAL_SPI_STREAM
+  return spiStreamTx(buf, len);
+#else
   if (spiTxLen != 0)
   {
     return 0;
@@ -670,7 +701,164 @@ static spiLen_t HalUARTWriteSPI(uint8 *buf, spiLen_t len)
 
 #endif
   return len;
+#endif
+}
+
+#if HAL_SPI_STREAM
+/**************************************************************************************************
+ * @fn          spiStreamTx
+ *
+ * @brief       Queue data bytes as a SPI frame onto the Tx stream, starting the stream if idle.
+ *
+ * input parameters
+ *
+ * @param       buf - pointer to the memory of the data bytes to send.
+ * @param       len - the length of the data bytes to send.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      Zero if there is no room for the whole frame; otherwise, 'len'.
+ */
+static spiLen_t spiStreamTx(uint8 *buf, spiLen_t len)
+{
+  halIntState_t intState;
+  uint16 idx;
+  uint8 sel;
+
+  if (len > SPI_MAX_DAT_LEN)
+  {
+    len = SPI_MAX_DAT_LEN;
+  }
+
+  HAL_ENTER_CRITICAL_SECTION(intState);
+  sel = spiTxSel;
+  idx = spiTxIdx[sel];
+  HAL_EXIT_CRITICAL_SECTION(intState);
+
+  /* Enforce all or none; the pad that the slave DMA Tx might drop goes after the buffer */
+  if ((idx + len + SPI_FRM_LEN) > SPI_MAX_PKT_LEN)
+  {
+    return 0;
+  }
+
+  spiStreamFrame(spiTxStrm[sel] + idx, buf, len);
+
+  HAL_ENTER_CRITICAL_SECTION(intState);
+  /* If the ongoing DMA Tx finished while this frame was being *appended*, then the DMA Tx will
+   * have already been re-armed on this buffer without it, so it has to be re-copied to the start
+   * of the new working buffer.
+   */
+  if (sel != spiTxSel)
+  {
+    HAL_EXIT_CRITICAL_SECTION(intState);
+    sel ^= 1;
+
+    spiStreamFrame(spiTxStrm[sel], buf, len);
+    HAL_ENTER_CRITICAL_SECTION(intState);
+    spiTxIdx[sel] = len + SPI_FRM_LEN;
+  }
+  else
+  {
+    spiTxIdx[sel] = idx + len + SPI_FRM_LEN;
+  }
+
+  /* A running stream picks up the frame from its Tx done ISR; otherwise handshake to start one */
+  if (spiTxLen != 0)
+  {
+    HAL_EXIT_CRITICAL_SECTION(intState);
+    return len;
+  }
+  spiTxLen = len;
+  HAL_EXIT_CRITICAL_SECTION(intState);
+
+#ifdef POWER_SAVING
+  /* Disable POWER SAVING when transmission is initiated */
+  CLEAR_SLEEP_MODE();
+#endif
+
+  SPI_CLR_RDY_OUT();
+
+  HAL_DMA_ARM_CH(HAL_SPI_CH_RX);
+
+  asm("NOP"); asm("NOP"); asm("NOP"); asm("NOP"); asm("NOP");
+  asm("NOP"); asm("NOP"); asm("NOP"); asm("NOP");
+
+  if ( SPI_RDY_IN() )
+  {
+    SPI_SET_RDY_OUT();
+  }
+
+  HAL_ENTER_CRITICAL_SECTION(intState);
+  spiStreamArm();
+  HAL_EXIT_CRITICAL_SECTION(intState);
+
+  asm("NOP"); asm("NOP"); asm("NOP"); asm("NOP"); asm("NOP");
+  asm("NOP"); asm("NOP"); asm("NOP"); asm("NOP");
+
+  SPI_SET_RDY_OUT();
+
+  return len;
+}
+
+/**************************************************************************************************
+ * @fn          spiStreamFrame
+ *
+ * @brief       Build a SPI Transport frame: SOF, LEN, data bytes and FCS.
+ *
+ * input parameters
+ *
+ * @param       pBuf - pointer to the memory where to build the frame.
+ * @param       buf - pointer to the memory of the data bytes to send.
+ * @param       len - the length of the data bytes to send.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ */
+static void spiStreamFrame(uint8 *pBuf, uint8 *buf, spiLen_t len)
+{
+  pBuf[SPI_LEN_IDX] = len;
+  (void)memcpy(pBuf + SPI_DAT_IDX, buf, len);
+
+  spiCalcFcs(pBuf);
+  pBuf[SPI_SOF_IDX] = SPI_SOF;
+}
+
+/**************************************************************************************************
+ * @fn          spiStreamArm
+ *
+ * @brief       Arm the DMA Tx on the working buffer and switch appending to the other buffer.
+ *              Must be called with interrupts disabled or from the DMA ISR.
+ *
+ * input parameters
+ *
+ * None.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ */
+static void spiStreamArm(void)
+{
+  halDMADesc_t *ch = HAL_DMA_GET_DESC1234(HAL_SPI_CH_TX);
+  uint8 sel = spiTxSel;
+
+  /* A zero pad is never taken for a SOF by the master when it clocks past the last frame */
+  spiTxStrm[sel][spiTxIdx[sel]] = 0;
+
+  HAL_DMA_SET_SOURCE(ch, spiTxStrm[sel]);
+  HAL_DMA_SET_LEN(ch, spiTxIdx[sel] + 1); /* slave DMA TX might drop the last byte */
+  HAL_DMA_ARM_CH(HAL_SPI_CH_TX);
+
+  spiTxSel = sel ^ 1;
 }
+#endif
 
 /**************************************************************************************************
  * @fn          HalUARTPollSPI
@@ -733,8 +921,14 @@ static void HalUARTPollSPI(void)
     SPI_CLR_RDY_OUT(); /* SPI_RDYOut = 1; */
     spiParseRx();
   }
+#if HAL_SPI_STREAM
+  else
+  {
+    spiParseRx();  /* Frames clocked in by the master during a Tx stream or an MRDY transfer */
+  }
+#endif
 
-#if defined HAL_SPI_MASTER
+#if (defined HAL_SPI_MASTER || HAL_SPI_STREAM)
   if( SPI_RX_RDY())
 #else
   if (SPI_RX_RDY() && !spiTxLen)
@@ -851,6 +1045,15 @@ static void spiParseRx(void)
     }
 
     uint8 ch = SPI_GET_RX_BYTE(spiRxIdx);
+
+    /* Leave a frame in spiRxBuf[] until spiRxDat[] has room for all of its data bytes */
+    if ((spiRxPktState == SPIRX_STATE_LEN) && (ch <= SPI_MAX_DAT_LEN) &&
+        (ch >= (SPI_MAX_PKT_LEN - ((spiRxTail >= spiRxHead) ? (spiRxTail - spiRxHead) :
+                                   (spiRxTail + (SPI_MAX_PKT_LEN - spiRxHead))))))
+    {
+      break;
+    }
+
     SPI_CLR_RX_BYTE(spiRxIdx);
     SPI_LEN_T_INCR(spiRxIdx);
 
@@ -911,7 +1114,12 @@ static void spiParseRx(void)
 #ifdef POWER_SAVING
       pktFound = TRUE;
 #endif
-      SPI_CLR_RDY_OUT(); /* SPI_RDYOut = 1 */
+#if HAL_SPI_STREAM
+      if (spiTxLen == 0)  /* SRDY stays asserted until the Tx stream drains */
+#endif
+      {
+        SPI_CLR_RDY_OUT(); /* SPI_RDYOut = 1 */
+      }
 
       if (ch == spiRxFcs)
       {
@@ -961,6 +1169,16 @@ void HalUART_DMAIsrSPI(void)
   }
 #else
   spiRdyIsr = 0;
+#endif
+#if HAL_SPI_STREAM
+  spiTxIdx[spiTxSel ^ 1] = 0;  /* The Tx buffer just finished is now free */
+
+  if (spiTxIdx[spiTxSel] != 0)
+  {
+    /* Frames were queued during the transfer: keep SRDY asserted and stream them on */
+    spiStreamArm();  /* Triggered when the master clocks out the pad byte still in UxDBUF */
+    return;
+  }
 #endif
   UxDBUF = 0x00;     /* Clear the garbage */
   SPI_CLR_RDY_OUT(); /* SPI_RDYOut = 1 */
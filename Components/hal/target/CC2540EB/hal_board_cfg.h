@@ -363,6 +363,11 @@ st( \
 #define HAL_TIMER FALSE
 #endif
 
+/* Set to TRUE to dim Port 1 outputs with Timer1 driven PWM and fades, FALSE to omit it */
+#if !defined HAL_TIMER_PWM
+#define HAL_TIMER_PWM FALSE
+#endif
+
 /* Set to TRUE enable ADC usage, FALSE disable it */
 #ifndef HAL_ADC
 #define HAL_ADC TRUE
@@ -460,6 +465,11 @@ st( \
 #define HAL_UART_SPI  0
 #endif
 
+/* Set to TRUE to keep UART throughput, overrun and latency counters, FALSE to omit them */
+#if !defined HAL_UART_STATS
+#define HAL_UART_STATS FALSE
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -43,14 +43,13 @@
        state of the previous poll and will only return a non-zero
        value if the key state changes.
 
- NOTE: If interrupts are used, the KeyRead() function is scheduled
-       25ms after the interrupt occurs by the ISR.  This delay is used
-       for key debouncing.  The ISR disables any further Key interrupt
-       until KeyRead() is executed.  KeyRead() will re-enable Key
-       interrupts after executing.  Unlike polling, when interrupts
-       are enabled, the previous key state is not remembered.  This
-       means that KeyRead() will return the current state of the keys
-       (not a change in state of the keys).
+ NOTE: If interrupts are used, HalBsKeyPoll() is scheduled 25ms after
+       the last interrupt by the ISR, any bounce restarting the delay.
+       While a key is held, HalBsKeyPoll() re-schedules itself every
+       50ms to time the long-press and to see the release; with all
+       keys up, no timer runs until the next key interrupt.  Each
+       change is reported per key as a press, release, long-press or
+       double-click event in the state parameter of the callback.
 
  NOTE: If interrupts are used, the KeyRead() fucntion is scheduled by
        the ISR.  Therefore, the joystick movements will only be detected
@@ -98,6 +97,13 @@
 
 #define HAL_BS_KEY_DEBOUNCE_VALUE  25
 
+/* While any key is held, the keys are scanned at this period (msecs) to time long-presses and to
+ * see the release; with all keys up, only the key interrupt wakes the driver.
+ */
+#define HAL_BS_KEY_SCAN_PERIOD     50
+
+#define HAL_BS_KEY_NUM             4
+
 /* CPU port interrupt */
 #define HAL_BS_KEY_CPU_PORT_0_IF P0IF
 #define HAL_BS_KEY_CPU_PORT_2_IF P2IF
@@ -187,7 +193,12 @@
 /**************************************************************************************************
  *                                        GLOBAL VARIABLES
  **************************************************************************************************/
-static uint8 halBsKeySavedKeys;     /* used to store previous key state in polling mode */
+static uint8 halBsKeySavedKeys;     /* used to store previous debounced key state */
+static uint8 halBsKeyLongSent;      /* held keys whose long-press has been reported */
+static uint8 halBsKeyClicked;       /* keys whose last press was a short click */
+static uint32 halBsKeyDownTime[HAL_BS_KEY_NUM];   /* when each key went down */
+static uint32 halBsKeyUpTime[HAL_BS_KEY_NUM];     /* when each key last went up */
+static uint16 halBsKeyLongTime[HAL_BS_KEY_NUM];   /* long-press time of each key */
 static halBsKeyCBack_t pHalBsKeyProcessFunction;
 static uint8 HalBsKeyConfigured;
 bool Hal_BsKeyIntEnable;            /* interrupt enable/disable flag */
@@ -214,6 +225,10 @@ void halProcessBsKeyInterrupt(void);
 void HalBsKeyInit( void )
 {
   halBsKeySavedKeys = 0;  // Initialize previous key to 0.
+  halBsKeyLongSent = 0;
+  halBsKeyClicked = 0;
+  HalBsKeySetLongPress( (HAL_BS_KEY_BTN1 | HAL_BS_KEY_BTN2 | HAL_BS_KEY_BTN3 | HAL_BS_KEY_BTN4),
+                        HAL_BS_KEY_LONG_TIME );
 
   // BTN1
   HAL_BS_KEY_BTN1_SEL &= ~(HAL_BS_KEY_BTN1_BIT);    /* Set pin function to GPIO */
@@ -373,6 +388,29 @@ void HalBsKeyConfig (bool interruptEnable, halBsKeyCBack_t cback)
 }
 
 
+/**************************************************************************************************
+ * @fn      HalBsKeySetLongPress
+ *
+ * @brief   Set the time a key has to be held for HAL_BS_KEY_EVT_LONG
+ *
+ * @param   keys - bit mask of the keys to set
+ *          msecs - long-press time
+ *
+ * @return  None
+ **************************************************************************************************/
+void HalBsKeySetLongPress( uint8 keys, uint16 msecs )
+{
+  uint8 idx;
+
+  for (idx = 0; idx < HAL_BS_KEY_NUM; idx++)
+  {
+    if (keys & BV(idx))
+    {
+      halBsKeyLongTime[idx] = msecs;
+    }
+  }
+}
+
 /**************************************************************************************************
  * @fn      HalKeyRead
  *
@@ -422,62 +460,69 @@ uint8 HalBsKeyRead ( void )
  **************************************************************************************************/
 void HalBsKeyPoll (void)
 {
-  uint8 keys = 0;
-  uint8 notify = 0;
+  uint8 keys = HalBsKeyRead();
+  uint8 changed = keys ^ halBsKeySavedKeys;
+  uint32 now = osal_GetSystemClock();
+  uint8 idx;
 
-  if (!(HAL_BS_KEY_BTN1_PORT & HAL_BS_KEY_BTN1_BIT))  /* Key is active low */
+  /* Classify the debounced state of each key against the previous one */
+  for (idx = 0; idx < HAL_BS_KEY_NUM; idx++)
   {
-    keys |= HAL_BS_KEY_BTN1;
-  }
-  
-  if (!(HAL_BS_KEY_BTN2_PORT & HAL_BS_KEY_BTN2_BIT))  /* Key is active low */
-  {
-    keys |= HAL_BS_KEY_BTN2;
-  }
-  
-  if (!(HAL_BS_KEY_BTN3_PORT & HAL_BS_KEY_BTN3_BIT))  /* Key is active low */
-  {
-    keys |= HAL_BS_KEY_BTN3;
-  }
-  
-  if (!(HAL_BS_KEY_BTN4_PORT & HAL_BS_KEY_BTN4_BIT))  /* Key is active low */
-  {
-    keys |= HAL_BS_KEY_BTN4;
-  }
-    
+    uint8 key = BV(idx);
+    uint8 evt = 0;
 
-  /* If interrupts are not enabled, previous key status and current key status
-   * are compared to find out if a key has changed status.
-   */
-  if (!Hal_BsKeyIntEnable)
-  {
-    if (keys == halBsKeySavedKeys)
+    if (changed & keys & key)
     {
-      /* Exit - since no keys have changed */
-      return;
+      halBsKeyDownTime[idx] = now;
+      halBsKeyLongSent &= ~key;
+      evt = HAL_BS_KEY_EVT_PRESS;
+
+      if ((halBsKeyClicked & key) && ((now - halBsKeyUpTime[idx]) <= HAL_BS_KEY_DOUBLE_TIME))
+      {
+        evt |= HAL_BS_KEY_EVT_DOUBLE;
+      }
+      halBsKeyClicked &= ~key;
     }
-    else
+    else if (changed & key)
     {
-      notify = 1;
+      halBsKeyUpTime[idx] = now;
+      evt = HAL_BS_KEY_EVT_RELEASE;
+
+      /* Only a short press counts as the first click of a double-click */
+      if (!(halBsKeyLongSent & key))
+      {
+        halBsKeyClicked |= key;
+      }
     }
-  }
-  else
-  {
-    /* Key interrupt handled here */
-    if (keys)
+    else if ((keys & key) && !(halBsKeyLongSent & key) &&
+             ((now - halBsKeyDownTime[idx]) >= halBsKeyLongTime[idx]))
     {
-      notify = 1;
+      halBsKeyLongSent |= key;
+      evt = HAL_BS_KEY_EVT_LONG;
+    }
+
+    /* Invoke Callback once per event, a double-click following its press */
+    if (evt && (pHalBsKeyProcessFunction))
+    {
+      uint8 bit;
+
+      for (bit = HAL_BS_KEY_EVT_PRESS; bit != 0; bit <<= 1)
+      {
+        if (evt & bit)
+        {
+          (pHalBsKeyProcessFunction) (key, bit);
+        }
+      }
     }
   }
 
   /* Store the current keys for comparation next time */
   halBsKeySavedKeys = keys;
 
-  /* Invoke Callback if new keys were depressed */
-  if (notify && (pHalBsKeyProcessFunction))
+  /* In interrupt mode, keep scanning only while a key is held (the polling mode has its own timer) */
+  if (Hal_BsKeyIntEnable && keys)
   {
-    (pHalBsKeyProcessFunction) (keys, HAL_BS_KEY_STATE_NORMAL);
-
+    osal_start_timerEx (Hal_TaskID, HAL_BS_KEY_EVENT, HAL_BS_KEY_SCAN_PERIOD);
   }
 }
 
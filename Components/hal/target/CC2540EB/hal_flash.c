@@ -119,6 +119,34 @@ void HalFlashRead(uint8 pg, uint16 offset, uint8 *buf, uint16 cnt)
 void HalFlashWrite(uint16 addr, uint8 *buf, uint16 cnt)
 {
 #if (defined HAL_DMA) && (HAL_DMA == TRUE)
+  HalFlashWriteStart(addr, buf, cnt);
+  while (FCTL & 0x80);  // Wait until writing is done.
+#endif
+}
+
+#if (defined HAL_DMA) && (HAL_DMA == TRUE)
+/**************************************************************************************************
+ * @fn          HalFlashWriteStart
+ *
+ * @brief       This function starts the DMA write of 'cnt' 4-byte blocks to the internal flash
+ *              and returns without waiting for it: the write is done once FCTL.BUSY (bit 7)
+ *              clears, and another write or an erase must not be started before.
+ *
+ * input parameters
+ *
+ * @param       addr - Valid HAL flash write address: actual addr / 4 and quad-aligned.
+ * @param       buf - Valid buffer space at least as big as 'cnt' X 4, untouched until written.
+ * @param       cnt - Number of 4-byte blocks to write.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ **************************************************************************************************
+ */
+void HalFlashWriteStart(uint16 addr, uint8 *buf, uint16 cnt)
+{
   halDMADesc_t *ch = HAL_NV_DMA_GET_DESC();
 
   HAL_DMA_SET_SOURCE(ch, buf);
@@ -140,9 +168,8 @@ void HalFlashWrite(uint16 addr, uint8 *buf, uint16 cnt)
   FADDRL = (uint8)addr;
   FADDRH = (uint8)(addr >> 8);
   FCTL |= 0x02;         // Trigger the DMA writes.
-  while (FCTL & 0x80);  // Wait until writing is done.
-#endif
 }
+#endif
 
 /**************************************************************************************************
  * @fn          HalFlashErase
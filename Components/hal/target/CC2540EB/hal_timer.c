@@ -214,6 +214,16 @@
 #define TCNH_T4OVF    &(X_T4CTL)   
 #define TCHN_T4OVFBIT T34CTL_OVFIM   
 #define TCHN_T4INTBIT IEN1_T4IE   
+
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE)
+/* PWM frame: Timer1 @ 32MHz/128 = 250kHz, modulo T1CC0 */
+#define HAL_PWM_TICKS       ((uint16)HAL_TIMER_PWM_FRAME_MS * 250)
+#define HAL_PWM_DUTY_FULL   (HAL_PWM_TICKS - 1)
+#define HAL_PWM_FRAC        7       /* Fractional bits of a fading level */
+
+#define T1STAT_OVFIF        0x20
+#define T1STAT_CHIF(ch)     BV((ch) + 1)    /* PWM channel n runs on Timer1 channel n+1 */
+#endif
    
 /*********************************************************************  
  * TYPEDEFS  
@@ -240,12 +250,45 @@ typedef struct
   uint8 ovfbit;   
   uint8 intbit;   
 } halTimerChannel_t;   
+
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE)
+typedef struct
+{
+  uint16 level;     /* Current level, HAL_PWM_FRAC fractional bits */
+  int16  step;      /* Level change per frame */
+  uint16 frames;    /* Frames left in the fade */
+  uint16 duty;      /* Compare value of the running frame, 0 = off */
+  uint16 next;      /* Compare value of the next frame */
+  uint8  target;
+  uint8  pin;
+} halTimerPwmCh_t;
+#endif
    
 /*********************************************************************  
  * GLOBAL VARIABLES  
  */   
 static halTimerSettings_t halTimerRecord[HW_TIMER_MAX];   
 static halTimerChannel_t  halTimerChannel[HW_TIMER_MAX];   
+
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE)
+/* Level (index x 4) to compare value, gamma 2.2 */
+static CODE const uint16 halTimerPwmGamma[65] =
+{
+     0,    0,    1,    1,    3,    5,    7,   10,
+    13,   17,   21,   26,   31,   37,   44,   51,
+    59,   68,   77,   86,   97,  108,  119,  131,
+   144,  158,  172,  187,  203,  219,  236,  253,
+   272,  291,  311,  331,  352,  374,  397,  420,
+   444,  469,  494,  521,  548,  575,  604,  633,
+   663,  694,  726,  758,  791,  825,  859,  895,
+   931,  968, 1006, 1044, 1084, 1124, 1165, 1206,
+  HAL_PWM_DUTY_FULL
+};
+
+static halTimerPwmCh_t halTimerPwmCh[HAL_TIMER_PWM_MAX_CH];
+static uint8 halTimerPwmNumCh;
+static uint8 halTimerPwmPins;
+#endif
    
 /*********************************************************************  
  * FUNCTIONS - External  
@@ -263,6 +306,12 @@ uint8 halTimerRemap (uint8 timerId);
 void halProcessTimer1 (void);   
 void halProcessTimer3 (void);   
 void halProcessTimer4 (void);   
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE)
+static uint16 halTimerPwmDuty (uint8 level);
+static void halTimerPwmLoad (uint8 ch, uint16 duty);
+static void halTimerPwmFrame (void);
+static void halTimerPwmIsr (void);
+#endif
    
    
 /*********************************************************************  
@@ -837,6 +886,281 @@ void halProcessTimer4 (void)
   }   
 }   
    
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE)
+/***************************************************************************************************
+ * @fn      HalTimerPwmInit
+ *
+ * @brief   Run Timer1 in modulo mode as the PWM frame clock.  The light pins are not on Timer1
+ *          output pins, so every frame the overflow sets the active pins and the compare of each
+ *          channel clears its own pin.  Fades are stepped from the overflow interrupt, no OSAL
+ *          event or timer is involved.
+ *
+ * @param   pins  - Port 1 pin mask of each channel, pins already configured as outputs
+ *          numCh - number of channels, up to HAL_TIMER_PWM_MAX_CH
+ *
+ * @return  Status - OK or Not OK
+ ***************************************************************************************************/
+uint8 HalTimerPwmInit (const uint8 *pins, uint8 numCh)
+{
+  uint8 ch;
+
+  if ((numCh == 0) || (numCh > HAL_TIMER_PWM_MAX_CH))
+  {
+    return HAL_TIMER_PARAMS_ERROR;
+  }
+
+  /* Keep HalTimerTick from polling Timer1 */
+  HalTimerConfig (HAL_TIMER_3, HAL_TIMER_MODE_CTC, HAL_TIMER_CHANNEL_SINGLE,
+                  HAL_TIMER_CH_MODE_OVERFLOW, TRUE, NULL);
+  halTimerSetOpMode (HW_TIMER_1, HAL_TIMER_MODE_STOP);
+
+  halTimerPwmNumCh = 0;
+  halTimerPwmPins = 0;
+  for (ch = 0; ch < numCh; ch++)
+  {
+    halTimerPwmCh[ch].level  = 0;
+    halTimerPwmCh[ch].frames = 0;
+    halTimerPwmCh[ch].duty   = 0;
+    halTimerPwmCh[ch].next   = 0;
+    halTimerPwmCh[ch].target = 0;
+    halTimerPwmCh[ch].pin    = pins[ch];
+    halTimerPwmPins |= pins[ch];
+    halTimerPwmLoad (ch, 0);
+  }
+  P1 &= ~halTimerPwmPins;
+
+  T1CCTL0 = 0;
+  T1CC0L = LO_UINT16 (HAL_PWM_TICKS - 1);
+  T1CC0H = HI_UINT16 (HAL_PWM_TICKS - 1);
+  T1CNTL = 0;     /* Any write clears the counter */
+  T1STAT = 0;
+  TIMIF |= TIMIF_T1OVFIM;
+
+  halTimerPwmNumCh = numCh;
+  halTimerSetPrescale (HW_TIMER_1, HAL_TIMER1_16_TC_DIV128);
+  halTimerSetOpMode (HW_TIMER_1, HAL_TIMER_MODE_CTC);
+  IEN1 |= IEN1_T1IE;
+
+  return HAL_TIMER_OK;
+}
+
+/***************************************************************************************************
+ * @fn      HalTimerPwmSet
+ *
+ * @brief   Start a linear fade of the level, the gamma table turns it into a perceptually even
+ *          change of brightness.  A new fade starts from wherever the running one got to.
+ *
+ * @param   channel - PWM channel
+ *          level   - 0 (off) to HAL_TIMER_PWM_LEVEL_MAX (fully on)
+ *          fadeMs  - fade time in msec
+ *
+ * @return  Status - OK or Not OK
+ ***************************************************************************************************/
+uint8 HalTimerPwmSet (uint8 channel, uint8 level, uint16 fadeMs)
+{
+  halTimerPwmCh_t *pCh;
+  halIntState_t intState;
+  uint16 frames;
+  int16 diff;
+
+  if (channel >= halTimerPwmNumCh)
+  {
+    return HAL_TIMER_PARAMS_ERROR;
+  }
+
+  pCh = &halTimerPwmCh[channel];
+  frames = fadeMs / HAL_TIMER_PWM_FRAME_MS;
+  if (frames == 0)
+  {
+    frames = 1;
+  }
+
+  HAL_ENTER_CRITICAL_SECTION (intState);
+  pCh->level &= ~((1 << HAL_PWM_FRAC) - 1);
+  diff = (int16)level - (int16)(pCh->level >> HAL_PWM_FRAC);
+  pCh->step = (int16)(diff << HAL_PWM_FRAC) / (int16)frames;
+  pCh->target = level;
+  pCh->frames = frames;
+  HAL_EXIT_CRITICAL_SECTION (intState);
+
+  return HAL_TIMER_OK;
+}
+
+/***************************************************************************************************
+ * @fn      HalTimerPwmGet
+ *
+ * @brief   Level a PWM channel is at or fading to
+ *
+ * @param   channel - PWM channel
+ *
+ * @return  level
+ ***************************************************************************************************/
+uint8 HalTimerPwmGet (uint8 channel)
+{
+  return (channel < halTimerPwmNumCh) ? halTimerPwmCh[channel].target : 0;
+}
+
+/***************************************************************************************************
+ * @fn      halTimerPwmDuty
+ *
+ * @brief   Gamma corrected compare value of a level, interpolated between table entries
+ *
+ * @param   level - 0 to HAL_TIMER_PWM_LEVEL_MAX
+ *
+ * @return  compare value, 0 = off
+ ***************************************************************************************************/
+static uint16 halTimerPwmDuty (uint8 level)
+{
+  uint8 idx = level >> 2;
+  uint16 duty;
+
+  if (level == HAL_TIMER_PWM_LEVEL_MAX)
+  {
+    return HAL_PWM_DUTY_FULL;
+  }
+
+  duty = halTimerPwmGamma[idx];
+  duty += ((halTimerPwmGamma[idx + 1] - duty) * (level & 0x03)) >> 2;
+
+  /* The lowest levels still give the shortest pulse */
+  return ((duty == 0) && (level != 0)) ? 1 : duty;
+}
+
+/***************************************************************************************************
+ * @fn      halTimerPwmLoad
+ *
+ * @brief   Program the compare value of a channel and mask its interrupt while it is off
+ *
+ * @param   ch   - PWM channel
+ *          duty - compare value
+ *
+ * @return  None
+ ***************************************************************************************************/
+static void halTimerPwmLoad (uint8 ch, uint16 duty)
+{
+  uint8 cctl = (duty) ? (T134CCTL_MODE | T134CCTL_IM) : T134CCTL_MODE;
+
+  halTimerPwmCh[ch].duty = duty;
+  switch (ch)
+  {
+    case 0:
+      T1CC1L = LO_UINT16 (duty);
+      T1CC1H = HI_UINT16 (duty);
+      T1CCTL1 = cctl;
+      break;
+    case 1:
+      T1CC2L = LO_UINT16 (duty);
+      T1CC2H = HI_UINT16 (duty);
+      T1CCTL2 = cctl;
+      break;
+    case 2:
+      T1CC3L = LO_UINT16 (duty);
+      T1CC3H = HI_UINT16 (duty);
+      T1CCTL3 = cctl;
+      break;
+    case 3:
+      T1CC4L = LO_UINT16 (duty);
+      T1CC4H = HI_UINT16 (duty);
+      T1CCTL4 = cctl;
+      break;
+    default:
+      break;
+  }
+}
+
+/***************************************************************************************************
+ * @fn      halTimerPwmFrame
+ *
+ * @brief   Start of a PWM frame: switch on every lit pin with one Port 1 write, then advance the
+ *          fades.  A new compare value is only loaded here for a channel that is off; a running
+ *          channel picks it up at its own compare, after this frame's edge.
+ *
+ * @param   None
+ *
+ * @return  None
+ ***************************************************************************************************/
+static void halTimerPwmFrame (void)
+{
+  halTimerPwmCh_t *pCh;
+  uint8 on = 0;
+  uint8 ch;
+
+  for (ch = 0; ch < halTimerPwmNumCh; ch++)
+  {
+    if (halTimerPwmCh[ch].duty)
+    {
+      on |= halTimerPwmCh[ch].pin;
+    }
+  }
+  P1 = (P1 & ~halTimerPwmPins) | on;
+
+  for (ch = 0; ch < halTimerPwmNumCh; ch++)
+  {
+    pCh = &halTimerPwmCh[ch];
+    if (pCh->frames)
+    {
+      if (--pCh->frames == 0)
+      {
+        pCh->level = (uint16)pCh->target << HAL_PWM_FRAC;
+      }
+      else
+      {
+        pCh->level += pCh->step;
+      }
+      pCh->next = halTimerPwmDuty ((uint8)(pCh->level >> HAL_PWM_FRAC));
+
+      if (pCh->duty == 0)
+      {
+        halTimerPwmLoad (ch, pCh->next);
+      }
+    }
+  }
+}
+
+/***************************************************************************************************
+ * @fn      halTimerPwmIsr
+ *
+ * @brief   Timer1 interrupt while PWM is running.  Overflow is served before the compares
+ *          flagged with it, so a short pulse is never cut before it is switched on.
+ *
+ * @param   None
+ *
+ * @return  None
+ ***************************************************************************************************/
+static void halTimerPwmIsr (void)
+{
+  halTimerPwmCh_t *pCh;
+  uint8 stat;
+  uint8 ch;
+
+  while ((stat = T1STAT) != 0)
+  {
+    T1STAT = ~stat;   /* Flags clear on writing 0 */
+
+    if (stat & T1STAT_OVFIF)
+    {
+      halTimerPwmFrame ();
+    }
+
+    for (ch = 0; ch < halTimerPwmNumCh; ch++)
+    {
+      pCh = &halTimerPwmCh[ch];
+      if ((stat & T1STAT_CHIF(ch)) && pCh->duty)
+      {
+        if (pCh->duty != HAL_PWM_DUTY_FULL)
+        {
+          P1 &= ~pCh->pin;
+        }
+        if (pCh->next != pCh->duty)
+        {
+          halTimerPwmLoad (ch, pCh->next);
+        }
+      }
+    }
+  }
+}
+#endif
+
 /***************************************************************************************************  
  *                                    INTERRUPT SERVICE ROUTINE  
  ***************************************************************************************************/   
@@ -852,6 +1176,13 @@ void halProcessTimer4 (void)
  **************************************************************************************************/   
 HAL_ISR_FUNCTION( halTimer1Isr, T1_VECTOR )   
 {   
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE)
+  if (halTimerPwmNumCh)
+  {
+    halTimerPwmIsr ();
+    return;
+  }
+#endif
   halProcessTimer1 ();   
 }   
    
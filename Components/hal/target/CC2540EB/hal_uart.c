@@ -49,6 +49,11 @@
 #if defined POWER_SAVING
 #include "OSAL.h"
 #include "OSAL_PwrMgr.h"
+#elif HAL_UART_STATS
+#include "OSAL.h"
+#endif
+#if HAL_UART_STATS
+#include <string.h>
 #endif
 
 /*********************************************************************
@@ -352,6 +357,39 @@ uint16 Hal_UART_RxBufLen( uint8 port )
 #endif
 }
 
+#if HAL_UART_STATS
+/******************************************************************************
+ * @fn      HalUARTGetStats
+ *
+ * @brief   Copy the run-time counters of a port and optionally clear them.
+ *
+ * @param   port - UART port
+ *          pStats - pointer to the counters to fill in
+ *          clear - TRUE to restart the counting from zero
+ *
+ * @return  None
+ *****************************************************************************/
+void HalUARTGetStats(uint8 port, halUARTStats_t *pStats, bool clear)
+{
+  (void)memset(pStats, 0, sizeof(halUARTStats_t));
+
+#if (HAL_UART_DMA == 1)
+  if (port == HAL_UART_PORT_0)  HalUARTStatsDMA(pStats, clear);
+#endif
+#if (HAL_UART_DMA == 2)
+  if (port == HAL_UART_PORT_1)  HalUARTStatsDMA(pStats, clear);
+#endif
+#if (HAL_UART_ISR == 1)
+  if (port == HAL_UART_PORT_0)  HalUARTStatsISR(pStats, clear);
+#endif
+#if (HAL_UART_ISR == 2)
+  if (port == HAL_UART_PORT_1)  HalUARTStatsISR(pStats, clear);
+#endif
+  (void)port;
+  (void)clear;
+}
+#endif
+
 void HalUARTIsrDMA(void)
 {
 #if (HAL_UART_DMA && HAL_UART_SPI)  // When both are defined, port is run-time choice.
@@ -39,7 +39,6 @@
 /******************************************************************************
  * INCLUDES
  */
-#include "osal.h"
 #include "hal_aes.h"
 #include "hal_dma.h"
 
@@ -49,8 +49,6 @@
  * MACROS
  */
 
-#define	YearLength(yr)	(IsLeapYear(yr) ? 366 : 365)
-
 /*********************************************************************
  * CONSTANTS
  */
@@ -63,6 +61,8 @@
 
 #define	DAY             86400UL  // 24 hours * 60 minutes * 60 seconds
 
+#define MARCH_1ST       60       // days from 1 January 2000 to 1 March 2000
+
 /*********************************************************************
  * TYPEDEFS
  */
@@ -94,8 +94,6 @@ UTCTime OSAL_timeSeconds = 0;
 /*********************************************************************
  * LOCAL FUNCTION PROTOTYPES
  */
-static uint8 monthLength( uint8 lpyr, uint8 mon );
-
 static void osalClockUpdate( uint16 elapsedMSec );
 
 /*********************************************************************
@@ -240,55 +238,27 @@ void osal_ConvertUTCTime( UTCTimeStruct *tm, UTCTime secTime )
   // Fill in the calendar - day, month, year
   {
     uint16 numDays = secTime / DAY;
-    tm->year = BEGYEAR;
-    while ( numDays >= YearLength( tm->year ) )
-    {
-      numDays -= YearLength( tm->year );
-      tm->year++;
-    }
-
-    tm->month = 0;
-    while ( numDays >= monthLength( IsLeapYear( tm->year ), tm->month ) )
-    {
-      numDays -= monthLength( IsLeapYear( tm->year ), tm->month );
-      tm->month++;
-    }
-
-    tm->day = numDays;
-  }
-}
-
-/*********************************************************************
- * @fn      monthLength
- *
- * @param   lpyr - 1 for leap year, 0 if not
- *
- * @param   mon - 0 - 11 (jan - dec)
- *
- * @return  number of days in specified month
- */
-static uint8 monthLength( uint8 lpyr, uint8 mon )
-{
-  uint8 days = 31;
 
-  if ( mon == 1 ) // feb
-  {
-    days = ( 28 + lpyr );
-  }
-  else
-  {
-    if ( mon > 6 ) // aug-dec
+    if ( numDays < MARCH_1ST )
     {
-      mon--;
+      tm->year = BEGYEAR;
+      tm->month = ( numDays >= 31 );
+      tm->day = numDays - ( tm->month * 31 );
     }
-
-    if ( mon & 1 )
+    else
     {
-      days = 30;
+      // Closed form over years counted from 1 March 2000 (see OSAL_UTC_DAYS):
+      // yoe - complete years, doy - day in the year, mp - month from March
+      uint16 doe = numDays - MARCH_1ST;
+      uint16 yoe = ( doe - doe / 1460 + doe / 36524 ) / 365;
+      uint16 doy = doe - OSAL_UTC_YEAR_DAYS( yoe );
+      uint8 mp = ( 5 * doy + 2 ) / 153;
+
+      tm->day = doy - ( 153 * mp + 2 ) / 5;
+      tm->month = ( mp < 10 ) ? ( mp + 2 ) : ( mp - 10 );
+      tm->year = BEGYEAR + yoe + ( mp >= 10 );
     }
   }
-
-  return ( days );
 }
 
 /*********************************************************************
@@ -307,32 +277,8 @@ UTCTime osal_ConvertUTCSecs( UTCTimeStruct *tm )
   /* Seconds for the partial day */
   seconds = (((tm->hour * 60UL) + tm->minutes) * 60UL) + tm->seconds;
 
-  /* Account for previous complete days */
-  {
-    /* Start with complete days in current month */
-    uint16 days = tm->day;
-
-    /* Next, complete months in current year */
-    {
-      int8 month = tm->month;
-      while ( --month >= 0 )
-      {
-        days += monthLength( IsLeapYear( tm->year ), month );
-      }
-    }
-
-    /* Next, complete years before current year */
-    {
-      uint16 year = tm->year;
-      while ( --year >= BEGYEAR )
-      {
-        days += YearLength( year );
-      }
-    }
-
-    /* Add total seconds before partial day */
-    seconds += (days * DAY);
-  }
+  /* Add total seconds of the complete days before */
+  seconds += ( OSAL_UTC_DAYS( tm->year, tm->month, tm->day ) * DAY );
 
   return ( seconds );
 }
@@ -55,6 +55,22 @@ extern "C"
 
 #define	IsLeapYear(yr)	(!((yr) % 400) || (((yr) % 100) && !((yr) % 4)))
 
+// Days from 1 January 2000 to yr/mon/day (mon 0-11, day 0-30) in closed form,
+// so constant arguments fold at compile time.  Years are counted from March,
+// which puts the leap day at their end; January and February 2000 come before
+// the first of them.  Valid through 2136, the range of UTCTime.
+#define OSAL_UTC_MARCH_YEAR(yr, mon)  ((uint16)((yr) - 2000 - ((mon) < 2)))
+#define OSAL_UTC_YEAR_DAYS(yoe)       ((uint16)(yoe) * 365U + (uint16)(yoe) / 4 - (uint16)(yoe) / 100)
+#define OSAL_UTC_DAYS(yr, mon, day)                                          \
+  ( (((yr) == 2000) && ((mon) < 2)) ? (uint16)((mon) * 31 + (day)) :         \
+    (uint16)(60 + OSAL_UTC_YEAR_DAYS( OSAL_UTC_MARCH_YEAR( yr, mon ) ) +    \
+             (153 * (((mon) + 10) % 12) + 2) / 5 + (day)) )
+
+// Seconds from 00:00:00 1 January 2000 to the given date and time
+#define OSAL_UTC_SECS(yr, mon, day, hr, min, sec)                            \
+  ( (UTCTime)OSAL_UTC_DAYS( yr, mon, day ) * 86400UL +                       \
+    (((hr) * 60UL) + (min)) * 60UL + (sec) )
+
 /*********************************************************************
  * CONSTANTS
  */
@@ -76,6 +76,8 @@
 
 #include "hal_bs_key.h"
 #include "parsingData.h"
+#include "lightJournal.h"
+#include "lightStats.h"
 
 /*********************************************************************
  * MACROS
@@ -125,6 +127,12 @@
 #define RESET_EVT_TIMER                                      10000
 #define FIND_PHONE_INDEX                                      11
 
+// The controller holds a single link; releasing it after this many msec without
+// a command lets the next phone in. 0 keeps the link until the phone drops it.
+#if !defined BS_LINK_IDLE_TIMEOUT
+#define BS_LINK_IDLE_TIMEOUT                                  0
+#endif
+
 
 /*********************************************************************
  * TYPEDEFS
@@ -151,15 +159,8 @@ static uint8 BSBLEPeripheral_TaskID;
 static bool isOperatedDevilAlarm = false;
 static bool isAbsenceMode = false;
 
-static bool isResetEvent = false;
-static bool isFindPhoneEvent = false;
 static bool isFindingPhoneEvent = false;
 
-//static bool is1BtnPressed = false;
-//static bool is2BtnPressed = false;
-static bool is3BtnPressed = false;
-static bool is4BtnPressed = false;
-
 static gaprole_States_t gapProfileState = GAPROLE_INIT;
 
 // GAP GATT Attributes
@@ -230,9 +231,10 @@ static uint8 advertData[] =
  * LOCAL FUNCTIONS
  */
 static void BSBLEPeripheral_ProcessOSALMsg( osal_event_hdr_t *pMsg );
-static void BSBLEPeripheral_HandleKeys( uint8 shift, uint8 keys );
+static void BSBLEPeripheral_HandleKeys( uint8 event, uint8 keys );
 static void peripheralStateNotificationCB( gaprole_States_t newState );
-static void BSProfileChangeCB(uint8 paramID, uint8* pData, uint8 pLength);
+static void BSProfileChangeCB(uint16 connHandle, uint8 paramID, uint8* pData, uint8 pLength);
+static void restartLinkIdleTimer( void );
 static void performCheckPeriodicTask( void );
 static void initGapProfile( void );
 static void initGattAttribute( void );
@@ -458,13 +460,7 @@ static void initPort( void ) {
   //P1_7 = 0;
   //P2 = 0;   // All pins on port 2 to low
   
-  PORT_LIGHT_ONE = 0;
-  PORT_LIGHT_TWO = 0;  
-  PORT_LIGHT_THREE = 0 ;
-  
-  PORT_LED_ONE = 0;
-  PORT_LED_TWO = 0;
-  PORT_LED_THREE = 0;
+  initLightPort();
 }
 
 /*********************************************************************
@@ -492,6 +488,11 @@ void BSBLEPeripheral_Init( uint8 task_id )
   
   RegisterForKeys( BSBLEPeripheral_TaskID );
   
+  // Holding BTN1/BTN2 recalls scene 0/1 (default long press time),
+  // holding BTN3 finds the phone, holding BTN4 resets the device
+  HalBsKeySetLongPress( HAL_BS_KEY_BTN3, FIND_PHONE_EVT_TIMER );
+  HalBsKeySetLongPress( HAL_BS_KEY_BTN4, RESET_EVT_TIMER );
+  
   // Enable clock divide on halt
   // This reduces active current while radio is active and CC254x MCU
   // is halted
@@ -519,6 +520,8 @@ uint16 BSBLEPeripheral_ProcessEvent( uint8 task_id, uint16 events )
 
   VOID task_id; // OSAL required parameter that isn't used in this function
 
+  lightStats_Event();
+
   if ( events & SYS_EVENT_MSG )
   {
     uint8 *pMsg;
@@ -568,6 +571,14 @@ uint16 BSBLEPeripheral_ProcessEvent( uint8 task_id, uint16 events )
     return (events ^ BBP_GAP_ADVERT_TIME_OUT_EVT);
   }
   
+  if( events & BBP_LINK_IDLE_EVT ) 
+  {
+    // the advertising restarts once the link is gone
+    GAPRole_TerminateConnection();
+    
+    return (events ^ BBP_LINK_IDLE_EVT);
+  }
+  
   if( events & BBP_GAP_DISCONNECT_EVT ) 
   {
     //GAPRole_TerminateConnection();
@@ -589,26 +600,6 @@ uint16 BSBLEPeripheral_ProcessEvent( uint8 task_id, uint16 events )
     return ( events ^ BBP_CHECK_PERIODIC_EVT );
   }
   
-  if( events & BBP_RESET_EVT )
-  { 
-    if( isResetEvent ) 
-      HAL_SYSTEM_RESET();
-    return ( events ^ BBP_RESET_EVT );
-  }
-  
-  if( events & BBP_FIND_PHONE_EVT )
-  {
-    if( isFindPhoneEvent ) {
-      isFindingPhoneEvent = true;
-
-      advertData[FIND_PHONE_INDEX] = 1;
-      GAPRole_SetParameter( GAPROLE_ADVERT_DATA, sizeof( advertData ), advertData );
-      
-      osal_start_timerEx( BSBLEPeripheral_TaskID, BBP_FIND_PHONE_END_EVT, FIND_PHONE_END_EVT_TIMER );
-    }
-    return ( events ^ BBP_FIND_PHONE_EVT );
-  }
-  
   if( events & BBP_FIND_PHONE_END_EVT )
   {
     if(isFindingPhoneEvent) {
@@ -665,6 +656,7 @@ static void BSBLEPeripheral_ProcessOSALMsg( osal_event_hdr_t *pMsg )
   {
     case KEY_CHANGE:
       BSBLEPeripheral_HandleKeys( ((keyChange_t *)pMsg)->state, ((keyChange_t *)pMsg)->keys );
+      lightJournal_Record( JOURNAL_SRC_BUTTON );
     break;
     
     default:
@@ -678,65 +670,62 @@ static void BSBLEPeripheral_ProcessOSALMsg( osal_event_hdr_t *pMsg )
  *
  * @brief   Handles all key events for this device.
  *
- * @param   shift - true if in shift/alt.
- * @param   keys - bit field for key events. Valid entries:
- *                 HAL_KEY_SW_2
- *                 HAL_KEY_SW_1
+ * @param   event - key event: HAL_BS_KEY_EVT_PRESS, HAL_BS_KEY_EVT_RELEASE,
+ *                  HAL_BS_KEY_EVT_LONG or HAL_BS_KEY_EVT_DOUBLE.
+ * @param   keys - key of the event: HAL_BS_KEY_BTN1 .. HAL_BS_KEY_BTN4
  *
  * @return  none
  */
-static void BSBLEPeripheral_HandleKeys( uint8 shift, uint8 keys )
+static void BSBLEPeripheral_HandleKeys( uint8 event, uint8 keys )
 {
-  (void)shift; // Intentionally unreferenced parameter
-  
-  if ( keys & HAL_BS_KEY_BTN1 )
+  if ( event == HAL_BS_KEY_EVT_LONG )
   {
-    if(isLightOneOn()) {
-      setLightOneOff();
-      setLedOneOn();
+    if ( keys & HAL_BS_KEY_BTN1 )
+    {
+      recallScene( 0 );
     }
-    else {
-      setLightOneOn();
-      setLedOneOff();
+    
+    if ( keys & HAL_BS_KEY_BTN2 )
+    {
+      recallScene( 1 );
+    }
+    
+    if ( (keys & HAL_BS_KEY_BTN3) && !isFindingPhoneEvent )
+    {
+      isFindingPhoneEvent = true;
+
+      advertData[FIND_PHONE_INDEX] = 1;
+      GAPRole_SetParameter( GAPROLE_ADVERT_DATA, sizeof( advertData ), advertData );
+      
+      osal_start_timerEx( BSBLEPeripheral_TaskID, BBP_FIND_PHONE_END_EVT, FIND_PHONE_END_EVT_TIMER );
     }
+    
+    if ( keys & HAL_BS_KEY_BTN4 )
+    {
+      HAL_SYSTEM_RESET();
+    }
+    return;
   }
   
-  if ( keys & HAL_BS_KEY_BTN2 )
+  // Only a press toggles the lights
+  if ( event != HAL_BS_KEY_EVT_PRESS )
   {
-    if(isLightTwoOn()) {
-      setLightTwoOff();
-      setLedTwoOn();
-    }
-    else {
-      setLightTwoOn();
-      setLedTwoOff();
-    }
+    return;
   }
   
-  if ( keys & HAL_BS_KEY_BTN3 )
+  if ( keys & HAL_BS_KEY_BTN1 )
   {
-    is3BtnPressed = true;
-    isFindPhoneEvent = true;
-    
-    if(!isFindingPhoneEvent)
-      osal_start_timerEx( BSBLEPeripheral_TaskID, BBP_FIND_PHONE_EVT, FIND_PHONE_EVT_TIMER  );
-    
-    if(isLightThreeOn()) {
-      setLightThreeOff();
-      setLedThreeOn();
-    }
-    else {
-      setLightThreeOn();
-      setLedThreeOff();
-    }
+    toggleLights(LIGHT_BIT(0));
   }
   
-  if( is3BtnPressed && !(keys & HAL_BS_KEY_BTN3) )
+  if ( keys & HAL_BS_KEY_BTN2 )
   {
-    is3BtnPressed = false;
-    isFindPhoneEvent = false;
-    
-    osal_stop_timerEx( BSBLEPeripheral_TaskID, BBP_FIND_PHONE_EVT );
+    toggleLights(LIGHT_BIT(1));
+  }
+  
+  if ( keys & HAL_BS_KEY_BTN3 )
+  {
+    toggleLights(LIGHT_BIT(2));
   }
   
   if ( keys & HAL_BS_KEY_BTN4 )
@@ -750,34 +739,8 @@ static void BSBLEPeripheral_HandleKeys( uint8 shift, uint8 keys )
       isOperatedDevilAlarm = false;
     }
     
-    is4BtnPressed = true;
-    isResetEvent = true;
-    
-    osal_start_timerEx( BSBLEPeripheral_TaskID, BBP_RESET_EVT, RESET_EVT_TIMER );
-    
-    if(isLightThreeOn() && isLightTwoOn() && isLightOneOn()) {
-      setLightOneOff();
-      setLedOneOn();
-      setLightTwoOff();
-      setLedTwoOn();
-      setLightThreeOff();
-      setLedThreeOn();
-    } else {
-      setLightOneOn();
-      setLedOneOff();
-      setLightTwoOn();
-      setLedTwoOff();
-      setLightThreeOn();
-      setLedThreeOff();
-    }
-  }
-  
-  if( is4BtnPressed && !(keys & HAL_BS_KEY_BTN4) )
-  {
-    is4BtnPressed = false;
-    isResetEvent = false;
-    
-    osal_stop_timerEx( BSBLEPeripheral_TaskID, BBP_RESET_EVT );
+    // all on turns all off, anything else turns all on
+    setLightState((getLightState() == LIGHT_ALL) ? 0 : LIGHT_ALL);
   }
 }
 
@@ -818,6 +781,7 @@ static void peripheralStateNotificationCB( gaprole_States_t newState )
 
     case GAPROLE_CONNECTED:
       {
+        restartLinkIdleTimer();
         //BSProfile_AddService( GATT_ALL_SERVICES );      // BS GATT Profile
 
         //setCharacteristicNotification(true);
@@ -832,6 +796,7 @@ static void peripheralStateNotificationCB( gaprole_States_t newState )
     case GAPROLE_WAITING:
       {
         isOperatedDevilAlarm = false;
+        osal_stop_timerEx( BSBLEPeripheral_TaskID, BBP_LINK_IDLE_EVT );
         /*
         if(bsBLEState == BLE_STATE_CONNECTED) {
           osal_set_event( BSBLEPeripheral_TaskID, BBP_GAP_DISCONNECT_EVT );
@@ -882,8 +847,12 @@ static void peripheralStateNotificationCB( gaprole_States_t newState )
  * @return  none
  */
 
-static void BSProfileChangeCB(uint8 paramID, uint8* pData, uint8 pLength)
+static void BSProfileChangeCB(uint16 connHandle, uint8 paramID, uint8* pData, uint8 pLength)
 {
+  VOID connHandle; // commands from every link are applied in the order they arrive
+  
+  restartLinkIdleTimer();
+  
   switch( paramID )
   {
     case BSPROFILE_CHAR1:
@@ -898,7 +867,10 @@ static void BSProfileChangeCB(uint8 paramID, uint8* pData, uint8 pLength)
         // notifyCharateristicChanged(BSPROFILE_CHAR1);
         //uint8** ppData = &pData;
         
-        parsingDataPacket(pData, pLength);
+        lightStats_CommandIn();
+        if(!parsingDataPacket(pData, pLength)) {
+          lightStats_CommandDrop();
+        }
           
         /*
         SendingToArduinoData* temp = (SendingToArduinoData*) osal_mem_alloc(sizeof(SendingToArduinoData));
@@ -919,6 +891,22 @@ static void BSProfileChangeCB(uint8 paramID, uint8* pData, uint8 pLength)
   }
 }
 
+/*********************************************************************
+ * @fn      restartLinkIdleTimer
+ *
+ * @brief   Count the idle time of the link from now on.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void restartLinkIdleTimer( void )
+{
+#if BS_LINK_IDLE_TIMEOUT > 0
+  osal_start_timerEx( BSBLEPeripheral_TaskID, BBP_LINK_IDLE_EVT, BS_LINK_IDLE_TIMEOUT );
+#endif
+}
+
 uint8 Application_StartAdvertise(uint16 duration, uint16 interval)
 {
   (void) duration;
@@ -59,8 +59,7 @@ extern "C"
 #define BBP_GAP_ADVERT_TIME_OUT_EVT                       0x0004
 #define BBP_GAP_DISCONNECT_EVT                            0x0008
 #define BBP_CHECK_PERIODIC_EVT                            0x0010
-#define BBP_RESET_EVT                                     0x0020
-#define BBP_FIND_PHONE_EVT                                0x0040
+#define BBP_LINK_IDLE_EVT                                 0x0020
 #define BBP_FIND_PHONE_END_EVT                            0x0080
   
 /*******************************************************************************
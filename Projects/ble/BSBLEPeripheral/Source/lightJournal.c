@@ -0,0 +1,247 @@
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "OSAL_Clock.h"
+#include "hal_flash.h"
+
+#include "BSGATTprofile.h"
+#include "parsingData.h"
+#include "lightJournal.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Every page starts with a header word pair, so a page left over from older code is never read as entries
+#define JOURNAL_PAGE_MAGIC              0x314A5342UL  // "BSJ1"
+#define JOURNAL_ENTRY_SIZE              8             // two flash words
+#define JOURNAL_ENTRIES_PER_PAGE        ((HAL_FLASH_PAGE_SIZE / JOURNAL_ENTRY_SIZE) - 1)
+#define JOURNAL_SEQ_ERASED              0xFFFF        // erased flash, never used as a sequence
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static bool isJournalPage(uint8 idx);
+static uint16 readSeq(uint8 idx, uint8 slot);
+static uint16 getEntryOffset(uint8 slot);
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+#if defined __IAR_SYSTEMS_ICC__
+#pragma location="BSJOURNAL_ADDRESS_SPACE"
+#endif
+__no_init uint8 _journalBuf[JOURNAL_PAGE_CNT * HAL_FLASH_PAGE_SIZE];
+#if defined __IAR_SYSTEMS_ICC__
+#pragma required=_journalBuf
+#endif
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static uint8 journal_TaskID;
+static uint16 journal_SyncEvent;
+
+static uint8 writePage;         // page index (0 - JOURNAL_PAGE_CNT-1) and slot of the next entry
+static uint8 writeSlot;
+static uint16 nextSeq;
+static uint8 lastState = 0;     // lights are off after a reset
+
+static bool isSyncing = FALSE;
+static uint8 syncPage;          // next entry to look at
+static uint8 syncSlot;
+static uint8 syncLeft;          // pages still to walk, the write page last
+static uint16 syncAfterSeq;
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+void lightJournal_Init( uint8 task_id, uint16 syncEvent )
+{
+  uint16 newestSeq = 0;
+  bool isFound = FALSE;
+  uint8 idx, slot;
+
+  journal_TaskID = task_id;
+  journal_SyncEvent = syncEvent;
+
+  writePage = 0;
+  writeSlot = 0;
+
+  for(idx = 0; idx < JOURNAL_PAGE_CNT; idx++) {
+    if(!isJournalPage(idx)) continue;
+
+    for(slot = 0; slot < JOURNAL_ENTRIES_PER_PAGE; slot++) {
+      uint16 seq = readSeq(idx, slot);
+
+      if(seq == JOURNAL_SEQ_ERASED) break; // a page fills from the front
+
+      // the journal spans far fewer than 32768 sequence numbers
+      if(!isFound || (int16)(seq - newestSeq) > 0) {
+        isFound = TRUE;
+        newestSeq = seq;
+        writePage = idx;
+        writeSlot = slot + 1;
+      }
+    }
+  }
+
+  if(isFound) {
+    uint8 state;
+
+    HalFlashRead(JOURNAL_PAGE_BEG + writePage, getEntryOffset(writeSlot - 1) + 3, &state, 1);
+    lastState = state & 0x3F;
+
+    if(writeSlot == JOURNAL_ENTRIES_PER_PAGE) {
+      writePage = (writePage + 1) % JOURNAL_PAGE_CNT;
+      writeSlot = 0;
+    }
+    nextSeq = newestSeq + 1;
+    if(nextSeq == JOURNAL_SEQ_ERASED) nextSeq = 0;
+  }
+  else {
+    nextSeq = 0;
+  }
+}
+
+void lightJournal_Record( uint8 source )
+{
+  uint8 state = getLightState();
+  uint8 entry[JOURNAL_ENTRY_SIZE];
+  uint8 pg = JOURNAL_PAGE_BEG + writePage;
+  UTCTime now = osal_getClock();
+
+  if(state == lastState) return;
+  lastState = state;
+
+  // a full ring drops its oldest page, the other pages keep their entries
+  if(writeSlot == 0) {
+    uint32 magic = JOURNAL_PAGE_MAGIC;
+
+    HalFlashErase(pg);
+    osal_memset(entry, 0, JOURNAL_ENTRY_SIZE);
+    osal_memcpy(entry, &magic, sizeof(magic));
+    HalFlashWrite((uint16)pg << 9, entry, JOURNAL_ENTRY_SIZE / HAL_FLASH_WORD_SIZE);
+  }
+
+  entry[0] = LO_UINT16(nextSeq);
+  entry[1] = HI_UINT16(nextSeq);
+  entry[2] = source;
+  entry[3] = state;
+  osal_memcpy(&entry[4], &now, sizeof(now));
+
+  // one append of two words, nothing written is ever rewritten
+  HalFlashWrite(((uint16)pg << 9) + (getEntryOffset(writeSlot) >> 2), entry,
+                JOURNAL_ENTRY_SIZE / HAL_FLASH_WORD_SIZE);
+
+  if(++writeSlot == JOURNAL_ENTRIES_PER_PAGE) {
+    writePage = (writePage + 1) % JOURNAL_PAGE_CNT;
+    writeSlot = 0;
+  }
+  if(++nextSeq == JOURNAL_SEQ_ERASED) nextSeq = 0;
+}
+
+void lightJournal_StartSync( uint16 afterSeq )
+{
+  // oldest first: the page after the write page, around to the write page
+  syncPage = (writePage + 1) % JOURNAL_PAGE_CNT;
+  syncSlot = 0;
+  syncLeft = JOURNAL_PAGE_CNT;
+  syncAfterSeq = afterSeq;
+  isSyncing = TRUE;
+
+  osal_set_event(journal_TaskID, journal_SyncEvent);
+}
+
+void lightJournal_ProcessSync( void )
+{
+  uint8 packet[3 + (JOURNAL_SYNC_ENTRIES * JOURNAL_SYNC_ENTRY_LEN)];
+  uint8 burst, count;
+
+  if(!isSyncing) return;
+
+  for(burst = 0; burst < JOURNAL_SYNC_BURST; burst++) {
+    uint8 page = syncPage, slot = syncSlot, left = syncLeft;
+
+    count = 0;
+
+    while(count < JOURNAL_SYNC_ENTRIES && syncLeft != 0) {
+      bool isLast = (syncPage == writePage);
+      uint8 end = isLast ? writeSlot : JOURNAL_ENTRIES_PER_PAGE;
+
+      if(syncSlot >= end || !isJournalPage(syncPage)) {
+        syncPage = (syncPage + 1) % JOURNAL_PAGE_CNT;
+        syncSlot = 0;
+        syncLeft--;
+        continue;
+      }
+
+      {
+        uint8 entry[JOURNAL_ENTRY_SIZE];
+        uint8* pOut = &packet[2 + count * JOURNAL_SYNC_ENTRY_LEN];
+        uint16 seq;
+
+        HalFlashRead(JOURNAL_PAGE_BEG + syncPage, getEntryOffset(syncSlot), entry, JOURNAL_ENTRY_SIZE);
+        syncSlot++;
+
+        seq = BUILD_UINT16(entry[0], entry[1]);
+        if(seq == JOURNAL_SEQ_ERASED) continue;
+        if(syncAfterSeq != JOURNAL_SYNC_ALL && (int16)(seq - syncAfterSeq) <= 0) continue;
+
+        pOut[0] = entry[1];
+        pOut[1] = entry[0];
+        pOut[2] = (entry[2] << 6) | (entry[3] & 0x3F);
+        pOut[3] = entry[7];
+        pOut[4] = entry[6];
+        pOut[5] = entry[5];
+        pOut[6] = entry[4];
+        count++;
+      }
+    }
+
+    packet[0] = STX;
+    packet[1] = JOURNAL_SYNC_FLAGS | count;
+    packet[2 + count * JOURNAL_SYNC_ENTRY_LEN] = ETX;
+    if(BSProfile_SetParameter(BSPROFILE_CHAR1, 3 + count * JOURNAL_SYNC_ENTRY_LEN, packet) != SUCCESS ||
+       notifyCharateristicChanged(BSPROFILE_CHAR1) != SUCCESS) {
+      // not sent: the cursor goes back to these entries for the next sync event
+      syncPage = page;
+      syncSlot = slot;
+      syncLeft = left;
+      break;
+    }
+
+    if(count == 0) { // the empty notification closes the sync
+      isSyncing = FALSE;
+      return;
+    }
+  }
+
+  osal_start_timerEx(journal_TaskID, journal_SyncEvent, JOURNAL_SYNC_PERIOD);
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static bool isJournalPage(uint8 idx) {
+  uint32 magic;
+
+  HalFlashRead(JOURNAL_PAGE_BEG + idx, 0, (uint8*)&magic, sizeof(magic));
+  return (magic == JOURNAL_PAGE_MAGIC);
+}
+
+static uint16 readSeq(uint8 idx, uint8 slot) {
+  uint8 seq[2];
+
+  HalFlashRead(JOURNAL_PAGE_BEG + idx, getEntryOffset(slot), seq, 2);
+  return BUILD_UINT16(seq[0], seq[1]);
+}
+
+// Entries follow the page header
+static uint16 getEntryOffset(uint8 slot) {
+  return (uint16)(slot + 1) * JOURNAL_ENTRY_SIZE;
+}
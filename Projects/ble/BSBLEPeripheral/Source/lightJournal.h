@@ -0,0 +1,59 @@
+#include "OSAL.h"
+#include "hal_board.h"
+
+/*******************************************************************************
+ * TYPEDEF
+ */
+
+/*******************************************************************************
+ * MACROS
+ */
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Flash pages of the journal, right below the NV pages.
+// They must coincide with BSJOURNAL_ADDRESS_SPACE in CC2540DB/ti_51ew_cc2540b_bs.xcl.
+#define JOURNAL_PAGE_CNT                2
+#define JOURNAL_PAGE_BEG                (HAL_NV_PAGE_BEG - JOURNAL_PAGE_CNT)
+
+// Who changed the lights
+#define JOURNAL_SRC_BUTTON              0x00
+#define JOURNAL_SRC_BLE                 0x01
+#define JOURNAL_SRC_SCHEDULE            0x02
+#define JOURNAL_SRC_ABSENCE             0x03
+
+// A sync notification: STX, JOURNAL_SYNC_FLAGS | entry count, entries, ETX.
+// Each entry is sequence (big endian), source << 6 | light state, time (big endian).
+// A notification with no entries ends the sync.
+#define JOURNAL_SYNC_FLAGS              0xB0  // BV(7) | ABSENCE_MODE_SYNC
+#define JOURNAL_SYNC_ENTRY_LEN          7
+#define JOURNAL_SYNC_ENTRIES            2     // per notification
+#define JOURNAL_SYNC_BURST              4     // notifications per connection event or so
+#define JOURNAL_SYNC_PERIOD             30    // msec between bursts
+#define JOURNAL_SYNC_ALL                0xFFFF  // no entry carries this sequence
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Find the newest entry in flash
+ */
+extern void lightJournal_Init( uint8 task_id, uint16 syncEvent );
+
+/*
+ * Append the light state if it changed since the last entry
+ */
+extern void lightJournal_Record( uint8 source );
+
+/*
+ * Stream every entry newer than afterSeq (or all with JOURNAL_SYNC_ALL) as notifications
+ */
+extern void lightJournal_StartSync( uint16 afterSeq );
+
+/*
+ * Send the next burst of a running sync
+ */
+extern void lightJournal_ProcessSync( void );
@@ -0,0 +1,356 @@
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "gap.h"
+#include "peripheral.h"
+
+#include "BSGATTprofile.h"
+#include "parsingData.h"
+#include "lightRelay.h"
+
+#if (defined BS_RELAY) && (BS_RELAY == TRUE)
+
+#if !(HOST_CONFIG & OBSERVER_CFG)
+#error "Relay mode scans, build with HOST_CONFIG=PERIPHERAL_CFG+OBSERVER_CFG"
+#endif
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Advertising data of a burst: the flags, then the relay frame
+#define RELAY_AD_FLAGS_LEN              3
+#define RELAY_AD_LEN_IDX                3     // length of the manufacturer specific data
+#define RELAY_AD_TYPE_IDX               4
+#define RELAY_FRAME_IDX                 5     // company id onwards
+
+// Offsets in the relay frame
+#define RELAY_COMPANY_IDX               0
+#define RELAY_MAGIC_IDX                 2
+#define RELAY_ORIGIN_IDX                3
+#define RELAY_SEQ_IDX                   5
+#define RELAY_TTL_IDX                   6
+#define RELAY_KIND_IDX                  7
+#define RELAY_TARGET_IDX                8
+#define RELAY_PAYLOAD_IDX               10
+
+// isSeen()
+#define RELAY_SEEN                      1
+#define RELAY_SEEN_BETTER               2
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct {
+  uint16 origin;
+  uint8 seq;
+  uint8 ttl;
+  uint8 kind;
+  uint16 target;
+  uint8 len;
+  uint8 payload[RELAY_PAYLOAD_MAX];
+} relayFrame_t;
+
+typedef struct {
+  uint16 origin;
+  uint8 seq;
+  uint8 ttl;      // most hops left of the copies heard
+} relayCacheEntry_t;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static uint16 getOwnId(void);
+static uint8 isSeen(uint16 origin, uint8 seq, uint8 ttl);
+static void enqueueFrame(relayFrame_t *pFrame);
+static void sendFromHere(uint8 kind, uint16 target, uint8* payload, uint8 len);
+static void receiveFrame(uint8* pFrame, uint8 frameLen);
+static uint8 getAdvertLength(uint8* pAdvert);
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static uint8 relay_TaskID;
+static uint16 relay_TxEvent;
+static uint16 relay_ScanEvent;
+
+static relayFrame_t relayQueue[RELAY_QUEUE_LEN];
+static uint8 queueHead = 0;
+static uint8 queueCount = 0;
+
+static relayCacheEntry_t relayCache[RELAY_CACHE_LEN];
+static uint8 cacheNext = 0;
+
+static uint8 ownSeq = 0;
+static bool isSending = FALSE;
+static uint8 savedAdvert[B_MAX_ADV_LEN];  // the switch's own advertising data during a burst
+static uint8 savedAdvertEnabled;          // and whether it was advertising
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+void lightRelay_Init( uint8 task_id, uint16 txEvent, uint16 scanEvent )
+{
+  relay_TaskID = task_id;
+  relay_TxEvent = txEvent;
+  relay_ScanEvent = scanEvent;
+
+  osal_memset(relayCache, 0xFF, sizeof(relayCache));
+
+  // a new frame from a known switch must not be dropped as a duplicate report
+  GAP_SetParamValue(TGAP_FILTER_ADV_REPORTS, FALSE);
+  GAP_SetParamValue(TGAP_GEN_DISC_SCAN, RELAY_SCAN_MS);
+
+  // the GAP role is not up yet
+  osal_start_timerEx(relay_TaskID, relay_ScanEvent, RELAY_SCAN_RETRY_MS);
+}
+
+bool lightRelay_ParsePacket( uint8* recvPacket, uint8 packetLength )
+{
+  uint8 dataLength = recvPacket[1];
+  uint8 innerLength;
+  uint16 target;
+
+  // STX, length, TYPE_RELAY, target id (2), packet, ETX
+  if(packetLength < HEADER_LENGTH + 2 || recvPacket[0] != STX) return false;
+  if(dataLength + HEADER_LENGTH != packetLength || recvPacket[3 + dataLength] != ETX) return false;
+
+  innerLength = dataLength - 2;
+  if(innerLength != PACKET_LENGTH_NORMAL && innerLength != PACKET_LENGTH_ABSENCE) return false;
+
+  target = BUILD_UINT16(recvPacket[4], recvPacket[3]);
+  if(target == getOwnId()) return parsingDataPacket(&recvPacket[5], innerLength);
+
+  sendFromHere(RELAY_KIND_COMMAND, target, &recvPacket[5], innerLength);
+  return true;
+}
+
+void lightRelay_ProcessGapMsg( gapEventHdr_t *pMsg )
+{
+  if(pMsg->opcode == GAP_DEVICE_INFO_EVENT) {
+    gapDeviceInfoEvent_t *pInfo = (gapDeviceInfoEvent_t *)pMsg;
+    uint8 i = 0;
+
+    if(pInfo->eventType != GAP_ADRPT_ADV_IND && pInfo->eventType != GAP_ADRPT_ADV_NONCONN_IND) return;
+
+    // walk the AD structures for our manufacturer specific data
+    while(i + 1 < pInfo->dataLen && pInfo->pEvtData[i] != 0) {
+      uint8 len = pInfo->pEvtData[i];
+
+      if(i + 1 + len > pInfo->dataLen) break;
+
+      if(pInfo->pEvtData[i + 1] == GAP_ADTYPE_MANUFACTURER_SPECIFIC) {
+        receiveFrame(&pInfo->pEvtData[i + 2], len - 1);
+        break;
+      }
+      i += len + 1;
+    }
+  }
+  else if(pMsg->opcode == GAP_DEVICE_DISCOVERY_EVENT) {
+    osal_set_event(relay_TaskID, relay_ScanEvent);
+  }
+}
+
+void lightRelay_ProcessTx( void )
+{
+  uint8 advert[B_MAX_ADV_LEN];
+  relayFrame_t *pFrame;
+
+  if(isSending) {
+    GAPRole_SetParameter(GAPROLE_ADVERT_DATA, getAdvertLength(savedAdvert), savedAdvert);
+    GAPRole_SetParameter(GAPROLE_ADVERT_ENABLED, sizeof(uint8), &savedAdvertEnabled);
+    isSending = FALSE;
+
+    if(queueCount != 0) {
+      osal_start_timerEx(relay_TaskID, relay_TxEvent, 1 + osal_rand() % RELAY_JITTER_MS);
+    }
+    return;
+  }
+
+  if(queueCount == 0) return;
+
+  pFrame = &relayQueue[queueHead];
+  queueHead = (queueHead + 1) % RELAY_QUEUE_LEN;
+  queueCount--;
+
+  osal_memset(savedAdvert, 0, B_MAX_ADV_LEN);
+  GAPRole_GetParameter(GAPROLE_ADVERT_DATA, savedAdvert);
+  GAPRole_GetParameter(GAPROLE_ADVERT_ENABLED, &savedAdvertEnabled);
+
+  advert[0] = 0x02;
+  advert[1] = GAP_ADTYPE_FLAGS;
+  advert[2] = GAP_ADTYPE_FLAGS_GENERAL | GAP_ADTYPE_FLAGS_BREDR_NOT_SUPPORTED;
+  advert[RELAY_AD_LEN_IDX] = 1 + RELAY_PAYLOAD_IDX + pFrame->len;
+  advert[RELAY_AD_TYPE_IDX] = GAP_ADTYPE_MANUFACTURER_SPECIFIC;
+  advert[RELAY_FRAME_IDX + RELAY_COMPANY_IDX] = LO_UINT16(RELAY_COMPANY_ID);
+  advert[RELAY_FRAME_IDX + RELAY_COMPANY_IDX + 1] = HI_UINT16(RELAY_COMPANY_ID);
+  advert[RELAY_FRAME_IDX + RELAY_MAGIC_IDX] = RELAY_MAGIC;
+  advert[RELAY_FRAME_IDX + RELAY_ORIGIN_IDX] = HI_UINT16(pFrame->origin);
+  advert[RELAY_FRAME_IDX + RELAY_ORIGIN_IDX + 1] = LO_UINT16(pFrame->origin);
+  advert[RELAY_FRAME_IDX + RELAY_SEQ_IDX] = pFrame->seq;
+  advert[RELAY_FRAME_IDX + RELAY_TTL_IDX] = pFrame->ttl;
+  advert[RELAY_FRAME_IDX + RELAY_KIND_IDX] = pFrame->kind;
+  advert[RELAY_FRAME_IDX + RELAY_TARGET_IDX] = HI_UINT16(pFrame->target);
+  advert[RELAY_FRAME_IDX + RELAY_TARGET_IDX + 1] = LO_UINT16(pFrame->target);
+  osal_memcpy(&advert[RELAY_FRAME_IDX + RELAY_PAYLOAD_IDX], pFrame->payload, pFrame->len);
+
+  // the frame goes out with every advertising event of the switch until the burst ends,
+  // advertising is turned on for the burst if the switch was not advertising
+  // (non-connectable while it holds a connection, see the peripheral role)
+  GAPRole_SetParameter(GAPROLE_ADVERT_DATA, RELAY_FRAME_IDX + RELAY_PAYLOAD_IDX + pFrame->len, advert);
+  if(!savedAdvertEnabled) {
+    uint8 enable = TRUE;
+
+    GAPRole_SetParameter(GAPROLE_ADVERT_ENABLED, sizeof(uint8), &enable);
+  }
+  isSending = TRUE;
+
+  osal_start_timerEx(relay_TaskID, relay_TxEvent, RELAY_BURST_MS);
+}
+
+void lightRelay_ProcessScan( void )
+{
+  gapDevDiscReq_t params;
+
+  params.taskID = relay_TaskID;
+  params.mode = DEVDISC_MODE_ALL;
+  params.activeScan = FALSE;
+  params.whiteList = FALSE;
+
+  if(GAP_DeviceDiscoveryRequest(&params) != SUCCESS) {
+    osal_start_timerEx(relay_TaskID, relay_ScanEvent, RELAY_SCAN_RETRY_MS);
+  }
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static uint16 getOwnId(void) {
+  uint8 addr[B_ADDR_LEN];
+
+  GAPRole_GetParameter(GAPROLE_BD_ADDR, addr);
+  return BUILD_UINT16(addr[0], addr[1]);
+}
+
+// Remembers the pair as a side effect, so each frame is handled once: FALSE for a new frame,
+// RELAY_SEEN_BETTER for a copy with more hops left than any before (it came a shorter way,
+// passing it on again lets it reach as far as the TTL allows), RELAY_SEEN otherwise
+static uint8 isSeen(uint16 origin, uint8 seq, uint8 ttl) {
+  uint8 i;
+
+  for(i = 0; i < RELAY_CACHE_LEN; i++) {
+    if(relayCache[i].origin == origin && relayCache[i].seq == seq) {
+      if(ttl <= relayCache[i].ttl) return RELAY_SEEN;
+
+      relayCache[i].ttl = ttl;
+      return RELAY_SEEN_BETTER;
+    }
+  }
+
+  relayCache[cacheNext].origin = origin;
+  relayCache[cacheNext].seq = seq;
+  relayCache[cacheNext].ttl = ttl;
+  cacheNext = (cacheNext + 1) % RELAY_CACHE_LEN;
+  return FALSE;
+}
+
+// A full queue drops the new frame, the neighbours still carry it
+static void enqueueFrame(relayFrame_t *pFrame) {
+  if(queueCount == RELAY_QUEUE_LEN) return;
+
+  osal_memcpy(&relayQueue[(queueHead + queueCount) % RELAY_QUEUE_LEN], pFrame, sizeof(relayFrame_t));
+  queueCount++;
+
+  if(!isSending) {
+    osal_start_timerEx(relay_TaskID, relay_TxEvent, 1 + osal_rand() % RELAY_JITTER_MS);
+  }
+}
+
+static void sendFromHere(uint8 kind, uint16 target, uint8* payload, uint8 len) {
+  relayFrame_t frame;
+
+  frame.origin = getOwnId();
+  frame.seq = ++ownSeq;
+  frame.ttl = RELAY_TTL;
+  frame.kind = kind;
+  frame.target = target;
+  frame.len = len;
+  osal_memcpy(frame.payload, payload, len);
+
+  VOID isSeen(frame.origin, frame.seq, frame.ttl); // our own frame coming back is not relayed again
+  enqueueFrame(&frame);
+}
+
+static void receiveFrame(uint8* pFrame, uint8 frameLen) {
+  relayFrame_t frame;
+  uint16 ownId;
+  uint8 seen;
+
+  if(frameLen < RELAY_PAYLOAD_IDX || frameLen > RELAY_PAYLOAD_IDX + RELAY_PAYLOAD_MAX) return;
+  if(BUILD_UINT16(pFrame[RELAY_COMPANY_IDX], pFrame[RELAY_COMPANY_IDX + 1]) != RELAY_COMPANY_ID) return;
+  if(pFrame[RELAY_MAGIC_IDX] != RELAY_MAGIC) return;
+
+  frame.origin = BUILD_UINT16(pFrame[RELAY_ORIGIN_IDX + 1], pFrame[RELAY_ORIGIN_IDX]);
+  frame.seq = pFrame[RELAY_SEQ_IDX];
+  frame.ttl = pFrame[RELAY_TTL_IDX];
+  frame.kind = pFrame[RELAY_KIND_IDX];
+  frame.target = BUILD_UINT16(pFrame[RELAY_TARGET_IDX + 1], pFrame[RELAY_TARGET_IDX]);
+  frame.len = frameLen - RELAY_PAYLOAD_IDX;
+  osal_memcpy(frame.payload, &pFrame[RELAY_PAYLOAD_IDX], frame.len);
+
+  seen = isSeen(frame.origin, frame.seq, frame.ttl);
+  if(seen == RELAY_SEEN) return;
+
+  ownId = getOwnId();
+
+  if(frame.target != ownId) {
+    if(frame.ttl > 1) {
+      frame.ttl--;
+      enqueueFrame(&frame);
+    }
+    return;
+  }
+
+  if(seen) return;  // the target takes a frame once
+
+  if(frame.kind == RELAY_KIND_COMMAND) {
+    uint8* responsePacket;
+
+    parsingDataPacket(frame.payload, frame.len);
+
+    responsePacket = getWriteStatePacket();
+    sendFromHere(RELAY_KIND_ACK, frame.origin, responsePacket, PACKET_LENGTH_RESPONSE);
+    osal_mem_free(responsePacket);
+  }
+  else if(frame.kind == RELAY_KIND_ACK) {
+    // STX, length, TYPE_RELAY, origin id (2), the target's state packet, ETX
+    uint8 packet[HEADER_LENGTH + 2 + RELAY_PAYLOAD_MAX];
+
+    packet[0] = STX;
+    packet[1] = 2 + frame.len;
+    packet[2] = TYPE_RELAY;
+    packet[3] = HI_UINT16(frame.origin);
+    packet[4] = LO_UINT16(frame.origin);
+    osal_memcpy(&packet[5], frame.payload, frame.len);
+    packet[5 + frame.len] = ETX;
+
+    BSProfile_SetParameter(BSPROFILE_CHAR1, HEADER_LENGTH + 2 + frame.len, packet);
+    notifyCharateristicChanged(BSPROFILE_CHAR1);
+  }
+}
+
+// Length of advertising data up to its first empty AD structure
+static uint8 getAdvertLength(uint8* pAdvert) {
+  uint8 len = 0;
+
+  while(len < B_MAX_ADV_LEN && pAdvert[len] != 0) {
+    len += pAdvert[len] + 1;
+  }
+  return (len > B_MAX_ADV_LEN) ? B_MAX_ADV_LEN : len;
+}
+
+#endif // BS_RELAY
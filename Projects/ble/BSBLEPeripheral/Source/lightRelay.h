@@ -0,0 +1,69 @@
+#include "OSAL.h"
+#include "gap.h"
+
+/*******************************************************************************
+ * TYPEDEF
+ */
+
+/*******************************************************************************
+ * MACROS
+ */
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Relay mode passes commands between switches in advertising packets.
+// It scans while advertising, so the project needs HOST_CONFIG=PERIPHERAL_CFG+OBSERVER_CFG
+// in buildConfig.cfg and CC2540_BLE.lib in place of CC2540_BLE_peri.lib.
+#if !defined BS_RELAY
+#define BS_RELAY                        FALSE
+#endif
+
+// A relay frame is manufacturer specific data:
+//   company (2), RELAY_MAGIC, origin id (2), sequence, ttl, kind, target id (2), packet
+// A switch id is the low two bytes of its device address, high byte first.
+#define RELAY_COMPANY_ID                0x000D
+#define RELAY_MAGIC                     0xB5
+#define RELAY_KIND_COMMAND              0x01
+#define RELAY_KIND_ACK                  0x02
+
+#if !defined RELAY_TTL
+#define RELAY_TTL                       4     // hops a frame may take
+#endif
+#define RELAY_PAYLOAD_MAX               10    // an absence-length packet
+#define RELAY_QUEUE_LEN                 4     // frames waiting for the air
+#define RELAY_CACHE_LEN                 16    // recent (origin, sequence) pairs
+#define RELAY_BURST_MS                  1000  // a frame stays in the advertising data this long
+#define RELAY_JITTER_MS                 100   // random wait before a burst, spreads rebroadcasts
+#define RELAY_SCAN_MS                   2000  // one discovery, restarted when it ends
+#define RELAY_SCAN_RETRY_MS             1000  // the stack refused a discovery
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Start listening for relay frames
+ */
+extern void lightRelay_Init( uint8 task_id, uint16 txEvent, uint16 scanEvent );
+
+/*
+ * A TYPE_RELAY packet from the phone: the target id and the packet to carry
+ */
+extern bool lightRelay_ParsePacket( uint8* recvPacket, uint8 packetLength );
+
+/*
+ * Advertising reports and the end of a discovery
+ */
+extern void lightRelay_ProcessGapMsg( gapEventHdr_t *pMsg );
+
+/*
+ * Start or end a burst
+ */
+extern void lightRelay_ProcessTx( void );
+
+/*
+ * Start the next discovery
+ */
+extern void lightRelay_ProcessScan( void );
@@ -0,0 +1,48 @@
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "osal_snv.h"
+
+#include "lightScene.h"
+
+// Scene items run from BS_NVID_SCENE_START up to 0x8F
+#if SCENE_MAX > 15
+#error "SCENE_MAX exceeds the SNV items reserved for scenes"
+#endif
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define SCENE_FLAG_STORED               0x80  // set on every written scene, an erased slot reads without it
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+bool lightScene_Get( uint8 slot, lightScene_t *pScene )
+{
+  if(slot >= SCENE_MAX) return FALSE;
+
+  if(osal_snv_read(BS_NVID_SCENE_START + slot, sizeof(lightScene_t), pScene) != SUCCESS) return FALSE;
+
+  return (pScene->flags & SCENE_FLAG_STORED) ? TRUE : FALSE;
+}
+
+bool lightScene_Set( uint8 slot, lightScene_t *pScene )
+{
+  if(slot >= SCENE_MAX) return FALSE;
+
+  pScene->flags |= SCENE_FLAG_STORED;
+  return (osal_snv_write(BS_NVID_SCENE_START + slot, sizeof(lightScene_t), pScene) == SUCCESS);
+}
+
+bool lightScene_Delete( uint8 slot )
+{
+  lightScene_t scene;
+
+  if(slot >= SCENE_MAX) return FALSE;
+
+  // SNV cannot drop an item, it is overwritten as empty
+  osal_memset(&scene, 0, sizeof(lightScene_t));
+  return (osal_snv_write(BS_NVID_SCENE_START + slot, sizeof(lightScene_t), &scene) == SUCCESS);
+}
@@ -0,0 +1,49 @@
+#include "OSAL.h"
+#include "parsingData.h"
+
+/*******************************************************************************
+ * TYPEDEF
+ */
+
+// A stored scene. levels[ch] is 0 (off) to 255 (fully on), without PWM any non-zero level is on.
+typedef struct {
+  uint8 levels[BS_LIGHT_CHANNELS];
+  uint16 fadeMs;
+  uint8 flags;      // SCENE_FLAG_*
+} lightScene_t;
+
+/*******************************************************************************
+ * MACROS
+ */
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#if !defined SCENE_MAX
+#define SCENE_MAX                       8
+#endif
+
+// One SNV item per scene, after the schedule
+#define BS_NVID_SCENE_START             0x81
+
+#define SCENE_FLAG_ABSENCE_OFF          0x01  // recalling the scene also ends absence mode
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Read a scene from SNV, FALSE if the slot is empty
+ */
+extern bool lightScene_Get( uint8 slot, lightScene_t *pScene );
+
+/*
+ * Store a scene in SNV
+ */
+extern bool lightScene_Set( uint8 slot, lightScene_t *pScene );
+
+/*
+ * Empty a slot
+ */
+extern bool lightScene_Delete( uint8 slot );
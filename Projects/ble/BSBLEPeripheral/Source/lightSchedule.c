@@ -0,0 +1,154 @@
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "osal_snv.h"
+
+#include "parsingData.h"
+#include "lightSchedule.h"
+#include "lightJournal.h"
+
+// SNV items are at most 255 bytes
+#if (SCHEDULE_MAX_RULES * 5) > 255
+#error "SCHEDULE_MAX_RULES does not fit in one SNV item"
+#endif
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static uint32 getWeekSeconds(UTCTime time);
+static uint32 getSecondsUntil(scheduleRule_t *pRule, uint32 weekSeconds);
+static void armNextRule(void);
+static void saveRules(void);
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static uint8 schedule_TaskID;
+static uint16 schedule_DueEvent;
+
+static scheduleRule_t scheduleRules[SCHEDULE_MAX_RULES];
+static bool isClockSet = FALSE;     // the clock restarts at 2000-01-01 after a reset
+static UTCTime lastRunTime;         // rules up to this time have run
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+void lightSchedule_Init( uint8 task_id, uint16 dueEvent )
+{
+  schedule_TaskID = task_id;
+  schedule_DueEvent = dueEvent;
+
+  if(osal_snv_read(BS_NVID_SCHEDULE, sizeof(scheduleRules), scheduleRules) != SUCCESS) {
+    osal_memset(scheduleRules, 0, sizeof(scheduleRules));
+  }
+}
+
+void lightSchedule_SetClock( UTCTime now )
+{
+  osal_setClock(now);
+  isClockSet = TRUE;
+  lastRunTime = now;
+  armNextRule();
+}
+
+bool lightSchedule_SetRule( uint8 slot, scheduleRule_t *pRule )
+{
+  if(slot >= SCHEDULE_MAX_RULES || pRule->hour > 23 || pRule->minute > 59) return FALSE;
+
+  osal_memcpy(&scheduleRules[slot], pRule, sizeof(scheduleRule_t));
+  scheduleRules[slot].days &= SCHEDULE_EVERY_DAY;
+  saveRules();
+
+  if(isClockSet) {
+    lastRunTime = osal_getClock();
+    armNextRule();
+  }
+  return TRUE;
+}
+
+void lightSchedule_Clear( void )
+{
+  osal_memset(scheduleRules, 0, sizeof(scheduleRules));
+  saveRules();
+  osal_stop_timerEx(schedule_TaskID, schedule_DueEvent);
+}
+
+void lightSchedule_ProcessDue( void )
+{
+  UTCTime now = osal_getClock();
+  uint32 elapsed = now - lastRunTime;
+  uint32 lastWeekSeconds = getWeekSeconds(lastRunTime);
+  uint8 state = getLightState();
+  uint8 i;
+
+  if(!isClockSet) return;
+
+  if(elapsed > SECONDS_WEEK) elapsed = SECONDS_WEEK;
+
+  // every rule that came due since the last run, normally just the one the timer was armed for
+  for(i = 0; i < SCHEDULE_MAX_RULES; i++) {
+    scheduleRule_t *pRule = &scheduleRules[i];
+    uint32 until = getSecondsUntil(pRule, lastWeekSeconds);
+
+    if(until != 0 && until <= elapsed) {
+      if(pRule->on) state |= pRule->lights;
+      else state &= ~pRule->lights;
+    }
+  }
+
+  if(state != getLightState()) {
+    setLightState(state);
+    lightJournal_Record(JOURNAL_SRC_SCHEDULE);
+  }
+
+  lastRunTime = now;
+  armNextRule();
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+// Seconds since Sunday 00:00 (2000-01-01 was a Saturday)
+static uint32 getWeekSeconds(UTCTime time) {
+  return ((time / SECONDS_DAY + 6) % 7) * SECONDS_DAY + (time % SECONDS_DAY);
+}
+
+// Seconds from weekSeconds to the next time the rule fires, 1 to SECONDS_WEEK. 0 for an empty slot.
+static uint32 getSecondsUntil(scheduleRule_t *pRule, uint32 weekSeconds) {
+  uint32 next = 0;
+  uint8 wday;
+
+  for(wday = 0; wday < 7; wday++) {
+    if(pRule->days & SCHEDULE_DAY(wday)) {
+      uint32 ruleSeconds = wday * SECONDS_DAY + pRule->hour * 3600UL + pRule->minute * 60UL;
+      uint32 until = (ruleSeconds + SECONDS_WEEK - weekSeconds) % SECONDS_WEEK;
+
+      if(until == 0) until = SECONDS_WEEK; // has just run
+      if(next == 0 || until < next) next = until;
+    }
+  }
+  return next;
+}
+
+// One OSAL timer for the earliest rule, the device sleeps until then
+static void armNextRule(void) {
+  uint32 weekSeconds = getWeekSeconds(lastRunTime);
+  uint32 next = 0;
+  uint8 i;
+
+  for(i = 0; i < SCHEDULE_MAX_RULES; i++) {
+    uint32 until = getSecondsUntil(&scheduleRules[i], weekSeconds);
+
+    if(until != 0 && (next == 0 || until < next)) next = until;
+  }
+
+  if(next != 0) osal_start_timerEx(schedule_TaskID, schedule_DueEvent, next * 1000);
+  else osal_stop_timerEx(schedule_TaskID, schedule_DueEvent);
+}
+
+static void saveRules(void) {
+  osal_snv_write(BS_NVID_SCHEDULE, sizeof(scheduleRules), scheduleRules);
+}
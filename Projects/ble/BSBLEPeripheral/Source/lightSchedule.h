@@ -0,0 +1,65 @@
+#include "OSAL.h"
+#include "OSAL_Clock.h"
+
+/*******************************************************************************
+ * TYPEDEF
+ */
+
+// One on/off rule. A rule with no weekday is an empty slot.
+typedef struct {
+  uint8 days;       // weekday mask, SCHEDULE_DAY(0) = Sunday
+  uint8 hour;       // 0-23
+  uint8 minute;     // 0-59
+  uint8 on;         // TRUE switches the lights on, FALSE off
+  uint8 lights;     // mask of LIGHT_BIT(ch)
+} scheduleRule_t;
+
+/*******************************************************************************
+ * MACROS
+ */
+
+#define SCHEDULE_DAY(wday)              BV(wday)
+#define SCHEDULE_EVERY_DAY              0x7F
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#if !defined SCHEDULE_MAX_RULES
+#define SCHEDULE_MAX_RULES              8
+#endif
+
+// SNV item of the rule table, above the BLE stack's own items
+#define BS_NVID_SCHEDULE                0x80
+
+#define SECONDS_DAY                     86400UL
+#define SECONDS_WEEK                    (SECONDS_DAY * 7)
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Load the rule table from SNV. Nothing fires until the clock is set.
+ */
+extern void lightSchedule_Init( uint8 task_id, uint16 dueEvent );
+
+/*
+ * Set the wall clock (seconds since 2000-01-01, local time) and re-arm
+ */
+extern void lightSchedule_SetClock( UTCTime now );
+
+/*
+ * Store a rule in a slot (an empty rule clears it), persist the table and re-arm
+ */
+extern bool lightSchedule_SetRule( uint8 slot, scheduleRule_t *pRule );
+
+/*
+ * Remove every rule
+ */
+extern void lightSchedule_Clear( void );
+
+/*
+ * Run the rules that came due and arm the timer for the next one
+ */
+extern void lightSchedule_ProcessDue( void );
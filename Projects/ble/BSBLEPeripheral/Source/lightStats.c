@@ -0,0 +1,196 @@
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "hal_mcu.h"
+#include "hci.h"
+
+#include "BSGATTprofile.h"
+#include "parsingData.h"
+#include "lightStats.h"
+
+#if (defined BS_LATENCY_STATS) && (BS_LATENCY_STATS == TRUE)
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define STATS_REPLY_LENGTH              (STATS_REPLY_DATA_LEN + HEADER_LENGTH)
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void stopTiming(void);
+static uint32 readSleepTimer(void);
+static void sampleHeap(void);
+static void putUint16(uint8* pOut, uint16 value);
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static uint8 statsTaskId;
+static uint16 statsConnEvt;
+
+static uint32 commandStart;
+static bool isTiming = FALSE;
+static bool isQueued;           // the notification of the command is with the stack
+static uint8 connEventCnt;      // connection events since the command was written
+static uint16 commandEvents;    // app task events of the command on the way
+
+static uint16 commandCnt;
+static uint32 latencySum;       // sleep timer ticks
+static uint16 latencyMin;
+static uint16 latencyMax;
+static uint32 eventCnt;         // app task events of the measured commands
+static uint16 heapMax;          // bytes
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+void lightStats_Init( uint8 task_id, uint16 connEvt )
+{
+  statsTaskId = task_id;
+  statsConnEvt = connEvt;
+}
+
+void lightStats_CommandIn( void )
+{
+  if(isTiming) return;
+
+  commandStart = readSleepTimer();
+  isTiming = TRUE;
+  isQueued = FALSE;
+  connEventCnt = 0;
+  commandEvents = 0;
+  sampleHeap();
+
+  // a notice left over from the last command must not stop this one
+  osal_clear_event(statsTaskId, statsConnEvt);
+  HCI_EXT_ConnEventNoticeCmd(statsTaskId, statsConnEvt);
+}
+
+void lightStats_CommandDrop( void )
+{
+  if(isTiming) stopTiming();
+}
+
+void lightStats_NotifyQueued( void )
+{
+  if(!isTiming) return;
+
+  isQueued = TRUE;
+  sampleHeap();
+}
+
+void lightStats_ProcessConnEvent( void )
+{
+  uint32 ticks;
+
+  if(!isTiming) return;
+
+  // the notification goes out in the first connection event after it is queued
+  if(!isQueued) {
+    if(++connEventCnt >= STATS_CONN_EVENT_MAX) stopTiming();
+    return;
+  }
+
+  // the sleep timer is 24 bits wide
+  ticks = (readSleepTimer() - commandStart) & 0x00FFFFFFUL;
+  if(ticks > 0xFFFF) ticks = 0xFFFF;
+
+  if(commandCnt == 0 || ticks < latencyMin) latencyMin = (uint16)ticks;
+  if(ticks > latencyMax) latencyMax = (uint16)ticks;
+  latencySum += ticks;
+  eventCnt += commandEvents;
+  if(commandCnt != 0xFFFF) commandCnt++;
+
+  sampleHeap();
+  stopTiming();
+}
+
+void lightStats_Event( void )
+{
+  if(isTiming) commandEvents++;
+}
+
+bool lightStats_ParsePacket( uint8* recvPacket, uint8 packetLength )
+{
+  uint8 packet[STATS_REPLY_LENGTH];
+  uint16 eventsPerCmd = 0;
+
+  if(packetLength != PACKET_LENGTH_NORMAL) return false;
+
+  // the request itself is not a command to measure
+  if(isTiming) stopTiming();
+
+  if(recvPacket[3] == STATS_OP_RESET) {
+    commandCnt = 0;
+    latencySum = 0;
+    latencyMin = 0;
+    latencyMax = 0;
+    eventCnt = 0;
+    heapMax = 0;
+  }
+  else if(recvPacket[3] != STATS_OP_READ) {
+    return false;
+  }
+
+  if(commandCnt != 0) {
+    uint32 perCmd = (eventCnt << 4) / commandCnt;
+
+    eventsPerCmd = (perCmd > 0xFFFF) ? 0xFFFF : (uint16)perCmd;
+  }
+
+  packet[0] = STX;
+  packet[1] = STATS_REPLY_DATA_LEN;
+  packet[2] = TYPE_STATS;
+  putUint16(&packet[3], commandCnt);
+  putUint16(&packet[5], latencyMin);
+  putUint16(&packet[7], (commandCnt != 0) ? (uint16)(latencySum / commandCnt) : 0);
+  putUint16(&packet[9], latencyMax);
+  putUint16(&packet[11], eventsPerCmd);
+  putUint16(&packet[13], heapMax);
+  packet[STATS_REPLY_LENGTH - 1] = ETX;
+
+  BSProfile_SetParameter(BSPROFILE_CHAR1, STATS_REPLY_LENGTH, packet);
+  notifyCharateristicChanged(BSPROFILE_CHAR1);
+
+  return true;
+}
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void stopTiming(void) {
+  isTiming = FALSE;
+  HCI_EXT_ConnEventNoticeCmd(statsTaskId, 0);
+}
+
+// Reading ST0 latches ST1 and ST2, so the three bytes belong together
+static uint32 readSleepTimer(void) {
+  uint32 ticks;
+
+  ((uint8*)&ticks)[0] = ST0;
+  ((uint8*)&ticks)[1] = ST1;
+  ((uint8*)&ticks)[2] = ST2;
+  ((uint8*)&ticks)[3] = 0;
+
+  return ticks;
+}
+
+static void sampleHeap(void) {
+#if (defined OSALMEM_METRICS) && (OSALMEM_METRICS == TRUE)
+  uint16 used = osal_heap_mem_used();
+
+  if(used > heapMax) heapMax = used;
+#endif
+}
+
+static void putUint16(uint8* pOut, uint16 value) {
+  pOut[0] = HI_UINT16(value);
+  pOut[1] = LO_UINT16(value);
+}
+
+#endif
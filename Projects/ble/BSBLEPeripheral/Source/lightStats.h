@@ -0,0 +1,88 @@
+#include "OSAL.h"
+
+/*******************************************************************************
+ * TYPEDEF
+ */
+
+/*******************************************************************************
+ * MACROS
+ */
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Command statistics, measured on the board itself: how long a written command
+// takes until the connection event that sends its notification has ended, how
+// many app task events it costs on the way and how much heap it needs. A command
+// written while another is on the way is not measured. Heap figures need
+// OSALMEM_METRICS=TRUE as well.
+#if !defined BS_LATENCY_STATS
+#define BS_LATENCY_STATS                FALSE
+#endif
+
+// A command whose notification is not queued within this many connection events
+// is given up.
+#if !defined STATS_CONN_EVENT_MAX
+#define STATS_CONN_EVENT_MAX            8
+#endif
+
+// TYPE_STATS in a normal packet: byte 3 STATS_OP_*.
+// The reply: STX, STATS_REPLY_DATA_LEN, TYPE_STATS, commands, min, avg and max
+// latency in 32 kHz sleep timer ticks, app events per command (x16) and peak heap
+// bytes, all 16 bit big endian, ETX.
+#define STATS_OP_READ                   0x00
+#define STATS_OP_RESET                  0x01
+#define STATS_REPLY_DATA_LEN            12
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+#if (defined BS_LATENCY_STATS) && (BS_LATENCY_STATS == TRUE)
+
+/*
+ * Take the task and event for the connection event notice of the stack
+ */
+extern void lightStats_Init( uint8 task_id, uint16 connEvt );
+
+/*
+ * A command was written, start its clock
+ */
+extern void lightStats_CommandIn( void );
+
+/*
+ * The command was refused, no notification will answer it
+ */
+extern void lightStats_CommandDrop( void );
+
+/*
+ * The stack took a notification of characteristic 1
+ */
+extern void lightStats_NotifyQueued( void );
+
+/*
+ * A connection event has ended: stop the clock if it sent the notification
+ */
+extern void lightStats_ProcessConnEvent( void );
+
+/*
+ * An app task is processing an event
+ */
+extern void lightStats_Event( void );
+
+/*
+ * A TYPE_STATS packet: read or reset the figures
+ */
+extern bool lightStats_ParsePacket( uint8* recvPacket, uint8 packetLength );
+
+#else
+
+#define lightStats_Init(task_id, connEvt)
+#define lightStats_CommandIn()
+#define lightStats_CommandDrop()
+#define lightStats_NotifyQueued()
+#define lightStats_ProcessConnEvent()
+#define lightStats_Event()
+
+#endif
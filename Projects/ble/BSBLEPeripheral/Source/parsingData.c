@@ -1,8 +1,19 @@
 #include "bcomdef.h"
+#include "hal_mcu.h"
+#include "hal_timer.h"
 
 #include "BSGATTprofile.h"
 #include "parsingData.h"
 #include "BSBLEPeripheral.h"
+#include "lightSchedule.h"
+#include "lightScene.h"
+#include "lightJournal.h"
+#include "lightRelay.h"
+#include "lightStats.h"
+
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE) && (BS_LIGHT_CHANNELS > HAL_TIMER_PWM_MAX_CH)
+#error "Timer1 has no PWM channel for every gang"
+#endif
 
 /*********************************************************************
  * LOCAL FUNCTIONS
@@ -13,7 +24,10 @@ static void writeDataInBoard(uint8 recvData);
 //static uint8* getReadStatePacket();
 //static uint8* getWriteStatePacket();
 static uint8* getAbsenceStatePacket();
-static uint8 getCurrentState();
+static uint8* getStatePacket(uint8 flags, uint8 lights);
+static uint8 getPacketLights(uint8* recvPacket, uint8 flagsIdx, uint8 spareIdx);
+static bool parsePacket(uint8* recvPacket, uint8 packetLength);
+static bool parseScenePacket(uint8* recvPacket, uint8 packetLength);
 
 static uint32 getEndMillis(uint8 endHours, uint8 endMinutes);
 static uint32 getStartMillis(uint8 startHours, uint8 startMinutes);
@@ -25,7 +39,13 @@ static uint32 getNextDayMillis(uint32 endMillis);
 
 static uint8 parsingData_TaskID;   // Task ID for internal task/event processing
 
+static const uint8 lightPortPins[BS_LIGHT_CHANNELS] = LIGHT_PORT_PINS;
+static const uint8 ledPortPins[BS_LIGHT_CHANNELS] = LED_PORT_PINS;
+static uint8 lightPortMask;     // Port 1 pins of all lights
+static uint8 ledPortMask;       // Port 1 pins of all LEDs
+
 static uint8 absenceDataByte;
+static uint8 absenceLights;
 static uint32 lStartMillis;
 static uint32 lEndMillis;
 static uint32 lNextDayMillis;
@@ -39,14 +59,38 @@ uint8 getParsingDataTaskId() { return parsingData_TaskID; }
 void parsingData_Init( uint8 task_id )
 {
   parsingData_TaskID = task_id;
+  
+  lightSchedule_Init(task_id, EVT_SCHEDULE_DUE);
+  lightJournal_Init(task_id, EVT_JOURNAL_SYNC);
+  lightStats_Init(task_id, EVT_STATS_CONN_EVENT);
+#if (defined BS_RELAY) && (BS_RELAY == TRUE)
+  lightRelay_Init(task_id, EVT_RELAY_TX, EVT_RELAY_SCAN);
+#endif
 }
 
 bool parsingDataPacket( uint8* recvPacket, uint8 packetLength )
+{
+  bool isParsed = parsePacket(recvPacket, packetLength);
+  
+  // whichever packet changed the lights, the journal keeps the new state
+  lightJournal_Record(JOURNAL_SRC_BLE);
+  
+  return isParsed;
+}
+
+static bool parsePacket(uint8* recvPacket, uint8 packetLength)
 {
   uint8 dataLength = 0;
   
   if(recvPacket != NULL && packetLength != 0) 
   {
+#if (defined BS_RELAY) && (BS_RELAY == TRUE)
+    // a relay packet wraps a whole packet, so it is longer than the others
+    if(packetLength > 2 && recvPacket[2] == TYPE_RELAY) 
+    {
+      return lightRelay_ParsePacket(recvPacket, packetLength);
+    }
+#endif
     if(packetLength == PACKET_LENGTH_NORMAL || packetLength == PACKET_LENGTH_ABSENCE) 
     {
       if(recvPacket[0] == STX) 
@@ -64,7 +108,7 @@ bool parsingDataPacket( uint8* recvPacket, uint8 packetLength )
               uint8 recvData = recvPacket[3];
               
               if(check_bit(recvData, 7)) { // 忡 ͸  
-                writeDataInBoard(recvData);
+                writeDataInBoard(getPacketLights(recvPacket, 3, 4));
                 
                 uint8* responsePacket = getWriteStatePacket();
                 BSProfile_SetParameter(BSPROFILE_CHAR1, PACKET_LENGTH_RESPONSE, responsePacket);
@@ -81,9 +125,9 @@ bool parsingDataPacket( uint8* recvPacket, uint8 packetLength )
             }
             else if(recvPacket[2] == TYPE_ALARM) 
             {
-              uint8 currentState = getCurrentState();
+              uint8 currentState = getLightState();
               uint8 recvData = recvPacket[3];
-              uint8 controlData = (currentState & recvData);
+              uint8 controlData = (currentState & getPacketLights(recvPacket, 3, 4));
               writeDataInBoard(controlData);
               
               if(check_bit(recvData, 3)) { // Ǹ ˶
@@ -101,9 +145,8 @@ bool parsingDataPacket( uint8* recvPacket, uint8 packetLength )
             }
             else if(recvPacket[2] == TYPE_TIMER) 
             {
-              uint8 currentState = getCurrentState();
-              uint8 recvData = recvPacket[3];
-              uint8 controlData = (currentState & recvData);
+              uint8 currentState = getLightState();
+              uint8 controlData = (currentState & getPacketLights(recvPacket, 3, 4));
               writeDataInBoard(controlData);
 
               uint8* responsePacket = getWriteStatePacket();
@@ -117,16 +160,13 @@ bool parsingDataPacket( uint8* recvPacket, uint8 packetLength )
             {
               absenceDataByte = recvPacket[3];
               
-              uint8 startHours = recvPacket[4];
-              uint8 startMinutes = recvPacket[5];
-              uint8 endHours = recvPacket[6];
-              uint8 endMinutes = recvPacket[7];
-              
-              lStartMillis  = getStartMillis(startHours, startMinutes);
-              lEndMillis  = getEndMillis(endHours, endMinutes);
-              lNextDayMillis = getNextDayMillis(lEndMillis);
-              
               if((absenceDataByte & 0x30) == ABSENCE_MODE_ON) { // 
+                // only a registration carries the hours, CHECK and SYNC must not move the running timers
+                absenceLights = getPacketLights(recvPacket, 3, 8);
+                lStartMillis  = getStartMillis(recvPacket[4], recvPacket[5]);
+                lEndMillis  = getEndMillis(recvPacket[6], recvPacket[7]);
+                lNextDayMillis = getNextDayMillis(lEndMillis);
+                
                 osal_set_event( parsingData_TaskID, EVT_ABSENCE_REGISTER );
                 
                 uint8* responsePacket = getWriteStatePacket();
@@ -157,6 +197,12 @@ bool parsingDataPacket( uint8* recvPacket, uint8 packetLength )
                 return true;
               }
               else if((absenceDataByte & 0x30) == ABSENCE_MODE_SYNC) { // ȭ
+                if(packetLength == PACKET_LENGTH_ABSENCE) {
+                  lightJournal_StartSync(BUILD_UINT16(recvPacket[JOURNAL_SEQ_IDX + 1], recvPacket[JOURNAL_SEQ_IDX]));
+                }
+                else {
+                  lightJournal_StartSync(JOURNAL_SYNC_ALL);
+                }
                 
                 return true;
               }
@@ -165,9 +211,65 @@ bool parsingDataPacket( uint8* recvPacket, uint8 packetLength )
             }
             else if(recvPacket[2] == TYPE_DIMMING) 
             {
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE)
+              if(packetLength != PACKET_LENGTH_ABSENCE) return false;
+              
+              setLightLevel(getPacketLights(recvPacket, 3, 8), recvPacket[DIMMING_LEVEL_IDX],
+                            BUILD_UINT16(recvPacket[DIMMING_FADE_IDX + 1], recvPacket[DIMMING_FADE_IDX]));
+              
+              uint8* responsePacket = getWriteStatePacket();
+              BSProfile_SetParameter(BSPROFILE_CHAR1, PACKET_LENGTH_RESPONSE, responsePacket);
+              notifyCharateristicChanged(BSPROFILE_CHAR1);
+              osal_mem_free(responsePacket);
+              
+              return true;
+#else
+              return false;  // no dimming in this build
+#endif
+            }
+            else if(recvPacket[2] == TYPE_SCHEDULE) 
+            {
+              uint8 op = recvPacket[3] & SCHEDULE_OP_MASK;
+              
+              if(packetLength != PACKET_LENGTH_ABSENCE) return false;
+              
+              if(op == SCHEDULE_OP_CLOCK) {
+                lightSchedule_SetClock(BUILD_UINT32(recvPacket[7], recvPacket[6], recvPacket[5], recvPacket[4]));
+              }
+              else if(op == SCHEDULE_OP_RULE) {
+                scheduleRule_t rule;
+                
+                rule.days = recvPacket[4];
+                rule.hour = recvPacket[5];
+                rule.minute = recvPacket[6];
+                rule.on = (recvPacket[7] != 0);
+                rule.lights = recvPacket[8] & LIGHT_ALL;
+                if(!lightSchedule_SetRule(recvPacket[3] & SCHEDULE_SLOT_MASK, &rule)) return false;
+              }
+              else if(op == SCHEDULE_OP_CLEAR) {
+                lightSchedule_Clear();
+              }
+              else {
+                return false;
+              }
+              
+              uint8* responsePacket = getWriteStatePacket();
+              BSProfile_SetParameter(BSPROFILE_CHAR1, PACKET_LENGTH_RESPONSE, responsePacket);
+              notifyCharateristicChanged(BSPROFILE_CHAR1);
+              osal_mem_free(responsePacket);
               
               return true;
             }
+            else if(recvPacket[2] == TYPE_SCENE) 
+            {
+              return parseScenePacket(recvPacket, packetLength);
+            }
+#if (defined BS_LATENCY_STATS) && (BS_LATENCY_STATS == TRUE)
+            else if(recvPacket[2] == TYPE_STATS) 
+            {
+              return lightStats_ParsePacket(recvPacket, packetLength);
+            }
+#endif
           }
         }
       }
@@ -209,86 +311,250 @@ static uint32 getEndMillis(uint8 endHours, uint8 endMinutes) {
 } 
 
 static void writeDataInBoard(uint8 recvData) {
-  if(check_bit(recvData, LIGHT_ONE)) {
-    setLightOneOn();
-    setLedOneOff();
+  setLightState(recvData & LIGHT_ALL);
+}
+
+void initLightPort( void ) {
+  uint8 ch;
+  
+  lightPortMask = 0;
+  ledPortMask = 0;
+  for(ch = 0; ch < BS_LIGHT_CHANNELS; ch++) {
+    lightPortMask |= lightPortPins[ch];
+    ledPortMask |= ledPortPins[ch];
   }
-  else {
-    setLightOneOff();
-    setLedOneOn();
+  
+  P1SEL &= ~(lightPortMask | ledPortMask);
+  P1DIR |= (lightPortMask | ledPortMask);
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE)
+  HalTimerPwmInit(lightPortPins, BS_LIGHT_CHANNELS);
+#endif
+  setLightState(0);
+}
+
+uint8 getLightState( void ) {
+  uint8 state = 0;
+  uint8 ch;
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE)
+  
+  // the pins follow the PWM, the level tells whether a light is on
+  for(ch = 0; ch < BS_LIGHT_CHANNELS; ch++) {
+    if(HalTimerPwmGet(ch)) state |= LIGHT_BIT(ch);
   }
-  if(check_bit(recvData, LIGHT_TWO)) {
-    setLightTwoOn();
-    setLedTwoOff();
+#else
+  uint8 port = P1;
+  
+  for(ch = 0; ch < BS_LIGHT_CHANNELS; ch++) {
+    if(port & lightPortPins[ch]) state |= LIGHT_BIT(ch);
   }
-  else {
-    setLightTwoOff();
-    setLedTwoOn();
+#endif
+  
+  return state;
+}
+
+void setLightState( uint8 state ) {
+  halIntState_t intState;
+  uint8 out = ledPortMask; // LEDs are active low, a lit light has its LED off
+  uint8 mask = (lightPortMask | ledPortMask);
+  uint8 ch;
+  
+  for(ch = 0; ch < BS_LIGHT_CHANNELS; ch++) {
+    if(state & LIGHT_BIT(ch)) out |= lightPortPins[ch];
+    else out &= ~ledPortPins[ch];
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE)
+    // a dimmed light that stays on keeps its level
+    if(((state & LIGHT_BIT(ch)) != 0) != (HalTimerPwmGet(ch) != 0)) {
+      HalTimerPwmSet(ch, (state & LIGHT_BIT(ch)) ? HAL_TIMER_PWM_LEVEL_MAX : 0, 0);
+    }
+#endif
   }
-  if(check_bit(recvData, LIGHT_THREE)) {
-    setLightThreeOn();
-    setLedThreeOff();
+  
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE)
+  mask = ledPortMask; // the light pins belong to the PWM
+#endif
+  
+  // one store switches every light and LED together, without glitches in between
+  HAL_ENTER_CRITICAL_SECTION(intState);
+  P1 = (P1 & ~mask) | (out & mask);
+  HAL_EXIT_CRITICAL_SECTION(intState);
+  
+  // the state characteristic follows every change, whoever made it
+  state = getLightState();
+  BSProfile_SetParameter(BSPROFILE_STATE, sizeof(uint8), &state);
+}
+
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE)
+void setLightLevel( uint8 lights, uint8 level, uint16 fadeMs ) {
+  uint8 state = getLightState();
+  uint8 ch;
+  
+  for(ch = 0; ch < BS_LIGHT_CHANNELS; ch++) {
+    if(lights & LIGHT_BIT(ch)) HalTimerPwmSet(ch, level, fadeMs);
   }
-  else {
-    setLightThreeOff();
-    setLedThreeOn();
+  
+  // LEDs follow right away, the fade runs on the Timer1 interrupt
+  setLightState(level ? (state | lights) : (state & ~lights));
+}
+#endif
+
+void getLightLevels( uint8* levels ) {
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE)
+  uint8 ch;
+  
+  for(ch = 0; ch < BS_LIGHT_CHANNELS; ch++) {
+    levels[ch] = HalTimerPwmGet(ch);
+  }
+#else
+  uint8 state = getLightState();
+  uint8 ch;
+  
+  for(ch = 0; ch < BS_LIGHT_CHANNELS; ch++) {
+    levels[ch] = (state & LIGHT_BIT(ch)) ? 0xFF : 0;
   }
+#endif
 }
 
-static uint8 getCurrentState() {
-  uint8 currentState = 0x00;
+void setLightLevels( uint8* levels, uint16 fadeMs ) {
+  uint8 state = 0;
+  uint8 ch;
+#if (defined HAL_TIMER_PWM) && (HAL_TIMER_PWM == TRUE)
+  halIntState_t intState;
   
-  if(isLightOneOn()) set_bit(currentState, LIGHT_ONE);
-  if(isLightTwoOn()) set_bit(currentState, LIGHT_TWO);
-  if(isLightThreeOn())  set_bit(currentState, LIGHT_THREE);
+  // every fade starts in the same PWM frame
+  HAL_ENTER_CRITICAL_SECTION(intState);
+  for(ch = 0; ch < BS_LIGHT_CHANNELS; ch++) {
+    HalTimerPwmSet(ch, levels[ch], fadeMs);
+  }
+  HAL_EXIT_CRITICAL_SECTION(intState);
+#else
+  (void)fadeMs;
+#endif
   
-  return currentState;
+  for(ch = 0; ch < BS_LIGHT_CHANNELS; ch++) {
+    if(levels[ch]) state |= LIGHT_BIT(ch);
+  }
+  setLightState(state);
 }
 
-static uint8* getAbsenceStatePacket() {
-  uint8* responsePacket = osal_mem_alloc(PACKET_LENGTH_RESPONSE);
+static bool parseScenePacket(uint8* recvPacket, uint8 packetLength) {
+  uint8 op = recvPacket[3] & SCENE_OP_MASK;
+  uint8 slot = recvPacket[3] & SCENE_SLOT_MASK;
+  bool isLong = (packetLength == PACKET_LENGTH_ABSENCE);
+  lightScene_t scene;
+  uint8 ch;
   
-  responsePacket[0] = STX;
-  responsePacket[1] = 0x00;
-  set_bit(responsePacket[1], 7);
-  if(GetAbsenceMode()) set_bit(responsePacket[1], 0);
-  responsePacket[2] = ETX;
+  if(op == SCENE_OP_RECALL) {
+    return recallScene(slot); // notifies the new state itself
+  }
   
-  return responsePacket;
+  if(op == SCENE_OP_DEFINE) {
+    if(!isLong) return false;
+    
+    for(ch = 0; ch < BS_LIGHT_CHANNELS; ch++) {
+      scene.levels[ch] = (recvPacket[4] & LIGHT_BIT(ch)) ? recvPacket[5] : 0;
+    }
+  }
+  else if(op == SCENE_OP_SAVE) {
+    getLightLevels(scene.levels);
+  }
+  else if(op != SCENE_OP_DELETE) {
+    return false;
+  }
+  
+  if(op == SCENE_OP_DELETE) {
+    if(!lightScene_Delete(slot)) return false;
+  }
+  else {
+    scene.fadeMs = isLong ? BUILD_UINT16(recvPacket[SCENE_FADE_IDX + 1], recvPacket[SCENE_FADE_IDX]) : 0;
+    scene.flags = isLong ? (recvPacket[SCENE_FLAGS_IDX] & SCENE_FLAG_ABSENCE_OFF) : 0;
+    if(!lightScene_Set(slot, &scene)) return false;
+  }
+  
+  uint8* responsePacket = getReadStatePacket();
+  BSProfile_SetParameter(BSPROFILE_CHAR1, PACKET_LENGTH_RESPONSE, responsePacket);
+  notifyCharateristicChanged(BSPROFILE_CHAR1);
+  osal_mem_free(responsePacket);
+  
+  return true;
 }
 
-uint8* getReadStatePacket() {
-  uint8* responsePacket = osal_mem_alloc(PACKET_LENGTH_RESPONSE);
+bool recallScene( uint8 slot ) {
+  lightScene_t scene;
   
-  responsePacket[0] = STX;
-  responsePacket[1] = 0x00;
-  if(isLightOneOn()) set_bit(responsePacket[1], LIGHT_ONE);
-  if(isLightTwoOn()) set_bit(responsePacket[1], LIGHT_TWO);
-  if(isLightThreeOn())  set_bit(responsePacket[1], LIGHT_THREE);
-  responsePacket[2] = ETX;
+  if(!lightScene_Get(slot, &scene)) return false;
   
-  return responsePacket;
+  if((scene.flags & SCENE_FLAG_ABSENCE_OFF) && GetAbsenceMode()) {
+    osal_set_event( parsingData_TaskID, EVT_ABSENCE_UNREGISTER );
+    SetAbsenceMode(false);
+  }
+  
+  setLightLevels(scene.levels, scene.fadeMs);
+  
+  uint8* responsePacket = getWriteStatePacket();
+  BSProfile_SetParameter(BSPROFILE_CHAR1, PACKET_LENGTH_RESPONSE, responsePacket);
+  notifyCharateristicChanged(BSPROFILE_CHAR1);
+  osal_mem_free(responsePacket);
+  
+  return true;
 }
 
-uint8* getWriteStatePacket() {
+static uint8 getPacketLights(uint8* recvPacket, uint8 flagsIdx, uint8 spareIdx) {
+#if BS_LIGHT_CHANNELS <= 3
+  (void)spareIdx;
+  return (recvPacket[flagsIdx] & LIGHT_ALL);
+#else
+  (void)flagsIdx;
+  return (recvPacket[spareIdx] & LIGHT_ALL);
+#endif
+}
+
+static uint8* getStatePacket(uint8 flags, uint8 lights) {
   uint8* responsePacket = osal_mem_alloc(PACKET_LENGTH_RESPONSE);
   
   responsePacket[0] = STX;
-  responsePacket[1] = 0x00;
-  set_bit(responsePacket[1], 7);
-  if(isLightOneOn()) set_bit(responsePacket[1], LIGHT_ONE);
-  if(isLightTwoOn()) set_bit(responsePacket[1], LIGHT_TWO);
-  if(isLightThreeOn()) set_bit(responsePacket[1], LIGHT_THREE);
-  responsePacket[1] = ( responsePacket[1] | ABSENCE_MODE_ON );
-  responsePacket[2] = ETX;
+#if BS_LIGHT_CHANNELS <= 3
+  responsePacket[1] = flags | lights;
+#else
+  responsePacket[1] = flags;
+  responsePacket[2] = lights;
+#endif
+  responsePacket[PACKET_LENGTH_RESPONSE - 1] = ETX;
   
   return responsePacket;
 }
 
+static uint8* getAbsenceStatePacket() {
+  uint8 flags = BV(7);
+  
+  if(GetAbsenceMode()) set_bit(flags, 0);
+  
+  return getStatePacket(flags, 0);
+}
+
+uint8* getReadStatePacket() {
+  return getStatePacket(0, getLightState());
+}
+
+uint8* getWriteStatePacket() {
+  return getStatePacket((BV(7) | ABSENCE_MODE_ON), getLightState());
+}
+
 uint16 parsingData_ProcessEvent( uint8 task_id, uint16 events )
 {
   VOID task_id; // OSAL required parameter that isn't used in this function
   
+#if (defined BS_LATENCY_STATS) && (BS_LATENCY_STATS == TRUE)
+  // the end of a connection event is taken before counting, it is no event of the command
+  if( events & EVT_STATS_CONN_EVENT )
+  {
+    lightStats_ProcessConnEvent();
+    
+    return ( events ^ EVT_STATS_CONN_EVENT );
+  }
+#endif
+  
+  lightStats_Event();
+  
   if ( events & SYS_EVENT_MSG )
   {
     uint8 *pMsg;
@@ -325,7 +591,8 @@ uint16 parsingData_ProcessEvent( uint8 task_id, uint16 events )
   
   if( events & EVT_ABSENCE_LIGHT_ON )
   {
-    writeDataInBoard(absenceDataByte);
+    writeDataInBoard(absenceLights);
+    lightJournal_Record(JOURNAL_SRC_ABSENCE);
     
     osal_stop_timerEx( parsingData_TaskID, EVT_ABSENCE_LIGHT_ON );
     osal_start_timerEx( parsingData_TaskID, EVT_ABSENCE_LIGHT_OFF, lEndMillis );
@@ -335,7 +602,8 @@ uint16 parsingData_ProcessEvent( uint8 task_id, uint16 events )
   
   if( events & EVT_ABSENCE_LIGHT_OFF )
   {
-    writeDataInBoard((!absenceDataByte));
+    writeDataInBoard(0);
+    lightJournal_Record(JOURNAL_SRC_ABSENCE);
     
     osal_stop_timerEx( parsingData_TaskID, EVT_ABSENCE_LIGHT_OFF );
     osal_start_timerEx( parsingData_TaskID, EVT_ABSENCE_LIGHT_ON, lNextDayMillis );
@@ -343,6 +611,36 @@ uint16 parsingData_ProcessEvent( uint8 task_id, uint16 events )
     return ( events ^ EVT_ABSENCE_LIGHT_OFF );
   }
   
+  if( events & EVT_SCHEDULE_DUE )
+  {
+    lightSchedule_ProcessDue();
+    
+    return ( events ^ EVT_SCHEDULE_DUE );
+  }
+  
+  if( events & EVT_JOURNAL_SYNC )
+  {
+    lightJournal_ProcessSync();
+    
+    return ( events ^ EVT_JOURNAL_SYNC );
+  }
+  
+#if (defined BS_RELAY) && (BS_RELAY == TRUE)
+  if( events & EVT_RELAY_TX )
+  {
+    lightRelay_ProcessTx();
+    
+    return ( events ^ EVT_RELAY_TX );
+  }
+  
+  if( events & EVT_RELAY_SCAN )
+  {
+    lightRelay_ProcessScan();
+    
+    return ( events ^ EVT_RELAY_SCAN );
+  }
+#endif
+  
   return 0;
 }
 
@@ -350,6 +648,12 @@ static void parsingData_ProcessOSALMsg( osal_event_hdr_t *pMsg )
 {
   switch ( pMsg->event )
   {
+#if (defined BS_RELAY) && (BS_RELAY == TRUE)
+  case GAP_MSG_EVENT:
+    lightRelay_ProcessGapMsg( (gapEventHdr_t *)pMsg );
+    break;
+    
+#endif
   default:
     // do nothing
     break;
@@ -15,51 +15,56 @@
 #define inver_bit(data, pos)            ((data) ^= (0x1<<(pos)))
 #define check_bit(data, pos)            ((data) & (0x1<<(pos)))
 
-#define isLightOneOn()                  (PORT_LIGHT_ONE != 0)
-#define isLightTwoOn()                  (PORT_LIGHT_TWO != 0)
-#define isLightThreeOn()                (PORT_LIGHT_THREE != 0)
+// State bit of a light channel (0 = first gang); the first gang is the highest bit
+#define LIGHT_BIT(ch)                   BV(BS_LIGHT_CHANNELS - 1 - (ch))
 
-#define setLightOneOn()                 (PORT_LIGHT_ONE = 1)
-#define setLightTwoOn()                 (PORT_LIGHT_TWO = 1)
-#define setLightThreeOn()               (PORT_LIGHT_THREE = 1)
-
-#define setLightOneOff()                (PORT_LIGHT_ONE = 0)
-#define setLightTwoOff()                (PORT_LIGHT_TWO = 0)
-#define setLightThreeOff()              (PORT_LIGHT_THREE = 0)
-
-#define setLedOneOn()                   (PORT_LED_ONE = 0)
-#define setLedTwoOn()                   (PORT_LED_TWO = 0)
-#define setLedThreeOn()                 (PORT_LED_THREE = 0)
-
-#define setLedOneOff()                  (PORT_LED_ONE = 1)
-#define setLedTwoOff()                  (PORT_LED_TWO = 1)
-#define setLedThreeOff()                (PORT_LED_THREE = 1)
+#define toggleLights(mask)              setLightState(getLightState() ^ (mask))
 
 
 /*********************************************************************
  * CONSTANTS
  */
 
+// Number of gangs of the board. Each gang has a light output (active high)
+// and an indicator LED (active low) on Port 1, mapped below.
+#if !defined BS_LIGHT_CHANNELS
+#define BS_LIGHT_CHANNELS               3
+#endif
+
+// Port 1 pins of each gang, first gang first. A LED pin of 0 means the gang has no LED.
+#if BS_LIGHT_CHANNELS == 3
+#define LIGHT_PORT_PINS                 { BV(5), BV(6), BV(7) }
+#define LED_PORT_PINS                   { BV(0), BV(1), BV(2) }
+#elif BS_LIGHT_CHANNELS == 4
+#define LIGHT_PORT_PINS                 { BV(4), BV(5), BV(6), BV(7) }
+#define LED_PORT_PINS                   { BV(0), BV(1), BV(2), BV(3) }
+#elif BS_LIGHT_CHANNELS == 6
+#define LIGHT_PORT_PINS                 { BV(2), BV(3), BV(4), BV(5), BV(6), BV(7) }
+#define LED_PORT_PINS                   { BV(0), BV(1), 0, 0, 0, 0 }
+#else
+#error "No Port 1 pin map for this BS_LIGHT_CHANNELS"
+#endif
+
+#define LIGHT_ALL                       ((uint8)(BV(BS_LIGHT_CHANNELS) - 1))
+
+// Up to 3 gangs share the data byte with the packet flags (bit 3 and up),
+// more gangs carry their state bits in the spare byte that follows it.
+#if BS_LIGHT_CHANNELS <= 3
 #define PACKET_LENGTH_RESPONSE          3
+#else
+#define PACKET_LENGTH_RESPONSE          4
+#endif
 #define HEADER_LENGTH                   4
 #define PACKET_LENGTH_NORMAL            6
 #define PACKET_LENGTH_ABSENCE           10
 
-#define PORT_LED_ONE                    P1_0
-#define PORT_LED_TWO                    P1_1
-#define PORT_LED_THREE                  P1_2
-
-#define PORT_LIGHT_ONE                  P1_5
-#define PORT_LIGHT_TWO                  P1_6
-#define PORT_LIGHT_THREE                P1_7
-
 #define PORT_INPUT_SWITCH_ONE           P0_4
 #define PORT_INPUT_SWITCH_TWO           P0_5
 #define PORT_INPUT_SWITCH_THREE         P0_6
 
-#define LIGHT_ONE                       2
-#define LIGHT_TWO                       1   
-#define LIGHT_THREE                     0
+#define LIGHT_ONE                       (BS_LIGHT_CHANNELS - 1)
+#define LIGHT_TWO                       (BS_LIGHT_CHANNELS - 2)
+#define LIGHT_THREE                     (BS_LIGHT_CHANNELS - 3)
 
 #define ABSENCE_MODE_CHECK              0x00
 #define ABSENCE_MODE_ON                 0x10
@@ -72,6 +77,44 @@
 #define TYPE_WIDGET                     0x08
 #define TYPE_ABSENCE                    0x10
 #define TYPE_DIMMING                    0x20
+#define TYPE_SCHEDULE                   0x40
+#define TYPE_SCENE                      0x80
+#define TYPE_RELAY                      0x03  // not a flag, a command for another switch
+#define TYPE_STATS                      0x05  // not a flag, command statistics (BS_LATENCY_STATS)
+
+// TYPE_RELAY from the phone: bytes 3-4 the target switch id, then a whole normal or
+// absence-length packet for it. The target's state comes back the same way, with its id.
+
+// TYPE_DIMMING comes in an absence-length packet, lights as in TYPE_ABSENCE,
+// level 0-255 and the fade time in msec (big endian)
+#define DIMMING_LEVEL_IDX               4
+#define DIMMING_FADE_IDX                5
+
+// TYPE_SCHEDULE comes in an absence-length packet, byte 3 holds the operation and the slot.
+//   clock: bytes 4-7 seconds since 2000-01-01 local time (big endian)
+//   rule:  byte 4 weekday mask (bit 0 = Sunday), 5 hour, 6 minute, 7 on (non-zero) / off, 8 lights
+#define SCHEDULE_OP_MASK                0xF0
+#define SCHEDULE_SLOT_MASK              0x0F
+#define SCHEDULE_OP_CLOCK               0x00
+#define SCHEDULE_OP_RULE                0x10
+#define SCHEDULE_OP_CLEAR               0x20
+
+// TYPE_SCENE, byte 3 holds the operation and the slot. Recall, save and delete also come
+// in a normal packet; define needs an absence-length packet.
+//   define: byte 4 lights, 5 their level (the others off), 6-7 fade msec (big endian), 8 SCENE_FLAG_*
+//   save:   the current lights and levels, with fade and flags as in define when given
+#define SCENE_OP_MASK                   0xF0
+#define SCENE_SLOT_MASK                 0x0F
+#define SCENE_OP_RECALL                 0x00
+#define SCENE_OP_DEFINE                 0x10
+#define SCENE_OP_SAVE                   0x20
+#define SCENE_OP_DELETE                 0x30
+#define SCENE_FADE_IDX                  6
+#define SCENE_FLAGS_IDX                 8
+
+// ABSENCE_MODE_SYNC in an absence-length packet asks for the journal entries after
+// the sequence in bytes 4-5 (big endian); a normal packet asks for the whole journal.
+#define JOURNAL_SEQ_IDX                 4
 
 #define STX                             0xF0
 #define ETX                             0xE0
@@ -80,10 +123,15 @@
 #define EVT_ABSENCE_LIGHT_OFF           0x02
 #define EVT_ABSENCE_REGISTER            0x04
 #define EVT_ABSENCE_UNREGISTER          0x08
+#define EVT_SCHEDULE_DUE                0x10
+#define EVT_JOURNAL_SYNC                0x20
+#define EVT_RELAY_TX                    0x40
+#define EVT_RELAY_SCAN                  0x80
+#define EVT_STATS_CONN_EVENT            0x0100
 
 #define MILLIS_MINUTE                   60000
 #define MILLIS_HOUR                     (MILLIS_MINUTE * 60)
-#define MILLIS_DAY                      (MILLIS_HOUR * 60)
+#define MILLIS_DAY                      (MILLIS_HOUR * 24)
    
 /*********************************************************************
  * FUNCTIONS
@@ -105,3 +153,38 @@ extern uint16 parsingData_ProcessEvent( uint8 task_id, uint16 events );
 extern uint8* getWriteStatePacket();
 
 extern uint8* getReadStatePacket();
+
+/*
+ * Light state as a bit mask of LIGHT_BIT(ch)
+ */
+extern uint8 getLightState( void );
+
+/*
+ * Switch all lights and their LEDs at once with a single Port 1 write
+ */
+extern void setLightState( uint8 state );
+
+/*
+ * Configure the light and LED pins as outputs, all lights off
+ */
+extern void initLightPort( void );
+
+/*
+ * Fade the masked lights to a level (0 = off) on the PWM, HAL_TIMER_PWM only
+ */
+extern void setLightLevel( uint8 lights, uint8 level, uint16 fadeMs );
+
+/*
+ * Level of every channel, 0 (off) to 255; without PWM a lit light reads 255
+ */
+extern void getLightLevels( uint8* levels );
+
+/*
+ * Apply a level to every channel at once, fading where the PWM is built in
+ */
+extern void setLightLevels( uint8* levels, uint16 fadeMs );
+
+/*
+ * Apply a stored scene and notify the new state, false if the slot is empty
+ */
+extern bool recallScene( uint8 slot );
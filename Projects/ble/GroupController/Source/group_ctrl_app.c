@@ -0,0 +1,1092 @@
+/**************************************************************************************************
+  Filename:       group_ctrl_app.c
+
+  Description:    This file contains the BlueSwitch Group Controller application.
+                  It keeps a link to every switch of a group and writes one
+                  command to all of them from a single central.
+**************************************************************************************************/
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "OSAL_PwrMgr.h"
+#include "OnBoard.h"
+#include "hal_board.h"
+#if (defined HAL_KEY) && (HAL_KEY == TRUE)
+#include "hal_key.h"
+#endif
+#if (defined HAL_LED) && (HAL_LED == TRUE)
+#include "hal_led.h"
+#endif
+#if (defined HAL_LCD) && (HAL_LCD == TRUE)
+#include "hal_lcd.h"
+#endif
+#include "osal_snv.h"
+#include "gatt.h"
+#include "gatt_uuid.h"
+#include "ll.h"
+#include "hci.h"
+#include "gapgattserver.h"
+#include "gattservapp.h"
+#include "central.h"
+#include "BSGATTprofile.h"
+#include "group_ctrl_app.h"
+
+/*********************************************************************
+ * MACROS
+ */
+
+// Length of bd addr as a string
+#define B_ADDR_STR_LEN                        15
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Maximum number of scan responses
+#define DEFAULT_MAX_SCAN_RES                  8
+
+// Scan duration in ms
+#define DEFAULT_SCAN_DURATION                 4000
+
+// Discovey mode (limited, general, all)
+#define DEFAULT_DISCOVERY_MODE                DEVDISC_MODE_ALL
+
+// TRUE to use active scan
+#define DEFAULT_DISCOVERY_ACTIVE_SCAN         TRUE
+
+// TRUE to use white list during discovery
+#define DEFAULT_DISCOVERY_WHITE_LIST          FALSE
+
+// TRUE to use high scan duty cycle when creating link
+#define DEFAULT_LINK_HIGH_DUTY_CYCLE          FALSE
+
+// TRUE to use white list when creating link
+#define DEFAULT_LINK_WHITE_LIST               FALSE
+
+// Supervision timeout value (units of 10ms)
+#define DEFAULT_GROUP_CONN_TIMEOUT            600
+
+// Reject Connection Parameter Update request received from a switch,
+// a switch asking for its own interval would spread the group over several intervals
+#define DEFAULT_GROUP_REJECT_CONN_PARAMS      TRUE
+
+// No member in this slot
+#define GROUP_ADDR_TYPE_NONE                  0xFF
+
+// No link is being established
+#define GROUP_IDX_NONE                        0xFF
+
+// Link states
+enum
+{
+  GROUP_LINK_IDLE,                    // Waiting for its turn to connect
+  GROUP_LINK_CONNECTING,
+  GROUP_LINK_DISC_SVC,                // Service discovery
+  GROUP_LINK_DISC_CHAR,               // Characteristic discovery
+  GROUP_LINK_READY                    // Takes group commands
+};
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// A switch of the group as kept in SNV. The value handle of its
+// characteristic 1 is cached so a reconnect skips discovery.
+typedef struct
+{
+  uint8 addr[B_ADDR_LEN];
+  uint8 addrType;
+  uint16 valueHandle;
+} groupMember_t;
+
+typedef struct
+{
+  groupMember_t member[GROUP_MAX_LINKS];
+} groupList_t;
+
+typedef struct
+{
+  uint8 state;
+  uint16 connHandle;
+  uint16 svcStartHdl;
+  uint16 svcEndHdl;
+} groupLink_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// Task ID for internal task/event processing
+static uint8 groupCtrlTaskId;
+
+// GAP GATT Attributes
+static const uint8 groupCtrlDeviceName[GAP_DEVICE_NAME_LEN] = "Group Controller";
+
+// Scanning state
+static uint8 groupCtrlScanning = FALSE;
+
+static groupList_t groupList;
+
+static groupLink_t groupLinks[GROUP_MAX_LINKS];
+
+// Member being connected, links are established one at a time
+static uint8 groupConnIdx = GROUP_IDX_NONE;
+
+// Last lights sent to the group
+static uint8 groupLights = 0;
+
+static uint8 groupCtrlAddr[B_ADDR_LEN] = { 0 };
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+static void groupCtrlProcessGATTMsg( gattMsgEvent_t *pPkt );
+static void groupCtrlEventCB( gapCentralRoleEvent_t *pEvent );
+#if (defined HAL_KEY) && (HAL_KEY == TRUE)
+static void groupCtrl_HandleKeys( uint8 shift, uint8 keys );
+#endif
+static void groupCtrl_ProcessOSALMsg( osal_event_hdr_t *pMsg );
+static void groupCtrlConnectNext( void );
+static void groupCtrlLinkUp( uint8 idx );
+static void groupCtrlSvcDiscoveryMsg( uint8 idx, gattMsgEvent_t *pMsg );
+static void groupCtrlCharDiscoveryMsg( uint8 idx, gattMsgEvent_t *pMsg );
+static void groupCtrlDevDiscovery( void );
+static bool groupCtrlFindServUUID( uint8 *pData, uint8 dataLen );
+static void groupCtrlAddMember( uint8 *pAddr, uint8 addrType );
+static void groupCtrlForget( void );
+static void groupCtrlEnableNoti( uint16 connHandle, uint16 handle );
+static uint8 groupCtrlFindLink( uint16 connHandle );
+static uint8 groupCtrlReadyCount( void );
+static void groupCtrlShowGroup( void );
+char *bdAddr2Str ( uint8 *pAddr );
+
+/*********************************************************************
+ * PROFILE CALLBACKS
+ */
+
+// GAP Role Callbacks
+static const gapCentralRoleCB_t groupCtrlRoleCB =
+{
+  NULL,             // RSSI callback
+  groupCtrlEventCB  // Event callback
+};
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      GroupCtrl_Init
+ *
+ * @brief   Initialization function for the Group Controller App Task.
+ *          This is called during initialization and should contain
+ *          any application specific initialization (ie. hardware
+ *          initialization/setup, table initialization, power up
+ *          notification).
+ *
+ * @param   task_id - the ID assigned by OSAL.  This ID should be
+ *                    used to send messages and set timers.
+ *
+ * @return  none
+ */
+void GroupCtrl_Init( uint8 task_id )
+{
+  uint8 i;
+
+  groupCtrlTaskId = task_id;
+
+  // Setup Central Profile
+  {
+    uint8 scanRes = DEFAULT_MAX_SCAN_RES;
+    GAPCentralRole_SetParameter ( GAPCENTRALROLE_MAX_SCAN_RES, sizeof( uint8 ), &scanRes );
+  }
+
+  // Setup GAP
+  GAP_SetParamValue( TGAP_GEN_DISC_SCAN, DEFAULT_SCAN_DURATION );
+  GAP_SetParamValue( TGAP_LIM_DISC_SCAN, DEFAULT_SCAN_DURATION );
+  GAP_SetParamValue( TGAP_REJECT_CONN_PARAMS, DEFAULT_GROUP_REJECT_CONN_PARAMS );
+
+  // Every link is created with the same interval
+  GAP_SetParamValue( TGAP_CONN_EST_INT_MIN, GROUP_CONN_INTERVAL );
+  GAP_SetParamValue( TGAP_CONN_EST_INT_MAX, GROUP_CONN_INTERVAL );
+  GAP_SetParamValue( TGAP_CONN_EST_SUPERV_TIMEOUT, DEFAULT_GROUP_CONN_TIMEOUT );
+
+  GGS_SetParameter( GGS_DEVICE_NAME_ATT, GAP_DEVICE_NAME_LEN, (uint8 *) groupCtrlDeviceName );
+
+  // Load the group, an empty one the first time
+  if ( osal_snv_read( GROUP_NVID_MEMBERS, sizeof( groupList_t ), &groupList ) != SUCCESS )
+  {
+    osal_memset( &groupList, GROUP_ADDR_TYPE_NONE, sizeof( groupList_t ) );
+  }
+
+  for ( i = 0; i < GROUP_MAX_LINKS; i++ )
+  {
+    groupLinks[i].state = GROUP_LINK_IDLE;
+    groupLinks[i].connHandle = GAP_CONNHANDLE_INIT;
+  }
+
+  // Initialize GATT Client
+  VOID GATT_InitClient();
+
+  // Register to receive incoming ATT Indications/Notifications
+  GATT_RegisterForInd( task_id );
+
+#if (defined HAL_KEY) && (HAL_KEY == TRUE)
+  // Register for all key events - This app will handle all key events
+  RegisterForKeys( task_id );
+#endif
+#if (defined HAL_LED) && (HAL_LED == TRUE)
+  HalLedSet( (HAL_LED_1 | HAL_LED_2), HAL_LED_MODE_OFF );
+#endif
+
+  // Setup a delayed profile startup
+  osal_set_event( task_id, START_DEVICE_EVT );
+}
+
+/*********************************************************************
+ * @fn      GroupCtrl_ProcessEvent
+ *
+ * @brief   Group Controller Application Task event processor.  This
+ *          function is called to process all events for the task.
+ *          Events include timers, messages and any other user defined
+ *          events.
+ *
+ * @param   task_id  - The OSAL assigned task ID.
+ * @param   events - events to process.  This is a bit map and can
+ *                   contain more than one event.
+ *
+ * @return  events not processed
+ */
+uint16 GroupCtrl_ProcessEvent( uint8 task_id, uint16 events )
+{
+  if ( events & SYS_EVENT_MSG )
+  {
+    uint8 *pMsg;
+
+    if ( (pMsg = osal_msg_receive( task_id )) != NULL )
+    {
+      groupCtrl_ProcessOSALMsg( (osal_event_hdr_t *)pMsg );
+      VOID osal_msg_deallocate( pMsg );
+    }
+
+    return (events ^ SYS_EVENT_MSG);
+  }
+
+  if ( events & DEV_DISCOVERY_EVT )
+  {
+    groupCtrlDevDiscovery();
+
+    return ( events ^ DEV_DISCOVERY_EVT );
+  }
+
+  if ( events & CONNECT_EVT )
+  {
+    groupCtrlConnectNext();
+
+    return ( events ^ CONNECT_EVT );
+  }
+
+  if ( events & CONNECT_TIMEOUT_EVT )
+  {
+    // Cancel the pending link, GAP_LINK_ESTABLISHED_EVENT moves on to the next switch
+    if ( groupConnIdx != GROUP_IDX_NONE )
+    {
+      VOID GAPCentralRole_TerminateLink( GAP_CONNHANDLE_INIT );
+    }
+
+    return ( events ^ CONNECT_TIMEOUT_EVT );
+  }
+
+  if ( events & START_DEVICE_EVT )
+  {
+    VOID GAPCentralRole_StartDevice( (gapCentralRoleCB_t *) &groupCtrlRoleCB );
+
+    return ( events ^ START_DEVICE_EVT );
+  }
+
+  return 0;
+}
+
+/*********************************************************************
+ * @fn      GroupCtrl_SendAll
+ *
+ * @brief   Write a BlueSwitch packet to every switch that is ready.
+ *          Write commands are queued without waiting for responses,
+ *          and all links share one interval, so the switches get the
+ *          packet within the same connection interval.
+ *
+ * @param   pPacket - packet to write
+ * @param   len - packet length
+ *
+ * @return  number of switches the packet was queued for
+ */
+uint8 GroupCtrl_SendAll( uint8 *pPacket, uint8 len )
+{
+  attWriteReq_t req;
+  uint8 i, sent = 0;
+
+  if ( len > ATT_MTU_SIZE - 3 )
+  {
+    return 0;
+  }
+
+  req.len = len;
+  req.sig = FALSE;
+  req.cmd = TRUE;
+  osal_memcpy( req.value, pPacket, len );
+
+  for ( i = 0; i < GROUP_MAX_LINKS; i++ )
+  {
+    if ( groupLinks[i].state == GROUP_LINK_READY )
+    {
+      req.handle = groupList.member[i].valueHandle;
+
+      if ( GATT_WriteNoRsp( groupLinks[i].connHandle, &req ) == SUCCESS )
+      {
+        sent++;
+      }
+    }
+  }
+
+  return sent;
+}
+
+/*********************************************************************
+ * @fn      GroupCtrl_SetLights
+ *
+ * @brief   Switch lights of every switch of the group.
+ *
+ * @param   lights - bit mask of the lights, bit 0 is the first gang
+ * @param   on - TRUE to switch them on
+ *
+ * @return  number of switches the command was queued for
+ */
+uint8 GroupCtrl_SetLights( uint8 lights, bool on )
+{
+  uint8 packet[GROUP_PKT_LEN];
+
+  if ( on )
+  {
+    groupLights |= lights;
+  }
+  else
+  {
+    groupLights &= ~lights;
+  }
+
+  packet[0] = GROUP_PKT_STX;
+  packet[1] = GROUP_PKT_LEN - 4;
+  packet[2] = GROUP_PKT_TYPE_SWITCH;
+  packet[3] = GROUP_PKT_WRITE | (groupLights & 0x07);
+  packet[4] = groupLights;
+  packet[5] = GROUP_PKT_ETX;
+
+  return GroupCtrl_SendAll( packet, GROUP_PKT_LEN );
+}
+
+/*********************************************************************
+ * @fn      groupCtrl_ProcessOSALMsg
+ *
+ * @brief   Process an incoming task message.
+ *
+ * @param   pMsg - message to process
+ *
+ * @return  none
+ */
+static void groupCtrl_ProcessOSALMsg( osal_event_hdr_t *pMsg )
+{
+  switch ( pMsg->event )
+  {
+#if (defined HAL_KEY) && (HAL_KEY == TRUE)
+  case KEY_CHANGE:
+    groupCtrl_HandleKeys( ((keyChange_t *)pMsg)->state, ((keyChange_t *)pMsg)->keys );
+    break;
+#endif
+
+  case GATT_MSG_EVENT:
+    groupCtrlProcessGATTMsg( (gattMsgEvent_t *) pMsg );
+    break;
+  }
+}
+
+#if (defined HAL_KEY) && (HAL_KEY == TRUE)
+/*********************************************************************
+ * @fn      groupCtrl_HandleKeys
+ *
+ * @brief   Handles all key events for this device.
+ *
+ * @param   shift - true if in shift/alt.
+ * @param   keys - bit field for key events.
+ *
+ * @return  none
+ */
+static void groupCtrl_HandleKeys( uint8 shift, uint8 keys )
+{
+  uint8 sent;  // switches the group command went to
+
+  (void)shift;  // Intentionally unreferenced parameter
+
+  if ( keys & HAL_KEY_UP )  // Look for switches to add to the group
+  {
+    if ( !groupCtrlScanning )
+    {
+      (void)osal_set_event(groupCtrlTaskId, DEV_DISCOVERY_EVT);
+    }
+    else
+    {
+      GAPCentralRole_CancelDiscovery();
+    }
+  }
+
+  if ( keys & HAL_KEY_RIGHT )  // All lights on
+  {
+    sent = GroupCtrl_SetLights( 0xFF, TRUE );
+    LCD_WRITE_STRING_VALUE( "All On", sent, 10, HAL_LCD_LINE_3 );
+  }
+
+  if ( keys & HAL_KEY_LEFT )  // All lights off
+  {
+    sent = GroupCtrl_SetLights( 0xFF, FALSE );
+    LCD_WRITE_STRING_VALUE( "All Off", sent, 10, HAL_LCD_LINE_3 );
+  }
+
+  if ( keys & HAL_KEY_CENTER )  // Toggle the group
+  {
+    bool on = (groupLights == 0);
+
+    sent = GroupCtrl_SetLights( 0xFF, on );
+    LCD_WRITE_STRING_VALUE( on ? "All On" : "All Off", sent, 10, HAL_LCD_LINE_3 );
+  }
+
+  if ( keys & HAL_KEY_DOWN )  // Forget the group
+  {
+    groupCtrlForget();
+  }
+}
+#endif
+
+/*********************************************************************
+ * @fn      groupCtrlProcessGATTMsg
+ *
+ * @brief   Process GATT messages
+ *
+ * @return  none
+ */
+static void groupCtrlProcessGATTMsg( gattMsgEvent_t *pPkt )
+{
+  uint8 idx = groupCtrlFindLink( pPkt->connHandle );
+
+  if ( idx == GROUP_IDX_NONE )
+  {
+    return;  // In case a GATT message came after a connection has dropped, ignore the message.
+  }
+
+  switch ( pPkt->method )
+  {
+    case ATT_FIND_BY_TYPE_VALUE_RSP:
+      groupCtrlSvcDiscoveryMsg( idx, pPkt );
+      break;
+
+    case ATT_READ_BY_TYPE_RSP:
+      groupCtrlCharDiscoveryMsg( idx, pPkt );
+      break;
+
+    case ATT_HANDLE_VALUE_NOTI:
+      // A switch reports its lights, e.g. after a button press
+      if ( pPkt->hdr.status == SUCCESS )
+      {
+        attHandleValueNoti_t *pNoti = &(pPkt->msg.handleValueNoti);
+
+        // Only a state packet, other notifications of the characteristic (journal, relay)
+        // are longer or carry other flags
+        if ( ( pNoti->len == GROUP_RSP_LEN_SHARED || pNoti->len == GROUP_RSP_LEN_SPARE ) &&
+             pNoti->value[0] == GROUP_PKT_STX && pNoti->value[pNoti->len - 1] == GROUP_PKT_ETX )
+        {
+          uint8 flags = pNoti->value[1];
+          uint8 lights;
+
+          if ( pNoti->len == GROUP_RSP_LEN_SHARED )
+          {
+            lights = flags & GROUP_RSP_LIGHTS_SHARED;
+            flags &= ~GROUP_RSP_LIGHTS_SHARED;
+          }
+          else
+          {
+            lights = pNoti->value[2];
+          }
+
+          if ( flags == 0 || flags == GROUP_RSP_FLAGS_WRITE )
+          {
+            LCD_WRITE_STRING_VALUE( "Switch", idx + 1, 10, HAL_LCD_LINE_2 );
+            LCD_WRITE_STRING_VALUE( "Lights", lights, 16, HAL_LCD_LINE_3 );
+          }
+        }
+      }
+      break;
+
+    case ATT_ERROR_RSP:
+      // Service or characteristic missing, leave the switch connected but out of the group
+      if ( groupLinks[idx].state == GROUP_LINK_DISC_SVC || groupLinks[idx].state == GROUP_LINK_DISC_CHAR )
+      {
+        groupLinks[idx].state = GROUP_LINK_IDLE;
+        LCD_WRITE_STRING( "BS Svc NotFound", HAL_LCD_LINE_3 );
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+/*********************************************************************
+ * @fn      groupCtrlEventCB
+ *
+ * @brief   Central event callback function.
+ *
+ * @param   pEvent - pointer to event structure
+ *
+ * @return  none
+ */
+static void groupCtrlEventCB( gapCentralRoleEvent_t *pEvent )
+{
+  switch ( pEvent->gap.opcode )
+  {
+    case GAP_DEVICE_INIT_DONE_EVENT:
+      {
+        VOID osal_memcpy( groupCtrlAddr, pEvent->initDone.devAddr, B_ADDR_LEN );
+
+        groupCtrlShowGroup();
+
+        (void)osal_set_event(groupCtrlTaskId, CONNECT_EVT);
+      }
+      break;
+
+    case GAP_DEVICE_INFO_EVENT:
+      {
+        // Only BlueSwitch switches advertise its service
+        if ( groupCtrlFindServUUID( pEvent->deviceInfo.pEvtData, pEvent->deviceInfo.dataLen ) )
+        {
+          groupCtrlAddMember( pEvent->deviceInfo.addr, pEvent->deviceInfo.addrType );
+        }
+      }
+      break;
+
+    case GAP_DEVICE_DISCOVERY_EVENT:
+      {
+        // discovery complete
+        groupCtrlScanning = FALSE;
+
+        groupCtrlShowGroup();
+
+        (void)osal_set_event(groupCtrlTaskId, CONNECT_EVT);
+      }
+      break;
+
+    case GAP_LINK_ESTABLISHED_EVENT:
+      {
+        uint8 idx = groupConnIdx;
+
+        VOID osal_stop_timerEx( groupCtrlTaskId, CONNECT_TIMEOUT_EVT );
+        groupConnIdx = GROUP_IDX_NONE;
+
+        if ( idx != GROUP_IDX_NONE )
+        {
+          if ( pEvent->gap.hdr.status == SUCCESS )
+          {
+            groupLinks[idx].connHandle = pEvent->linkCmpl.connectionHandle;
+            groupCtrlLinkUp( idx );
+          }
+          else
+          {
+            groupLinks[idx].state = GROUP_LINK_IDLE;
+          }
+        }
+
+        // Next switch, a switch that failed gets another try after the others
+        (void)osal_set_event(groupCtrlTaskId, CONNECT_EVT);
+      }
+      break;
+
+    case GAP_LINK_TERMINATED_EVENT:
+      {
+        uint8 idx = groupCtrlFindLink( pEvent->linkTerminate.connectionHandle );
+
+        if ( idx != GROUP_IDX_NONE )
+        {
+          groupLinks[idx].state = GROUP_LINK_IDLE;
+          groupLinks[idx].connHandle = GAP_CONNHANDLE_INIT;
+
+          VOID osal_start_timerEx( groupCtrlTaskId, CONNECT_EVT, GROUP_RECONNECT_DELAY );
+        }
+
+        groupCtrlShowGroup();
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+/*********************************************************************
+ * @fn      groupCtrlConnectNext
+ *
+ * @brief   Start a link to the next member that has none.
+ *
+ * @return  none
+ */
+static void groupCtrlConnectNext( void )
+{
+  static uint8 nextIdx = 0;
+  uint8 n;
+
+  if ( groupConnIdx != GROUP_IDX_NONE || groupCtrlScanning )
+  {
+    return;  // Picked up again when the link or the scan is done
+  }
+
+  // Round robin, so a switch out of range does not hold back the others
+  for ( n = 0; n < GROUP_MAX_LINKS; n++ )
+  {
+    uint8 idx = nextIdx;
+
+    nextIdx = (nextIdx + 1) % GROUP_MAX_LINKS;
+
+    if ( groupList.member[idx].addrType != GROUP_ADDR_TYPE_NONE &&
+         groupLinks[idx].state == GROUP_LINK_IDLE &&
+         groupLinks[idx].connHandle == GAP_CONNHANDLE_INIT )
+    {
+      if ( GAPCentralRole_EstablishLink( DEFAULT_LINK_HIGH_DUTY_CYCLE,
+                                         DEFAULT_LINK_WHITE_LIST,
+                                         groupList.member[idx].addrType,
+                                         groupList.member[idx].addr ) == SUCCESS )
+      {
+        groupConnIdx = idx;
+        groupLinks[idx].state = GROUP_LINK_CONNECTING;
+
+        VOID osal_start_timerEx( groupCtrlTaskId, CONNECT_TIMEOUT_EVT, GROUP_CONNECT_TIMEOUT );
+
+        LCD_WRITE_STRING( "Connecting", HAL_LCD_LINE_1 );
+        LCD_WRITE_STRING( bdAddr2Str( groupList.member[idx].addr ), HAL_LCD_LINE_2 );
+      }
+      else
+      {
+        VOID osal_start_timerEx( groupCtrlTaskId, CONNECT_EVT, GROUP_RECONNECT_DELAY );
+      }
+
+      return;
+    }
+  }
+}
+
+/*********************************************************************
+ * @fn      groupCtrlLinkUp
+ *
+ * @brief   A switch is connected. A cached handle is used as is,
+ *          otherwise the BlueSwitch service is discovered first.
+ *
+ * @return  none
+ */
+static void groupCtrlLinkUp( uint8 idx )
+{
+  groupLink_t *pLink = &groupLinks[idx];
+
+  if ( groupList.member[idx].valueHandle != 0 )
+  {
+    pLink->state = GROUP_LINK_READY;
+
+    // The CCCD follows the value
+    groupCtrlEnableNoti( pLink->connHandle, groupList.member[idx].valueHandle + 1 );
+
+    groupCtrlShowGroup();
+  }
+  else
+  {
+    uint8 uuid[ATT_BT_UUID_SIZE] = { LO_UINT16( BSPROFILE_SERV_UUID ), HI_UINT16( BSPROFILE_SERV_UUID ) };
+
+    pLink->state = GROUP_LINK_DISC_SVC;
+    pLink->svcStartHdl = pLink->svcEndHdl = 0;
+
+    if ( GATT_DiscPrimaryServiceByUUID( pLink->connHandle, uuid, ATT_BT_UUID_SIZE,
+                                        groupCtrlTaskId ) != SUCCESS )
+    {
+      VOID GAPCentralRole_TerminateLink( pLink->connHandle );
+    }
+  }
+}
+
+/*********************************************************************
+ * @fn      groupCtrlSvcDiscoveryMsg
+ *
+ * @brief   Process GATT Primary Service discovery message
+ *
+ * @return  none
+ */
+static void groupCtrlSvcDiscoveryMsg( uint8 idx, gattMsgEvent_t *pMsg )
+{
+  groupLink_t *pLink = &groupLinks[idx];
+
+  if ( pLink->state != GROUP_LINK_DISC_SVC )
+  {
+    return;
+  }
+
+  if ( pMsg->hdr.status == SUCCESS )
+  {
+    attFindByTypeValueRsp_t *pRsp = &(pMsg->msg.findByTypeValueRsp);
+
+    if ( pRsp->numInfo > 0 )
+    {
+      pLink->svcStartHdl = pRsp->handlesInfo[0].handle;
+      pLink->svcEndHdl = pRsp->handlesInfo[0].grpEndHandle;
+    }
+  }
+  else if ( pMsg->hdr.status == bleProcedureComplete )
+  {
+    if ( pLink->svcStartHdl != 0 )
+    {
+      attReadByTypeReq_t req;
+
+      req.startHandle = pLink->svcStartHdl;
+      req.endHandle = pLink->svcEndHdl;
+      req.type.len = ATT_BT_UUID_SIZE;
+      req.type.uuid[0] = LO_UINT16( BSPROFILE_CHAR1_UUID );
+      req.type.uuid[1] = HI_UINT16( BSPROFILE_CHAR1_UUID );
+
+      pLink->state = GROUP_LINK_DISC_CHAR;
+
+      if ( GATT_DiscCharsByUUID( pLink->connHandle, &req, groupCtrlTaskId ) != SUCCESS )
+      {
+        VOID GAPCentralRole_TerminateLink( pLink->connHandle );
+      }
+    }
+    else
+    {
+      pLink->state = GROUP_LINK_IDLE;
+      LCD_WRITE_STRING( "BS Svc NotFound", HAL_LCD_LINE_3 );
+    }
+  }
+}
+
+/*********************************************************************
+ * @fn      groupCtrlCharDiscoveryMsg
+ *
+ * @brief   Process GATT Characteristic discovery message
+ *
+ * @return  none
+ */
+static void groupCtrlCharDiscoveryMsg( uint8 idx, gattMsgEvent_t *pMsg )
+{
+  groupLink_t *pLink = &groupLinks[idx];
+
+  if ( pLink->state != GROUP_LINK_DISC_CHAR )
+  {
+    return;
+  }
+
+  if ( pMsg->hdr.status == SUCCESS )
+  {
+    attReadByTypeRsp_t *pRsp = &(pMsg->msg.readByTypeRsp);
+
+    if ( pRsp->numPairs > 0 )
+    {
+      groupList.member[idx].valueHandle = BUILD_UINT16(pRsp->dataList[3], pRsp->dataList[4]);
+    }
+  }
+  else if ( pMsg->hdr.status == bleProcedureComplete )
+  {
+    if ( groupList.member[idx].valueHandle != 0 )
+    {
+      // Keep the handle, the next connection goes straight to READY
+      VOID osal_snv_write( GROUP_NVID_MEMBERS, sizeof( groupList_t ), &groupList );
+
+      groupCtrlLinkUp( idx );
+    }
+    else
+    {
+      pLink->state = GROUP_LINK_IDLE;
+      LCD_WRITE_STRING( "BS CharNotFound", HAL_LCD_LINE_3 );
+    }
+  }
+}
+
+/*********************************************************************
+ * @fn      groupCtrlDevDiscovery
+ *
+ * @brief   Scan for switches to add to the group.
+ *
+ * @return  none
+ */
+static void groupCtrlDevDiscovery( void )
+{
+  groupCtrlScanning = TRUE;
+
+  LCD_WRITE_STRING( "Discovering...", HAL_LCD_LINE_1 );
+  LCD_WRITE_STRING( "", HAL_LCD_LINE_2 );
+  LCD_WRITE_STRING( "", HAL_LCD_LINE_3 );
+
+  GAPCentralRole_StartDiscovery( DEFAULT_DISCOVERY_MODE,
+                                 DEFAULT_DISCOVERY_ACTIVE_SCAN,
+                                 DEFAULT_DISCOVERY_WHITE_LIST );
+}
+
+/*********************************************************************
+ * @fn      groupCtrlFindServUUID
+ *
+ * @brief   Find the BlueSwitch Service UUID in an advertiser's service UUID list.
+ *
+ * @return  TRUE if service UUID found
+ */
+static bool groupCtrlFindServUUID( uint8 *pData, uint8 dataLen )
+{
+  uint8 adLen;
+  uint8 adType;
+  uint8 *pEnd;
+
+  pEnd = pData + dataLen - 1;
+
+  // While end of data not reached
+  while ( pData < pEnd )
+  {
+    // Get length of next AD item
+    adLen = *pData++;
+    if ( adLen > 0 )
+    {
+      adType = *pData;
+
+      if ( adType == GAP_ADTYPE_16BIT_MORE || adType == GAP_ADTYPE_16BIT_COMPLETE )
+      {
+        pData++;
+        adLen--;
+
+        while ( (adLen >= ATT_BT_UUID_SIZE) && (pData < pEnd) )     // For each UUID in list.
+        {
+          if ( pData[0] == LO_UINT16( BSPROFILE_SERV_UUID ) &&
+               pData[1] == HI_UINT16( BSPROFILE_SERV_UUID ) )
+          {
+            return TRUE;  // Match found
+          }
+
+          // Go to next
+          pData += ATT_BT_UUID_SIZE;
+          adLen -= ATT_BT_UUID_SIZE;
+        }
+
+        // Handle possible erroneous extra byte in UUID list
+        if ( adLen == 1 )
+        {
+          pData++;
+        }
+      }
+      else  // Go to next item
+      {
+        pData += adLen;
+      }
+    }
+  }
+
+  return FALSE;  // Match not found
+}
+
+/*********************************************************************
+ * @fn      groupCtrlAddMember
+ *
+ * @brief   Add a switch to the group, if it is new and there is room.
+ *
+ * @return  none
+ */
+static void groupCtrlAddMember( uint8 *pAddr, uint8 addrType )
+{
+  uint8 i, freeIdx = GROUP_IDX_NONE;
+
+  for ( i = 0; i < GROUP_MAX_LINKS; i++ )
+  {
+    if ( groupList.member[i].addrType == GROUP_ADDR_TYPE_NONE )
+    {
+      if ( freeIdx == GROUP_IDX_NONE )
+      {
+        freeIdx = i;
+      }
+    }
+    else if ( osal_memcmp( pAddr, groupList.member[i].addr, B_ADDR_LEN ) )
+    {
+      return;
+    }
+  }
+
+  if ( freeIdx != GROUP_IDX_NONE )
+  {
+    osal_memcpy( groupList.member[freeIdx].addr, pAddr, B_ADDR_LEN );
+    groupList.member[freeIdx].addrType = addrType;
+    groupList.member[freeIdx].valueHandle = 0;
+
+    VOID osal_snv_write( GROUP_NVID_MEMBERS, sizeof( groupList_t ), &groupList );
+  }
+}
+
+/*********************************************************************
+ * @fn      groupCtrlForget
+ *
+ * @brief   Drop every link and the stored group.
+ *
+ * @return  none
+ */
+static void groupCtrlForget( void )
+{
+  uint8 i;
+
+  if ( groupConnIdx != GROUP_IDX_NONE )
+  {
+    VOID GAPCentralRole_TerminateLink( GAP_CONNHANDLE_INIT );
+  }
+
+  for ( i = 0; i < GROUP_MAX_LINKS; i++ )
+  {
+    if ( groupLinks[i].connHandle != GAP_CONNHANDLE_INIT )
+    {
+      VOID GAPCentralRole_TerminateLink( groupLinks[i].connHandle );
+    }
+  }
+
+  // Terminations that follow find no member and do not reconnect
+  osal_memset( &groupList, GROUP_ADDR_TYPE_NONE, sizeof( groupList_t ) );
+  VOID osal_snv_write( GROUP_NVID_MEMBERS, sizeof( groupList_t ), &groupList );
+
+  groupLights = 0;
+
+  LCD_WRITE_STRING( "Group Cleared", HAL_LCD_LINE_3 );
+}
+
+/*********************************************************************
+ * @fn      groupCtrlEnableNoti
+ *
+ * @brief   Enable notification on a switch
+ *
+ * @return  none
+ */
+static void groupCtrlEnableNoti( uint16 connHandle, uint16 handle )
+{
+  attWriteReq_t req;
+
+  req.handle = handle;
+  req.len = 2;
+  req.sig = FALSE;
+  req.cmd = TRUE;
+
+  req.value[0] = LO_UINT16(GATT_CLIENT_CFG_NOTIFY);
+  req.value[1] = HI_UINT16(GATT_CLIENT_CFG_NOTIFY);
+
+  VOID GATT_WriteNoRsp(connHandle, &req);
+}
+
+/*********************************************************************
+ * @fn      groupCtrlFindLink
+ *
+ * @brief   Find the member a connection belongs to.
+ *
+ * @return  member index, GROUP_IDX_NONE if none
+ */
+static uint8 groupCtrlFindLink( uint16 connHandle )
+{
+  uint8 i;
+
+  if ( connHandle == GAP_CONNHANDLE_INIT )
+  {
+    return GROUP_IDX_NONE;
+  }
+
+  for ( i = 0; i < GROUP_MAX_LINKS; i++ )
+  {
+    if ( groupLinks[i].connHandle == connHandle )
+    {
+      return i;
+    }
+  }
+
+  return GROUP_IDX_NONE;
+}
+
+/*********************************************************************
+ * @fn      groupCtrlReadyCount
+ *
+ * @brief   Number of switches that take group commands.
+ *
+ * @return  count
+ */
+static uint8 groupCtrlReadyCount( void )
+{
+  uint8 i, n = 0;
+
+  for ( i = 0; i < GROUP_MAX_LINKS; i++ )
+  {
+    if ( groupLinks[i].state == GROUP_LINK_READY )
+    {
+      n++;
+    }
+  }
+
+  return n;
+}
+
+/*********************************************************************
+ * @fn      groupCtrlShowGroup
+ *
+ * @brief   Show the number of members and of ready switches.
+ *
+ * @return  none
+ */
+static void groupCtrlShowGroup( void )
+{
+#if (defined HAL_LCD) && (HAL_LCD == TRUE)
+  uint8 i, members = 0;
+
+  for ( i = 0; i < GROUP_MAX_LINKS; i++ )
+  {
+    if ( groupList.member[i].addrType != GROUP_ADDR_TYPE_NONE )
+    {
+      members++;
+    }
+  }
+
+  LCD_WRITE_STRING_VALUE( "Group Members", members, 10, HAL_LCD_LINE_1 );
+  LCD_WRITE_STRING_VALUE( "Ready", groupCtrlReadyCount(), 10, HAL_LCD_LINE_2 );
+#endif
+}
+
+/*********************************************************************
+ * @fn      bdAddr2Str
+ *
+ * @brief   Convert Bluetooth address to string
+ *
+ * @return  none
+ */
+char *bdAddr2Str( uint8 *pAddr )
+{
+  uint8       i;
+  char        hex[] = "0123456789ABCDEF";
+  static char str[B_ADDR_STR_LEN];
+  char        *pStr = str;
+
+  *pStr++ = '0';
+  *pStr++ = 'x';
+
+  // Start from end of addr
+  pAddr += B_ADDR_LEN;
+
+  for ( i = B_ADDR_LEN; i > 0; i-- )
+  {
+    *pStr++ = hex[*--pAddr >> 4];
+    *pStr++ = hex[*pAddr & 0x0F];
+  }
+
+  *pStr = 0;
+
+  return str;
+}
+
+/*********************************************************************
+*********************************************************************/
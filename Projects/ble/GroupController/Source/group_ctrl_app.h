@@ -0,0 +1,106 @@
+/**************************************************************************************************
+  Filename:       group_ctrl_app.h
+
+  Description:    This file contains the BlueSwitch Group Controller application
+                  definitions and prototypes.
+**************************************************************************************************/
+#ifndef GROUP_CTRL_APP_H
+#define GROUP_CTRL_APP_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*********************************************************************
+ * INCLUDES
+ */
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// Group Controller Task Events
+#define CONNECT_TIMEOUT_EVT                           0x0008
+#define DEV_DISCOVERY_EVT                             0x0004
+#define CONNECT_EVT                                   0x0002
+#define START_DEVICE_EVT                              0x0001
+
+// Switches kept connected at once; the link layer of a central holds MAX_NUM_LL_CONN links
+#if !defined GROUP_MAX_LINKS
+#define GROUP_MAX_LINKS                               MAX_NUM_LL_CONN
+#endif
+
+// SNV item holding the group members and their cached handles
+#define GROUP_NVID_MEMBERS                            0x80
+
+// Every link runs at this interval (units of 1.25ms), so one group command
+// goes out to all switches within a single interval
+#define GROUP_CONN_INTERVAL                           80
+
+#define GROUP_CONNECT_TIMEOUT                         3000 // msec, a switch out of range is skipped
+#define GROUP_RECONNECT_DELAY                         5000 // msec
+
+// BlueSwitch switch packet: STX, data length, TYPE_SWITCH, flags | lights, lights, ETX.
+// Bit 7 of the flags writes the lights; up to 3 gangs read the flags byte, more gangs the next one.
+#define GROUP_PKT_LEN                                 6
+#define GROUP_PKT_STX                                 0xF0
+#define GROUP_PKT_ETX                                 0xE0
+#define GROUP_PKT_TYPE_SWITCH                         0x01
+#define GROUP_PKT_WRITE                               0x80
+
+// BlueSwitch state packet, notified after a write or a read: STX, flags | lights, ETX for up
+// to 3 gangs, STX, flags, lights, ETX for more. A write is answered with GROUP_RSP_FLAGS_WRITE,
+// a read with no flags.
+#define GROUP_RSP_LEN_SHARED                          3
+#define GROUP_RSP_LEN_SPARE                           4
+#define GROUP_RSP_LIGHTS_SHARED                       0x07
+#define GROUP_RSP_FLAGS_WRITE                         0x90
+
+/*********************************************************************
+ * MACROS
+ */
+
+// LCD macros
+#if HAL_LCD == TRUE
+#define LCD_WRITE_STRING(str, option)                       HalLcdWriteString( (str), (option))
+#define LCD_WRITE_SCREEN(line1, line2)                      HalLcdWriteScreen( (line1), (line2) )
+#define LCD_WRITE_STRING_VALUE(title, value, format, line)  HalLcdWriteStringValue( (title), (value), (format), (line) )
+#else
+#define LCD_WRITE_STRING(str, option)
+#define LCD_WRITE_SCREEN(line1, line2)
+#define LCD_WRITE_STRING_VALUE(title, value, format, line)
+#endif
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+/*
+ * Task Initialization for the BLE Application
+ */
+extern void GroupCtrl_Init( uint8 task_id );
+
+/*
+ * Task Event Processor for the BLE Application
+ */
+extern uint16 GroupCtrl_ProcessEvent( uint8 task_id, uint16 events );
+
+/*
+ * Write one packet to every connected switch of the group, returns the number of switches
+ */
+extern uint8 GroupCtrl_SendAll( uint8 *pPacket, uint8 len );
+
+/*
+ * Switch the given lights of every switch on or off
+ */
+extern uint8 GroupCtrl_SetLights( uint8 lights, bool on );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GROUP_CTRL_APP_H
+
+/*********************************************************************
+*********************************************************************/
@@ -37,6 +37,7 @@
   contact Texas Instruments Incorporated at www.TI.com.
 **************************************************************************************************/
 
+
 /*********************************************************************
  * INCLUDES
  */
@@ -128,27 +129,58 @@
 // TRUE to filter discovery results on desired service UUID
 #define DEFAULT_DEV_DISC_BY_SVC_UUID          FALSE
 
-// Application states
-enum
-{
-  BLE_STATE_IDLE,
-  BLE_STATE_CONNECTING,
-  BLE_STATE_CONNECTED,
-  BLE_STATE_DISCONNECTING
-};
+// No target slot
+#define OAD_IDX_NONE                          0xFF
 
-// Discovery states
+#if (OAD_MGR_WINDOW > OAD_WINDOW_MAX) || (OAD_MGR_WINDOW == 0)
+#error "OAD_MGR_WINDOW must be 1 to OAD_WINDOW_MAX blocks"
+#endif
+
+// Target states
 enum
 {
-  BLE_DISC_STATE_IDLE,                // Idle
-  BLE_DISC_STATE_SVC,                 // Service discovery
-  BLE_DISC_STATE_CHAR                 // Characteristic discovery
+  OAD_TARGET_IDLE,                    // Slot is free
+  OAD_TARGET_CONNECTING,
+  OAD_TARGET_DISC_SVC,                // Service discovery
+  OAD_TARGET_DISC_CCC,                // CCCD discovery
+  OAD_TARGET_DISC_CHAR,               // Characteristic discovery
+  OAD_TARGET_DOWNLOAD,                // The target requests image blocks
+  OAD_TARGET_DONE,                    // Completed, failed or refused
+  OAD_TARGET_DISCONNECTING
 };
 
 /*********************************************************************
  * TYPEDEFS
  */
 
+// One OAD Target. The blocks of the window it asked for last are read
+// from flash in one go, and sent while any of them is still missing.
+typedef struct
+{
+  uint8 state;
+  uint8 discStart;                    // The discovery procedure of the state is still to start
+  uint16 connHandle;
+  uint8 addr[B_ADDR_LEN];
+
+  uint16 svcStartHdl;
+  uint16 svcEndHdl;
+  uint8 discIdx;
+  uint8 cccIdx;
+  uint16 handles[OAD_CHAR_CNT];
+  uint16 cccHandles[OAD_CHAR_CNT];
+
+  uint16 blkNum;                      // First block the target is missing
+  uint16 winEnd;                      // End of the window it asked for
+  uint32 missing;                     // Blocks of the window still to send, bit 0 is blkNum
+  uint8 buf[OAD_MGR_WINDOW * OAD_BLOCK_SIZE];
+  uint8 polls;                        // Requests repeated without an answer
+
+  uint16 blkSent;                     // Blocks written, repeats included
+  uint32 startTime;                   // msec
+  uint32 lastTime;                    // msec, last block request
+  uint32 endTime;                     // msec, last block written
+} oadTarget_t;
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -181,29 +213,18 @@ static gapDevRec_t oadManagerDevList[DEFAULT_MAX_SCAN_RES];
 // Scanning state
 static uint8 oadManagerScanning = FALSE;
 
-// Connection handle of current connection
-static uint16 oadManagerConnHandle = GAP_CONNHANDLE_INIT;
-
-// Application state
-static uint8 oadManagerState = BLE_STATE_IDLE;
-
-static uint8 oadManagerDiscIdx;
+// Targets, and the one whose link is being established
+static oadTarget_t oadTargets[OAD_MGR_MAX_LINKS];
+static uint8 oadManagerConnIdx = OAD_IDX_NONE;
 
-static uint16 oadManagerHandles[OAD_CHAR_CNT];
+// Connect every scan result in turn
+static uint8 oadManagerConnectAll = FALSE;
 
-static uint16 oadBlkNum, oadBlkTot;
+// Blocks of the image, the same for every target
+static uint16 oadBlkTot;
 
 static uint8 oadManagerAddr[B_ADDR_LEN] = { 0 };
 
-// Service handles used during discovery
-static uint16 oadSvcStartHdl;
-static uint16 oadSvcEndHdl;
-
-static uint8 oadManagerCCCIdx;
-
-// CCCD handles used to enable notifications
-static uint16 oadManagerCCCHandles[OAD_CHAR_CNT];
-
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
@@ -213,19 +234,32 @@ static void oadManagerEventCB( gapCentralRoleEvent_t *pEvent );
 static void oadManager_HandleKeys( uint8 shift, uint8 keys );
 #endif
 static void oadManager_ProcessOSALMsg( osal_event_hdr_t *pMsg );
-static void oadManagerSvcDiscoveryMsg( gattMsgEvent_t *pMsg );
-static void oadManagerCCCDiscoveryMsg( gattMsgEvent_t *pMsg );
-static void oadManagerCharDiscoveryMsg( gattMsgEvent_t *pMsg );
-static void oadManagerErrorRsp( attErrorRsp_t *pRsp );
-static void oadManagerSvcDiscovery( void );
-static void oadManagerCCCDiscovery( void );
-static void oadManagerCharDiscovery( void );
+static void oadManagerSvcDiscoveryMsg( uint8 idx, gattMsgEvent_t *pMsg );
+static void oadManagerCCCDiscoveryMsg( uint8 idx, gattMsgEvent_t *pMsg );
+static void oadManagerCharDiscoveryMsg( uint8 idx, gattMsgEvent_t *pMsg );
+static void oadManagerErrorRsp( uint8 idx, attErrorRsp_t *pRsp );
+static void oadManagerStartDisc( uint8 state, uint16 event );
+static bStatus_t oadManagerSvcDiscovery( uint8 idx );
+static bStatus_t oadManagerCCCDiscovery( uint8 idx );
+static bStatus_t oadManagerCharDiscovery( uint8 idx );
 static void oadManagerDevDiscovery( void );
 static bool oadManagerFindServUUID( uint8 *pData, uint8 dataLen );
 static void oadManagerAddDeviceInfo( uint8 *pAddr, uint8 addrType );
-static void oadManagerEnableNoti( uint16 handle );
-static void oadManagerHandleNoti(attHandleValueNoti_t *pNoti);
-static void oadManagerSendImgNotify(void);
+static void oadManagerConnect( uint8 scanIdx );
+static void oadManagerConnectNext( void );
+static uint8 oadManagerFindTarget( uint16 connHandle );
+static uint8 oadManagerFindAddr( uint8 *pAddr );
+static void oadManagerEnableNoti( uint16 connHandle, uint16 handle );
+static void oadManagerHandleNoti( uint8 idx, attHandleValueNoti_t *pNoti );
+static void oadManagerSendImgNotify( uint8 idx );
+static void oadManagerPrefetch( oadTarget_t *pTarget, uint16 blkNum, uint8 win );
+static bStatus_t oadManagerSendBlock( oadTarget_t *pTarget );
+static void oadManagerPump( void );
+static void oadManagerPoll( oadTarget_t *pTarget );
+static void oadManagerWatchdog( void );
+static void oadManagerDownloadEnd( uint8 idx );
+static uint8 oadManagerDownloading( void );
+static void oadManagerShowProgress( void );
 char *bdAddr2Str ( uint8 *pAddr );
 
 #include "sbl_exec_uart.c"
@@ -261,8 +295,16 @@ static const gapCentralRoleCB_t oadManagerRoleCB =
  */
 void OADManager_Init( uint8 task_id )
 {
+  uint8 i;
+
   oadManagerTaskId = task_id;
 
+  for ( i = 0; i < OAD_MGR_MAX_LINKS; i++ )
+  {
+    oadTargets[i].state = OAD_TARGET_IDLE;
+    oadTargets[i].connHandle = GAP_CONNHANDLE_INIT;
+  }
+
   // Setup Central Profile
   {
     uint8 scanRes = DEFAULT_MAX_SCAN_RES;
@@ -272,8 +314,8 @@ void OADManager_Init( uint8 task_id )
   // Setup GAP
   GAP_SetParamValue( TGAP_GEN_DISC_SCAN, DEFAULT_SCAN_DURATION );
   GAP_SetParamValue( TGAP_LIM_DISC_SCAN, DEFAULT_SCAN_DURATION );
-  GAP_SetParamValue( TGAP_REJECT_CONN_PARAMS, DEFAULT_OAD_REJECT_CONN_PARAMS ); 
-  
+  GAP_SetParamValue( TGAP_REJECT_CONN_PARAMS, DEFAULT_OAD_REJECT_CONN_PARAMS );
+
   GGS_SetParameter( GGS_DEVICE_NAME_ATT, GAP_DEVICE_NAME_LEN, (uint8 *) oadManagerDeviceName );
 
   // Initialize GATT Client
@@ -322,6 +364,13 @@ uint16 OADManager_ProcessEvent( uint8 task_id, uint16 events )
     return (events ^ SYS_EVENT_MSG);
   }
 
+  if ( events & OAD_SEND_EVT )
+  {
+    oadManagerPump();
+
+    return ( events ^ OAD_SEND_EVT );
+  }
+
   if ( events & DEV_DISCOVERY_EVT )
   {
     oadManagerDevDiscovery();
@@ -331,36 +380,34 @@ uint16 OADManager_ProcessEvent( uint8 task_id, uint16 events )
 
   if ( events & SVC_DISCOVERY_EVT )
   {
-    oadManagerSvcDiscovery();
+    oadManagerStartDisc( OAD_TARGET_DISC_SVC, SVC_DISCOVERY_EVT );
 
     return ( events ^ SVC_DISCOVERY_EVT );
   }
 
   if ( events & CCC_DISCOVERY_EVT )
   {
-    oadManagerCCCDiscovery();
+    oadManagerStartDisc( OAD_TARGET_DISC_CCC, CCC_DISCOVERY_EVT );
 
     return ( events ^ CCC_DISCOVERY_EVT );
   }
 
   if ( events & CHAR_DISCOVERY_EVT )
   {
-    oadManagerCharDiscovery();
+    oadManagerStartDisc( OAD_TARGET_DISC_CHAR, CHAR_DISCOVERY_EVT );
 
     return ( events ^ CHAR_DISCOVERY_EVT );
   }
 
-  if ( events & CONN_INTERVAL_EVT )
+  if ( events & CONNECT_TIMEOUT_EVT )
   {
-    (void)osal_set_event(oadManagerTaskId, SVC_DISCOVERY_EVT);
-
-    GAPCentralRole_UpdateLink( oadManagerConnHandle,
-                               DEFAULT_OAD_MIN_CONN_INTERVAL,
-                               DEFAULT_OAD_MAX_CONN_INTERVAL,
-                               DEFAULT_OAD_SLAVE_LATENCY,
-                               DEFAULT_OAD_CONN_TIMEOUT );
+    // Cancel the pending link, GAP_LINK_ESTABLISHED_EVENT moves on to the next target
+    if ( oadManagerConnIdx != OAD_IDX_NONE )
+    {
+      VOID GAPCentralRole_TerminateLink( GAP_CONNHANDLE_INIT );
+    }
 
-    return ( events ^ CONN_INTERVAL_EVT );
+    return ( events ^ CONNECT_TIMEOUT_EVT );
   }
 
   if ( events & START_DEVICE_EVT )
@@ -373,16 +420,13 @@ uint16 OADManager_ProcessEvent( uint8 task_id, uint16 events )
 
   if ( events & OAD_DOWNLOAD_EVT )
   {
-#if (defined HAL_LCD) && (HAL_LCD == TRUE)
-    if ( (oadBlkNum + 1) >= oadBlkTot )
-    {
-      LCD_WRITE_STRING("OAD Completed!", HAL_LCD_LINE_3);
-    }
-    else
+    oadManagerWatchdog();
+    oadManagerShowProgress();
+
+    if ( oadManagerDownloading() )
     {
-      LCD_WRITE_STRING("OAD Failed!", HAL_LCD_LINE_3);
+      VOID osal_start_timerEx( oadManagerTaskId, OAD_DOWNLOAD_EVT, OAD_PROGRESS_PERIOD );
     }
-#endif
 
     return ( events ^ OAD_DOWNLOAD_EVT );
   }
@@ -405,11 +449,7 @@ static void oadManager_ProcessOSALMsg( osal_event_hdr_t *pMsg )
   {
 #if (defined HAL_KEY) && (HAL_KEY == TRUE)
   case KEY_CHANGE:
-    // Make sure the OAD download timer is not running
-    if ( osal_get_timeoutEx( oadManagerTaskId, OAD_DOWNLOAD_EVT ) == 0 )
-    {
-      oadManager_HandleKeys( ((keyChange_t *)pMsg)->state, ((keyChange_t *)pMsg)->keys );
-    }
+    oadManager_HandleKeys( ((keyChange_t *)pMsg)->state, ((keyChange_t *)pMsg)->keys );
     break;
 #endif
 
@@ -438,7 +478,7 @@ static void oadManager_HandleKeys( uint8 shift, uint8 keys )
 
   if ( keys & HAL_KEY_UP )  // Start or stop discovery
   {
-    if ( oadManagerState != BLE_STATE_CONNECTED )
+    if ( oadManagerConnIdx == OAD_IDX_NONE )
     {
       if ( !oadManagerScanning )
       {
@@ -470,70 +510,66 @@ static void oadManager_HandleKeys( uint8 shift, uint8 keys )
     }
   }
 
-  if ( keys & HAL_KEY_RIGHT )
+  if ( keys & HAL_KEY_RIGHT )  // Update every device found, as many at once as there are links
   {
+    if ( !oadManagerScanning && oadManagerScanRes > 0 )
+    {
+      oadManagerConnectAll = TRUE;
+      oadManagerConnectNext();
+    }
   }
 
   if ( keys & HAL_KEY_CENTER )
   {
-    uint8 addrType;
-    uint8 *peerAddr;
-
-    // Connect or disconnect
-    if ( oadManagerState == BLE_STATE_IDLE )
+    // Connect the selected device, or disconnect it
+    if ( oadManagerScanIdx < oadManagerScanRes )
     {
-      // if there is a scan result
-      if ( oadManagerScanRes > 0 )
-      {
-        if ( oadManagerScanIdx < oadManagerScanRes )
-        {
-          // connect to current device in scan result
-          peerAddr = oadManagerDevList[oadManagerScanIdx].addr;
-          addrType = oadManagerDevList[oadManagerScanIdx].addrType;
+      uint8 idx = oadManagerFindAddr( oadManagerDevList[oadManagerScanIdx].addr );
 
-          oadManagerState = BLE_STATE_CONNECTING;
+      if ( idx == OAD_IDX_NONE )
+      {
+        oadManagerConnect( oadManagerScanIdx );
+      }
+      else if ( oadTargets[idx].state != OAD_TARGET_DISCONNECTING )
+      {
+        // A link still being established is cancelled with the initial handle
+        VOID GAPCentralRole_TerminateLink( oadTargets[idx].connHandle );
 
-          GAPCentralRole_EstablishLink( DEFAULT_LINK_HIGH_DUTY_CYCLE,
-                                        DEFAULT_LINK_WHITE_LIST,
-                                        addrType, peerAddr );
+        if ( oadTargets[idx].connHandle != GAP_CONNHANDLE_INIT )
+        {
+          oadTargets[idx].state = OAD_TARGET_DISCONNECTING;
+        }
 
 #if (defined HAL_LCD) && (HAL_LCD == TRUE)
-          LCD_WRITE_STRING( "Connecting", HAL_LCD_LINE_1 );
-          LCD_WRITE_STRING( bdAddr2Str( peerAddr ), HAL_LCD_LINE_2 );
-        }
-        else
-        {
-          LCD_WRITE_STRING( "Select device", HAL_LCD_LINE_3 );
+        LCD_WRITE_STRING( "Disconnecting", HAL_LCD_LINE_1 );
+        LCD_WRITE_STRING( bdAddr2Str( oadTargets[idx].addr ), HAL_LCD_LINE_2 );
+        LCD_WRITE_STRING( "", HAL_LCD_LINE_3 );
 #endif
-        }
       }
     }
-    else if ( oadManagerState == BLE_STATE_CONNECTING || oadManagerState == BLE_STATE_CONNECTED )
-    {
-      // disconnect
-      oadManagerState = BLE_STATE_DISCONNECTING;
-
-      VOID GAPCentralRole_TerminateLink( oadManagerConnHandle );
-
 #if (defined HAL_LCD) && (HAL_LCD == TRUE)
-      LCD_WRITE_STRING( "Disconnecting", HAL_LCD_LINE_1 );
-      LCD_WRITE_STRING( "", HAL_LCD_LINE_2 );
-      LCD_WRITE_STRING( "", HAL_LCD_LINE_3 );
-#endif
+    else
+    {
+      LCD_WRITE_STRING( "Select device", HAL_LCD_LINE_3 );
     }
+#endif
   }
 
   if ( keys & HAL_KEY_DOWN )
   {
+    // The serial boot loader holds the CPU, which would break every download
+    if ( !oadManagerDownloading() )
+    {
 #if (defined HAL_LCD) && (HAL_LCD == TRUE)
-    LCD_WRITE_STRING("SBL Mode...", HAL_LCD_LINE_3);
+      LCD_WRITE_STRING("SBL Mode...", HAL_LCD_LINE_3);
 #endif
-    EA = 0;
-    sblRun();
-    EA = 1;
+      EA = 0;
+      sblRun();
+      EA = 1;
 #if (defined HAL_LCD) && (HAL_LCD == TRUE)
-    LCD_WRITE_STRING("SBL Done.", HAL_LCD_LINE_3);
+      LCD_WRITE_STRING("SBL Done.", HAL_LCD_LINE_3);
 #endif
+    }
   }
 }
 #endif
@@ -547,7 +583,10 @@ static void oadManager_HandleKeys( uint8 shift, uint8 keys )
  */
 static void oadManagerProcessGATTMsg( gattMsgEvent_t *pPkt )
 {
-  if (oadManagerState != BLE_STATE_CONNECTED)
+  uint8 idx = oadManagerFindTarget( pPkt->connHandle );
+
+  if ( ( idx == OAD_IDX_NONE ) || ( oadTargets[idx].state < OAD_TARGET_DISC_SVC ) ||
+       ( oadTargets[idx].state == OAD_TARGET_DISCONNECTING ) )
   {
     return;  // In case a GATT message came after a connection has dropped, ignore the message.
   }
@@ -555,27 +594,27 @@ static void oadManagerProcessGATTMsg( gattMsgEvent_t *pPkt )
   switch (pPkt->method)
   {
     case ATT_FIND_BY_TYPE_VALUE_RSP:
-      oadManagerSvcDiscoveryMsg( pPkt );
+      oadManagerSvcDiscoveryMsg( idx, pPkt );
       break;
 
     case ATT_FIND_INFO_RSP:
-      oadManagerCCCDiscoveryMsg( pPkt );
+      oadManagerCCCDiscoveryMsg( idx, pPkt );
       break;
 
     case ATT_READ_BY_TYPE_RSP:
-      oadManagerCharDiscoveryMsg( pPkt );
+      oadManagerCharDiscoveryMsg( idx, pPkt );
       break;
 
     case ATT_HANDLE_VALUE_NOTI:
     case ATT_HANDLE_VALUE_IND:
       if (pPkt->hdr.status == SUCCESS)
       {
-        oadManagerHandleNoti(&(pPkt->msg.handleValueNoti));
+        oadManagerHandleNoti( idx, &(pPkt->msg.handleValueNoti) );
       }
       break;
 
    case ATT_ERROR_RSP:
-      oadManagerErrorRsp( &(pPkt->msg.errorRsp) );
+      oadManagerErrorRsp( idx, &(pPkt->msg.errorRsp) );
       break;
 
     default:
@@ -648,36 +687,68 @@ static void oadManagerEventCB( gapCentralRoleEvent_t *pEvent )
 
     case GAP_LINK_ESTABLISHED_EVENT:
       {
-        if ( pEvent->gap.hdr.status == SUCCESS )
+        uint8 idx = oadManagerConnIdx;
+
+        VOID osal_stop_timerEx( oadManagerTaskId, CONNECT_TIMEOUT_EVT );
+        oadManagerConnIdx = OAD_IDX_NONE;
+
+        if ( idx != OAD_IDX_NONE )
         {
-          oadManagerState = BLE_STATE_CONNECTED;
-          oadManagerConnHandle = pEvent->linkCmpl.connectionHandle;
+          oadTarget_t *pTarget = &oadTargets[idx];
+
+          if ( pEvent->gap.hdr.status == SUCCESS )
+          {
+            pTarget->connHandle = pEvent->linkCmpl.connectionHandle;
+            pTarget->state = OAD_TARGET_DISC_SVC;
+            pTarget->discStart = TRUE;
 
-          (void)osal_set_event(oadManagerTaskId, CONN_INTERVAL_EVT);
+            GAPCentralRole_UpdateLink( pTarget->connHandle,
+                                       DEFAULT_OAD_MIN_CONN_INTERVAL,
+                                       DEFAULT_OAD_MAX_CONN_INTERVAL,
+                                       DEFAULT_OAD_SLAVE_LATENCY,
+                                       DEFAULT_OAD_CONN_TIMEOUT );
+
+            (void)osal_set_event(oadManagerTaskId, SVC_DISCOVERY_EVT);
 
 #if (defined HAL_LCD) && (HAL_LCD == TRUE)
-          LCD_WRITE_STRING( "Connected", HAL_LCD_LINE_1 );
-          LCD_WRITE_STRING( "", HAL_LCD_LINE_3 );
+            LCD_WRITE_STRING( "Connected", HAL_LCD_LINE_1 );
+            LCD_WRITE_STRING( "", HAL_LCD_LINE_3 );
 #endif
+          }
+          else
+          {
+            pTarget->state = OAD_TARGET_IDLE;
+            pTarget->connHandle = GAP_CONNHANDLE_INIT;
+          }
         }
-        else
-        {
-          oadManagerState = BLE_STATE_IDLE;
-          oadManagerConnHandle = GAP_CONNHANDLE_INIT;
-        }
+
+        oadManagerConnectNext();
       }
       break;
 
     case GAP_LINK_TERMINATED_EVENT:
       {
-        oadManagerState = BLE_STATE_IDLE;
-        oadManagerConnHandle = GAP_CONNHANDLE_INIT;
+        uint8 idx = oadManagerFindTarget( pEvent->linkTerminate.connectionHandle );
+
+        if ( idx != OAD_IDX_NONE )
+        {
+          if ( oadTargets[idx].state == OAD_TARGET_DOWNLOAD )
+          {
+            oadManagerDownloadEnd( idx );  // A target that has the image resets itself.
+          }
+
+          oadTargets[idx].state = OAD_TARGET_IDLE;
+          oadTargets[idx].connHandle = GAP_CONNHANDLE_INIT;
+        }
 
 #if (defined HAL_LCD) && (HAL_LCD == TRUE)
         LCD_WRITE_STRING( "OAD Manager", HAL_LCD_LINE_1 );
         LCD_WRITE_STRING( bdAddr2Str( oadManagerAddr ),  HAL_LCD_LINE_2 );
         LCD_WRITE_STRING( "Disconnected", HAL_LCD_LINE_3 );
 #endif
+
+        // A free link takes the next device
+        oadManagerConnectNext();
       }
       break;
 
@@ -686,25 +757,154 @@ static void oadManagerEventCB( gapCentralRoleEvent_t *pEvent )
   }
 }
 
+/*********************************************************************
+ * @fn      oadManagerConnect
+ *
+ * @brief   Establish a link to a scan result in a free target slot.
+ *
+ * @param   scanIdx - index of the scan result
+ *
+ * @return  none
+ */
+static void oadManagerConnect( uint8 scanIdx )
+{
+  uint8 idx;
+
+  if ( oadManagerConnIdx != OAD_IDX_NONE )
+  {
+    return;  // One link is established at a time
+  }
+
+  for ( idx = 0; idx < OAD_MGR_MAX_LINKS; idx++ )
+  {
+    if ( oadTargets[idx].state == OAD_TARGET_IDLE )
+    {
+      uint8 *peerAddr = oadManagerDevList[scanIdx].addr;
+
+      if ( GAPCentralRole_EstablishLink( DEFAULT_LINK_HIGH_DUTY_CYCLE,
+                                         DEFAULT_LINK_WHITE_LIST,
+                                         oadManagerDevList[scanIdx].addrType,
+                                         peerAddr ) == SUCCESS )
+      {
+        oadManagerConnIdx = idx;
+        oadTargets[idx].state = OAD_TARGET_CONNECTING;
+        VOID osal_memcpy( oadTargets[idx].addr, peerAddr, B_ADDR_LEN );
+
+        VOID osal_start_timerEx( oadManagerTaskId, CONNECT_TIMEOUT_EVT, OAD_CONNECT_TIMEOUT );
+
+#if (defined HAL_LCD) && (HAL_LCD == TRUE)
+        LCD_WRITE_STRING( "Connecting", HAL_LCD_LINE_1 );
+        LCD_WRITE_STRING( bdAddr2Str( peerAddr ), HAL_LCD_LINE_2 );
+#endif
+      }
+
+      return;
+    }
+  }
+
+#if (defined HAL_LCD) && (HAL_LCD == TRUE)
+  LCD_WRITE_STRING( "No free link", HAL_LCD_LINE_3 );
+#endif
+}
+
+/*********************************************************************
+ * @fn      oadManagerConnectNext
+ *
+ * @brief   When updating every device found, connect the next one
+ *          that has no link yet.
+ *
+ * @return  none
+ */
+static void oadManagerConnectNext( void )
+{
+  uint8 scanIdx;
+
+  if ( !oadManagerConnectAll || ( oadManagerConnIdx != OAD_IDX_NONE ) )
+  {
+    return;
+  }
+
+  for ( scanIdx = 0; scanIdx < oadManagerScanRes; scanIdx++ )
+  {
+    if ( oadManagerFindAddr( oadManagerDevList[scanIdx].addr ) == OAD_IDX_NONE )
+    {
+      // The device is left out of the list once it is connected, so it is updated once.
+      oadManagerConnect( scanIdx );
+
+      if ( oadManagerConnIdx != OAD_IDX_NONE )
+      {
+        oadManagerDevList[scanIdx] = oadManagerDevList[--oadManagerScanRes];
+      }
+      return;
+    }
+  }
+
+  oadManagerConnectAll = FALSE;
+}
+
+/*********************************************************************
+ * @fn      oadManagerStartDisc
+ *
+ * @brief   Start the discovery procedure of every target in a state
+ *          that still waits for it. A procedure that cannot start yet
+ *          is tried again on the next event.
+ *
+ * @param   state - OAD_TARGET_DISC_SVC, _CCC or _CHAR
+ * @param   event - the event of that state
+ *
+ * @return  none
+ */
+static void oadManagerStartDisc( uint8 state, uint16 event )
+{
+  uint8 idx;
+
+  for ( idx = 0; idx < OAD_MGR_MAX_LINKS; idx++ )
+  {
+    if ( ( oadTargets[idx].state == state ) && oadTargets[idx].discStart )
+    {
+      bStatus_t status;
+
+      if ( state == OAD_TARGET_DISC_SVC )
+      {
+        status = oadManagerSvcDiscovery( idx );
+      }
+      else if ( state == OAD_TARGET_DISC_CCC )
+      {
+        status = oadManagerCCCDiscovery( idx );
+      }
+      else
+      {
+        status = oadManagerCharDiscovery( idx );
+      }
+
+      if ( status == SUCCESS )
+      {
+        oadTargets[idx].discStart = FALSE;
+      }
+      else
+      {
+        (void)osal_set_event(oadManagerTaskId, event);
+      }
+    }
+  }
+}
+
 /*********************************************************************
  * @fn      oadManagerSvcDiscovery
  *
  * @brief   OAD Service discovery.
  *
- * @return  none
+ * @return  status
  */
-static void oadManagerSvcDiscovery(void)
+static bStatus_t oadManagerSvcDiscovery( uint8 idx )
 {
   uint8 oadServUUID[ATT_UUID_SIZE] = { TI_BASE_UUID_128( OAD_SERVICE_UUID ) };
 
   // Initialize service discovery variables
-  oadSvcStartHdl = oadSvcEndHdl = 0;
+  oadTargets[idx].svcStartHdl = oadTargets[idx].svcEndHdl = 0;
 
-  if (GATT_DiscPrimaryServiceByUUID(oadManagerConnHandle, oadServUUID,
-                                    ATT_UUID_SIZE, oadManagerTaskId) != SUCCESS)
-  {
-    (void)osal_set_event(oadManagerTaskId, SVC_DISCOVERY_EVT);
-  }
+  return GATT_DiscPrimaryServiceByUUID(oadTargets[idx].connHandle, oadServUUID,
+                                       ATT_UUID_SIZE, oadManagerTaskId);
 }
 
 /*********************************************************************
@@ -712,19 +912,16 @@ static void oadManagerSvcDiscovery(void)
  *
  * @brief   OAD Client Characteristic Configuration discovery.
  *
- * @return  none
+ * @return  status
  */
-static void oadManagerCCCDiscovery(void)
+static bStatus_t oadManagerCCCDiscovery( uint8 idx )
 {
   // Initialize CCCD discovery variable
-  oadManagerCCCIdx = 0;
+  oadTargets[idx].cccIdx = 0;
 
   // Discover characteristic descriptors
-  if (GATT_DiscAllCharDescs(oadManagerConnHandle, oadSvcStartHdl,
-                            oadSvcEndHdl, oadManagerTaskId) != SUCCESS)
-  {
-    (void)osal_set_event(oadManagerTaskId, CCC_DISCOVERY_EVT);
-  }
+  return GATT_DiscAllCharDescs(oadTargets[idx].connHandle, oadTargets[idx].svcStartHdl,
+                               oadTargets[idx].svcEndHdl, oadManagerTaskId);
 }
 
 /*********************************************************************
@@ -732,17 +929,17 @@ static void oadManagerCCCDiscovery(void)
  *
  * @brief   OAD Characteristics service discovery.
  *
- * @return  none
+ * @return  status
  */
-static void oadManagerCharDiscovery(void)
+static bStatus_t oadManagerCharDiscovery( uint8 idx )
 {
   attReadByTypeReq_t req;
 
-  req.startHandle = oadSvcStartHdl;
-  req.endHandle = oadSvcEndHdl;
+  req.startHandle = oadTargets[idx].svcStartHdl;
+  req.endHandle = oadTargets[idx].svcEndHdl;
   req.type.len = ATT_UUID_SIZE;
 
-  if ( oadManagerDiscIdx == 0 )
+  if ( oadTargets[idx].discIdx == 0 )
   {
     uint8 oadCharUUID[ATT_UUID_SIZE] = { TI_BASE_UUID_128( OAD_IMG_IDENTIFY_UUID ) };
 
@@ -755,10 +952,7 @@ static void oadManagerCharDiscovery(void)
     (void)osal_memcpy(req.type.uuid, oadCharUUID, ATT_UUID_SIZE);
   }
 
-  if (GATT_DiscCharsByUUID(oadManagerConnHandle, &req, oadManagerTaskId) != SUCCESS)
-  {
-    (void)osal_set_event(oadManagerTaskId, CHAR_DISCOVERY_EVT);
-  }
+  return GATT_DiscCharsByUUID(oadTargets[idx].connHandle, &req, oadManagerTaskId);
 }
 
 /*********************************************************************
@@ -791,27 +985,36 @@ static void oadManagerDevDiscovery(void)
  *
  * @return  none
  */
-static void oadManagerSvcDiscoveryMsg(gattMsgEvent_t *pMsg)
+static void oadManagerSvcDiscoveryMsg( uint8 idx, gattMsgEvent_t *pMsg )
 {
+  oadTarget_t *pTarget = &oadTargets[idx];
+
+  if ( pTarget->state != OAD_TARGET_DISC_SVC )
+  {
+    return;
+  }
+
   if ( pMsg->hdr.status == SUCCESS ) // Characteristic found, the store handle.
   {
     attFindByTypeValueRsp_t *pRsp = &(pMsg->msg.findByTypeValueRsp);
 
     if ( pRsp->numInfo > 0 )
     {
-      oadSvcStartHdl = pRsp->handlesInfo[0].handle;
-      oadSvcEndHdl = pRsp->handlesInfo[0].grpEndHandle;
+      pTarget->svcStartHdl = pRsp->handlesInfo[0].handle;
+      pTarget->svcEndHdl = pRsp->handlesInfo[0].grpEndHandle;
 
 #if (defined HAL_LCD) && (HAL_LCD == TRUE)
       LCD_WRITE_STRING("OAD Svc Found!", HAL_LCD_LINE_1);
 #endif
       // OAD service found
+      pTarget->state = OAD_TARGET_DISC_CCC;
+      pTarget->discStart = TRUE;
       (void)osal_set_event(oadManagerTaskId, CCC_DISCOVERY_EVT);
     }
   }
   else if ( pMsg->hdr.status == bleProcedureComplete )
   {
-    if ( oadSvcStartHdl == 0 )
+    if ( pTarget->svcStartHdl == 0 )
     {
 #if (defined HAL_LCD) && (HAL_LCD == TRUE)
         LCD_WRITE_STRING("OAD SvcNotFound", HAL_LCD_LINE_3);
@@ -827,9 +1030,11 @@ static void oadManagerSvcDiscoveryMsg(gattMsgEvent_t *pMsg)
  *
  * @return  none
  */
-static void oadManagerCCCDiscoveryMsg(gattMsgEvent_t *pMsg)
+static void oadManagerCCCDiscoveryMsg( uint8 idx, gattMsgEvent_t *pMsg )
 {
-  if (oadManagerCCCIdx < OAD_CHAR_CNT)
+  oadTarget_t *pTarget = &oadTargets[idx];
+
+  if ( ( pTarget->state == OAD_TARGET_DISC_CCC ) && ( pTarget->cccIdx < OAD_CHAR_CNT ) )
   {
     if ( pMsg->hdr.status == SUCCESS ) // CCCD found, the store handle.
     {
@@ -845,18 +1050,20 @@ static void oadManagerCCCDiscoveryMsg(gattMsgEvent_t *pMsg)
                ( pRsp->info.btPair[i].uuid[1] == HI_UINT16(GATT_CLIENT_CHAR_CFG_UUID) ) )
           {
             // CCCD found
-            oadManagerCCCHandles[oadManagerCCCIdx] = pRsp->info.btPair[i].handle;
+            pTarget->cccHandles[pTarget->cccIdx] = pRsp->info.btPair[i].handle;
 
-            if (++oadManagerCCCIdx == OAD_CHAR_CNT)
+            if (++pTarget->cccIdx == OAD_CHAR_CNT)
             {
 #if (defined HAL_LCD) && (HAL_LCD == TRUE)
               LCD_WRITE_STRING("OAD CCCDs Found!", HAL_LCD_LINE_1);
 #endif
               // OAD CCCDs found; enable them for notification
-              oadManagerEnableNoti( oadManagerCCCHandles[OAD_CHAR_IMG_IDENTIFY] );
-              oadManagerEnableNoti( oadManagerCCCHandles[OAD_CHAR_IMG_BLOCK] );
+              oadManagerEnableNoti( pTarget->connHandle, pTarget->cccHandles[OAD_CHAR_IMG_IDENTIFY] );
+              oadManagerEnableNoti( pTarget->connHandle, pTarget->cccHandles[OAD_CHAR_IMG_BLOCK] );
 
-              oadManagerDiscIdx = 0;
+              pTarget->discIdx = 0;
+              pTarget->state = OAD_TARGET_DISC_CHAR;
+              pTarget->discStart = TRUE;
               (void)osal_set_event(oadManagerTaskId, CHAR_DISCOVERY_EVT);
 
               break;
@@ -867,7 +1074,7 @@ static void oadManagerCCCDiscoveryMsg(gattMsgEvent_t *pMsg)
     }
     else if ( pMsg->hdr.status == bleProcedureComplete )
     {
-      if (oadManagerCCCIdx < OAD_CHAR_CNT)
+      if (pTarget->cccIdx < OAD_CHAR_CNT)
       {
 #if (defined HAL_LCD) && (HAL_LCD == TRUE)
         LCD_WRITE_STRING("OAD CCCDNotFound", HAL_LCD_LINE_3);
@@ -884,9 +1091,11 @@ static void oadManagerCCCDiscoveryMsg(gattMsgEvent_t *pMsg)
  *
  * @return  none
  */
-static void oadManagerCharDiscoveryMsg(gattMsgEvent_t *pMsg)
+static void oadManagerCharDiscoveryMsg( uint8 idx, gattMsgEvent_t *pMsg )
 {
-  if (oadManagerDiscIdx < OAD_CHAR_CNT)
+  oadTarget_t *pTarget = &oadTargets[idx];
+
+  if ( ( pTarget->state == OAD_TARGET_DISC_CHAR ) && ( pTarget->discIdx < OAD_CHAR_CNT ) )
   {
     if ( pMsg->hdr.status == SUCCESS ) // Characteristic found, the store handle.
     {
@@ -894,24 +1103,25 @@ static void oadManagerCharDiscoveryMsg(gattMsgEvent_t *pMsg)
 
       if (pRsp->numPairs > 0)
       {
-        oadManagerHandles[oadManagerDiscIdx] = BUILD_UINT16(pRsp->dataList[3], pRsp->dataList[4]);
+        pTarget->handles[pTarget->discIdx] = BUILD_UINT16(pRsp->dataList[3], pRsp->dataList[4]);
 
-        if (++oadManagerDiscIdx == OAD_CHAR_CNT)
+        if (++pTarget->discIdx == OAD_CHAR_CNT)
         {
 #if (defined HAL_LCD) && (HAL_LCD == TRUE)
           LCD_WRITE_STRING("OAD Chars Found!", HAL_LCD_LINE_1);
 #endif
-          oadManagerSendImgNotify();
+          oadManagerSendImgNotify( idx );
 
           return;
         }
       }
 
+      pTarget->discStart = TRUE;
       (void)osal_set_event(oadManagerTaskId, CHAR_DISCOVERY_EVT);
     }
     else if ( pMsg->hdr.status == bleProcedureComplete )
     {
-      if (oadManagerDiscIdx < OAD_CHAR_CNT)
+      if (pTarget->discIdx < OAD_CHAR_CNT)
       {
 #if (defined HAL_LCD) && (HAL_LCD == TRUE)
         LCD_WRITE_STRING("OAD CharNotFound", HAL_LCD_LINE_3);
@@ -928,14 +1138,14 @@ static void oadManagerCharDiscoveryMsg(gattMsgEvent_t *pMsg)
  *
  * @return  none
  */
-static void oadManagerErrorRsp( attErrorRsp_t *pRsp )
+static void oadManagerErrorRsp( uint8 idx, attErrorRsp_t *pRsp )
 {
   if ( pRsp->errCode == ATT_ERR_ATTR_NOT_FOUND )
   {
     switch ( pRsp->reqOpcode )
     {
       case ATT_FIND_BY_TYPE_VALUE_REQ:
-        if ( oadSvcStartHdl == 0 )
+        if ( oadTargets[idx].svcStartHdl == 0 )
         {
 #if (defined HAL_LCD) && (HAL_LCD == TRUE)
           LCD_WRITE_STRING("OAD SvcNotFound", HAL_LCD_LINE_3);
@@ -944,7 +1154,7 @@ static void oadManagerErrorRsp( attErrorRsp_t *pRsp )
         break;
 
       case ATT_FIND_INFO_RSP:
-        if (oadManagerCCCIdx < OAD_CHAR_CNT)
+        if (oadTargets[idx].cccIdx < OAD_CHAR_CNT)
         {
 #if (defined HAL_LCD) && (HAL_LCD == TRUE)
           LCD_WRITE_STRING("OAD CCCDNotFound", HAL_LCD_LINE_3);
@@ -953,7 +1163,7 @@ static void oadManagerErrorRsp( attErrorRsp_t *pRsp )
         break;
 
       case ATT_READ_BY_TYPE_RSP:
-        if (oadManagerDiscIdx < OAD_CHAR_CNT)
+        if (oadTargets[idx].discIdx < OAD_CHAR_CNT)
         {
 #if (defined HAL_LCD) && (HAL_LCD == TRUE)
           LCD_WRITE_STRING("OAD CharNotFound", HAL_LCD_LINE_3);
@@ -1058,6 +1268,56 @@ static void oadManagerAddDeviceInfo( uint8 *pAddr, uint8 addrType )
   }
 }
 
+/*********************************************************************
+ * @fn      oadManagerFindTarget
+ *
+ * @brief   Find the target a connection belongs to.
+ *
+ * @return  target index, OAD_IDX_NONE if none
+ */
+static uint8 oadManagerFindTarget( uint16 connHandle )
+{
+  uint8 idx;
+
+  if ( connHandle == GAP_CONNHANDLE_INIT )
+  {
+    return OAD_IDX_NONE;
+  }
+
+  for ( idx = 0; idx < OAD_MGR_MAX_LINKS; idx++ )
+  {
+    if ( oadTargets[idx].connHandle == connHandle )
+    {
+      return idx;
+    }
+  }
+
+  return OAD_IDX_NONE;
+}
+
+/*********************************************************************
+ * @fn      oadManagerFindAddr
+ *
+ * @brief   Find the target slot that holds a device.
+ *
+ * @return  target index, OAD_IDX_NONE if none
+ */
+static uint8 oadManagerFindAddr( uint8 *pAddr )
+{
+  uint8 idx;
+
+  for ( idx = 0; idx < OAD_MGR_MAX_LINKS; idx++ )
+  {
+    if ( ( oadTargets[idx].state != OAD_TARGET_IDLE ) &&
+         osal_memcmp( pAddr, oadTargets[idx].addr, B_ADDR_LEN ) )
+    {
+      return idx;
+    }
+  }
+
+  return OAD_IDX_NONE;
+}
+
 /*********************************************************************
  * @fn      oadManagerEnableNoti
  *
@@ -1065,7 +1325,7 @@ static void oadManagerAddDeviceInfo( uint8 *pAddr, uint8 addrType )
  *
  * @return  none
  */
-static void oadManagerEnableNoti( uint16 handle )
+static void oadManagerEnableNoti( uint16 connHandle, uint16 handle )
 {
   attWriteReq_t req;
 
@@ -1077,7 +1337,7 @@ static void oadManagerEnableNoti( uint16 handle )
   req.value[0] = LO_UINT16(GATT_CLIENT_CFG_NOTIFY);
   req.value[1] = HI_UINT16(GATT_CLIENT_CFG_NOTIFY);
 
-  VOID GATT_WriteNoRsp(oadManagerConnHandle, &req);
+  VOID GATT_WriteNoRsp(connHandle, &req);
 }
 
 /*********************************************************************
@@ -1087,9 +1347,11 @@ static void oadManagerEnableNoti( uint16 handle )
  *
  * @return  none
  */
-static void oadManagerHandleNoti(attHandleValueNoti_t *pNoti)
+static void oadManagerHandleNoti( uint8 idx, attHandleValueNoti_t *pNoti )
 {
-  if (pNoti->handle == oadManagerHandles[OAD_CHAR_IMG_IDENTIFY])
+  oadTarget_t *pTarget = &oadTargets[idx];
+
+  if (pNoti->handle == pTarget->handles[OAD_CHAR_IMG_IDENTIFY])
   {
 #if (defined HAL_LCD && (HAL_LCD == TRUE))
     uint16 ver = BUILD_UINT16(pNoti->value[0], pNoti->value[1]);
@@ -1113,54 +1375,393 @@ static void oadManagerHandleNoti(attHandleValueNoti_t *pNoti)
 
     HalLcdWriteString((char*)userId, HAL_LCD_LINE_3);
 #endif
+
+    // The target refused the image and told what it runs instead.
+    if ( pTarget->state == OAD_TARGET_DOWNLOAD )
+    {
+      pTarget->state = OAD_TARGET_DONE;
+    }
   }
-  else if (pNoti->handle == oadManagerHandles[OAD_CHAR_IMG_BLOCK])
+  else if ( ( pNoti->handle == pTarget->handles[OAD_CHAR_IMG_BLOCK] ) &&
+            ( pTarget->state == OAD_TARGET_DOWNLOAD ) )
   {
-    oadBlkNum = BUILD_UINT16(pNoti->value[0], pNoti->value[1]);
-    attWriteReq_t req;
+    uint16 blkNum = BUILD_UINT16(pNoti->value[0], pNoti->value[1]);
+    uint8 win = 1;
+    uint32 missing = 1;
 
-    req.handle = oadManagerHandles[OAD_CHAR_IMG_BLOCK];
-    req.len = 2 + OAD_BLOCK_SIZE;
-    req.sig = FALSE;
-    req.cmd = TRUE;
+    if ( blkNum >= oadBlkTot )
+    {
+      return;
+    }
 
-    req.value[0] = LO_UINT16(oadBlkNum);
-    req.value[1] = HI_UINT16(oadBlkNum);
+    // A windowed target follows with its window and the blocks it misses;
+    // one that is not asks for a single block.
+    if ( pNoti->len > 2 )
+    {
+      win = ( pNoti->value[2] > OAD_MGR_WINDOW ) ? OAD_MGR_WINDOW : pNoti->value[2];
+      missing = 0;
+      for ( uint8 i = 0; ( i < OAD_WINDOW_BYTES( win ) ) && ( 3 + i < pNoti->len ); i++ )
+      {
+        missing |= (uint32)pNoti->value[3 + i] << (8 * i);
+      }
+    }
+
+    if ( win > oadBlkTot - blkNum )
+    {
+      win = oadBlkTot - blkNum;
+    }
+    if ( win < 32 )
+    {
+      missing &= ((uint32)1 << win) - 1;
+    }
+
+    // A window already read is sent from RAM again
+    if ( ( blkNum != pTarget->blkNum ) || ( blkNum + win > pTarget->winEnd ) )
+    {
+      oadManagerPrefetch( pTarget, blkNum, win );
+    }
 
-    uint8 page = oadBlkNum / OAD_BLOCKS_PER_PAGE;
-    uint16 oset = (oadBlkNum - (OAD_BLOCKS_PER_PAGE * page)) * OAD_BLOCK_SIZE;
-    HalFlashRead(page+OAD_IMG_B_PAGE, oset, req.value+2, OAD_BLOCK_SIZE);
+    pTarget->blkNum = blkNum;
+    pTarget->winEnd = blkNum + win;
+    pTarget->missing = missing;
+    pTarget->polls = 0;
+    pTarget->lastTime = osal_GetSystemClock();
 
-#if (defined HAL_LCD) && (HAL_LCD == TRUE)
-    if (oadBlkNum == 0)
+    oadManagerPump();
+  }
+}
+
+/*********************************************************************
+ * @fn      oadManagerPrefetch
+ *
+ * @brief   Read the blocks of a window from the image in flash, one
+ *          read per flash page instead of one per block.
+ *
+ * @param   pTarget - the target
+ * @param   blkNum - first block of the window
+ * @param   win - number of blocks
+ *
+ * @return  none
+ */
+static void oadManagerPrefetch( oadTarget_t *pTarget, uint16 blkNum, uint8 win )
+{
+  uint8 *pBuf = pTarget->buf;
+
+  while ( win != 0 )
+  {
+    uint8 page = blkNum / OAD_BLOCKS_PER_PAGE;
+    uint8 oset = blkNum % OAD_BLOCKS_PER_PAGE;
+    uint8 cnt = OAD_BLOCKS_PER_PAGE - oset;
+
+    if ( cnt > win )
+    {
+      cnt = win;
+    }
+
+    HalFlashRead(page+OAD_IMG_B_PAGE, (uint16)oset * OAD_BLOCK_SIZE, pBuf, (uint16)cnt * OAD_BLOCK_SIZE);
+
+    pBuf += (uint16)cnt * OAD_BLOCK_SIZE;
+    blkNum += cnt;
+    win -= cnt;
+  }
+}
+
+/*********************************************************************
+ * @fn      oadManagerSendBlock
+ *
+ * @brief   Write the first block of the window the target still misses.
+ *
+ * @param   pTarget - the target
+ *
+ * @return  The status of GATT_WriteNoRsp(), MSG_BUFFER_NOT_AVAIL while
+ *          the link has no buffer free
+ */
+static bStatus_t oadManagerSendBlock( oadTarget_t *pTarget )
+{
+  attWriteReq_t req;
+  bStatus_t status;
+  uint16 blkNum;
+  uint8 bit = 0;
+
+  while ( !( pTarget->missing & ((uint32)1 << bit) ) )
+  {
+    bit++;
+  }
+  blkNum = pTarget->blkNum + bit;
+
+  req.handle = pTarget->handles[OAD_CHAR_IMG_BLOCK];
+  req.len = 2 + OAD_BLOCK_SIZE;
+  req.sig = FALSE;
+  req.cmd = TRUE;
+
+  req.value[0] = LO_UINT16(blkNum);
+  req.value[1] = HI_UINT16(blkNum);
+  VOID osal_memcpy( req.value+2, pTarget->buf + bit * OAD_BLOCK_SIZE, OAD_BLOCK_SIZE );
+
+  status = GATT_WriteNoRsp(pTarget->connHandle, &req);
+
+  if ( status == SUCCESS )
+  {
+    pTarget->missing &= ~((uint32)1 << bit);
+    pTarget->blkSent++;
+
+    if ( blkNum + 1 == oadBlkTot )
+    {
+      pTarget->endTime = osal_GetSystemClock();
+    }
+  }
+
+  return status;
+}
+
+/*********************************************************************
+ * @fn      oadManagerPump
+ *
+ * @brief   Keep the links busy: send one block to every target that
+ *          misses any, round after round, until no link takes more.
+ *          Blocks of all targets go out in the same connection events.
+ *          A link out of buffers is tried again shortly.
+ *
+ * @return  none
+ */
+static void oadManagerPump( void )
+{
+  uint8 sent, stalled = FALSE;
+
+  do
+  {
+    uint8 idx;
+
+    sent = FALSE;
+
+    for ( idx = 0; idx < OAD_MGR_MAX_LINKS; idx++ )
+    {
+      oadTarget_t *pTarget = &oadTargets[idx];
+
+      if ( ( pTarget->state == OAD_TARGET_DOWNLOAD ) && ( pTarget->missing != 0 ) )
+      {
+        if ( oadManagerSendBlock( pTarget ) == SUCCESS )
+        {
+          sent = TRUE;
+        }
+        else
+        {
+          stalled = TRUE;
+        }
+      }
+    }
+  } while ( sent );
+
+  if ( stalled )
+  {
+    VOID osal_start_timerEx( oadManagerTaskId, OAD_SEND_EVT, OAD_SEND_RETRY_DELAY );
+  }
+}
+
+/*********************************************************************
+ * @fn      oadManagerPoll
+ *
+ * @brief   Ask a target again what it misses: the Image Identify if it
+ *          never asked for a block, else a block write of the block
+ *          number alone.
+ *
+ * @param   pTarget - the target
+ *
+ * @return  none
+ */
+static void oadManagerPoll( oadTarget_t *pTarget )
+{
+  attWriteReq_t req;
+
+  pTarget->polls++;
+
+  if ( pTarget->blkSent == 0 )
+  {
+    oadManagerSendImgNotify( (uint8)(pTarget - oadTargets) );
+    return;
+  }
+
+  req.handle = pTarget->handles[OAD_CHAR_IMG_BLOCK];
+  req.len = 2;
+  req.sig = FALSE;
+  req.cmd = TRUE;
+
+  req.value[0] = LO_UINT16(pTarget->blkNum);
+  req.value[1] = HI_UINT16(pTarget->blkNum);
+
+  VOID GATT_WriteNoRsp(pTarget->connHandle, &req);
+}
+
+/*********************************************************************
+ * @fn      oadManagerWatchdog
+ *
+ * @brief   A target that has not asked for blocks for OAD_DOWNLOAD_TIMEOUT
+ *          is polled. After the last block that means it took the image
+ *          and resets; otherwise it has failed after OAD_MGR_POLLS polls.
+ *
+ * @return  none
+ */
+static void oadManagerWatchdog( void )
+{
+  uint32 now = osal_GetSystemClock();
+  uint8 idx;
+
+  for ( idx = 0; idx < OAD_MGR_MAX_LINKS; idx++ )
+  {
+    oadTarget_t *pTarget = &oadTargets[idx];
+
+    if ( ( pTarget->state != OAD_TARGET_DOWNLOAD ) || ( pTarget->missing != 0 ) ||
+         ( now - pTarget->lastTime < OAD_DOWNLOAD_TIMEOUT ) )
     {
-      HalLcdWriteString("", HAL_LCD_LINE_3);
+      continue;
     }
-    HalLcdDisplayPercentBar( "OAD Progress...", (oadBlkNum / (oadBlkTot / 100)) );
+
+    pTarget->lastTime = now;
+
+    if ( ( ( pTarget->winEnd >= oadBlkTot ) && ( pTarget->polls != 0 ) ) ||
+         ( pTarget->polls >= OAD_MGR_POLLS ) )
+    {
+      oadManagerDownloadEnd( idx );
+      pTarget->state = OAD_TARGET_DONE;
+
+      if ( pTarget->winEnd < oadBlkTot )
+      {
+        pTarget->state = OAD_TARGET_DISCONNECTING;
+        VOID GAPCentralRole_TerminateLink( pTarget->connHandle );
+      }
+    }
+    else
+    {
+      oadManagerPoll( pTarget );
+    }
+  }
+}
+
+/*********************************************************************
+ * @fn      oadManagerDownloadEnd
+ *
+ * @brief   Report how the download of a target ended, with its
+ *          throughput in bytes per second.
+ *
+ * @param   idx - target index
+ *
+ * @return  none
+ */
+static void oadManagerDownloadEnd( uint8 idx )
+{
+  oadTarget_t *pTarget = &oadTargets[idx];
+
+#if (defined HAL_LCD) && (HAL_LCD == TRUE)
+  if ( ( pTarget->winEnd >= oadBlkTot ) && ( pTarget->missing == 0 ) )
+  {
+    uint32 ms = pTarget->endTime - pTarget->startTime;
+    uint32 rate = ( ms != 0 ) ? ((uint32)oadBlkTot * OAD_BLOCK_SIZE * 1000) / ms : 0;
+
+    LCD_WRITE_STRING("OAD Completed!", HAL_LCD_LINE_1);
+    HalLcdWriteStringValueValue("T", idx + 1, 10, (rate > 0xFFFF) ? 0xFFFF : (uint16)rate, 10,
+                                HAL_LCD_LINE_3);
+  }
+  else
+  {
+    LCD_WRITE_STRING("OAD Failed!", HAL_LCD_LINE_1);
+    LCD_WRITE_STRING_VALUE("T", idx + 1, 10, HAL_LCD_LINE_3);
+  }
+#else
+  (void)pTarget;
 #endif
+}
+
+/*********************************************************************
+ * @fn      oadManagerDownloading
+ *
+ * @brief   Whether any target is taking the image.
+ *
+ * @return  TRUE if so
+ */
+static uint8 oadManagerDownloading( void )
+{
+  uint8 idx;
+
+  for ( idx = 0; idx < OAD_MGR_MAX_LINKS; idx++ )
+  {
+    if ( oadTargets[idx].state == OAD_TARGET_DOWNLOAD )
+    {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/*********************************************************************
+ * @fn      oadManagerShowProgress
+ *
+ * @brief   Show the percentage of every target taking the image and
+ *          their throughput together, in bytes per second.
+ *
+ * @return  none
+ */
+static void oadManagerShowProgress( void )
+{
+#if (defined HAL_LCD) && (HAL_LCD == TRUE)
+  char str[4 * OAD_MGR_MAX_LINKS + 1];
+  char *pStr = str;
+  uint32 now = osal_GetSystemClock();
+  uint32 rate = 0;
+  uint8 idx;
+
+  for ( idx = 0; idx < OAD_MGR_MAX_LINKS; idx++ )
+  {
+    oadTarget_t *pTarget = &oadTargets[idx];
+
+    if ( pTarget->state == OAD_TARGET_DOWNLOAD )
+    {
+      uint8 pct = (uint8)(((uint32)pTarget->blkNum * 100) / oadBlkTot);
 
-    VOID GATT_WriteNoRsp(oadManagerConnHandle, &req);
+      *pStr++ = (pct >= 100) ? '1' : ' ';
+      *pStr++ = (pct >= 10) ? '0' + (pct / 10) % 10 : ' ';
+      *pStr++ = '0' + pct % 10;
 
-    VOID osal_start_timerEx( oadManagerTaskId, OAD_DOWNLOAD_EVT, OAD_DOWNLOAD_TIMEOUT );
+      if ( now != pTarget->startTime )
+      {
+        rate += ((uint32)pTarget->blkSent * OAD_BLOCK_SIZE * 1000) / (now - pTarget->startTime);
+      }
+    }
+    else
+    {
+      *pStr++ = ' ';
+      *pStr++ = ' ';
+      *pStr++ = '-';
+    }
+    *pStr++ = ' ';
   }
+  *pStr = '\0';
+
+  LCD_WRITE_STRING( str, HAL_LCD_LINE_2 );
+  LCD_WRITE_STRING_VALUE( "B/s", (rate > 0xFFFF) ? 0xFFFF : (uint16)rate, 10, HAL_LCD_LINE_3 );
+#endif
 }
 
 /*********************************************************************
  * @fn      oadManagerSendImgNotify
  *
- * @brief   OAD device discovery.
+ * @brief   Offer the image to a target, with the window of blocks it
+ *          may ask for at once.
+ *
+ * @param   idx - target index
  *
  * @return  none
  */
-static void oadManagerSendImgNotify(void)
+static void oadManagerSendImgNotify( uint8 idx )
 {
+  oadTarget_t *pTarget = &oadTargets[idx];
   attWriteReq_t req;
   img_hdr_t ImgHdr;
 
   HalFlashRead(OAD_IMG_B_PAGE, OAD_IMG_HDR_OSET, (uint8 *)&ImgHdr, sizeof(img_hdr_t));
 
-  req.handle = oadManagerHandles[OAD_CHAR_IMG_IDENTIFY];
-  req.len = OAD_IMG_HDR_SIZE;
+  req.handle = pTarget->handles[OAD_CHAR_IMG_IDENTIFY];
+  req.len = OAD_IMG_HDR_SIZE + 1;
   req.value[0] = LO_UINT16(ImgHdr.ver);
   req.value[1] = HI_UINT16(ImgHdr.ver);
 
@@ -1169,13 +1770,31 @@ static void oadManagerSendImgNotify(void)
 
   (void)osal_memcpy(req.value+4, ImgHdr.uid, sizeof(ImgHdr.uid));
 
+  req.value[OAD_IMG_HDR_SIZE] = OAD_MGR_WINDOW;
+
   req.sig = FALSE;
   req.cmd = TRUE;
 
-  VOID GATT_WriteNoRsp(oadManagerConnHandle, &req);
+  VOID GATT_WriteNoRsp(pTarget->connHandle, &req);
 
   // Save the total number of blocks
   oadBlkTot = ImgHdr.len / (OAD_BLOCK_SIZE / HAL_FLASH_WORD_SIZE);
+
+  if ( pTarget->state != OAD_TARGET_DOWNLOAD )
+  {
+    pTarget->state = OAD_TARGET_DOWNLOAD;
+    pTarget->blkNum = 0;
+    pTarget->winEnd = 0;
+    pTarget->missing = 0;
+    pTarget->polls = 0;
+    pTarget->blkSent = 0;
+    pTarget->startTime = pTarget->lastTime = osal_GetSystemClock();
+
+    if ( osal_get_timeoutEx( oadManagerTaskId, OAD_DOWNLOAD_EVT ) == 0 )
+    {
+      VOID osal_start_timerEx( oadManagerTaskId, OAD_DOWNLOAD_EVT, OAD_PROGRESS_PERIOD );
+    }
+  }
 }
 
 /*********************************************************************
@@ -53,15 +53,30 @@ extern "C"
  */
 
 // OAD Manager Task Events
+#define CONNECT_TIMEOUT_EVT                           0x0080
 #define OAD_DOWNLOAD_EVT                              0x0040
 #define DEV_DISCOVERY_EVT                             0x0020
 #define CHAR_DISCOVERY_EVT                            0x0010
 #define CCC_DISCOVERY_EVT                             0x0008
 #define SVC_DISCOVERY_EVT                             0x0004
-#define CONN_INTERVAL_EVT                             0x0002
+#define OAD_SEND_EVT                                  0x0002
 #define START_DEVICE_EVT                              0x0001
 
+#define OAD_CONNECT_TIMEOUT                           3000 // msec, a target out of range is skipped
 #define OAD_DOWNLOAD_TIMEOUT                          2000 // msec
+#define OAD_PROGRESS_PERIOD                           1000 // msec
+#define OAD_SEND_RETRY_DELAY                          5    // msec, wait for link buffers
+#define OAD_MGR_POLLS                                 3    // Polls before a target has failed
+
+// Number of OAD Targets updated at once
+#if !defined OAD_MGR_MAX_LINKS
+#define OAD_MGR_MAX_LINKS                             MAX_NUM_LL_CONN
+#endif
+
+// Blocks a target may ask for at once, and read ahead from flash for it
+#if !defined OAD_MGR_WINDOW
+#define OAD_MGR_WINDOW                                16
+#endif
 
 /*********************************************************************
  * MACROS
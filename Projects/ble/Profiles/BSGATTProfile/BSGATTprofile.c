@@ -50,6 +50,7 @@
 #include "gapbondmgr.h"
 
 #include "BSGATTprofile.h"
+#include "lightStats.h"
 
 /*********************************************************************
  * MACROS
@@ -61,12 +62,21 @@
 
 #define INDEX_CHAR_ONE_VALUE 2
 #define INDEX_CHAR_ONE_CONFIG 3
-#define SERVAPP_NUM_ATTR_SUPPORTED        5
+#define INDEX_STATE_VALUE 6
+#define SERVAPP_NUM_ATTR_SUPPORTED        9
 
 /*********************************************************************
  * TYPEDEFS
  */
 
+// Command budget of one link
+typedef struct
+{
+  uint16 connHandle;    // INVALID_CONNHANDLE for a free entry
+  uint8 tokens;         // writes the link may still send
+  uint32 lastTick;      // system clock of the last refill
+} BSProfileLinkBudget_t;
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -82,6 +92,12 @@ CONST uint8 BSProfilechar1UUID[ATT_BT_UUID_SIZE] =
   LO_UINT16(BSPROFILE_CHAR1_UUID), HI_UINT16(BSPROFILE_CHAR1_UUID)
 };
 
+// Light State UUID: 0xFFE2
+CONST uint8 BSProfileStateUUID[ATT_BT_UUID_SIZE] =
+{ 
+  LO_UINT16(BSPROFILE_STATE_UUID), HI_UINT16(BSPROFILE_STATE_UUID)
+};
+
 /*********************************************************************
  * EXTERNAL VARIABLES
  */
@@ -96,6 +112,8 @@ CONST uint8 BSProfilechar1UUID[ATT_BT_UUID_SIZE] =
 
 static BSProfileCBs_t *BSProfile_AppCBs = NULL;
 
+static BSProfileLinkBudget_t BSProfileLinkBudget[GATT_MAX_NUM_CONN];
+
 /*********************************************************************
  * Profile Attributes - variables
  */
@@ -110,6 +128,9 @@ static uint8 BSProfileChar1Props = GATT_PROP_WRITE | GATT_PROP_NOTIFY;
 static uint8 BSProfileChar1[MAX_LENGTH_CHARATERISTIC_VALUE] = "\0";
 static uint16 BSProfileChar1Length = 0;
 
+// First failure of GATT_Notification() in the notifyCharateristicChanged() running
+static bStatus_t BSProfileNotifyStatus = SUCCESS;
+
 // BS Profile Characteristic 4 Configuration Each client has its own
 // instantiation of the Client Characteristic Configuration. Reads of the
 // Client Characteristic Configuration only shows the configuration for
@@ -119,6 +140,18 @@ static gattCharCfg_t BSProfileChar1Config[GATT_MAX_NUM_CONN];
 // BS Profile Characteristic 1 User Description
 static uint8 BSProfileChar1UserDesp[MAX_LENGTH_CHARATERISTIC_VALUE] = "Characteristic 1\0";
 
+// BS Profile Light State Properties
+static uint8 BSProfileStateProps = GATT_PROP_READ | GATT_PROP_NOTIFY;
+
+// Light State Value, kept current by the light driver so a read needs no command
+static uint8 BSProfileState = 0;
+
+// Light State Configuration, one per client
+static gattCharCfg_t BSProfileStateConfig[GATT_MAX_NUM_CONN];
+
+// BS Profile Light State User Description
+static uint8 BSProfileStateUserDesp[] = "Light State\0";
+
 /*********************************************************************
  * Profile Attributes - Table
  */
@@ -164,6 +197,38 @@ static gattAttribute_t BSProfileAttrTbl[SERVAPP_NUM_ATTR_SUPPORTED] =
         0, 
         BSProfileChar1UserDesp 
       },       
+
+    // Light State Declaration
+    { 
+      { ATT_BT_UUID_SIZE, characterUUID },
+      GATT_PERMIT_READ, 
+      0,
+      &BSProfileStateProps 
+    },
+
+      // Light State Value
+      { 
+        { ATT_BT_UUID_SIZE, BSProfileStateUUID },
+        GATT_PERMIT_READ, 
+        0, 
+        &BSProfileState 
+      },
+      
+      // Light State configuration
+      { 
+        { ATT_BT_UUID_SIZE, clientCharCfgUUID },
+        GATT_PERMIT_READ | GATT_PERMIT_WRITE, 
+        0, 
+        (uint8 *)BSProfileStateConfig 
+      },
+
+      // Light State User Description
+      { 
+        { ATT_BT_UUID_SIZE, charUserDescUUID },
+        GATT_PERMIT_READ, 
+        0, 
+        BSProfileStateUserDesp 
+      },       
 };
 
 
@@ -176,6 +241,10 @@ static bStatus_t BSProfile_WriteAttrCB( uint16 connHandle, gattAttribute_t *pAtt
                                  uint8 *pValue, uint8 len, uint16 offset );
 
 static void BSProfile_HandleConnStatusCB( uint16 connHandle, uint8 changeType );
+static void BSProfile_NotifyCB( linkDBItem_t *pLinkItem );
+static void BSProfile_StateNotifyCB( linkDBItem_t *pLinkItem );
+static bool BSProfile_TakeToken( uint16 connHandle );
+static void BSProfile_ResetBudget( uint16 connHandle );
 
 /*********************************************************************
  * PROFILE CALLBACKS
@@ -209,6 +278,8 @@ bStatus_t BSProfile_AddService( uint32 services )
 
   // Initialize Client Characteristic Configuration attributes
   GATTServApp_InitCharCfg( INVALID_CONNHANDLE, BSProfileChar1Config );
+  GATTServApp_InitCharCfg( INVALID_CONNHANDLE, BSProfileStateConfig );
+  BSProfile_ResetBudget( INVALID_CONNHANDLE );
 
   // Register with Link DB to receive link status change callback
   VOID linkDB_Register( BSProfile_HandleConnStatusCB );  
@@ -250,15 +321,33 @@ bStatus_t BSProfile_RegisterAppCBs( BSProfileCBs_t *appCallbacks )
 }
   
 
-void notifyCharateristicChanged( uint8 param ) {
+/*********************************************************************
+ * @fn      notifyCharateristicChanged
+ *
+ * @brief   Send the characteristic value to every connected link
+ *          that has notifications enabled.
+ *
+ * @param   param - Profile parameter ID
+ *
+ * @return  SUCCESS, or the status of the first notification
+ *          the stack refused (no buffer for it)
+ */
+bStatus_t notifyCharateristicChanged( uint8 param ) {
+  BSProfileNotifyStatus = SUCCESS;
+
   switch ( param )
   {
     case BSPROFILE_CHAR1:
-      GATTServApp_ProcessCharCfg( BSProfileChar1Config, (uint8*) BSProfileChar1, FALSE,
-                                    BSProfileAttrTbl, GATT_NUM_ATTRS( BSProfileAttrTbl ),
-                                    INVALID_TASK_ID );
+      // Execute linkDB callback to send notification
+      linkDB_PerformFunc( BSProfile_NotifyCB );
+      break;
+
+    case BSPROFILE_STATE:
+      linkDB_PerformFunc( BSProfile_StateNotifyCB );
       break;
   }
+
+  return ( BSProfileNotifyStatus );
 }
 
 /*********************************************************************
@@ -283,6 +372,11 @@ bStatus_t BSProfile_SetParameter( uint8 param, uint8 len, void *value )
   switch ( param )
   {
     case BSPROFILE_CHAR1:
+      if ( len > sizeof(BSProfileChar1) )
+      {
+        ret = bleInvalidRange;
+        break;
+      }
       osal_memset((uint8*) BSProfileChar1, 0, sizeof(BSProfileChar1));
       osal_memcpy((uint8*) BSProfileChar1, (uint8*) value, len);
       osal_memcpy(&BSProfileChar1Length, &len, sizeof(uint8));
@@ -291,6 +385,22 @@ bStatus_t BSProfile_SetParameter( uint8 param, uint8 len, void *value )
       //notifyCharateristicChanged(BSPROFILE_CHAR1);
       break;
       
+    case BSPROFILE_STATE:
+      // Only a change goes out, setting the same lights again costs nothing on air
+      if ( len == sizeof ( uint8 ) ) 
+      {
+        if ( BSProfileState != *((uint8*)value) )
+        {
+          BSProfileState = *((uint8*)value);
+          notifyCharateristicChanged(BSPROFILE_STATE);
+        }
+      }
+      else
+      {
+        ret = bleInvalidRange;
+      }
+      break;
+      
     default:
       ret = INVALIDPARAMETER;
       break;
@@ -323,6 +433,10 @@ bStatus_t BSProfile_GetParameter( uint8 param, void *value )
       //*((uint8*)value) = BSProfileAttrTbl[INDEX_CHAR_ONE_VALUE].pValue;
       break;
 
+    case BSPROFILE_STATE:
+      *((uint8*)value) = BSProfileState;
+      break;
+
     default:
       ret = INVALIDPARAMETER;
       break;
@@ -383,6 +497,12 @@ static uint8 BSProfile_ReadAttrCB( uint16 connHandle, gattAttribute_t *pAttr,
         //pValue[0] = *pAttr->pValue;
         break;
         
+      // served from the cached value, Read Multiple can fetch it with other services
+      case BSPROFILE_STATE_UUID:
+        *pLen = 1;
+        pValue[0] = *pAttr->pValue;
+        break;
+        
       default:
         // Should never get here! (characteristics 3 and 4 do not have read permissions)
         *pLen = 0;
@@ -428,6 +548,11 @@ static bStatus_t BSProfile_WriteAttrCB( uint16 connHandle, gattAttribute_t *pAtt
     uint16 uuid = BUILD_UINT16( pAttr->type.uuid[0], pAttr->type.uuid[1]);
     switch ( uuid ) {
       case BSPROFILE_CHAR1_UUID:
+        // A link over its command budget is refused, the others keep going
+        if ( !BSProfile_TakeToken( connHandle ) ) {
+          status = ATT_ERR_INSUFFICIENT_RESOURCES;
+        }
+        
         //Write the value
         if ( status == SUCCESS ) {
           uint8 *pCurValue = (uint8 *)pAttr->pValue;
@@ -461,7 +586,7 @@ static bStatus_t BSProfile_WriteAttrCB( uint16 connHandle, gattAttribute_t *pAtt
 
   // If a charactersitic value changed then callback function to notify application of change
   if ( (notifyApp != 0xFF ) && BSProfile_AppCBs && BSProfile_AppCBs->pfnBSProfileChange ) {
-    BSProfile_AppCBs->pfnBSProfileChange( notifyApp , pValue , len);  
+    BSProfile_AppCBs->pfnBSProfileChange( connHandle, notifyApp , pValue , len);  
   }
   
   return ( status );
@@ -488,6 +613,8 @@ static void BSProfile_HandleConnStatusCB( uint16 connHandle, uint8 changeType )
          ( ( changeType == LINKDB_STATUS_UPDATE_STATEFLAGS ) && 
            ( !linkDB_Up( connHandle ) ) ) ) { 
       GATTServApp_InitCharCfg( connHandle, BSProfileChar1Config );
+      GATTServApp_InitCharCfg( connHandle, BSProfileStateConfig );
+      BSProfile_ResetBudget( connHandle );
     } else if( changeType == LINKDB_STATUS_UPDATE_NEW ) { // when new link is established
       GATTServApp_WriteCharCfg ( connHandle, // configuration value is seted to notify
                                  BSProfileChar1Config, 
@@ -495,6 +622,165 @@ static void BSProfile_HandleConnStatusCB( uint16 connHandle, uint8 changeType )
       // if writing is correct, return success(0). else return failure(1)
     } else {
       GATTServApp_InitCharCfg( connHandle, BSProfileChar1Config );
+      GATTServApp_InitCharCfg( connHandle, BSProfileStateConfig );
+    }
+  }
+}
+
+
+/*********************************************************************
+ * @fn          BSProfile_NotifyCB
+ *
+ * @brief       Send a notification of characteristic 1 to one link.
+ *
+ * @param       pLinkItem - linkDB item
+ *
+ * @return      none
+ */
+static void BSProfile_NotifyCB( linkDBItem_t *pLinkItem )
+{
+  if ( pLinkItem->stateFlags & LINK_CONNECTED )
+  {
+    uint16 value = GATTServApp_ReadCharCfg( pLinkItem->connectionHandle,
+                                            BSProfileChar1Config );
+    if ( value & GATT_CLIENT_CFG_NOTIFY )
+    {
+      attHandleValueNoti_t noti;
+      bStatus_t status;
+
+      noti.handle = BSProfileAttrTbl[INDEX_CHAR_ONE_VALUE].handle;
+      noti.len = (uint8)BSProfileChar1Length;
+      osal_memcpy( noti.value, BSProfileChar1, BSProfileChar1Length );
+
+      status = GATT_Notification( pLinkItem->connectionHandle, &noti, FALSE );
+      if ( status == SUCCESS )
+      {
+        lightStats_NotifyQueued();
+      }
+      else if ( BSProfileNotifyStatus == SUCCESS )
+      {
+        BSProfileNotifyStatus = status;
+      }
+    }
+  }
+}
+
+/*********************************************************************
+ * @fn          BSProfile_StateNotifyCB
+ *
+ * @brief       Send a notification of the light state to one link.
+ *
+ * @param       pLinkItem - linkDB item
+ *
+ * @return      none
+ */
+static void BSProfile_StateNotifyCB( linkDBItem_t *pLinkItem )
+{
+  if ( pLinkItem->stateFlags & LINK_CONNECTED )
+  {
+    uint16 value = GATTServApp_ReadCharCfg( pLinkItem->connectionHandle,
+                                            BSProfileStateConfig );
+    if ( value & GATT_CLIENT_CFG_NOTIFY )
+    {
+      attHandleValueNoti_t noti;
+      bStatus_t status;
+
+      noti.handle = BSProfileAttrTbl[INDEX_STATE_VALUE].handle;
+      noti.len = 1;
+      noti.value[0] = BSProfileState;
+
+      status = GATT_Notification( pLinkItem->connectionHandle, &noti, FALSE );
+      if ( status != SUCCESS && BSProfileNotifyStatus == SUCCESS )
+      {
+        BSProfileNotifyStatus = status;
+      }
+    }
+  }
+}
+
+/*********************************************************************
+ * @fn          BSProfile_TakeToken
+ *
+ * @brief       Spend one write from the command budget of a link.
+ *              The budget refills by one every BSPROFILE_CMD_INTERVAL
+ *              msec, up to BSPROFILE_CMD_BURST.
+ *
+ * @param       connHandle - connection handle
+ *
+ * @return      TRUE if the write may go on, FALSE if the link is over its budget
+ */
+static bool BSProfile_TakeToken( uint16 connHandle )
+{
+  BSProfileLinkBudget_t *pBudget = NULL;
+  BSProfileLinkBudget_t *pFree = NULL;
+  uint32 now = osal_GetSystemClock();
+  uint8 i;
+
+  for ( i = 0; i < GATT_MAX_NUM_CONN; i++ )
+  {
+    if ( BSProfileLinkBudget[i].connHandle == connHandle )
+    {
+      pBudget = &BSProfileLinkBudget[i];
+      break;
+    }
+    if ( pFree == NULL && BSProfileLinkBudget[i].connHandle == INVALID_CONNHANDLE )
+    {
+      pFree = &BSProfileLinkBudget[i];
+    }
+  }
+
+  if ( pBudget == NULL )
+  {
+    // A link that cannot be tracked is never locked out
+    if ( pFree == NULL )
+    {
+      return ( TRUE );
+    }
+
+    pBudget = pFree;
+    pBudget->connHandle = connHandle;
+    pBudget->tokens = BSPROFILE_CMD_BURST;
+    pBudget->lastTick = now;
+  }
+  else
+  {
+    uint32 refill = (now - pBudget->lastTick) / BSPROFILE_CMD_INTERVAL;
+
+    if ( refill != 0 )
+    {
+      pBudget->lastTick += refill * BSPROFILE_CMD_INTERVAL;
+      pBudget->tokens = ( refill >= (uint32)(BSPROFILE_CMD_BURST - pBudget->tokens) ) ?
+                        BSPROFILE_CMD_BURST : (uint8)(pBudget->tokens + refill);
+    }
+  }
+
+  if ( pBudget->tokens == 0 )
+  {
+    return ( FALSE );
+  }
+
+  pBudget->tokens--;
+  return ( TRUE );
+}
+
+/*********************************************************************
+ * @fn          BSProfile_ResetBudget
+ *
+ * @brief       Forget the command budget of a link.
+ *
+ * @param       connHandle - connection handle, INVALID_CONNHANDLE for all links
+ *
+ * @return      none
+ */
+static void BSProfile_ResetBudget( uint16 connHandle )
+{
+  uint8 i;
+
+  for ( i = 0; i < GATT_MAX_NUM_CONN; i++ )
+  {
+    if ( connHandle == INVALID_CONNHANDLE || BSProfileLinkBudget[i].connHandle == connHandle )
+    {
+      BSProfileLinkBudget[i].connHandle = INVALID_CONNHANDLE;
     }
   }
 }
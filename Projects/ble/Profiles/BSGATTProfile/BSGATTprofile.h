@@ -55,12 +55,16 @@ extern "C"
 
 // Profile Parameters
 #define BSPROFILE_CHAR1                0  // RW uint8 - Profile Characteristic 1 value 
+#define BSPROFILE_STATE                1  // R uint8 - Light state, notified on change
   
 // BS Profile Service UUID
 #define BSPROFILE_SERV_UUID            0xFFE0
     
 // Key Pressed UUID
 #define BSPROFILE_CHAR1_UUID           0xFFE1
+
+// Light State UUID
+#define BSPROFILE_STATE_UUID           0xFFE2
   
 // BS Keys Profile Services bit fields
 #define BSPROFILE_SERVICE              0x00000001
@@ -68,6 +72,15 @@ extern "C"
 // Maximum Length Of Characteristic Value
 #define MAX_LENGTH_CHARATERISTIC_VALUE 17
 
+// Per-link command rate limit: a link may send BSPROFILE_CMD_BURST writes at once,
+// then one every BSPROFILE_CMD_INTERVAL msec. Writes over the limit are rejected.
+#if !defined BSPROFILE_CMD_BURST
+#define BSPROFILE_CMD_BURST            4
+#endif
+#if !defined BSPROFILE_CMD_INTERVAL
+#define BSPROFILE_CMD_INTERVAL         250
+#endif
+
 /*********************************************************************
  * TYPEDEFS
  */
@@ -81,8 +94,8 @@ extern "C"
  * Profile Callbacks
  */
 
-// Callback when a characteristic value has changed
-typedef void (*BSProfileChange_t)(uint8 paramID, uint8* pData, uint8 pLength);
+// Callback when a characteristic value has changed, connHandle is the link that wrote it
+typedef void (*BSProfileChange_t)(uint16 connHandle, uint8 paramID, uint8* pData, uint8 pLength);
 
 typedef struct
 {
@@ -137,7 +150,13 @@ extern bStatus_t BSProfile_SetParameter( uint8 param, uint8 len, void *value );
  */
 extern bStatus_t BSProfile_GetParameter( uint8 param, void *value );
 
-extern void notifyCharateristicChanged( uint8 param );
+/*
+ * notifyCharateristicChanged - Notify the characteristic value to every
+ *          connected link that has notifications enabled.
+ *          Returns SUCCESS or the status of the first notification
+ *          the stack refused.
+ */
+extern bStatus_t notifyCharateristicChanged( uint8 param );
 
 
 /*********************************************************************
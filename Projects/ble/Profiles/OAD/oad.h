@@ -83,6 +83,44 @@ extern "C"
 #define OAD_BLOCKS_PER_PAGE  (HAL_FLASH_PAGE_SIZE / OAD_BLOCK_SIZE)
 #define OAD_BLOCK_MAX        (OAD_BLOCKS_PER_PAGE * OAD_IMG_D_AREA)
 
+// Windowed transfer. The ATT MTU of 23 keeps a block at 16 bytes, so speed comes from
+// streaming many blocks per round trip instead. A client that appends a window size
+// (one byte, in blocks) to the Image Identify write may send that many blocks without
+// waiting. The target then requests blocks with:
+//   first missing block (2, LE), window size (1), bitmap of missing blocks from the first one
+// A 2-byte block write (block number only) asks the target to repeat that request.
+#if !defined OAD_WINDOW_MAX
+#define OAD_WINDOW_MAX        32
+#endif
+#define OAD_WINDOW_BYTES(win) (((win) + 7) / 8)
+#define OAD_WINDOW_REQ_SIZE   (3 + OAD_WINDOW_BYTES(OAD_WINDOW_MAX))
+
+// Coded images. A client that follows the window size with a coding (one byte) and the
+// length of the coded stream (2, LE, in blocks) sends that stream instead of the image.
+// The header in front still describes the decoded image, and its CRC is checked as usual.
+// A delta also names the running image it was made against: version (2, LE) and user id.
+// The stream is a run of ops; once the image is complete the rest of the block is padding:
+//   0x00-0x7F  literal: (op + 1) bytes follow
+//   0x80-0xBF  match: (op & 0x3F) + 3 bytes from a distance (2, LE) back in the decoded image
+//   0xC0-0xFF  base copy: (op & 0x3F) + 4 bytes from an offset (3, LE) in the running image
+// Coded blocks are only taken in order, so a window is resent from its first missing block.
+#if !defined OAD_CODED_IMAGES
+#define OAD_CODED_IMAGES      FALSE
+#endif
+
+#define OAD_CODING_NONE       0
+#define OAD_CODING_LZ         1
+#define OAD_CODING_DELTA      2
+
+#define OAD_CODED_REQ_SIZE   (OAD_IMG_HDR_SIZE + 4)
+#define OAD_DELTA_REQ_SIZE   (OAD_CODED_REQ_SIZE + 2 + OAD_IMG_ID_SIZE)
+
+#define OAD_OP_MATCH          0x80
+#define OAD_OP_BASE           0xC0
+#define OAD_OP_LEN_MASK       0x3F
+#define OAD_OP_MATCH_MIN      3
+#define OAD_OP_BASE_MIN       4
+
 /*********************************************************************
  * MACROS
  */
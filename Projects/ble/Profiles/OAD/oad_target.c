@@ -58,6 +58,7 @@
 #include "oad.h"
 #include "oad_target.h"
 #include "OSAL.h"
+#include "osal_snv.h"
 
 /*********************************************************************
  * CONSTANTS
@@ -65,6 +66,15 @@
 
 #define OAD_FLASH_PAGE_MULT  ((uint16)(HAL_FLASH_PAGE_SIZE / HAL_FLASH_WORD_SIZE))
 
+#if (OAD_WINDOW_MAX > 32)
+#error "The received-block bitmap holds 32 blocks"
+#endif
+
+// Encrypted images do not compress, so coded images are for the CRC-checked OAD only.
+#if (defined OAD_CODED_IMAGES) && (OAD_CODED_IMAGES == TRUE) && !defined FEATURE_OAD_SECURE
+#define OAD_CODED
+#endif
+
 #if defined (FEATURE_OAD_SECURE) && defined (HAL_IMAGE_A)
   // Enabled to ONLY build a BOOTSTRAP Encrypted Image-A (for programming over
   // BEM, not BIM). Comment line below to build a non-bootstrap Encrypted Image-A.
@@ -87,6 +97,12 @@
  * MACROS
  */
 
+#if defined OAD_CODED
+#define OAD_IS_CODED()        (oadCoding != OAD_CODING_NONE)
+#else
+#define OAD_IS_CODED()        FALSE
+#endif
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
@@ -242,6 +258,45 @@ static const __code aes_hdr_t _aesHdr = {
 
 static uint16 oadBlkNum = 0, oadBlkTot = 0xFFFF;
 
+// Windowed transfer: window size (0 for one block per request), blocks received from
+// oadBlkNum on (bit 0 is oadBlkNum itself) and the end of the last requested window.
+static uint8 oadWindow = 0;
+static uint32 oadWinRcvd = 0;
+static uint16 oadWinEnd = 0;
+
+// First block whose flash page is not erased yet
+static uint16 oadEraseBlk = 0;
+
+#if !defined FEATURE_OAD_SECURE
+// Blocks of the image itself; oadBlkTot counts the blocks sent, which differ for a coded image.
+static uint16 oadImgTot = 0;
+
+// Running image CRC over the blocks before oadCrcBlk, kept up as blocks are committed
+static uint16 oadCrc = 0x0000;
+static uint16 oadCrcBlk = 0;
+
+// Download progress, saved to SNV whenever a page is complete
+static oadProgress_t oadProgress;
+#endif
+
+#if defined OAD_CODED
+// Coded download: the coding, the decoded blocks written so far and the one being decoded
+static uint8 oadCoding = OAD_CODING_NONE;
+static uint16 oadOutBlk;
+static uint8 oadOutLen;
+static uint8 oadOutBuf[OAD_BLOCK_SIZE];
+
+// The op being decoded: literal bytes still to come, or its argument bytes still to come
+static uint8 oadOp;
+static uint8 oadOpLit;
+static uint8 oadOpArgs;
+static uint8 oadOpShift;
+static uint32 oadOpArg;
+
+// Bytes of the running image a delta may copy from
+static uint32 oadBaseLen;
+#endif
+
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
@@ -263,15 +318,34 @@ static void oadImgBlockReq(uint16 connHandle, uint16 blkNum);
 
 static void oadImgIdentifyReq(uint16 connHandle, img_hdr_t *pImgHdr);
 
-static bStatus_t oadImgIdentifyWrite( uint16 connHandle, uint8 *pValue );
+static bStatus_t oadImgIdentifyWrite( uint16 connHandle, uint8 *pValue, uint8 len );
+
+static bStatus_t oadImgBlockWrite( uint16 connHandle, uint8 *pValue, uint8 len );
+
+static void oadImgBlockStore(uint16 blkNum, uint8 *pBlock);
 
-static bStatus_t oadImgBlockWrite( uint16 connHandle, uint8 *pValue );
+static uint8 oadImgBlockPage(uint16 blkNum);
+
+static void oadImgComplete(void);
 
 static void oadHandleConnStatusCB( uint16 connHandle, uint8 changeType );
 
+#if defined OAD_CODED
+static uint8 oadCodedIdentify(uint8 *pValue, uint8 len, img_hdr_t *pRunHdr);
+static bStatus_t oadCodedBlockWrite( uint16 connHandle, uint16 blkNum, uint8 *pBlock );
+static uint8 oadDecode(uint8 *pIn);
+static uint8 oadDecCopy(void);
+static uint8 oadDecOut(uint8 b);
+static uint8 oadImgRunPage(uint8 idx);
+#endif
+
 #if !defined FEATURE_OAD_SECURE
 static void DMAExecCrc(uint8 page, uint16 offset, uint16 len);
 static uint8 checkDL(void);
+static void crcUpdateDL(uint16 blkCnt);
+static uint16 crcEndDL(void);
+static uint16 crcCalcDLDMA(uint8 pageCnt);
+static void oadImgResume(img_hdr_t *pRxHdr);
 #endif
 
 /*********************************************************************
@@ -357,11 +431,11 @@ static bStatus_t oadWriteAttrCB(uint16 connHandle, gattAttribute_t *pAttr,
     // 128-bit UUID
     if (osal_memcmp(pAttr->type.uuid, oadCharUUID[OAD_CHAR_IMG_IDENTIFY], ATT_UUID_SIZE))
     {
-      status = oadImgIdentifyWrite( connHandle, pValue );
+      status = oadImgIdentifyWrite( connHandle, pValue, len );
     }
     else if (osal_memcmp(pAttr->type.uuid, oadCharUUID[OAD_CHAR_IMG_BLOCK], ATT_UUID_SIZE))
     {
-      status = oadImgBlockWrite( connHandle, pValue );
+      status = oadImgBlockWrite( connHandle, pValue, len );
     }
     else
     {
@@ -379,10 +453,11 @@ static bStatus_t oadWriteAttrCB(uint16 connHandle, gattAttribute_t *pAttr,
  *
  * @param   connHandle - connection message was received on
  * @param   pValue - pointer to data to be written
+ * @param   len - length of data, a window size and a coding may follow the header
  *
  * @return  status
  */
-static bStatus_t oadImgIdentifyWrite( uint16 connHandle, uint8 *pValue )
+static bStatus_t oadImgIdentifyWrite( uint16 connHandle, uint8 *pValue, uint8 len )
 {
   img_hdr_t rxHdr;
   img_hdr_t ImgHdr;
@@ -395,13 +470,42 @@ static bStatus_t oadImgIdentifyWrite( uint16 connHandle, uint8 *pValue )
   HalFlashRead(OAD_IMG_R_PAGE, OAD_IMG_HDR_OSET, (uint8 *)&ImgHdr, sizeof(img_hdr_t));
 
   oadBlkTot = rxHdr.len / (OAD_BLOCK_SIZE / HAL_FLASH_WORD_SIZE);
+#if !defined FEATURE_OAD_SECURE
+  oadImgTot = oadBlkTot;
+#endif
+
+#if defined OAD_CODED
+  if ( !oadCodedIdentify( pValue, len, &ImgHdr ) )
+  {
+    oadBlkTot = 0;  // Refused below.
+  }
+#endif
 
   if ( (OAD_IMG_ID( ImgHdr.ver ) != OAD_IMG_ID( rxHdr.ver )) && // TBD: add customer criteria for initiating OAD here.
        (oadBlkTot <= OAD_BLOCK_MAX) &&
        (oadBlkTot != 0) )
   {
+    oadWindow = 0;
+    if (len > OAD_IMG_HDR_SIZE)
+    {
+      oadWindow = (pValue[OAD_IMG_HDR_SIZE] > OAD_WINDOW_MAX) ? OAD_WINDOW_MAX :
+                                                               pValue[OAD_IMG_HDR_SIZE];
+    }
+
     oadBlkNum = 0;
-    oadImgBlockReq(connHandle, 0);
+    oadWinRcvd = 0;
+    oadEraseBlk = 0;
+#if !defined FEATURE_OAD_SECURE
+    oadCrc = 0x0000;  // Seed the CRC calculation with zero.
+    oadCrcBlk = 0;
+
+    // Pick up a download of the same image that was cut off; a coded stream starts over.
+    if ( !OAD_IS_CODED() )
+    {
+      oadImgResume(&rxHdr);
+    }
+#endif
+    oadImgBlockReq(connHandle, oadBlkNum);
   }
   else
   {
@@ -418,13 +522,45 @@ static bStatus_t oadImgIdentifyWrite( uint16 connHandle, uint8 *pValue )
  *
  * @param   connHandle - connection message was received on
  * @param   pValue - pointer to data to be written
+ * @param   len - length of data
  *
  * @return  status
  */
-static bStatus_t oadImgBlockWrite( uint16 connHandle, uint8 *pValue )
+static bStatus_t oadImgBlockWrite( uint16 connHandle, uint8 *pValue, uint8 len )
 {
   uint16 blkNum = BUILD_UINT16( pValue[0], pValue[1] );
 
+  if ( oadWindow != 0 )
+  {
+    uint16 idx = blkNum - oadBlkNum;
+
+    if ( len == 2 )  // The client has sent its window, tell it what is missing.
+    {
+      oadImgBlockReq(connHandle, oadBlkNum);
+      return ( SUCCESS );
+    }
+
+    // Drop blocks outside the window or already received; until block 0 has passed
+    // the header checks nothing else is stored.
+    if ( ( len != 2 + OAD_BLOCK_SIZE ) || ( blkNum < oadBlkNum ) || ( idx >= oadWindow ) ||
+         ( blkNum >= oadBlkTot ) || ( oadWinRcvd & ((uint32)1 << idx) ) ||
+         ( ( oadBlkNum == 0 ) && ( blkNum != 0 ) ) )
+    {
+      return ( SUCCESS );
+    }
+  }
+  else if ( len != 2 + OAD_BLOCK_SIZE )
+  {
+    return ( ATT_ERR_INVALID_VALUE_SIZE );
+  }
+
+#if defined OAD_CODED
+  if ( oadCoding != OAD_CODING_NONE )
+  {
+    return oadCodedBlockWrite( connHandle, blkNum, pValue+2 );
+  }
+#endif
+
   // make sure this is the image we're expecting
   if ( blkNum == 0 )
   {
@@ -442,60 +578,170 @@ static bStatus_t oadImgBlockWrite( uint16 connHandle, uint8 *pValue )
     }
   }
 
-  if (oadBlkNum == blkNum)
+  if ( oadWindow != 0 )
   {
-    uint16 addr = oadBlkNum * (OAD_BLOCK_SIZE / HAL_FLASH_WORD_SIZE) +
-                              (OAD_IMG_D_PAGE * OAD_FLASH_PAGE_MULT);
-    oadBlkNum++;
+    oadImgBlockStore(blkNum, pValue+2);
 
-#if defined FEATURE_OAD_SECURE
-    if (blkNum == 0)
+    // Slide the window over every block received in order.
+    oadWinRcvd |= (uint32)1 << (blkNum - oadBlkNum);
+    while (oadWinRcvd & 1)
     {
-      // Stop attack with crc0==crc1 by forcing crc1=0xffff.
-      pValue[4] = 0xFF;
-      pValue[5] = 0xFF;
+      oadWinRcvd >>= 1;
+      oadBlkNum++;
     }
+#if !defined FEATURE_OAD_SECURE
+    crcUpdateDL(oadBlkNum);
 #endif
 
-#if defined HAL_IMAGE_B
-    // Skip the Image-B area which lies between the lower & upper Image-A parts.
-    if (addr >= (OAD_IMG_B_PAGE * OAD_FLASH_PAGE_MULT))
+    if (oadBlkNum == oadBlkTot)  // If the OAD Image is complete.
     {
-      addr += OAD_IMG_B_AREA * OAD_FLASH_PAGE_MULT;
+      oadImgComplete();
     }
-#endif
-    if ((addr % OAD_FLASH_PAGE_MULT) == 0)
+    else if (oadBlkNum >= oadWinEnd)  // The whole window arrived, ask for the next one.
     {
-      HalFlashErase(addr / OAD_FLASH_PAGE_MULT);
+      oadImgBlockReq(connHandle, oadBlkNum);
     }
-
-    HalFlashWrite(addr, pValue+2, (OAD_BLOCK_SIZE / HAL_FLASH_WORD_SIZE));
   }
-
-  if (oadBlkNum == oadBlkTot)  // If the OAD Image is complete.
+  else
   {
-#if defined FEATURE_OAD_SECURE
-    HAL_SYSTEM_RESET();  // Only the secure OAD boot loader has the security key to decrypt.
-#else
-    if (checkDL())
+    if (oadBlkNum == blkNum)
     {
-#if !defined HAL_IMAGE_A
-      // The BIM always checks for a valid Image-B before Image-A,
-      // so Image-A never has to invalidate itself.
-      uint16 crc[2] = { 0x0000, 0xFFFF };
-      uint16 addr = OAD_IMG_R_PAGE * OAD_FLASH_PAGE_MULT + OAD_IMG_CRC_OSET / HAL_FLASH_WORD_SIZE;
-      HalFlashWrite(addr, (uint8 *)crc, 1);
+      oadImgBlockStore(blkNum, pValue+2);
+      oadBlkNum++;
+#if !defined FEATURE_OAD_SECURE
+      crcUpdateDL(oadBlkNum);
 #endif
-      HAL_SYSTEM_RESET();
     }
+
+    if (oadBlkNum == oadBlkTot)  // If the OAD Image is complete.
+    {
+      oadImgComplete();
+    }
+    else  // Request the next OAD Image block.
+    {
+      oadImgBlockReq(connHandle, oadBlkNum);
+    }
+  }
+
+  return ( SUCCESS );
+}
+
+/*********************************************************************
+ * @fn      oadImgBlockStore
+ *
+ * @brief   Write one image block to its place in the download area,
+ *          erasing every page up to it that has not been erased yet.
+ *          Blocks of a window may come out of order.
+ *
+ * @param   blkNum - block number
+ * @param   pBlock - OAD_BLOCK_SIZE bytes of image
+ *
+ * @return  None
+ */
+static void oadImgBlockStore(uint16 blkNum, uint8 *pBlock)
+{
+  uint16 addr = blkNum * (OAD_BLOCK_SIZE / HAL_FLASH_WORD_SIZE) +
+                         (OAD_IMG_D_PAGE * OAD_FLASH_PAGE_MULT);
+
+  uint8 cnt = OAD_BLOCK_SIZE / HAL_FLASH_WORD_SIZE;
+
+#if defined FEATURE_OAD_SECURE
+  if (blkNum == 0)
+  {
+    // Stop attack with crc0==crc1 by forcing crc1=0xffff.
+    pBlock[2] = 0xFF;
+    pBlock[3] = 0xFF;
+  }
+#else
+  if (blkNum == 0)
+  {
+    // Hold crc0 back until the last block: with crc0 erased the BIM takes a partial download
+    // for no image, instead of checking it on every reset and marking it failed in the header
+    // page that a resumed download keeps.
+    oadProgress.crc0 = BUILD_UINT16(pBlock[0], pBlock[1]);
+    pBlock += HAL_FLASH_WORD_SIZE;
+    addr++;
+    cnt--;
+  }
 #endif
+
+  while (oadEraseBlk <= blkNum)
+  {
+    HalFlashErase(oadImgBlockPage(oadEraseBlk));
+    oadEraseBlk = (oadEraseBlk / OAD_BLOCKS_PER_PAGE + 1) * OAD_BLOCKS_PER_PAGE;
   }
-  else  // Request the next OAD Image block.
+
+#if defined HAL_IMAGE_B
+  // Skip the Image-B area which lies between the lower & upper Image-A parts.
+  if (addr >= (OAD_IMG_B_PAGE * OAD_FLASH_PAGE_MULT))
   {
-    oadImgBlockReq(connHandle, oadBlkNum);
+    addr += OAD_IMG_B_AREA * OAD_FLASH_PAGE_MULT;
+  }
+#endif
+
+  HalFlashWrite(addr, pBlock, cnt);
+}
+
+/*********************************************************************
+ * @fn      oadImgBlockPage
+ *
+ * @brief   Flash page of an image block in the download area.
+ *
+ * @param   blkNum - block number
+ *
+ * @return  The flash page.
+ */
+static uint8 oadImgBlockPage(uint16 blkNum)
+{
+  uint8 page = blkNum / OAD_BLOCKS_PER_PAGE + OAD_IMG_D_PAGE;
+
+#if defined HAL_IMAGE_B
+  // Skip the Image-B area which lies between the lower & upper Image-A parts.
+  if (page >= OAD_IMG_B_PAGE)
+  {
+    page += OAD_IMG_B_AREA;
   }
+#endif
 
-  return ( SUCCESS );
+  return page;
+}
+
+/*********************************************************************
+ * @fn      oadImgComplete
+ *
+ * @brief   The last block is written: validate and run the new image.
+ *
+ * @return  None
+ */
+static void oadImgComplete(void)
+{
+#if defined FEATURE_OAD_SECURE
+  HAL_SYSTEM_RESET();  // Only the secure OAD boot loader has the security key to decrypt.
+#else
+  uint16 crc[2] = { 0x0000, 0xFFFF };
+  uint16 addr = OAD_IMG_D_PAGE * OAD_FLASH_PAGE_MULT + OAD_IMG_CRC_OSET / HAL_FLASH_WORD_SIZE;
+
+  // Whatever the check says, this download is over.
+  oadProgress.pages = 0;
+  VOID osal_snv_write(OAD_NVID_PROGRESS, sizeof(oadProgress_t), &oadProgress);
+
+  // Only now does the download look like an image to the BIM.
+  crc[0] = oadProgress.crc0;
+  HalFlashWrite(addr, (uint8 *)crc, 1);
+
+  if (checkDL())
+  {
+#if !defined HAL_IMAGE_A
+    // The BIM always checks for a valid Image-B before Image-A,
+    // so Image-A never has to invalidate itself.
+    crc[0] = 0x0000;
+    crc[1] = 0xFFFF;
+    addr = OAD_IMG_R_PAGE * OAD_FLASH_PAGE_MULT + OAD_IMG_CRC_OSET / HAL_FLASH_WORD_SIZE;
+    HalFlashWrite(addr, (uint8 *)crc, 1);
+#endif
+    HAL_SYSTEM_RESET();
+  }
+#endif
 }
 
 /*********************************************************************
@@ -523,6 +769,32 @@ static void oadImgBlockReq(uint16 connHandle, uint16 blkNum)
     noti.value[0] = LO_UINT16(blkNum);
     noti.value[1] = HI_UINT16(blkNum);
 
+    if (oadWindow != 0)
+    {
+      uint32 missing = ~oadWinRcvd;
+      uint16 left = oadBlkTot - blkNum;
+      uint8 idx;
+
+      // Only the window counts, and blocks past the end of the image are never missing.
+      if (left > oadWindow)
+      {
+        left = oadWindow;
+      }
+      if (left < 32)
+      {
+        missing &= ((uint32)1 << left) - 1;
+      }
+
+      noti.value[2] = oadWindow;
+      for (idx = 0; idx < OAD_WINDOW_BYTES(oadWindow); idx++)
+      {
+        noti.value[3 + idx] = (uint8)(missing >> (8 * idx));
+      }
+      noti.len = 3 + OAD_WINDOW_BYTES(oadWindow);
+
+      oadWinEnd = blkNum + oadWindow;
+    }
+
     VOID GATT_Notification(connHandle, &noti, FALSE);
   }
 }
@@ -561,6 +833,317 @@ static void oadImgIdentifyReq(uint16 connHandle, img_hdr_t *pImgHdr)
   }
 }
 
+#if defined OAD_CODED
+/*********************************************************************
+ * @fn      oadCodedIdentify
+ *
+ * @brief   Pick up the coding that may follow the window size in an
+ *          Image Identify write and reset the decoder.
+ *
+ * @param   pValue - pointer to the Image Identify write
+ * @param   len - length of the write
+ * @param   pRunHdr - header of the running image
+ *
+ * @return  FALSE if the coded image cannot be taken, else TRUE
+ */
+static uint8 oadCodedIdentify(uint8 *pValue, uint8 len, img_hdr_t *pRunHdr)
+{
+  uint8 coding;
+
+  oadCoding = OAD_CODING_NONE;
+
+  if ((len < OAD_CODED_REQ_SIZE) || (pValue[OAD_IMG_HDR_SIZE + 1] == OAD_CODING_NONE))
+  {
+    return TRUE;  // A plain image.
+  }
+
+  coding = pValue[OAD_IMG_HDR_SIZE + 1];
+
+  if (coding == OAD_CODING_DELTA)
+  {
+    // A delta only decodes against the image it was made from.
+    if ((len < OAD_DELTA_REQ_SIZE) ||
+        (BUILD_UINT16(pValue[OAD_CODED_REQ_SIZE], pValue[OAD_CODED_REQ_SIZE + 1]) != pRunHdr->ver) ||
+        !osal_memcmp(pValue + OAD_CODED_REQ_SIZE + 2, pRunHdr->uid, OAD_IMG_ID_SIZE))
+    {
+      return FALSE;
+    }
+  }
+  else if (coding != OAD_CODING_LZ)
+  {
+    return FALSE;
+  }
+
+  if (oadImgTot > OAD_BLOCK_MAX)
+  {
+    return FALSE;
+  }
+
+  oadCoding = coding;
+  oadBlkTot = BUILD_UINT16(pValue[OAD_IMG_HDR_SIZE + 2], pValue[OAD_IMG_HDR_SIZE + 3]);
+  oadBaseLen = (uint32)pRunHdr->len * HAL_FLASH_WORD_SIZE;
+
+  oadOutBlk = 0;
+  oadOutLen = 0;
+  oadOpLit = 0;
+  oadOpArgs = 0;
+
+  return TRUE;
+}
+
+/*********************************************************************
+ * @fn      oadCodedBlockWrite
+ *
+ * @brief   Process an Image Block Write of a coded image: decode it
+ *          into the download area.
+ *
+ * @param   connHandle - connection message was received on
+ * @param   blkNum - block number
+ * @param   pBlock - OAD_BLOCK_SIZE bytes of the coded stream
+ *
+ * @return  status
+ */
+static bStatus_t oadCodedBlockWrite( uint16 connHandle, uint16 blkNum, uint8 *pBlock )
+{
+  if ( oadBlkNum >= oadBlkTot )
+  {
+    return ( ATT_ERR_WRITE_NOT_PERMITTED );
+  }
+
+  // The decoder takes the stream in order only; a block past a gap is sent again.
+  if ( blkNum != oadBlkNum )
+  {
+    if ( oadWindow == 0 )
+    {
+      oadImgBlockReq(connHandle, oadBlkNum);
+    }
+    return ( SUCCESS );
+  }
+
+  if ( oadDecode(pBlock) )
+  {
+    oadBlkNum++;
+
+    if ( oadBlkNum != oadBlkTot )
+    {
+      if ( ( oadWindow == 0 ) || ( oadBlkNum >= oadWinEnd ) )
+      {
+        oadImgBlockReq(connHandle, oadBlkNum);
+      }
+      return ( SUCCESS );
+    }
+
+    if ( ( oadOutBlk == oadImgTot ) && ( oadOpLit == 0 ) && ( oadOpArgs == 0 ) )
+    {
+      oadImgComplete();
+      return ( SUCCESS );
+    }
+  }
+
+  // A broken stream ends the download; the client gets the running image header back.
+  {
+    img_hdr_t ImgHdr;
+
+    oadBlkTot = 0;
+    HalFlashRead(OAD_IMG_R_PAGE, OAD_IMG_HDR_OSET, (uint8 *)&ImgHdr, sizeof(img_hdr_t));
+    oadImgIdentifyReq(connHandle, &ImgHdr);
+  }
+
+  return ( ATT_ERR_INVALID_VALUE );
+}
+
+/*********************************************************************
+ * @fn      oadDecode
+ *
+ * @brief   Run one block of the coded stream through the decoder. An
+ *          op may span blocks; its state is kept between calls.
+ *
+ * @param   pIn - OAD_BLOCK_SIZE bytes of the coded stream
+ *
+ * @return  FALSE if the stream is broken, else TRUE
+ */
+static uint8 oadDecode(uint8 *pIn)
+{
+  for (uint8 idx = 0; idx < OAD_BLOCK_SIZE; idx++)
+  {
+    uint8 b = pIn[idx];
+
+    if ((oadOutBlk == oadImgTot) && (oadOpLit == 0) && (oadOpArgs == 0))
+    {
+      break;  // The image is complete, the rest is padding.
+    }
+
+    if (oadOpLit != 0)
+    {
+      oadOpLit--;
+      if (!oadDecOut(b))
+      {
+        return FALSE;
+      }
+    }
+    else if (oadOpArgs != 0)
+    {
+      oadOpArg |= (uint32)b << oadOpShift;
+      oadOpShift += 8;
+
+      if ((--oadOpArgs == 0) && !oadDecCopy())
+      {
+        return FALSE;
+      }
+    }
+    else if (b < OAD_OP_MATCH)
+    {
+      oadOpLit = b + 1;
+    }
+    else
+    {
+      oadOp = b;
+      oadOpArg = 0;
+      oadOpShift = 0;
+      oadOpArgs = (b < OAD_OP_BASE) ? 2 : 3;
+    }
+  }
+
+  return TRUE;
+}
+
+/*********************************************************************
+ * @fn      oadDecCopy
+ *
+ * @brief   Run a match or a base copy op whose arguments are complete.
+ *          A match reads the decoded image back from the download area
+ *          and may overlap the bytes it writes; a base copy reads the
+ *          running image.
+ *
+ * @return  FALSE if the op reaches outside either image, else TRUE
+ */
+static uint8 oadDecCopy(void)
+{
+  uint32 pos = (uint32)oadOutBlk * OAD_BLOCK_SIZE + oadOutLen;
+  uint32 src;
+  uint8 cnt;
+
+  if (oadOp < OAD_OP_BASE)
+  {
+    cnt = (oadOp & OAD_OP_LEN_MASK) + OAD_OP_MATCH_MIN;
+
+    if ((oadOpArg == 0) || (oadOpArg > pos))
+    {
+      return FALSE;
+    }
+    src = pos - oadOpArg;
+  }
+  else
+  {
+    cnt = (oadOp & OAD_OP_LEN_MASK) + OAD_OP_BASE_MIN;
+
+    if ((oadCoding != OAD_CODING_DELTA) || (oadOpArg + cnt > oadBaseLen))
+    {
+      return FALSE;
+    }
+    src = oadOpArg;
+  }
+
+  for (; cnt != 0; cnt--, src++)
+  {
+    uint8 b;
+
+    if (oadOp >= OAD_OP_BASE)
+    {
+      HalFlashRead(oadImgRunPage(src / HAL_FLASH_PAGE_SIZE), src % HAL_FLASH_PAGE_SIZE, &b, 1);
+    }
+    else if ((src / OAD_BLOCK_SIZE) == oadOutBlk)
+    {
+      b = oadOutBuf[src % OAD_BLOCK_SIZE];  // Not written to flash yet.
+    }
+    else
+    {
+      uint16 blk = src / OAD_BLOCK_SIZE;
+
+      HalFlashRead(oadImgBlockPage(blk),
+                   (blk % OAD_BLOCKS_PER_PAGE) * OAD_BLOCK_SIZE + src % OAD_BLOCK_SIZE, &b, 1);
+    }
+
+    if (!oadDecOut(b))
+    {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/*********************************************************************
+ * @fn      oadDecOut
+ *
+ * @brief   Append one decoded byte; a full block is committed to the
+ *          download area and the running CRC like a plain one.
+ *
+ * @param   b - decoded byte
+ *
+ * @return  FALSE if the image is already complete or its header is
+ *          not the one identified, else TRUE
+ */
+static uint8 oadDecOut(uint8 b)
+{
+  if (oadOutBlk == oadImgTot)
+  {
+    return FALSE;
+  }
+
+  oadOutBuf[oadOutLen++] = b;
+
+  if (oadOutLen == OAD_BLOCK_SIZE)
+  {
+    // make sure this is the image we're expecting
+    if (oadOutBlk == 0)
+    {
+      img_hdr_t ImgHdr;
+      uint16 ver = BUILD_UINT16(oadOutBuf[4], oadOutBuf[5]);
+      uint16 blkTot = BUILD_UINT16(oadOutBuf[6], oadOutBuf[7]) / (OAD_BLOCK_SIZE / HAL_FLASH_WORD_SIZE);
+
+      HalFlashRead(OAD_IMG_R_PAGE, OAD_IMG_HDR_OSET, (uint8 *)&ImgHdr, sizeof(img_hdr_t));
+
+      if ((oadImgTot != blkTot) || (OAD_IMG_ID(ImgHdr.ver) == OAD_IMG_ID(ver)))
+      {
+        return FALSE;
+      }
+    }
+
+    oadImgBlockStore(oadOutBlk, oadOutBuf);
+    oadOutBlk++;
+    oadOutLen = 0;
+    crcUpdateDL(oadOutBlk);
+  }
+
+  return TRUE;
+}
+
+/*********************************************************************
+ * @fn      oadImgRunPage
+ *
+ * @brief   Flash page of a page of the running image.
+ *
+ * @param   idx - page index from the start of the running image
+ *
+ * @return  The flash page.
+ */
+static uint8 oadImgRunPage(uint8 idx)
+{
+  uint8 page = idx + OAD_IMG_R_PAGE;
+
+#if !defined HAL_IMAGE_B
+  // Skip the Image-B area which lies between the lower & upper Image-A parts.
+  if (page >= OAD_IMG_B_PAGE)
+  {
+    page += OAD_IMG_B_AREA;
+  }
+#endif
+
+  return page;
+}
+#endif // OAD_CODED
+
 #if !defined FEATURE_OAD_SECURE
 
 #if 0
@@ -628,6 +1211,131 @@ static uint16 crcCalcDL(void)
 }
 #endif
 
+/**************************************************************************************************
+ * @fn          crcEndDL
+ *
+ * @brief       The first block after the CRC span: the whole pages of the DL image, the same
+ *              span crcCalcDLDMA() covers.
+ *
+ * input parameters
+ *
+ * None.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      The block number.
+ **************************************************************************************************
+ */
+static uint16 crcEndDL(void)
+{
+  return (oadImgTot / OAD_BLOCKS_PER_PAGE) * OAD_BLOCKS_PER_PAGE;
+}
+
+/**************************************************************************************************
+ * @fn          crcUpdateDL
+ *
+ * @brief       Run the CRC16 Polynomial calculation over the blocks committed since the last
+ *              call, reading them back from flash. The H/W CRC is seeded with the running value
+ *              and its result saved again, so the RNG is free between blocks.
+ *
+ * input parameters
+ *
+ * @param       blkCnt - Number of image blocks committed in order.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ **************************************************************************************************
+ */
+static void crcUpdateDL(uint16 blkCnt)
+{
+  uint16 crcEnd = crcEndDL();
+
+  while ((oadCrcBlk < blkCnt) && (oadCrcBlk < crcEnd))
+  {
+    uint8 buf[OAD_BLOCK_SIZE];
+    // Skip the CRC and shadow at the start of the image.
+    uint8 idx = (oadCrcBlk == 0) ? 4 : 0;
+    uint8 adccon1;
+    halIntState_t is;
+
+    HalFlashRead(oadImgBlockPage(oadCrcBlk), (oadCrcBlk % OAD_BLOCKS_PER_PAGE) * OAD_BLOCK_SIZE,
+                 buf, OAD_BLOCK_SIZE);
+
+    HAL_ENTER_CRITICAL_SECTION(is);
+    adccon1 = ADCCON1;
+    HalCRCInit(oadCrc);
+    for (; idx < OAD_BLOCK_SIZE; idx++)
+    {
+      HalCRCExec(buf[idx]);
+    }
+    oadCrc = HalCRCCalc();
+    ADCCON1 = adccon1;
+    HAL_EXIT_CRITICAL_SECTION(is);
+
+    // A finished page is a point to resume from, unless the page came out of a decoder.
+    if (((++oadCrcBlk % OAD_BLOCKS_PER_PAGE) == 0) && !OAD_IS_CODED())
+    {
+      oadProgress.pages = oadCrcBlk / OAD_BLOCKS_PER_PAGE;
+      oadProgress.crc = oadCrc;
+      VOID osal_snv_write(OAD_NVID_PROGRESS, sizeof(oadProgress_t), &oadProgress);
+    }
+  }
+}
+
+/**************************************************************************************************
+ * @fn          oadImgResume
+ *
+ * @brief       Start the progress record of a new download. If SNV holds the progress of the
+ *              same image and the CRC of its finished pages still matches, continue after them.
+ *
+ * input parameters
+ *
+ * @param       pRxHdr - The header of the image offered.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ **************************************************************************************************
+ */
+static void oadImgResume(img_hdr_t *pRxHdr)
+{
+  oadProgress_t saved;
+
+  if ((osal_snv_read(OAD_NVID_PROGRESS, sizeof(oadProgress_t), &saved) == SUCCESS) &&
+      (saved.pages != 0) && (saved.ver == pRxHdr->ver) && (saved.len == pRxHdr->len) &&
+      osal_memcmp(saved.uid, pRxHdr->uid, sizeof(saved.uid)) &&
+      ((uint16)saved.pages * OAD_BLOCKS_PER_PAGE < oadBlkTot))
+  {
+    uint8 adccon1 = ADCCON1;
+    uint16 crc = crcCalcDLDMA(saved.pages);
+
+    ADCCON1 = adccon1;
+
+    if (crc == saved.crc)
+    {
+      // The page after the finished ones is erased again before its first block.
+      oadBlkNum = oadEraseBlk = oadCrcBlk = (uint16)saved.pages * OAD_BLOCKS_PER_PAGE;
+      oadCrc = saved.crc;
+      oadProgress = saved;
+      return;
+    }
+  }
+
+  oadProgress.ver = pRxHdr->ver;
+  oadProgress.len = pRxHdr->len;
+  (void)osal_memcpy(oadProgress.uid, pRxHdr->uid, sizeof(oadProgress.uid));
+  oadProgress.pages = 0;
+  oadProgress.crc = 0x0000;
+  VOID osal_snv_write(OAD_NVID_PROGRESS, sizeof(oadProgress_t), &oadProgress);
+}
+
 /**************************************************************************************************
  * @fn          crcCalcDLDMA
  *
@@ -636,7 +1344,7 @@ static uint16 crcCalcDL(void)
  *
  * input parameters
  *
- * None.
+ * @param       pageCnt - Number of pages from the start of the DL image.
  *
  * output parameters
  *
@@ -645,33 +1353,18 @@ static uint16 crcCalcDL(void)
  * @return      The CRC16 calculated.
  **************************************************************************************************
  */
-static uint16 crcCalcDLDMA(void)
+static uint16 crcCalcDLDMA(uint8 pageCnt)
 {
-  uint8 pageBeg = OAD_IMG_D_PAGE;
-  uint8 pageEnd = oadBlkTot / OAD_BLOCKS_PER_PAGE;
-
-#if defined HAL_IMAGE_B
-  pageEnd += OAD_IMG_D_PAGE + OAD_IMG_B_AREA;
-#else
-  pageEnd += OAD_IMG_D_PAGE;
-#endif
-
   HalCRCInit(0x0000);  // Seed thd CRC calculation with zero.
 
   // Handle first page differently to skip CRC and CRC shadow when calculating
-  DMAExecCrc(pageBeg, 4, HAL_FLASH_PAGE_SIZE-4);
+  DMAExecCrc(OAD_IMG_D_PAGE, 4, HAL_FLASH_PAGE_SIZE-4);
 
-  // Do remaining pages
-  for (uint8 pg = pageBeg + 1; pg < pageEnd; pg++)
+  // Do remaining pages; a part of the image that ends before the Image-B area
+  // must not run into it, so every page is mapped from its index.
+  for (uint8 idx = 1; idx < pageCnt; idx++)
   {
-#if defined HAL_IMAGE_B  // Means we are receiving ImgA, so skip ImgB pages
-    if (pg == OAD_IMG_B_PAGE)
-    {
-      pg += OAD_IMG_B_AREA;
-    }
-#endif
-    
-    DMAExecCrc(pg, 0, HAL_FLASH_PAGE_SIZE);
+    DMAExecCrc(oadImgBlockPage((uint16)idx * OAD_BLOCKS_PER_PAGE), 0, HAL_FLASH_PAGE_SIZE);
   }
   
   return HalCRCCalc();
@@ -797,7 +1490,8 @@ static uint8 checkDL(void)
     //P0_0 = 1;
     //P0_0 = 0;
     //P0_0 = 1;
-    crc[1] = crcCalcDLDMA();
+    // The running CRC already covers the image unless a block was never committed in order.
+    crc[1] = (oadCrcBlk == crcEndDL()) ? oadCrc : crcCalcDLDMA(oadImgTot / OAD_BLOCKS_PER_PAGE);
     //P0_0 = 0;
 
 #if defined FEATURE_OAD_BIM  // If download image is made to run in-place, enable it here.
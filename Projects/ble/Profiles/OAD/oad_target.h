@@ -82,6 +82,11 @@ extern "C"
 #define OAD_IMG_R_AREA        OAD_IMG_A_AREA
 #endif
 
+// SNV item holding the progress of a download, so a dropped link resumes where it stopped
+#if !defined OAD_NVID_PROGRESS
+#define OAD_NVID_PROGRESS     0x90
+#endif
+
 /*********************************************************************
  * MACROS
  */
@@ -97,6 +102,18 @@ extern const __code img_hdr_t _imgHdr;
  * TYPEDEFS
  */
 
+// Download progress: the image being received, how many of its pages are
+// complete, the running CRC at the end of the last complete page and the
+// image CRC from block 0, which is written to flash only at the end.
+typedef struct {
+  uint16 ver;
+  uint16 len;
+  uint8  uid[OAD_IMG_ID_SIZE];
+  uint8  pages;
+  uint16 crc;
+  uint16 crc0;
+} oadProgress_t;
+
 /*********************************************************************
  * @fn      OADTarget_AddService
  *
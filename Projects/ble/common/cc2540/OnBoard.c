@@ -245,22 +245,16 @@ uint8 OnBoard_SendKeys( uint8 keys, uint8 state )
  *
  * @brief   Callback service for keys
  *
- * @param   keys  - keys that were pressed
- *          state - shifted
+ * @param   keys  - key that changed
+ *          state - key event (HAL_BS_KEY_EVT_xxx)
  *
  * @return  void
  *********************************************************************/
 void OnBoard_BsKeyCallback ( uint8 keys, uint8 state )
 {
-  uint8 shift;
-  (void)state;
-
-  // shift key (S1) is used to generate key interrupt
-  // applications should not use S1 when key interrupt is enabled
-  shift = (OnboardBsKeyIntEnable == HAL_BS_KEY_INTERRUPT_ENABLE) ? false : 
-    (((keys & HAL_BS_KEY_BTN1) || (keys & HAL_BS_KEY_BTN2) || (keys & HAL_BS_KEY_BTN3) || (keys & HAL_BS_KEY_BTN4))? true : false);
-
-  if ( OnBoard_SendKeys( keys, shift ) != SUCCESS )
+  // The key driver debounces and classifies the keys itself and stays
+  // in interrupt mode, so the event is passed on as the key state
+  if ( OnBoard_SendKeys( keys, state ) != SUCCESS )
   {
     // Process SW1 here
     if ( keys & HAL_BS_KEY_BTN1 )  // Switch 1
@@ -279,27 +273,6 @@ void OnBoard_BsKeyCallback ( uint8 keys, uint8 state )
     {
     }
   }
-
-  // If any key is currently pressed down and interrupt
-  //  is still enabled, disable interrupt and switch to polling 
-  if( keys != 0 )
-  {
-    if( OnboardBsKeyIntEnable == HAL_BS_KEY_INTERRUPT_ENABLE )
-    {
-      OnboardBsKeyIntEnable = HAL_BS_KEY_INTERRUPT_DISABLE;
-      HalBsKeyConfig( OnboardBsKeyIntEnable, OnBoard_BsKeyCallback);
-    }
-  }
-  // If no key is currently pressed down and interrupt
-  // is disabled, enable interrupt and turn off polling 
-  else
-  {
-    if( OnboardBsKeyIntEnable == HAL_BS_KEY_INTERRUPT_DISABLE )
-    {
-      OnboardBsKeyIntEnable = HAL_BS_KEY_INTERRUPT_ENABLE;
-      HalBsKeyConfig( OnboardBsKeyIntEnable, OnBoard_BsKeyCallback);
-    }
-  }
 }
 
 /*********************************************************************
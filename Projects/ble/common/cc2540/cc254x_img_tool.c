@@ -0,0 +1,869 @@
+/**************************************************************************************************
+  Filename:       cc254x_img_tool.c
+
+  Description:
+
+  Host tool that post-processes the binary images for the boot loaders, for release builds that
+  stamp many images at once:
+
+    cc254x_img_tool oad  [options] <in.bin> <out.bin> [<in.bin> <out.bin> ...]
+    cc254x_img_tool boad [options] <in.bin> <out.bin> [<in.bin> <out.bin> ...]
+    cc254x_img_tool ubl  [options] <in.bin> <out.bin> [<in.bin> <out.bin> ...]
+    cc254x_img_tool sbl  [options] <in.bin> <out.bin> [<in.bin> <out.bin> ...]
+    cc254x_img_tool check oad|boad|ubl|sbl [options] <img.bin> [<img.bin> ...]
+    cc254x_img_tool hex  <ubl.hex> <root lines> <app.a51> <out.hex>
+
+  oad   An OAD image for the BIM: the header version and user id are set if given and the CRC
+        is calculated as the linker (-J2,crc=8005) and the BIM do. The image is padded with
+        0xFF to the length in its header, which must be whole flash pages as the BIM checks.
+  boad  A secure OAD image for the BEM: the header is set as above, the AES CBC-MAC signature
+        is calculated as aesSignature() does and the image is then encrypted in 64-byte blocks
+        as the EBL does and imgCrypt() undoes.
+  ubl   A USB-MSD UBL image: the run-code CRC as the linker places it. With -e the AES control
+        block is filled in, the image signed as ublAesAuth() does and encrypted page by page
+        as ublAesCrypt() undoes.
+  sbl   A serial boot loader image: the CRC that calcCRC() checks.
+  check Runs the check that the boot loader runs on each image and fails if any does not pass.
+  hex   The "ProdHex" step of cc254x_ubl_pp.js: the application hex file inside the boot loader
+        hex file. The "ProdUBL" step is only the call to cc254x_sim2bin.exe.
+
+  Options:
+    -v <ver>     Image version, decimal or 0x hex, as it is in the header (i.e. with the A/B bit).
+    -u <uid>     User id, 8 hex digits in header byte order.
+    -k <key>     AES key, 32 hex digits; the dummy key of the boot loaders by default.
+    -n <nonce>   Signature nonce, 24 hex digits (boad) or 20 (ubl -e); the image's own otherwise.
+    -e           Secure UBL image (UBL_SECURE).
+
+  Images are independent of one another, so a release pipeline gets the most out of many cores
+  by running one tool per core on its share of the images, e.g. with "xargs -P" or "make -j".
+
+  Build with any C compiler, e.g. "cl cc254x_img_tool.c" or "cc -O2 -o cc254x_img_tool
+  cc254x_img_tool.c".
+
+  "make test" in Projects/ble/host checks the tool against the golden images of its img/.
+**************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define FLASH_PAGE_SIZE       2048
+#define FLASH_WORD_SIZE       4
+#define KEY_BLENGTH           16
+
+// As in oad.h and bim_main.c: crc0, crc1, ver, len (in flash words), uid and res.
+#define OAD_CRC_OSET          0x00
+#define OAD_CRC1_OSET         0x02
+#define OAD_VER_OSET          0x04
+#define OAD_LEN_OSET          0x06
+#define OAD_UID_OSET          0x08
+#define OAD_IMG_ID_SIZE       4
+#define OAD_CRC_POLY          0x8005
+
+// As in bem_main.c: the aes_hdr_t follows the 16-byte img_hdr_t.
+#define BEM_SIG_OSET          0x10
+#define BEM_NONCE_OSET        0x20
+#define BEM_NONCE_LEN         12
+#define BEM_PAGE_LEN         (FLASH_PAGE_SIZE / FLASH_WORD_SIZE)
+#define SBL_RW_BUF_LEN        64
+
+// As in cc254x_f256_ubl_msd.xcl and ubl_app.h, relative to the image start at page 1 (0x800).
+#define UBL_CODE_OSET        (0x0820 - 0x0800)
+#define UBL_CRC_OSET         (0x0E9C - 0x0800)
+#define UBL_MD_END           (0x1000 - 0x0800)
+#define UBL_IMG_LEN          (119L * FLASH_PAGE_SIZE)
+#define UBL_SPARE_OSET        0x10
+#define UBL_PAGES_OSET        0x14
+#define UBL_SIGN_CMD_OSET     0x15
+#define UBL_NONCE_OSET        0x16
+#define UBL_NONCE_LEN         10
+#define UBL_CRC_POLY          0x1021
+
+// As in sbl_app.h for a CC2540F256 (HAL_NV_PAGE_BEG 125), relative to the image start at 0x800.
+#define SBL_CRC_OSET         (0x0890 - 0x0800)
+#define SBL_IMG_LEN          (125L * FLASH_PAGE_SIZE - 0x0800)
+#define SBL_CRC_POLY          0x1021
+
+#define VAR_OAD               0
+#define VAR_BOAD              1
+#define VAR_UBL               2
+#define VAR_SBL               3
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct {
+  unsigned char *buf;
+  long len;               // bytes processed, the file padded with 0xFF if need be
+  long size;              // bytes written back
+} image_t;
+
+typedef struct {
+  int hasVer, hasUid, hasNonce, ublSecure;
+  unsigned ver;
+  unsigned char uid[OAD_IMG_ID_SIZE];
+  unsigned char nonce[BEM_NONCE_LEN];
+} opts_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static const char *variants[] = { "oad", "boad", "ubl", "sbl" };
+
+// The dummy key of bem_main.c and ubl_exec.c.
+static unsigned char aesKey[KEY_BLENGTH] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+};
+
+static unsigned char sbox[256];
+static unsigned char roundKey[KEY_BLENGTH * 11];
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void fail(const char *msg, const char *arg)
+{
+  fprintf(stderr, "cc254x_img_tool: %s%s\n", msg, arg ? arg : "");
+  exit(1);
+}
+
+static void *alloc(long size)
+{
+  void *p = calloc((size_t)size, 1);
+
+  if (p == NULL)
+  {
+    fail("out of memory", NULL);
+  }
+  return p;
+}
+
+static unsigned get16(const unsigned char *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+static void put16(unsigned char *p, unsigned val)
+{
+  p[0] = (unsigned char)val;
+  p[1] = (unsigned char)(val >> 8);
+}
+
+static void hexArg(const char *arg, unsigned char *out, int len)
+{
+  int idx;
+
+  if ((int)strlen(arg) != len * 2)
+  {
+    fail("wrong number of hex digits in ", arg);
+  }
+  for (idx = 0; idx < len; idx++)
+  {
+    unsigned val;
+
+    if (sscanf(arg + idx * 2, "%2x", &val) != 1)
+    {
+      fail("not hex: ", arg);
+    }
+    out[idx] = (unsigned char)val;
+  }
+}
+
+/*********************************************************************
+ * Images
+ */
+
+// Read an image, padded with 0xFF to at least 'len' bytes; 0 for the file length.
+static void readImage(const char *path, image_t *pImg, long len)
+{
+  FILE *f = fopen(path, "rb");
+
+  if ((f == NULL) || (fseek(f, 0, SEEK_END) != 0) || ((pImg->size = ftell(f)) <= 0))
+  {
+    fail("cannot read ", path);
+  }
+
+  pImg->len = (pImg->size > len) ? pImg->size : len;
+  pImg->buf = alloc(pImg->len);
+  memset(pImg->buf, 0xFF, (size_t)pImg->len);
+  fseek(f, 0, SEEK_SET);
+  if (fread(pImg->buf, 1, (size_t)pImg->size, f) != (size_t)pImg->size)
+  {
+    fail("cannot read ", path);
+  }
+  fclose(f);
+}
+
+static void writeImage(const char *path, const image_t *pImg)
+{
+  FILE *f = fopen(path, "wb");
+
+  if ((f == NULL) || (fwrite(pImg->buf, 1, (size_t)pImg->size, f) != (size_t)pImg->size))
+  {
+    fail("cannot write ", path);
+  }
+  fclose(f);
+}
+
+// The OAD image length from its header: whole flash pages, cut or padded to it.
+static void oadLength(image_t *pImg, const char *path)
+{
+  long len;
+
+  if (pImg->len < KEY_BLENGTH)
+  {
+    fail("no image header in ", path);
+  }
+  if ((len = (long)get16(pImg->buf + OAD_LEN_OSET) * FLASH_WORD_SIZE) == 0)
+  {
+    fail("no image length in ", path);
+  }
+  if (len % FLASH_PAGE_SIZE)
+  {
+    // The BIM and the BEM check and copy whole pages only, so the CRC could never match.
+    fail("image length not whole flash pages in ", path);
+  }
+
+  if (len > pImg->len)
+  {
+    pImg->buf = realloc(pImg->buf, (size_t)len);
+    if (pImg->buf == NULL)
+    {
+      fail("out of memory", NULL);
+    }
+    memset(pImg->buf + pImg->len, 0xFF, (size_t)(len - pImg->len));
+  }
+  pImg->len = pImg->size = len;
+}
+
+/*********************************************************************
+ * CRC
+ */
+
+// As crc16() in sbl_exec.c: the bits are shifted in, so two zero bytes flush the result out.
+static unsigned crc16(unsigned crc, unsigned char val, unsigned poly)
+{
+  int cnt;
+
+  for (cnt = 0; cnt < 8; cnt++, val <<= 1)
+  {
+    unsigned msb = crc & 0x8000;
+
+    crc = (crc << 1) & 0xFFFF;
+    if (val & 0x80)  crc |= 0x0001;
+    if (msb)         crc ^= poly;
+  }
+  return crc;
+}
+
+// The CRC from 'beg' to the end of the image with the bytes from 'skipBeg' up to 'skipEnd' left
+// out, as the linker calculates it and the boot loaders check it.
+static unsigned crcCalc(const image_t *pImg, long beg, long skipBeg, long skipEnd, unsigned poly)
+{
+  unsigned crc = 0;
+  long idx;
+
+  for (idx = beg; idx < pImg->len; idx++)
+  {
+    if ((idx < skipBeg) || (idx >= skipEnd))
+    {
+      crc = crc16(crc, pImg->buf[idx], poly);
+    }
+  }
+  crc = crc16(crc, 0, poly);
+  crc = crc16(crc, 0, poly);
+
+  return crc;
+}
+
+/*********************************************************************
+ * AES-128, encryption only as the CTR and CBC-MAC modes need no more
+ */
+
+#define ROTL8(x, n)  ((unsigned char)(((x) << (n)) | ((x) >> (8 - (n)))))
+
+static unsigned char xtime(unsigned char x)
+{
+  return (unsigned char)((x << 1) ^ ((x & 0x80) ? 0x1B : 0x00));
+}
+
+static void aesInit(void)
+{
+  unsigned char p = 1, q = 1;
+  unsigned char rcon = 1;
+  int idx;
+
+  // The S-box is the inverse in GF(2^8) put through the affine transform; p runs over the
+  // field by multiplying by 3 while q divides by 3, so q is the inverse of p.
+  do
+  {
+    p = (unsigned char)(p ^ (p << 1) ^ ((p & 0x80) ? 0x1B : 0x00));
+    q ^= (unsigned char)(q << 1);
+    q ^= (unsigned char)(q << 2);
+    q ^= (unsigned char)(q << 4);
+    if (q & 0x80)
+    {
+      q ^= 0x09;
+    }
+    sbox[p] = (unsigned char)(q ^ ROTL8(q, 1) ^ ROTL8(q, 2) ^ ROTL8(q, 3) ^ ROTL8(q, 4) ^ 0x63);
+  } while (p != 1);
+  sbox[0] = 0x63;
+
+  memcpy(roundKey, aesKey, KEY_BLENGTH);
+  for (idx = KEY_BLENGTH; idx < (int)sizeof(roundKey); idx += 4)
+  {
+    unsigned char t[4];
+
+    memcpy(t, roundKey + idx - 4, 4);
+    if ((idx % KEY_BLENGTH) == 0)
+    {
+      unsigned char t0 = t[0];
+
+      t[0] = (unsigned char)(sbox[t[1]] ^ rcon);
+      t[1] = sbox[t[2]];
+      t[2] = sbox[t[3]];
+      t[3] = sbox[t0];
+      rcon = xtime(rcon);
+    }
+    roundKey[idx + 0] = roundKey[idx - KEY_BLENGTH + 0] ^ t[0];
+    roundKey[idx + 1] = roundKey[idx - KEY_BLENGTH + 1] ^ t[1];
+    roundKey[idx + 2] = roundKey[idx - KEY_BLENGTH + 2] ^ t[2];
+    roundKey[idx + 3] = roundKey[idx - KEY_BLENGTH + 3] ^ t[3];
+  }
+}
+
+static void aesEncrypt(unsigned char *s)
+{
+  unsigned char t[KEY_BLENGTH];
+  int round, idx;
+
+  for (idx = 0; idx < KEY_BLENGTH; idx++)
+  {
+    s[idx] ^= roundKey[idx];
+  }
+
+  for (round = 1; round <= 10; round++)
+  {
+    // SubBytes and ShiftRows: byte r of column c comes from column c + r.
+    for (idx = 0; idx < KEY_BLENGTH; idx++)
+    {
+      t[idx] = sbox[s[(idx + (idx % 4) * 4) % KEY_BLENGTH]];
+    }
+
+    if (round < 10)
+    {
+      for (idx = 0; idx < KEY_BLENGTH; idx += 4)
+      {
+        unsigned char all = t[idx] ^ t[idx + 1] ^ t[idx + 2] ^ t[idx + 3];
+        unsigned char t0 = t[idx];
+
+        s[idx + 0] = t[idx + 0] ^ all ^ xtime(t[idx + 0] ^ t[idx + 1]);
+        s[idx + 1] = t[idx + 1] ^ all ^ xtime(t[idx + 1] ^ t[idx + 2]);
+        s[idx + 2] = t[idx + 2] ^ all ^ xtime(t[idx + 2] ^ t[idx + 3]);
+        s[idx + 3] = t[idx + 3] ^ all ^ xtime(t[idx + 3] ^ t0);
+      }
+    }
+    else
+    {
+      memcpy(s, t, KEY_BLENGTH);
+    }
+
+    for (idx = 0; idx < KEY_BLENGTH; idx++)
+    {
+      s[idx] ^= roundKey[round * KEY_BLENGTH + idx];
+    }
+  }
+}
+
+// CTR over 'len' bytes from A1 = { 1, 0 ... 0, 1 }, as aesCrypt() and ublAesCrypt() load it.
+static void aesCtr(unsigned char *buf, long len)
+{
+  unsigned char ctr[KEY_BLENGTH] = { 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+  long oset;
+
+  for (oset = 0; oset < len; oset += KEY_BLENGTH)
+  {
+    unsigned char ks[KEY_BLENGTH];
+    int idx;
+
+    memcpy(ks, ctr, KEY_BLENGTH);
+    aesEncrypt(ks);
+    for (idx = 0; idx < KEY_BLENGTH; idx++)
+    {
+      buf[oset + idx] ^= ks[idx];
+    }
+
+    // The 2-byte counter of the L = 2 encoding.
+    if (++ctr[15] == 0)
+    {
+      ctr[14]++;
+    }
+  }
+}
+
+// CBC-MAC with a zero IV, starting with the B0 block and leaving out the 16 signature bytes.
+static void aesMac(const unsigned char *b0, const unsigned char *buf, long len, long sigOset,
+                   unsigned char *mac)
+{
+  long oset;
+  int idx;
+
+  memcpy(mac, b0, KEY_BLENGTH);
+  aesEncrypt(mac);
+
+  for (oset = 0; oset < len; oset += KEY_BLENGTH)
+  {
+    if (oset == sigOset)
+    {
+      continue;
+    }
+    for (idx = 0; idx < KEY_BLENGTH; idx++)
+    {
+      mac[idx] ^= buf[oset + idx];
+    }
+    aesEncrypt(mac);
+  }
+}
+
+// B0 flags: Res=0, A_Data=0, (M-2)/2=7, (L-1)=2; then the nonce and the 3-byte signed length.
+static void aesB0(unsigned char *b0, const unsigned char *nonce, long len)
+{
+  b0[0] = 0x3A;
+  memcpy(b0 + 1, nonce, 12);
+  b0[13] = (unsigned char)(len >> 16);
+  b0[14] = (unsigned char)(len >> 8);
+  b0[15] = (unsigned char)len;
+}
+
+/*********************************************************************
+ * Secure OAD for the BEM
+ */
+
+static long boadPages(const image_t *pImg, const char *path)
+{
+  long pages = get16(pImg->buf + OAD_LEN_OSET) / BEM_PAGE_LEN;
+
+  if (pages == 0)
+  {
+    fail("less than a flash page in ", path);
+  }
+  return pages;
+}
+
+static void boadSign(const image_t *pImg, long pages, unsigned char *sig)
+{
+  unsigned char b0[KEY_BLENGTH];
+  long len = pages * FLASH_PAGE_SIZE;
+
+  aesB0(b0, pImg->buf + BEM_NONCE_OSET, len - KEY_BLENGTH);
+  aesMac(b0, pImg->buf, len, BEM_SIG_OSET, sig);
+}
+
+// The EBL encrypts in SBL_RW_BUF_LEN blocks, each from the first counter, and not the header.
+static void boadCrypt(image_t *pImg, long pages)
+{
+  long oset;
+
+  for (oset = 0; oset < pages * FLASH_PAGE_SIZE; oset += SBL_RW_BUF_LEN)
+  {
+    if (oset == 0)
+    {
+      aesCtr(pImg->buf + KEY_BLENGTH, SBL_RW_BUF_LEN - KEY_BLENGTH);
+    }
+    else
+    {
+      aesCtr(pImg->buf + oset, SBL_RW_BUF_LEN);
+    }
+  }
+}
+
+/*********************************************************************
+ * Secure UBL
+ */
+
+static long ublPages(const image_t *pImg)
+{
+  return (pImg->size + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
+}
+
+static void ublSign(const image_t *pImg, long pages, unsigned char *sig)
+{
+  unsigned char nonce[12];
+  unsigned char b0[KEY_BLENGTH];
+
+  // The crc spare in front of the 10 nonce bytes, as aesInitSig() in ubl_exec.c loads it.
+  memcpy(nonce, pImg->buf + UBL_SPARE_OSET, 2);
+  memcpy(nonce + 2, pImg->buf + UBL_NONCE_OSET, UBL_NONCE_LEN);
+  aesB0(b0, nonce, pages * FLASH_PAGE_SIZE - KEY_BLENGTH);
+  aesMac(b0, pImg->buf, pages * FLASH_PAGE_SIZE, 0, sig);
+}
+
+static void ublCrypt(image_t *pImg, long pages)
+{
+  long pg;
+
+  for (pg = 0; pg < pages; pg++)
+  {
+    aesCtr(pImg->buf + pg * FLASH_PAGE_SIZE, FLASH_PAGE_SIZE);
+  }
+}
+
+/*********************************************************************
+ * Variants
+ */
+
+static void readVariant(int var, const char *path, image_t *pImg, const opts_t *pOpts)
+{
+  if (var == VAR_OAD || var == VAR_BOAD)
+  {
+    readImage(path, pImg, 0);
+    oadLength(pImg, path);
+  }
+  else if (var == VAR_UBL)
+  {
+    readImage(path, pImg, UBL_IMG_LEN);
+    if (pImg->size <= UBL_MD_END)
+    {
+      fail("too short for a UBL image: ", path);
+    }
+    if (pOpts->ublSecure)
+    {
+      // Whole pages, as the USB-MSD transport writes them.
+      pImg->size = ublPages(pImg) * FLASH_PAGE_SIZE;
+    }
+  }
+  else
+  {
+    readImage(path, pImg, SBL_IMG_LEN);
+    if (pImg->size <= SBL_CRC_OSET + 4)
+    {
+      fail("too short for an SBL image: ", path);
+    }
+  }
+
+  if (((var == VAR_UBL) && (pImg->len > UBL_IMG_LEN)) ||
+      ((var == VAR_SBL) && (pImg->len > SBL_IMG_LEN)))
+  {
+    fail("too long for its image area: ", path);
+  }
+}
+
+static void make(int var, const char *inPath, const char *outPath, const opts_t *pOpts)
+{
+  image_t img;
+  unsigned crc;
+
+  readVariant(var, inPath, &img, pOpts);
+
+  if (var == VAR_OAD || var == VAR_BOAD)
+  {
+    if (pOpts->hasVer)
+    {
+      put16(img.buf + OAD_VER_OSET, pOpts->ver);
+    }
+    if (pOpts->hasUid)
+    {
+      memcpy(img.buf + OAD_UID_OSET, pOpts->uid, OAD_IMG_ID_SIZE);
+    }
+    put16(img.buf + OAD_CRC1_OSET, 0xFFFF);
+  }
+
+  switch (var)
+  {
+  case VAR_OAD:
+    crc = crcCalc(&img, OAD_CRC_OSET + 4, 0, 0, OAD_CRC_POLY);
+    if ((crc == 0x0000) || (crc == 0xFFFF))
+    {
+      fail("the CRC is a value the BIM takes for no image; change the image: ", inPath);
+    }
+    put16(img.buf + OAD_CRC_OSET, crc);
+    break;
+
+  case VAR_BOAD:
+  {
+    long pages = boadPages(&img, inPath);
+
+    // The BEM takes crc0 only as the mark of a downloaded image, the signature validates it.
+    crc = get16(img.buf + OAD_CRC_OSET);
+    if ((crc == 0x0000) || (crc == 0xFFFF))
+    {
+      fail("crc0 must be neither 0x0000 nor 0xFFFF in ", inPath);
+    }
+    if (pOpts->hasNonce)
+    {
+      memcpy(img.buf + BEM_NONCE_OSET, pOpts->nonce, BEM_NONCE_LEN);
+    }
+    boadSign(&img, pages, img.buf + BEM_SIG_OSET);
+    boadCrypt(&img, pages);
+    break;
+  }
+
+  case VAR_UBL:
+    crc = crcCalc(&img, UBL_CODE_OSET, UBL_CRC_OSET, UBL_MD_END, UBL_CRC_POLY);
+    put16(img.buf + UBL_CRC_OSET, crc);
+
+    if (pOpts->ublSecure)
+    {
+      long pages = ublPages(&img);
+
+      put16(img.buf + UBL_SPARE_OSET, crc);
+      img.buf[UBL_PAGES_OSET] = (unsigned char)pages;
+      img.buf[UBL_SIGN_CMD_OSET] = 0;
+      if (pOpts->hasNonce)
+      {
+        memcpy(img.buf + UBL_NONCE_OSET, pOpts->nonce, UBL_NONCE_LEN);
+      }
+      ublSign(&img, pages, img.buf);
+      ublCrypt(&img, pages);
+    }
+    break;
+
+  default:
+    crc = crcCalc(&img, 0, SBL_CRC_OSET, SBL_CRC_OSET + 4, SBL_CRC_POLY);
+    put16(img.buf + SBL_CRC_OSET, crc);
+    put16(img.buf + SBL_CRC_OSET + 2, 0xFFFF);
+    break;
+  }
+
+  writeImage(outPath, &img);
+  printf("%s: %s image, %ld bytes, CRC %04X\n", outPath, variants[var], img.size, crc);
+  free(img.buf);
+}
+
+// The check that the boot loader runs on a downloaded image.
+static int check(int var, const char *path, const opts_t *pOpts)
+{
+  image_t img;
+  unsigned char sig[KEY_BLENGTH];
+  int ok;
+
+  readVariant(var, path, &img, pOpts);
+
+  switch (var)
+  {
+  case VAR_OAD:
+  {
+    unsigned crc = get16(img.buf + OAD_CRC_OSET);
+
+    ok = (crc != 0x0000) && (crc != 0xFFFF) && (get16(img.buf + OAD_CRC1_OSET) == 0xFFFF) &&
+         (crc == crcCalc(&img, OAD_CRC_OSET + 4, 0, 0, OAD_CRC_POLY));
+    break;
+  }
+
+  case VAR_BOAD:
+  {
+    long pages = boadPages(&img, path);
+
+    boadCrypt(&img, pages);
+    boadSign(&img, pages, sig);
+    ok = (memcmp(sig, img.buf + BEM_SIG_OSET, KEY_BLENGTH) == 0);
+    break;
+  }
+
+  case VAR_UBL:
+    if (pOpts->ublSecure)
+    {
+      long pages;
+
+      ublCrypt(&img, ublPages(&img));
+      pages = img.buf[UBL_PAGES_OSET];
+      ok = (pages != 0) && (pages <= ublPages(&img)) && (img.buf[UBL_SIGN_CMD_OSET] == 0);
+      if (ok)
+      {
+        ublSign(&img, pages, sig);
+        ok = (memcmp(sig, img.buf, KEY_BLENGTH) == 0);
+      }
+    }
+    else
+    {
+      ok = 1;
+    }
+    ok = ok && (get16(img.buf + UBL_CRC_OSET) ==
+                crcCalc(&img, UBL_CODE_OSET, UBL_CRC_OSET, UBL_MD_END, UBL_CRC_POLY));
+    break;
+
+  default:
+    ok = (get16(img.buf + SBL_CRC_OSET) ==
+          crcCalc(&img, 0, SBL_CRC_OSET, SBL_CRC_OSET + 4, SBL_CRC_POLY));
+    break;
+  }
+
+  printf("%s: %s\n", path, ok ? "ok" : "FAILED");
+  free(img.buf);
+  return ok;
+}
+
+/*********************************************************************
+ * Production hex file
+ */
+
+static int readLine(FILE *f, char *line, int size)
+{
+  size_t len;
+
+  if (fgets(line, size, f) == NULL)
+  {
+    return 0;
+  }
+  len = strlen(line);
+  while ((len != 0) && ((line[len - 1] == '\n') || (line[len - 1] == '\r')))
+  {
+    line[--len] = '\0';
+  }
+  return 1;
+}
+
+// The boot loader keeps its first 'rootCnt' lines in front, where it intercepts the IVEC's,
+// and the rest after the application, whose first line and last two are the ones to drop.
+static void prodHex(const char *ublPath, long rootCnt, const char *appPath, const char *outPath)
+{
+  FILE *ubl = fopen(ublPath, "r");
+  FILE *app = fopen(appPath, "r");
+  FILE *out = fopen(outPath, "w");
+  char line[3][600];
+  int idx = 0;
+
+  if ((ubl == NULL) || (app == NULL) || (out == NULL))
+  {
+    fail("cannot open the hex files for ", outPath);
+  }
+
+  for (; (rootCnt != 0) && readLine(ubl, line[0], sizeof(line[0])); rootCnt--)
+  {
+    fprintf(out, "%s\n", line[0]);
+  }
+
+  if (!readLine(app, line[0], sizeof(line[0])) || !readLine(app, line[0], sizeof(line[0])) ||
+      !readLine(app, line[1], sizeof(line[1])))
+  {
+    fail("too short an application hex file: ", appPath);
+  }
+  while (readLine(app, line[(idx + 2) % 3], sizeof(line[0])))
+  {
+    fprintf(out, "%s\n", line[idx]);
+    idx = (idx + 1) % 3;
+  }
+
+  // The header line of the banked area of the boot loader is dropped.
+  if (readLine(ubl, line[0], sizeof(line[0])) && (line[0][1] != '0'))
+  {
+    fprintf(out, "%s\n", line[0]);
+  }
+  while (readLine(ubl, line[0], sizeof(line[0])))
+  {
+    fprintf(out, "%s\n", line[0]);
+  }
+
+  if (ferror(out) || (fclose(out) != 0))
+  {
+    fail("cannot write ", outPath);
+  }
+  fclose(app);
+  fclose(ubl);
+}
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+int main(int argc, char **argv)
+{
+  opts_t opts;
+  int var, arg = 2, checkOnly = 0, failed = 0;
+
+  if ((argc == 6) && (strcmp(argv[1], "hex") == 0))
+  {
+    prodHex(argv[2], strtol(argv[3], NULL, 0), argv[4], argv[5]);
+    return 0;
+  }
+
+  if ((argc > 2) && (strcmp(argv[1], "check") == 0))
+  {
+    checkOnly = 1;
+    arg++;
+  }
+  for (var = 0; var < (int)(sizeof(variants) / sizeof(variants[0])); var++)
+  {
+    if ((argc > arg - 1) && (strcmp(argv[arg - 1], variants[var]) == 0))
+    {
+      break;
+    }
+  }
+  if (var == (int)(sizeof(variants) / sizeof(variants[0])))
+  {
+    fail("usage: cc254x_img_tool oad|boad|ubl|sbl [options] <in.bin> <out.bin> ... | "
+         "check oad|boad|ubl|sbl [options] <img.bin> ... | "
+         "hex <ubl.hex> <root lines> <app.a51> <out.hex>", NULL);
+  }
+
+  memset(&opts, 0, sizeof(opts));
+  for (; (arg < argc) && (argv[arg][0] == '-'); arg++)
+  {
+    char opt = argv[arg][1];
+
+    if (opt == 'e')
+    {
+      opts.ublSecure = 1;
+      continue;
+    }
+    if ((arg + 1 >= argc) || (argv[arg][2] != '\0'))
+    {
+      fail("bad option ", argv[arg]);
+    }
+    arg++;
+
+    switch (opt)
+    {
+    case 'v':
+      opts.ver = (unsigned)strtoul(argv[arg], NULL, 0) & 0xFFFF;
+      opts.hasVer = 1;
+      break;
+    case 'u':
+      hexArg(argv[arg], opts.uid, OAD_IMG_ID_SIZE);
+      opts.hasUid = 1;
+      break;
+    case 'k':
+      hexArg(argv[arg], aesKey, KEY_BLENGTH);
+      break;
+    case 'n':
+      hexArg(argv[arg], opts.nonce, (var == VAR_UBL) ? UBL_NONCE_LEN : BEM_NONCE_LEN);
+      opts.hasNonce = 1;
+      break;
+    default:
+      fail("bad option ", argv[arg - 1]);
+      break;
+    }
+  }
+
+  if ((arg == argc) || (!checkOnly && ((argc - arg) % 2 != 0)))
+  {
+    fail(checkOnly ? "no images to check" : "the images must come in <in.bin> <out.bin> pairs",
+         NULL);
+  }
+
+  aesInit();
+
+  for (; arg < argc; arg += checkOnly ? 1 : 2)
+  {
+    if (checkOnly)
+    {
+      failed |= !check(var, argv[arg], &opts);
+    }
+    else
+    {
+      make(var, argv[arg], argv[arg + 1], &opts);
+    }
+  }
+
+  return failed;
+}
+
+/*********************************************************************
+*********************************************************************/
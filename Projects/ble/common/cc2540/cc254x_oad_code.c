@@ -0,0 +1,474 @@
+/**************************************************************************************************
+  Filename:       cc254x_oad_code.c
+
+  Description:
+
+  Host tool that codes an OAD image for a coded download (OAD_CODED_IMAGES in oad.h):
+
+    cc254x_oad_code lz    <new.bin> <out.bin>
+    cc254x_oad_code delta <new.bin> <running.bin> <out.bin>
+
+  <new.bin> is the image as a plain OAD would send it; <running.bin> is the image installed on
+  the target, whose header version and user id the delta is bound to. The coded stream is
+  written to <out.bin>, padded to whole OAD blocks, and decoded again to check it. The tool
+  prints the Image Identify write that starts the download; its window byte is left at 0 for
+  the OAD client to fill in.
+
+  Build with any C compiler, e.g. "cl cc254x_oad_code.c" or "cc -O2 -o cc254x_oad_code
+  cc254x_oad_code.c".
+
+  "make test" in Projects/ble/host sends its streams of firmware images to the OAD target,
+  which must decode them back; the x column of the results is the ratio the coding achieved.
+**************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// As in oad.h
+#define OAD_BLOCK_SIZE        16
+#define OAD_IMG_ID_SIZE       4
+#define OAD_IMG_HDR_SIZE      (2 + 2 + OAD_IMG_ID_SIZE)
+#define OAD_IMG_HDR_OSET      2
+#define OAD_FLASH_WORD_SIZE   4
+
+#define OAD_CODING_LZ         1
+#define OAD_CODING_DELTA      2
+
+#define OAD_OP_MATCH          0x80
+#define OAD_OP_BASE           0xC0
+#define OAD_OP_LEN_MASK       0x3F
+#define OAD_OP_MATCH_MIN      3
+#define OAD_OP_BASE_MIN       4
+
+#define OP_LIT_MAX            128
+#define OP_MATCH_MAX          (OAD_OP_LEN_MASK + OAD_OP_MATCH_MIN)
+#define OP_BASE_MAX           (OAD_OP_LEN_MASK + OAD_OP_BASE_MIN)
+#define MATCH_DIST_MAX        0xFFFF
+#define BASE_OSET_MIN         4       // past crc0 and crc1 of the running image
+#define BASE_OSET_MAX         0xFFFFFF
+
+#define HASH_BITS             15
+#define HASH_SIZE             (1 << HASH_BITS)
+#define CHAIN_MAX             256     // candidates tried per position
+#define NIL                   (-1L)
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct {
+  unsigned char *buf;
+  long len;
+  unsigned short ver;
+  unsigned char uid[OAD_IMG_ID_SIZE];
+} image_t;
+
+typedef struct {
+  long *head;
+  long *prev;
+} chain_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static unsigned char *out;
+static long outLen;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void fail(const char *msg, const char *arg)
+{
+  fprintf(stderr, "cc254x_oad_code: %s%s\n", msg, arg ? arg : "");
+  exit(1);
+}
+
+static void *alloc(long size)
+{
+  void *p = calloc((size_t)size, 1);
+
+  if (p == NULL)
+  {
+    fail("out of memory", NULL);
+  }
+  return p;
+}
+
+// Read an image and its header; the image is cut or padded to the length the header gives.
+static void readImage(const char *path, image_t *pImg)
+{
+  FILE *f = fopen(path, "rb");
+  unsigned char hdr[OAD_IMG_HDR_SIZE];
+  long size;
+
+  if ((f == NULL) || (fseek(f, OAD_IMG_HDR_OSET + 2, SEEK_SET) != 0) ||
+      (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr)))
+  {
+    fail("cannot read the image header of ", path);
+  }
+
+  pImg->ver = (unsigned short)(hdr[0] | (hdr[1] << 8));
+  pImg->len = (long)(hdr[2] | (hdr[3] << 8)) * OAD_FLASH_WORD_SIZE;
+  memcpy(pImg->uid, hdr + 4, OAD_IMG_ID_SIZE);
+
+  if (pImg->len == 0)
+  {
+    fail("no image length in ", path);
+  }
+
+  pImg->buf = alloc(pImg->len);
+  memset(pImg->buf, 0xFF, (size_t)pImg->len);
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (fread(pImg->buf, 1, (size_t)((size < pImg->len) ? size : pImg->len), f) == 0)
+  {
+    fail("cannot read ", path);
+  }
+  fclose(f);
+}
+
+static unsigned hash4(const unsigned char *p)
+{
+  unsigned long v = p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16) |
+                    ((unsigned long)p[3] << 24);
+
+  return (unsigned)((v * 2654435761UL) >> (32 - HASH_BITS)) & (HASH_SIZE - 1);
+}
+
+static void chainInit(chain_t *pChain, long len)
+{
+  long idx;
+
+  pChain->head = alloc(HASH_SIZE * sizeof(long));
+  pChain->prev = alloc(((len > 0) ? len : 1) * sizeof(long));
+  for (idx = 0; idx < HASH_SIZE; idx++)
+  {
+    pChain->head[idx] = NIL;
+  }
+}
+
+static void chainAdd(chain_t *pChain, const unsigned char *buf, long pos)
+{
+  unsigned h = hash4(buf + pos);
+
+  pChain->prev[pos] = pChain->head[h];
+  pChain->head[h] = pos;
+}
+
+static long matchLen(const unsigned char *a, const unsigned char *b, long max)
+{
+  long len = 0;
+
+  while ((len < max) && (a[len] == b[len]))
+  {
+    len++;
+  }
+  return len;
+}
+
+static void emit(unsigned char b)
+{
+  out[outLen++] = b;
+}
+
+static void flushLiterals(const unsigned char *img, long from, long to)
+{
+  while (from < to)
+  {
+    long cnt = ((to - from) > OP_LIT_MAX) ? OP_LIT_MAX : (to - from);
+
+    emit((unsigned char)(cnt - 1));
+    memcpy(out + outLen, img + from, (size_t)cnt);
+    outLen += cnt;
+    from += cnt;
+  }
+}
+
+// Greedy parse: at every position take the op that saves the most bytes.
+static void encode(const image_t *pImg, const image_t *pBase)
+{
+  const unsigned char *img = pImg->buf;
+  long len = pImg->len;
+  long pos = 0, lit = 0;
+  long shift = 0;         // where the last base copy came from, relative to its output
+  chain_t self, base;
+
+  chainInit(&self, len);
+  if (pBase != NULL)
+  {
+    long idx;
+
+    // The BIM writes the CRC shadow into the running image, so its first word in flash is not
+    // as in <running.bin> and is never a source.
+    chainInit(&base, pBase->len);
+    for (idx = BASE_OSET_MIN; idx + 4 <= pBase->len; idx++)
+    {
+      chainAdd(&base, pBase->buf, idx);
+    }
+  }
+
+  while (pos < len)
+  {
+    long bestGain = 0, bestLen = 0, bestArg = 0;
+    int bestBase = 0;
+
+    if (pos + 4 <= len)
+    {
+      long cand = self.head[hash4(img + pos)];
+      int tries = CHAIN_MAX;
+      long max = ((len - pos) > OP_MATCH_MAX) ? OP_MATCH_MAX : (len - pos);
+
+      while ((cand != NIL) && (pos - cand <= MATCH_DIST_MAX) && tries--)
+      {
+        long l = matchLen(img + cand, img + pos, max);
+
+        if (l - 3 > bestGain)
+        {
+          bestGain = l - 3;
+          bestLen = l;
+          bestArg = pos - cand;
+          bestBase = 0;
+        }
+        cand = self.prev[cand];
+      }
+    }
+
+    if ((pBase != NULL) && (pos + 4 <= len))
+    {
+      long max = ((len - pos) > OP_BASE_MAX) ? OP_BASE_MAX : (len - pos);
+      long cand = pos + shift;
+      int tries = CHAIN_MAX;
+
+      // Unchanged code keeps the offset of the last copy, so that one is tried first.
+      if ((cand >= BASE_OSET_MIN) && (cand < pBase->len))
+      {
+        long l = matchLen(pBase->buf + cand, img + pos,
+                          (max < pBase->len - cand) ? max : (pBase->len - cand));
+
+        if ((l >= OAD_OP_BASE_MIN) && (l - 4 > bestGain))
+        {
+          bestGain = l - 4;
+          bestLen = l;
+          bestArg = cand;
+          bestBase = 1;
+        }
+      }
+
+      for (cand = base.head[hash4(img + pos)]; (cand != NIL) && tries--; cand = base.prev[cand])
+      {
+        long l = matchLen(pBase->buf + cand, img + pos,
+                          (max < pBase->len - cand) ? max : (pBase->len - cand));
+
+        if ((l - 4 > bestGain) && (cand <= BASE_OSET_MAX))
+        {
+          bestGain = l - 4;
+          bestLen = l;
+          bestArg = cand;
+          bestBase = 1;
+        }
+      }
+    }
+
+    if (bestGain <= 0)
+    {
+      if (pos + 4 <= len)
+      {
+        chainAdd(&self, img, pos);
+      }
+      pos++;
+      lit++;
+      continue;
+    }
+
+    flushLiterals(img, pos - lit, pos);
+    lit = 0;
+
+    if (bestBase)
+    {
+      emit((unsigned char)(OAD_OP_BASE | (bestLen - OAD_OP_BASE_MIN)));
+      emit((unsigned char)bestArg);
+      emit((unsigned char)(bestArg >> 8));
+      emit((unsigned char)(bestArg >> 16));
+      shift = bestArg - pos;
+    }
+    else
+    {
+      emit((unsigned char)(OAD_OP_MATCH | (bestLen - OAD_OP_MATCH_MIN)));
+      emit((unsigned char)bestArg);
+      emit((unsigned char)(bestArg >> 8));
+    }
+
+    for (; bestLen != 0; bestLen--, pos++)
+    {
+      if (pos + 4 <= len)
+      {
+        chainAdd(&self, img, pos);
+      }
+    }
+  }
+
+  flushLiterals(img, pos - lit, pos);
+
+  while (outLen % OAD_BLOCK_SIZE)
+  {
+    emit(0xFF);
+  }
+}
+
+// The target's decoder, on the whole stream at once.
+static int decode(const image_t *pImg, const image_t *pBase, unsigned char *dec)
+{
+  long in = 0, pos = 0;
+
+  while (pos < pImg->len)
+  {
+    unsigned char op;
+    long cnt, arg;
+
+    if (in >= outLen)
+    {
+      return 0;
+    }
+    op = out[in++];
+
+    if (op < OAD_OP_MATCH)
+    {
+      cnt = op + 1;
+      if ((in + cnt > outLen) || (pos + cnt > pImg->len))
+      {
+        return 0;
+      }
+      memcpy(dec + pos, out + in, (size_t)cnt);
+      in += cnt;
+      pos += cnt;
+    }
+    else if (op < OAD_OP_BASE)
+    {
+      cnt = (op & OAD_OP_LEN_MASK) + OAD_OP_MATCH_MIN;
+      arg = out[in] | ((long)out[in + 1] << 8);
+      in += 2;
+      if ((arg == 0) || (arg > pos) || (pos + cnt > pImg->len))
+      {
+        return 0;
+      }
+      for (; cnt != 0; cnt--, pos++)
+      {
+        dec[pos] = dec[pos - arg];
+      }
+    }
+    else
+    {
+      cnt = (op & OAD_OP_LEN_MASK) + OAD_OP_BASE_MIN;
+      arg = out[in] | ((long)out[in + 1] << 8) | ((long)out[in + 2] << 16);
+      in += 3;
+      if ((pBase == NULL) || (arg + cnt > pBase->len) || (pos + cnt > pImg->len))
+      {
+        return 0;
+      }
+      memcpy(dec + pos, pBase->buf + arg, (size_t)cnt);
+      pos += cnt;
+    }
+  }
+
+  return (memcmp(dec, pImg->buf, (size_t)pImg->len) == 0);
+}
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+int main(int argc, char **argv)
+{
+  image_t img, base;
+  image_t *pBase = NULL;
+  const char *outPath;
+  unsigned char req[OAD_IMG_HDR_SIZE + 4 + 2 + OAD_IMG_ID_SIZE];
+  unsigned reqLen, idx;
+  long blocks;
+  FILE *f;
+
+  if ((argc == 4) && (strcmp(argv[1], "lz") == 0))
+  {
+    outPath = argv[3];
+  }
+  else if ((argc == 5) && (strcmp(argv[1], "delta") == 0))
+  {
+    readImage(argv[3], &base);
+    pBase = &base;
+    outPath = argv[4];
+  }
+  else
+  {
+    fail("usage: cc254x_oad_code lz <new.bin> <out.bin> | "
+         "delta <new.bin> <running.bin> <out.bin>", NULL);
+    return 1;
+  }
+
+  readImage(argv[2], &img);
+
+  // The target decodes whole blocks only.
+  img.len -= img.len % OAD_BLOCK_SIZE;
+
+  // Every op costs at least one byte per OP_LIT_MAX of output, plus the padding.
+  out = alloc(img.len + img.len / OP_LIT_MAX + 2 * OAD_BLOCK_SIZE);
+  outLen = 0;
+  encode(&img, pBase);
+
+  if (!decode(&img, pBase, alloc(img.len)))
+  {
+    fail("the coded image does not decode back to ", argv[2]);
+  }
+
+  blocks = outLen / OAD_BLOCK_SIZE;
+  if (blocks > 0xFFFF)
+  {
+    fail("the coded image is too long", NULL);
+  }
+
+  f = fopen(outPath, "wb");
+  if ((f == NULL) || (fwrite(out, 1, (size_t)outLen, f) != (size_t)outLen))
+  {
+    fail("cannot write ", outPath);
+  }
+  fclose(f);
+
+  req[0] = (unsigned char)img.ver;
+  req[1] = (unsigned char)(img.ver >> 8);
+  req[2] = (unsigned char)(img.len / OAD_FLASH_WORD_SIZE);
+  req[3] = (unsigned char)((img.len / OAD_FLASH_WORD_SIZE) >> 8);
+  memcpy(req + 4, img.uid, OAD_IMG_ID_SIZE);
+  req[OAD_IMG_HDR_SIZE] = 0;  // Window, set by the OAD client.
+  req[OAD_IMG_HDR_SIZE + 1] = (pBase != NULL) ? OAD_CODING_DELTA : OAD_CODING_LZ;
+  req[OAD_IMG_HDR_SIZE + 2] = (unsigned char)blocks;
+  req[OAD_IMG_HDR_SIZE + 3] = (unsigned char)(blocks >> 8);
+  reqLen = OAD_IMG_HDR_SIZE + 4;
+  if (pBase != NULL)
+  {
+    req[reqLen++] = (unsigned char)base.ver;
+    req[reqLen++] = (unsigned char)(base.ver >> 8);
+    memcpy(req + reqLen, base.uid, OAD_IMG_ID_SIZE);
+    reqLen += OAD_IMG_ID_SIZE;
+  }
+
+  printf("%s: %ld blocks coded to %ld (%.1fx)\nImage Identify:",
+         outPath, img.len / OAD_BLOCK_SIZE, blocks,
+         (double)img.len / (double)outLen);
+  for (idx = 0; idx < reqLen; idx++)
+  {
+    printf(" %02X", req[idx]);
+  }
+  printf("\n");
+
+  return 0;
+}
+
+/*********************************************************************
+*********************************************************************/
@@ -47,6 +47,10 @@
 #include "hal_types.h"
 #include "hal_board.h"
 #include "npi.h"
+#if NPI_BATCH
+#include "OSAL.h"
+#include "osal_cbtimer.h"
+#endif
 
 /*******************************************************************************
  * MACROS
@@ -64,6 +68,14 @@
  * LOCAL VARIABLES
  */
 
+#if NPI_BATCH
+static npiCBack_t npiAppCBack;
+static uint8  npiBatchBuf[NPI_BATCH_BUF_SIZE];
+static uint16 npiBatchLen;     // Bytes of events queued after the header.
+static uint8  npiBatchCnt;     // Number of events queued.
+static uint8  npiBatchTimerId = INVALID_TIMER_ID;
+#endif
+
 /*******************************************************************************
  * GLOBAL VARIABLES
  */
@@ -72,6 +84,12 @@
  * PROTOTYPES
  */
 
+#if NPI_BATCH
+static void  npiBatchCBack( uint8 port, uint8 event );
+static void  npiBatchTimeout( uint8 *pData );
+static uint8 npiBatchFlush( void );
+#endif
+
 /*******************************************************************************
  * FUNCTIONS
  */
@@ -107,7 +125,12 @@ void NPI_InitTransport( npiCBack_t npiCBack )
   uartConfig.tx.maxBufSize        = NPI_UART_TX_BUF_SIZE;
   uartConfig.idleTimeout          = NPI_UART_IDLE_TIMEOUT;
   uartConfig.intEnable            = NPI_UART_INT_ENABLE;
+#if NPI_BATCH
+  npiAppCBack = npiCBack;
+  uartConfig.callBackFunc         = (halUARTCBack_t)npiBatchCBack;
+#else
   uartConfig.callBackFunc         = (halUARTCBack_t)npiCBack;
+#endif
   
   // start UART
   // Note: Assumes no issue opening UART port.
@@ -158,8 +181,176 @@ uint16 NPI_ReadTransport( uint8 *buf, uint16 len )
  */
 uint16 NPI_WriteTransport( uint8 *buf, uint16 len )
 {
+#if NPI_BATCH
+  // an event that does not fit in a batch by itself goes out as is, behind the pending ones
+  if ( len > NPI_BATCH_MAX_DATA )
+  {
+    return( npiBatchFlush() ? HalUARTWrite( NPI_UART_PORT, buf, len ) : 0 );
+  }
+
+  // flush on size
+  if ( ((npiBatchLen + len) > NPI_BATCH_MAX_DATA) && !npiBatchFlush() )
+  {
+    return( 0 );
+  }
+
+  osal_memcpy( &npiBatchBuf[NPI_BATCH_HDR_LEN + npiBatchLen], buf, len );
+  npiBatchLen += len;
+  npiBatchCnt++;
+
+  // flush on deadline, counted from the oldest event of the batch
+  if ( npiBatchTimerId == INVALID_TIMER_ID )
+  {
+    if ( osal_CbTimerStart( npiBatchTimeout, NULL, NPI_BATCH_TIMEOUT,
+                            &npiBatchTimerId ) != SUCCESS )
+    {
+      npiBatchTimerId = INVALID_TIMER_ID;
+      (void)npiBatchFlush();
+    }
+  }
+
+  return( len );
+#else
   return( HalUARTWrite( NPI_UART_PORT, buf, len ) );
+#endif
+}
+
+#if NPI_BATCH
+/*******************************************************************************
+ * @fn          NPI_FlushTransport
+ *
+ * @brief       This routine sends any batched events to the transport layer
+ *              without waiting for the batch deadline.
+ *
+ * input parameters
+ *
+ * @param       None.
+ *
+ * output parameters
+ *
+ * @param       None.
+ *
+ * @return      None.
+ */
+void NPI_FlushTransport( void )
+{
+  (void)npiBatchFlush();
+}
+
+/*******************************************************************************
+ * @fn          npiBatchFlush
+ *
+ * @brief       This routine writes the pending batch to the transport layer.
+ *              A single event is written without the batch header.
+ *
+ * input parameters
+ *
+ * @param       None.
+ *
+ * output parameters
+ *
+ * @param       None.
+ *
+ * @return      TRUE if the batch is empty on return, FALSE if the transport
+ *              refused it and it is still pending.
+ */
+static uint8 npiBatchFlush( void )
+{
+  uint16 written;
+
+  if ( npiBatchCnt == 0 )
+  {
+    return( TRUE );
+  }
+
+  if ( npiBatchCnt == 1 )
+  {
+    written = HalUARTWrite( NPI_UART_PORT, &npiBatchBuf[NPI_BATCH_HDR_LEN], npiBatchLen );
+  }
+  else
+  {
+    npiBatchBuf[0] = NPI_BATCH_PKT_TYPE;
+    npiBatchBuf[1] = npiBatchCnt;
+    npiBatchBuf[2] = LO_UINT16( npiBatchLen );
+    npiBatchBuf[3] = HI_UINT16( npiBatchLen );
+
+    written = HalUARTWrite( NPI_UART_PORT, npiBatchBuf, NPI_BATCH_HDR_LEN + npiBatchLen );
+  }
+
+  // the transport is all or none, so a refused batch is retried as a whole
+  if ( written == 0 )
+  {
+    return( FALSE );
+  }
+
+  npiBatchLen = 0;
+  npiBatchCnt = 0;
+
+  if ( npiBatchTimerId != INVALID_TIMER_ID )
+  {
+    (void)osal_CbTimerStop( npiBatchTimerId );
+    npiBatchTimerId = INVALID_TIMER_ID;
+  }
+
+  return( TRUE );
+}
+
+/*******************************************************************************
+ * @fn          npiBatchTimeout
+ *
+ * @brief       Callback timer for the batch deadline. A batch that the
+ *              transport refuses here is flushed on the next Tx empty event
+ *              or the next write.
+ *
+ * input parameters
+ *
+ * @param       pData - Not used.
+ *
+ * output parameters
+ *
+ * @param       None.
+ *
+ * @return      None.
+ */
+static void npiBatchTimeout( uint8 *pData )
+{
+  (void)pData;
+
+  // the callback timer frees itself on return, so it must not be stopped here
+  npiBatchTimerId = INVALID_TIMER_ID;
+  (void)npiBatchFlush();
+}
+
+/*******************************************************************************
+ * @fn          npiBatchCBack
+ *
+ * @brief       Transport callback that flushes a pending batch as soon as the
+ *              transport drains, then passes the event on to the user.
+ *
+ * input parameters
+ *
+ * @param       port - UART port.
+ * @param       event - UART event.
+ *
+ * output parameters
+ *
+ * @param       None.
+ *
+ * @return      None.
+ */
+static void npiBatchCBack( uint8 port, uint8 event )
+{
+  if ( event & HAL_UART_TX_EMPTY )
+  {
+    (void)npiBatchFlush();
+  }
+
+  if ( npiAppCBack != NULL )
+  {
+    npiAppCBack( port, event );
+  }
 }
+#endif
 
 
 /*******************************************************************************
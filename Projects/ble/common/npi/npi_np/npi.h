@@ -102,6 +102,32 @@ extern "C"
 #define NPI_UART_BR                    HAL_UART_BR_9600
 #endif // !NPI_UART_BR
   
+
+/* Pack several HCI events into one transport frame, flushed when full or when the oldest event
+ * has waited NPI_BATCH_TIMEOUT msecs (requires an OSAL callback timer task).
+ */
+#if !defined( NPI_BATCH )
+#define NPI_BATCH                      FALSE
+#endif
+
+// HalUARTWrite() is all or none and its Tx queue holds one byte less than its size.
+#if !defined( NPI_BATCH_BUF_SIZE )
+#define NPI_BATCH_BUF_SIZE             (NPI_UART_TX_BUF_SIZE - 1)
+#endif
+
+#if ( NPI_BATCH_BUF_SIZE > (NPI_UART_TX_BUF_SIZE - 1) )
+#error "NPI_BATCH_BUF_SIZE must be less than NPI_UART_TX_BUF_SIZE"
+#endif
+
+#if !defined( NPI_BATCH_TIMEOUT )
+#define NPI_BATCH_TIMEOUT              2
+#endif
+
+// Batch frame header: type, event count, payload length (LSB, MSB); followed by the events as is.
+#define NPI_BATCH_PKT_TYPE             0x0B
+#define NPI_BATCH_HDR_LEN              4
+#define NPI_BATCH_MAX_DATA             (NPI_BATCH_BUF_SIZE - NPI_BATCH_HDR_LEN)
+
   /*
 #define HAL_UART_BR_9600   0x00
 #define HAL_UART_BR_19200  0x01
@@ -138,6 +164,9 @@ extern uint16 NPI_WriteTransport( uint8 *, uint16 );
 extern uint16 NPI_RxBufLen( void );
 extern uint16 NPI_GetMaxRxBufSize( void );
 extern uint16 NPI_GetMaxTxBufSize( void );
+#if NPI_BATCH
+extern void   NPI_FlushTransport( void );
+#endif
 
 /*******************************************************************************
 */
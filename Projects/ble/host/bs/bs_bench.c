@@ -0,0 +1,505 @@
+/**************************************************************************************************
+  Filename:       bs_bench.c
+
+  Description:
+
+  BSBLEPeripheral on a Linux host: BSBLEPeripheral.c, parsingData.c, BSGATTprofile.c and the
+  modules under them run on OSAL with the task table of OSAL_BSBLEPeripheral.c, on the stack
+  stand-ins of bs_stack.c and the register model of hal_sim.c. A scripted central connects,
+  enables the notifications of characteristic 1 and writes commands to it, one Write Request
+  at a time:
+
+    bs_bench          Command to notification latency, events and heap per command, by
+                      connection interval, as the central sees them and as TYPE_STATS reports
+                      them (BS_LATENCY_STATS).
+    bs_bench -t       Test: fails unless every check below holds.
+
+  Latency is from the connection event that carries the write to the one that carries its
+  notification. Events are OSAL task events processed meanwhile, of all tasks and of the two
+  app tasks (parsingData and BSBLEPeripheral). Heap is the most OSAL heap in use when a
+  notification is queued, over what is in use before the first command. TYPE_STATS stops its
+  clock when the app task runs after the event, so a command that has lightJournal.c erase a
+  page (20 ms in HalFlashErase() of bs_stack.c) shows in its maximum.
+
+  Checks of the test, at connection intervals of 7.5, 30 and 100 ms:
+    - Every TYPE_SWITCH write is answered with the state packet of its lights in the next
+      connection event, and a packet with a bad ETX is answered with nothing.
+    - TYPE_STATS counts exactly the answered commands, its mean latency is that of the central
+      within BENCH_STATS_SLACK_US plus the length of the event, and its app events per command
+      and its heap are those the bench counts.
+    - Writes over the command budget of BSGATTprofile.c are refused and not counted.
+    - The heap is back where it was once the notifications are sent.
+**************************************************************************************************/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "hal_types.h"
+#include "hal_mcu.h"
+#include "hal_sim.h"
+#include "OSAL.h"
+#include "OSAL_Tasks.h"
+#include "att.h"
+#include "gatt.h"
+#include "gattservapp.h"
+
+#include "BSGATTprofile.h"
+#include "parsingData.h"
+#include "lightStats.h"
+
+#include "bs_stack.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define BENCH_OPS_MAX             128
+#define BENCH_IDLE_STEP_US        50      // clock step while no task has an event
+#define BENCH_SETUP_MS            200
+#define BENCH_TAIL_MS             2000    // refills the command budget before the stats read
+#define BENCH_STATS_SLACK_US      500
+#define BENCH_ST_HZ               32768
+
+enum { OP_CCCD, OP_STATS_RESET, OP_SWITCH, OP_BAD, OP_STATS_READ };
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  const char *name;
+  uint16 interval;                // 1.25 ms
+  uint16 gapMs;                   // from one command to the next, 0 back to back
+  uint8 cmds;
+  uint8 badEvery;                 // every n-th command has a bad ETX, 0 none
+} benchScenario_t;
+
+typedef struct
+{
+  uint8 type;
+  uint8 lights;
+  uint64_t due;
+  uint64_t sentAt;                // connection event of the write, 0 if not yet
+  uint64_t answeredAt;            // connection event of the notification, 0 if none
+  uint8 status;                   // of the Write Response
+  bool rsp;
+} benchOp_t;
+
+typedef struct
+{
+  uint16 cmds, latMin, latAvg, latMax, eventsX16, heapMax;
+} benchStats_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static const benchScenario_t testScenarios[] =
+{
+  { "7.5 ms",     6, 300, 20, 5 },
+  { "30 ms",     24, 300, 20, 5 },
+  { "100 ms",    80, 400, 20, 5 },
+  { "30 burst",  24,   0, 12, 0 },
+};
+
+static const benchScenario_t benchScenarios[] =
+{
+  { "7.5 ms",     6, 300, 60, 0 },
+  { "30 ms",     24, 300, 60, 0 },
+  { "50 ms",     40, 300, 60, 0 },
+  { "100 ms",    80, 400, 60, 0 },
+  { "30 burst",  24,   0, 30, 0 },
+};
+
+static const benchScenario_t *sc;
+static uint8 isTest;
+static uint8 fails;
+
+static benchOp_t ops[BENCH_OPS_MAX];
+static uint8 opCnt;
+static uint8 opNext;              // the next to write
+static int16 opAwait = -1;        // written and waiting for its notification
+
+static uint16 char1Handle;
+static benchStats_t stats;
+static bool statsRead;
+static uint16 heapBase;
+
+// OSAL task events while a command is on the way
+static uint32 cmdEventsAll;
+static uint32 cmdEventsApp;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void centralConnEvent(uint32 eventCnt);
+static void centralWriteRsp(uint8 status);
+static void centralNotify(uint16 handle, uint8 *pValue, uint8 len);
+static void addOp(uint8 type, uint8 lights, uint64_t due);
+static void runFor(uint64_t ps);
+static void runScenario(void);
+static void fail(const char *fmt, ...);
+
+static const bsStackCentral_t central =
+{
+  centralWriteRsp,
+  centralNotify,
+  centralConnEvent
+};
+
+/*********************************************************************
+ * The central
+ */
+
+static void centralConnEvent(uint32 eventCnt)
+{
+  benchOp_t *pOp = &ops[opNext];
+  uint8 pkt[PACKET_LENGTH_NORMAL] = { STX, 2, 0, 0, 0, ETX };
+  uint8 cccd[2] = { LO_UINT16(GATT_CLIENT_CFG_NOTIFY), HI_UINT16(GATT_CLIENT_CFG_NOTIFY) };
+  bool ok;
+
+  (void)eventCnt;
+
+  if (opNext == opCnt || opAwait >= 0 || pOp->due > halSimTime())
+  {
+    return;
+  }
+
+  switch (pOp->type)
+  {
+    case OP_CCCD:
+      ok = bsStackWrite(char1Handle + 1, cccd, sizeof(cccd));
+      break;
+
+    case OP_STATS_RESET:
+    case OP_STATS_READ:
+      pkt[2] = TYPE_STATS;
+      pkt[3] = (pOp->type == OP_STATS_RESET) ? STATS_OP_RESET : STATS_OP_READ;
+      ok = bsStackWrite(char1Handle, pkt, sizeof(pkt));
+      break;
+
+    default:
+      pkt[2] = TYPE_SWITCH;
+      pkt[3] = BV(7) | pOp->lights;
+      if (pOp->type == OP_BAD)
+      {
+        pkt[PACKET_LENGTH_NORMAL - 1] = 0;
+      }
+      ok = bsStackWrite(char1Handle, pkt, sizeof(pkt));
+      break;
+  }
+
+  if (ok)
+  {
+    pOp->sentAt = halSimTime();
+    opAwait = opNext++;
+  }
+}
+
+static void centralWriteRsp(uint8 status)
+{
+  benchOp_t *pOp = &ops[opAwait];
+
+  pOp->rsp = TRUE;
+  pOp->status = status;
+
+  // Only a command that was taken and parsed has a notification coming.
+  if (status != SUCCESS || pOp->type == OP_CCCD || pOp->type == OP_BAD)
+  {
+    opAwait = -1;
+  }
+}
+
+static void centralNotify(uint16 handle, uint8 *pValue, uint8 len)
+{
+  benchOp_t *pOp;
+
+  if (handle != char1Handle)
+  {
+    return;
+  }
+  if (opAwait < 0)
+  {
+    fail("notification of %u bytes that no write asked for", len);
+    return;
+  }
+
+  pOp = &ops[opAwait];
+  pOp->answeredAt = halSimTime();
+  opAwait = -1;
+
+  if (pOp->type == OP_STATS_READ)
+  {
+    if (len != STATS_REPLY_DATA_LEN + HEADER_LENGTH || pValue[2] != TYPE_STATS)
+    {
+      fail("stats reply of %u bytes, type 0x%02x", len, pValue[2]);
+      return;
+    }
+    stats.cmds = BUILD_UINT16(pValue[4], pValue[3]);
+    stats.latMin = BUILD_UINT16(pValue[6], pValue[5]);
+    stats.latAvg = BUILD_UINT16(pValue[8], pValue[7]);
+    stats.latMax = BUILD_UINT16(pValue[10], pValue[9]);
+    stats.eventsX16 = BUILD_UINT16(pValue[12], pValue[11]);
+    stats.heapMax = BUILD_UINT16(pValue[14], pValue[13]);
+    statsRead = TRUE;
+  }
+  else if (pOp->type == OP_SWITCH)
+  {
+    if (len != PACKET_LENGTH_RESPONSE || pValue[0] != STX || pValue[len - 1] != ETX ||
+        pValue[1] != (0x90 | pOp->lights))
+    {
+      fail("command for lights 0x%02x answered with 0x%02x", pOp->lights, pValue[1]);
+    }
+  }
+}
+
+static void addOp(uint8 type, uint8 lights, uint64_t due)
+{
+  ops[opCnt].type = type;
+  ops[opCnt].lights = lights;
+  ops[opCnt].due = due;
+  opCnt++;
+}
+
+/*********************************************************************
+ * OSAL on the clock
+ */
+
+static void runFor(uint64_t ps)
+{
+  uint64_t end = halSimTime() + ps;
+  uint8 appFirst = getParsingDataTaskId();
+
+  while (halSimTime() < end)
+  {
+    uint8 idx;
+
+    for (idx = 0; idx < tasksCnt && tasksEvents[idx] == 0; idx++);
+
+    if (idx == tasksCnt)
+    {
+      osal_run_system();
+      halSimRun(HAL_SIM_US(BENCH_IDLE_STEP_US));
+      continue;
+    }
+
+    // The notice of the connection event belongs to the statistics, not to the command.
+    if (opAwait >= 0 && ops[opAwait].type == OP_SWITCH &&
+        !(idx == appFirst && (tasksEvents[idx] & EVT_STATS_CONN_EVENT)))
+    {
+      cmdEventsAll++;
+      if (idx >= appFirst)
+      {
+        cmdEventsApp++;
+      }
+    }
+
+    osal_run_system();
+  }
+}
+
+/*********************************************************************
+ * Scenarios
+ */
+
+static void fail(const char *fmt, ...)
+{
+  va_list ap;
+
+  va_start(ap, fmt);
+  printf("FAIL %s: ", sc->name);
+  vprintf(fmt, ap);
+  printf("\n");
+  va_end(ap);
+  fails++;
+}
+
+static void runScenario(void)
+{
+  uint64_t t;
+  uint16 answered = 0, refused = 0, dropped = 0, cmds = 0;
+  uint64_t latSum = 0, latMin = UINT64_MAX, latMax = 0;
+  uint64_t interval = HAL_SIM_US(1250) * sc->interval;
+  uint64_t statsAvg;
+  uint32 appX16;
+  uint16 heapMax;
+
+  halSimInit();
+  bsStackInit(&central);
+  osal_init_system();
+
+  runFor(HAL_SIM_MS(BENCH_SETUP_MS));
+  if (!bsStackConnect(sc->interval))
+  {
+    fail("the peripheral does not advertise");
+    return;
+  }
+  char1Handle = bsStackFindHandle(BSPROFILE_CHAR1_UUID);
+
+  t = halSimTime();
+  addOp(OP_CCCD, 0, t);
+  addOp(OP_STATS_RESET, 0, t);
+  t += HAL_SIM_MS(BENCH_SETUP_MS);
+  for (uint8 i = 0; i < sc->cmds; i++)
+  {
+    bool bad = sc->badEvery != 0 && (i % sc->badEvery) == sc->badEvery - 1;
+
+    addOp(bad ? OP_BAD : OP_SWITCH, (i * 5 + 1) & LIGHT_ALL, t);
+    t += HAL_SIM_MS(sc->gapMs);
+  }
+
+  // The heap in use before the first command, the link and its services set up.
+  while (opNext < 2 || opAwait >= 0)
+  {
+    runFor(interval);
+  }
+  heapBase = osal_heap_mem_used();
+  bsStackHeapMax = heapBase;
+
+  while (opNext < opCnt || opAwait >= 0)
+  {
+    runFor(interval);
+  }
+  runFor(HAL_SIM_MS(BENCH_TAIL_MS));
+
+  if (bsStackTxPending() != 0 || osal_heap_mem_used() != heapBase)
+  {
+    fail("heap at %u bytes after the commands, %u before", osal_heap_mem_used(), heapBase);
+  }
+
+  // before the reply of the stats read, which is larger than the state packets
+  heapMax = bsStackHeapMax;
+  addOp(OP_STATS_READ, 0, halSimTime());
+  while (opNext < opCnt || opAwait >= 0)
+  {
+    runFor(interval);
+  }
+
+  for (uint8 i = 2; i < opCnt - 1; i++)
+  {
+    benchOp_t *pOp = &ops[i];
+
+    cmds++;
+    if (pOp->status != SUCCESS)
+    {
+      refused++;
+    }
+    else if (pOp->type == OP_BAD)
+    {
+      dropped += (pOp->answeredAt == 0);
+      if (pOp->answeredAt != 0)
+      {
+        fail("command %u with a bad ETX answered", i);
+      }
+    }
+    else if (pOp->answeredAt == 0)
+    {
+      fail("command %u not answered", i);
+    }
+    else
+    {
+      uint64_t lat = pOp->answeredAt - pOp->sentAt;
+
+      answered++;
+      latSum += lat;
+      if (lat < latMin) latMin = lat;
+      if (lat > latMax) latMax = lat;
+      if (lat != interval)
+      {
+        fail("command %u answered after %u us", i, (uint32)(lat / HAL_SIM_US(1)));
+      }
+    }
+  }
+
+  if (!statsRead || answered == 0)
+  {
+    fail("no stats read or no command answered");
+    return;
+  }
+
+  statsAvg = (uint64_t)stats.latAvg * HAL_SIM_MS(1000) / BENCH_ST_HZ;
+  appX16 = (cmdEventsApp << 4) / answered;
+
+  printf("%-9s %5u %5u %5u %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f %6.2f %6.2f %6.2f %6u %6u\n",
+         sc->name, answered, refused, dropped,
+         latMin / 1e9, latSum / answered / 1e9, latMax / 1e9,
+         stats.latMin * 1000.0 / BENCH_ST_HZ, statsAvg / 1e9, stats.latMax * 1000.0 / BENCH_ST_HZ,
+         (double)cmdEventsAll / answered, appX16 / 16.0, stats.eventsX16 / 16.0,
+         heapMax - heapBase, stats.heapMax - heapBase);
+
+  if (stats.cmds != answered)
+  {
+    fail("stats count %u commands, the central %u", stats.cmds, answered);
+  }
+  if (statsAvg + HAL_SIM_US(BENCH_STATS_SLACK_US) < latSum / answered ||
+      statsAvg > latSum / answered + HAL_SIM_US(BENCH_STATS_SLACK_US + 2 * BS_STACK_PDU_PAIR_US))
+  {
+    fail("stats mean latency %u us, the central %u us", (uint32)(statsAvg / HAL_SIM_US(1)),
+         (uint32)(latSum / answered / HAL_SIM_US(1)));
+  }
+  if (stats.eventsX16 != appX16)
+  {
+    fail("stats count %u/16 app events per command, the bench %u/16", stats.eventsX16,
+         appX16);
+  }
+  if (stats.heapMax != heapMax)
+  {
+    fail("stats heap %u bytes, the bench %u", stats.heapMax, heapMax);
+  }
+  if (sc->gapMs == 0 && refused == 0)
+  {
+    fail("%u writes back to back and none refused", sc->cmds);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  const benchScenario_t *list;
+  uint8 cnt;
+
+  isTest = (argc > 1) && (strcmp(argv[1], "-t") == 0);
+  list = isTest ? testScenarios : benchScenarios;
+  cnt = isTest ? sizeof(testScenarios) / sizeof(testScenarios[0])
+               : sizeof(benchScenarios) / sizeof(benchScenarios[0]);
+
+  printf("BSBLEPeripheral budget=%u per %u ms, tx=%u per event; latency ms, events and heap "
+         "bytes per command, central | stats\n", BSPROFILE_CMD_BURST, BSPROFILE_CMD_INTERVAL,
+         BS_STACK_TX_PER_EVENT);
+  printf("%-9s %5s %5s %5s %7s %7s %7s %7s %7s %7s %6s %6s %6s %6s %6s\n", "interval", "cmds",
+         "refus", "drop", "min", "avg", "max", "st min", "st avg", "st max", "ev all", "ev app",
+         "st ev", "heap", "st hp");
+
+  // Each scenario in its own process: OSAL and the modules start from their initial data.
+  for (uint8 i = 0; i < cnt; i++)
+  {
+    pid_t pid;
+    int status;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0)
+    {
+      sc = &list[i];
+      runScenario();
+      fflush(stdout);
+      _exit(fails ? 1 : 0);
+    }
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+      fails++;
+    }
+  }
+
+  if (isTest)
+  {
+    printf("%s\n", fails ? "FAIL" : "PASS");
+  }
+  return fails ? 1 : 0;
+}
@@ -0,0 +1,876 @@
+/**************************************************************************************************
+  Filename:       bs_stack.c
+
+  Description:
+
+  Stand-ins for what BSBLEPeripheral calls below its own sources, on a Linux host: the stack
+  tasks of OSAL_BSBLEPeripheral.c, GAP, the peripheral role, the bond manager, the link
+  database, the GATT server with the client characteristic configurations, GATT notifications,
+  the connection event notice of HCI, the HAL task, keys, flash, SNV and the NPI transport.
+
+  The link to the central runs on the clock of hal_sim.c:
+    - A connection event every connection interval. The central sends first: a Write Request
+      it has queued goes in the event, and the GATTServApp task hands it to the attribute's
+      write callback once the event has ended, as the stack does with a received PDU.
+    - The peripheral answers in the same event with the Write Response of the last request,
+      then with the notifications in the order they were queued, BS_STACK_TX_PER_EVENT PDUs
+      at most. The others wait for the next event.
+    - A notification is held in the OSAL heap from GATT_Notification() until it is sent, as
+      the stack holds its L2CAP packet.
+    - The event lasts BS_STACK_PDU_PAIR_US per PDU pair; the notice of
+      HCI_EXT_ConnEventNoticeCmd() comes at its end.
+**************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal_types.h"
+#include "hal_mcu.h"
+#include "hal_sim.h"
+#include "OSAL.h"
+#include "OSAL_PwrMgr.h"
+#include "osal_snv.h"
+#include "OnBoard.h"
+#include "hal_drivers.h"
+#include "hal_flash.h"
+#include "hal_bs_key.h"
+
+#include "ll.h"
+#include "hci_tl.h"
+#include "l2cap.h"
+#include "gap.h"
+#include "gatt.h"
+#include "att.h"
+#include "linkdb.h"
+#include "gattservapp.h"
+#include "gapgattserver.h"
+#include "gapbondmgr.h"
+#include "peripheral.h"
+#include "devinfoservice.h"
+#include "npi.h"
+
+#include "bs_stack.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define STACK_RX_EVT              0x0001  // GATTServApp: a Write Request came in
+#define STACK_ROLE_EVT            0x0001  // GAPRole: a state change to report
+
+#define STACK_SERVICES_MAX        4
+#define STACK_LINKDB_CBS_MAX      4
+#define STACK_ROLE_STATES_MAX     4
+#define STACK_SNV_ITEMS_MAX       32
+#define STACK_SNV_ITEM_MAX        32
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  gattAttribute_t *pAttrs;
+  uint16 numAttrs;
+  CONST gattServiceCBs_t *pCBs;
+} stackService_t;
+
+typedef struct
+{
+  uint16 handle;
+  uint8 len;
+  uint8 value[];
+} stackNoti_t;
+
+typedef struct
+{
+  bool up;
+  bool terminate;
+  uint32 gen;                     // connection events of an older link are dropped
+  uint64_t interval;              // ps
+  uint64_t anchor;
+  uint32 eventCnt;
+
+  bool reqQueued;                 // for the next event
+  bool reqOutstanding;            // until its response is sent
+  uint16 reqHandle;
+  uint8 reqLen;
+  uint8 reqValue[ATT_MTU_SIZE - 3];
+
+  bool rspPending;
+  uint8 rspStatus;
+
+  stackNoti_t *tx[BS_STACK_TX_BUFS];
+  uint8 txHead, txCnt;
+} stackLink_t;
+
+typedef struct
+{
+  uint16 id;
+  uint8 len;
+  uint8 data[STACK_SNV_ITEM_MAX];
+} stackSnv_t;
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+uint16 bsStackHeapMax;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static const bsStackCentral_t *stackCentral;
+
+static uint8 gattServAppTaskId;
+static uint8 gapRoleTaskId;
+
+static stackService_t stackServices[STACK_SERVICES_MAX];
+static uint8 stackServiceCnt;
+static uint16 stackNextHandle;
+
+static linkDBItem_t stackLinkItem;
+static pfnLinkDBCB_t stackLinkDBCBs[STACK_LINKDB_CBS_MAX];
+
+static stackLink_t link;
+
+static gapRolesCBs_t *pRoleCBs;
+static gaprole_States_t roleStates[STACK_ROLE_STATES_MAX];
+static uint8 roleStateCnt;
+static uint8 roleAdvEnabled;
+
+static uint8 noticeTaskId;
+static uint16 noticeEvent;
+
+static stackSnv_t stackSnv[STACK_SNV_ITEMS_MAX];
+static uint8 stackSnvCnt;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void roleReport(gaprole_States_t state);
+static void linkDBNotify(uint16 connHandle, uint8 changeType);
+static gattAttribute_t *findAttr(uint16 handle, CONST gattServiceCBs_t **ppCBs);
+static gattCharCfg_t *findCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl);
+static void connEvent(void *arg);
+static void connEventEnd(void *arg);
+static void linkDown(void);
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ */
+
+void bsStackInit(const bsStackCentral_t *pCentral)
+{
+  stackCentral = pCentral;
+  stackNextHandle = 1;
+}
+
+bool bsStackConnect(uint16 interval)
+{
+  uint32 gen;
+
+  if (link.up || !roleAdvEnabled)
+  {
+    return FALSE;
+  }
+
+  gen = link.gen;
+  memset(&link, 0, sizeof(link));
+  link.up = TRUE;
+  link.gen = gen + 1;
+  link.interval = HAL_SIM_US(1250) * interval;
+  link.anchor = halSimTime() + link.interval;
+  halSimAt(link.anchor, connEvent, (void *)(uintptr_t)link.gen);
+
+  // Advertising stops with the connection.
+  roleAdvEnabled = FALSE;
+
+  stackLinkItem.connectionHandle = BS_STACK_CONN_HANDLE;
+  stackLinkItem.stateFlags = LINK_CONNECTED;
+  linkDBNotify(BS_STACK_CONN_HANDLE, LINKDB_STATUS_UPDATE_NEW);
+  roleReport(GAPROLE_CONNECTED);
+
+  return TRUE;
+}
+
+void bsStackDisconnect(void)
+{
+  if (link.up)
+  {
+    linkDown();
+  }
+}
+
+bool bsStackConnected(void)
+{
+  return link.up;
+}
+
+bool bsStackWrite(uint16 handle, const uint8 *pValue, uint8 len)
+{
+  if (!link.up || link.reqQueued || link.reqOutstanding || len > sizeof(link.reqValue))
+  {
+    return FALSE;
+  }
+
+  link.reqQueued = TRUE;
+  link.reqHandle = handle;
+  link.reqLen = len;
+  memcpy(link.reqValue, pValue, len);
+
+  return TRUE;
+}
+
+uint16 bsStackFindHandle(uint16 uuid)
+{
+  for (uint8 i = 0; i < stackServiceCnt; i++)
+  {
+    for (uint16 j = 0; j < stackServices[i].numAttrs; j++)
+    {
+      gattAttribute_t *pAttr = &stackServices[i].pAttrs[j];
+
+      if (pAttr->type.len == ATT_BT_UUID_SIZE &&
+          BUILD_UINT16(pAttr->type.uuid[0], pAttr->type.uuid[1]) == uuid)
+      {
+        return pAttr->handle;
+      }
+    }
+  }
+
+  return 0;
+}
+
+uint8 bsStackTxPending(void)
+{
+  return link.txCnt;
+}
+
+/*********************************************************************
+ * Connection events
+ */
+
+static void connEvent(void *arg)
+{
+  uint8 sent = 0;
+  uint8 pairs;
+  bool rx = FALSE;
+
+  if ((uint32)(uintptr_t)arg != link.gen || !link.up)
+  {
+    return;
+  }
+
+  link.eventCnt++;
+  stackCentral->connEvent(link.eventCnt);
+
+  if (link.reqQueued)
+  {
+    link.reqQueued = FALSE;
+    link.reqOutstanding = TRUE;
+    rx = TRUE;
+  }
+
+  if (link.rspPending)
+  {
+    link.rspPending = FALSE;
+    link.reqOutstanding = FALSE;
+    stackCentral->writeRsp(link.rspStatus);
+    sent++;
+  }
+
+  while (link.txCnt != 0 && sent < BS_STACK_TX_PER_EVENT)
+  {
+    stackNoti_t *pNoti = link.tx[link.txHead];
+
+    link.txHead = (link.txHead + 1) % BS_STACK_TX_BUFS;
+    link.txCnt--;
+    stackCentral->notify(pNoti->handle, pNoti->value, pNoti->len);
+    osal_mem_free(pNoti);
+    sent++;
+  }
+
+  pairs = (sent > 1) ? sent : 1;
+  halSimAt(halSimTime() + HAL_SIM_US(BS_STACK_PDU_PAIR_US) * pairs, connEventEnd,
+           (void *)(uintptr_t)(rx ? 1 : 0));
+
+  link.anchor += link.interval;
+  halSimAt(link.anchor, connEvent, (void *)(uintptr_t)link.gen);
+}
+
+static void connEventEnd(void *arg)
+{
+  if (!link.up)
+  {
+    return;
+  }
+
+  if (arg != NULL)
+  {
+    osal_set_event(gattServAppTaskId, STACK_RX_EVT);
+  }
+
+  if (noticeEvent != 0)
+  {
+    osal_set_event(noticeTaskId, noticeEvent);
+  }
+
+  if (link.terminate)
+  {
+    linkDown();
+  }
+}
+
+static void linkDown(void)
+{
+  link.up = FALSE;
+
+  while (link.txCnt != 0)
+  {
+    osal_mem_free(link.tx[link.txHead]);
+    link.txHead = (link.txHead + 1) % BS_STACK_TX_BUFS;
+    link.txCnt--;
+  }
+
+  stackLinkItem.stateFlags = LINK_NOT_CONNECTED;
+  linkDBNotify(BS_STACK_CONN_HANDLE, LINKDB_STATUS_UPDATE_REMOVED);
+  roleReport(GAPROLE_WAITING);
+}
+
+/*********************************************************************
+ * Stack tasks
+ */
+
+void LL_Init(uint8 taskId) { (void)taskId; }
+uint16 LL_ProcessEvent(uint8 task_id, uint16 events) { (void)task_id; (void)events; return 0; }
+void HCI_Init(uint8 taskID) { (void)taskID; }
+uint16 HCI_ProcessEvent(uint8 task_id, uint16 events) { (void)task_id; (void)events; return 0; }
+void L2CAP_Init(uint8 taskId) { (void)taskId; }
+uint16 L2CAP_ProcessEvent(uint8 taskId, uint16 events) { (void)taskId; (void)events; return 0; }
+void GAP_Init(uint8 task_id) { (void)task_id; }
+uint16 GAP_ProcessEvent(uint8 task_id, uint16 events) { (void)task_id; (void)events; return 0; }
+void GATT_Init(uint8 taskId) { (void)taskId; }
+uint16 GATT_ProcessEvent(uint8 taskId, uint16 events) { (void)taskId; (void)events; return 0; }
+void SM_Init(uint8 task_id) { (void)task_id; }
+uint16 SM_ProcessEvent(uint8 task_id, uint16 events) { (void)task_id; (void)events; return 0; }
+void GAPBondMgr_Init(uint8 task_id) { (void)task_id; }
+uint16 GAPBondMgr_ProcessEvent(uint8 task_id, uint16 events) { (void)task_id; (void)events; return 0; }
+
+void Hal_Init(uint8 task_id) { (void)task_id; }
+uint16 Hal_ProcessEvent(uint8 task_id, uint16 events) { (void)task_id; (void)events; return 0; }
+void Hal_ProcessPoll(void) {}
+
+void GATTServApp_Init(uint8 taskId)
+{
+  gattServAppTaskId = taskId;
+}
+
+uint16 GATTServApp_ProcessEvent(uint8 taskId, uint16 events)
+{
+  (void)taskId;
+
+  if (events & STACK_RX_EVT)
+  {
+    CONST gattServiceCBs_t *pCBs;
+    gattAttribute_t *pAttr = findAttr(link.reqHandle, &pCBs);
+    uint8 status;
+
+    if (pAttr == NULL)
+    {
+      status = ATT_ERR_INVALID_HANDLE;
+    }
+    else if (!gattPermitWrite(pAttr->permissions))
+    {
+      status = ATT_ERR_WRITE_NOT_PERMITTED;
+    }
+    else
+    {
+      status = pCBs->pfnWriteAttrCB(BS_STACK_CONN_HANDLE, pAttr, link.reqValue, link.reqLen, 0);
+    }
+
+    if (link.up)
+    {
+      link.rspPending = TRUE;
+      link.rspStatus = status;
+    }
+
+    return (events ^ STACK_RX_EVT);
+  }
+
+  return 0;
+}
+
+/*********************************************************************
+ * GAP and the peripheral role
+ */
+
+bStatus_t GAP_SetParamValue(gapParamIDs_t paramID, uint16 paramValue)
+{
+  (void)paramID;
+  (void)paramValue;
+  return SUCCESS;
+}
+
+void GAPRole_Init(uint8 task_id)
+{
+  gapRoleTaskId = task_id;
+}
+
+uint16 GAPRole_ProcessEvent(uint8 task_id, uint16 events)
+{
+  (void)task_id;
+
+  if (events & STACK_ROLE_EVT)
+  {
+    gaprole_States_t state = roleStates[0];
+
+    roleStateCnt--;
+    memmove(&roleStates[0], &roleStates[1], roleStateCnt * sizeof(roleStates[0]));
+    if (roleStateCnt != 0)
+    {
+      osal_set_event(gapRoleTaskId, STACK_ROLE_EVT);
+    }
+
+    if (pRoleCBs != NULL && pRoleCBs->pfnStateChange != NULL)
+    {
+      pRoleCBs->pfnStateChange(state);
+    }
+
+    return (events ^ STACK_ROLE_EVT);
+  }
+
+  return 0;
+}
+
+bStatus_t GAPRole_StartDevice(gapRolesCBs_t *pAppCallbacks)
+{
+  pRoleCBs = pAppCallbacks;
+  roleReport(GAPROLE_STARTED);
+  if (roleAdvEnabled)
+  {
+    roleReport(GAPROLE_ADVERTISING);
+  }
+  return SUCCESS;
+}
+
+bStatus_t GAPRole_SetParameter(uint16 param, uint8 len, void *pValue)
+{
+  (void)len;
+
+  if (param == GAPROLE_ADVERT_ENABLED)
+  {
+    uint8 enable = *(uint8 *)pValue;
+
+    if (enable && !roleAdvEnabled && !link.up && pRoleCBs != NULL)
+    {
+      roleReport(GAPROLE_ADVERTISING);
+    }
+    roleAdvEnabled = enable;
+  }
+
+  return SUCCESS;
+}
+
+bStatus_t GAPRole_GetParameter(uint16 param, void *pValue)
+{
+  switch (param)
+  {
+    case GAPROLE_ADVERT_ENABLED:
+      *(uint8 *)pValue = roleAdvEnabled;
+      break;
+
+    case GAPROLE_CONNHANDLE:
+      *(uint16 *)pValue = BS_STACK_CONN_HANDLE;
+      break;
+
+    default:
+      return INVALIDPARAMETER;
+  }
+
+  return SUCCESS;
+}
+
+bStatus_t GAPRole_TerminateConnection(void)
+{
+  if (!link.up)
+  {
+    return bleIncorrectMode;
+  }
+
+  link.terminate = TRUE;
+  return SUCCESS;
+}
+
+bStatus_t GAPBondMgr_SetParameter(uint16 param, uint8 len, void *pValue)
+{
+  (void)param;
+  (void)len;
+  (void)pValue;
+  return SUCCESS;
+}
+
+void GAPBondMgr_Register(gapBondCBs_t *pCB)
+{
+  (void)pCB;
+}
+
+static void roleReport(gaprole_States_t state)
+{
+  if (roleStateCnt == STACK_ROLE_STATES_MAX)
+  {
+    fprintf(stderr, "bs_stack: role state queue overflow\n");
+    exit(2);
+  }
+
+  roleStates[roleStateCnt++] = state;
+  osal_set_event(gapRoleTaskId, STACK_ROLE_EVT);
+}
+
+/*********************************************************************
+ * Link database
+ */
+
+uint8 linkDB_Register(pfnLinkDBCB_t pFunc)
+{
+  for (uint8 i = 0; i < STACK_LINKDB_CBS_MAX; i++)
+  {
+    if (stackLinkDBCBs[i] == NULL)
+    {
+      stackLinkDBCBs[i] = pFunc;
+      return SUCCESS;
+    }
+  }
+
+  return bleNoResources;
+}
+
+uint8 linkDB_State(uint16 connectionHandle, uint8 state)
+{
+  return (stackLinkItem.stateFlags != LINK_NOT_CONNECTED &&
+          stackLinkItem.connectionHandle == connectionHandle &&
+          (stackLinkItem.stateFlags & state) == state);
+}
+
+void linkDB_PerformFunc(pfnPerformFuncCB_t cb)
+{
+  if (stackLinkItem.stateFlags != LINK_NOT_CONNECTED)
+  {
+    cb(&stackLinkItem);
+  }
+}
+
+static void linkDBNotify(uint16 connHandle, uint8 changeType)
+{
+  for (uint8 i = 0; i < STACK_LINKDB_CBS_MAX && stackLinkDBCBs[i] != NULL; i++)
+  {
+    stackLinkDBCBs[i](connHandle, changeType);
+  }
+}
+
+/*********************************************************************
+ * GATT server
+ */
+
+bStatus_t GGS_AddService(uint32 services) { (void)services; return SUCCESS; }
+bStatus_t GATTServApp_AddService(uint32 services) { (void)services; return SUCCESS; }
+bStatus_t DevInfo_AddService(void) { return SUCCESS; }
+
+bStatus_t GGS_SetParameter(uint8 param, uint8 len, void *value)
+{
+  (void)param;
+  (void)len;
+  (void)value;
+  return SUCCESS;
+}
+
+bStatus_t GATTServApp_RegisterService(gattAttribute_t *pAttrs, uint16 numAttrs,
+                                      CONST gattServiceCBs_t *pServiceCBs)
+{
+  if (stackServiceCnt == STACK_SERVICES_MAX)
+  {
+    return bleNoResources;
+  }
+
+  for (uint16 i = 0; i < numAttrs; i++)
+  {
+    pAttrs[i].handle = stackNextHandle++;
+  }
+
+  stackServices[stackServiceCnt].pAttrs = pAttrs;
+  stackServices[stackServiceCnt].numAttrs = numAttrs;
+  stackServices[stackServiceCnt].pCBs = pServiceCBs;
+  stackServiceCnt++;
+
+  return SUCCESS;
+}
+
+void GATTServApp_InitCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl)
+{
+  for (uint8 i = 0; i < GATT_MAX_NUM_CONN; i++)
+  {
+    if (connHandle == INVALID_CONNHANDLE || charCfgTbl[i].connHandle == connHandle)
+    {
+      charCfgTbl[i].connHandle = INVALID_CONNHANDLE;
+      charCfgTbl[i].value = GATT_CFG_NO_OPERATION;
+    }
+  }
+}
+
+uint16 GATTServApp_ReadCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl)
+{
+  gattCharCfg_t *pItem = findCharCfg(connHandle, charCfgTbl);
+
+  return (pItem != NULL) ? pItem->value : GATT_CFG_NO_OPERATION;
+}
+
+uint8 GATTServApp_WriteCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl, uint16 value)
+{
+  gattCharCfg_t *pItem = findCharCfg(connHandle, charCfgTbl);
+
+  if (pItem == NULL)
+  {
+    pItem = findCharCfg(INVALID_CONNHANDLE, charCfgTbl);
+    if (pItem == NULL)
+    {
+      return FAILURE;
+    }
+  }
+
+  pItem->connHandle = connHandle;
+  pItem->value = (uint8)value;
+
+  return SUCCESS;
+}
+
+bStatus_t GATTServApp_ProcessCCCWriteReq(uint16 connHandle, gattAttribute_t *pAttr,
+                                         uint8 *pValue, uint8 len, uint16 offset,
+                                         uint16 validCfg)
+{
+  uint16 value;
+
+  if (offset != 0)
+  {
+    return ATT_ERR_ATTR_NOT_LONG;
+  }
+  if (len != 2)
+  {
+    return ATT_ERR_INVALID_VALUE_SIZE;
+  }
+
+  value = BUILD_UINT16(pValue[0], pValue[1]);
+  if (value != GATT_CFG_NO_OPERATION && value != validCfg)
+  {
+    return ATT_ERR_INVALID_VALUE;
+  }
+
+  if (GATTServApp_WriteCharCfg(connHandle, (gattCharCfg_t *)pAttr->pValue, value) != SUCCESS)
+  {
+    return ATT_ERR_INSUFFICIENT_RESOURCES;
+  }
+
+  return SUCCESS;
+}
+
+bStatus_t GATT_Notification(uint16 connHandle, attHandleValueNoti_t *pNoti, uint8 authenticated)
+{
+  stackNoti_t *pItem;
+
+  (void)authenticated;
+
+  if (!link.up || connHandle != BS_STACK_CONN_HANDLE)
+  {
+    return bleNotConnected;
+  }
+  if (link.txCnt == BS_STACK_TX_BUFS)
+  {
+    return MSG_BUFFER_NOT_AVAIL;
+  }
+
+  pItem = osal_mem_alloc(sizeof(stackNoti_t) + pNoti->len);
+  if (pItem == NULL)
+  {
+    return bleMemAllocError;
+  }
+
+  pItem->handle = pNoti->handle;
+  pItem->len = pNoti->len;
+  memcpy(pItem->value, pNoti->value, pNoti->len);
+  link.tx[(link.txHead + link.txCnt) % BS_STACK_TX_BUFS] = pItem;
+  link.txCnt++;
+
+  if (osal_heap_mem_used() > bsStackHeapMax)
+  {
+    bsStackHeapMax = osal_heap_mem_used();
+  }
+
+  return SUCCESS;
+}
+
+static gattAttribute_t *findAttr(uint16 handle, CONST gattServiceCBs_t **ppCBs)
+{
+  for (uint8 i = 0; i < stackServiceCnt; i++)
+  {
+    for (uint16 j = 0; j < stackServices[i].numAttrs; j++)
+    {
+      if (stackServices[i].pAttrs[j].handle == handle)
+      {
+        *ppCBs = stackServices[i].pCBs;
+        return &stackServices[i].pAttrs[j];
+      }
+    }
+  }
+
+  return NULL;
+}
+
+static gattCharCfg_t *findCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl)
+{
+  for (uint8 i = 0; i < GATT_MAX_NUM_CONN; i++)
+  {
+    if (charCfgTbl[i].connHandle == connHandle)
+    {
+      return &charCfgTbl[i];
+    }
+  }
+
+  return NULL;
+}
+
+/*********************************************************************
+ * HCI
+ */
+
+hciStatus_t HCI_EXT_ClkDivOnHaltCmd(uint8 control)
+{
+  (void)control;
+  return HCI_SUCCESS;
+}
+
+hciStatus_t HCI_EXT_ConnEventNoticeCmd(uint8 taskID, uint16 taskEvent)
+{
+  noticeTaskId = taskID;
+  noticeEvent = taskEvent;
+  return HCI_SUCCESS;
+}
+
+// The 625 us ticks of the LL, which OSAL_ClockBLE.c counts the system clock in.
+uint16 ll_McuPrecisionCount(void)
+{
+  return (uint16)(halSimTime() / HAL_SIM_US(625));
+}
+
+/*********************************************************************
+ * Board
+ */
+
+void osal_pwrmgr_init(void) {}
+
+uint8 RegisterForKeys(uint8 task_id)
+{
+  (void)task_id;
+  return TRUE;
+}
+
+void HalBsKeySetLongPress(uint8 keys, uint16 msecs)
+{
+  (void)keys;
+  (void)msecs;
+}
+
+uint16 Onboard_rand(void)
+{
+  return (uint16)rand();
+}
+
+// Flash on the memory of hal_sim.c; the CPU stalls for as long as the controller works.
+void HalFlashRead(uint8 pg, uint16 offset, uint8 *buf, uint16 cnt)
+{
+  memcpy(buf, &halSimFlash[(uint32)pg * HAL_FLASH_PAGE_SIZE + offset], cnt);
+}
+
+void HalFlashWrite(uint16 addr, uint8 *buf, uint16 cnt)
+{
+  uint8 *pDst = &halSimFlash[(uint32)addr * HAL_FLASH_WORD_SIZE];
+
+  for (uint32 i = 0; i < (uint32)cnt * HAL_FLASH_WORD_SIZE; i++)
+  {
+    pDst[i] &= buf[i];
+  }
+  halSimRun(HAL_SIM_US(20) * cnt);
+}
+
+void HalFlashErase(uint8 pg)
+{
+  memset(&halSimFlash[(uint32)pg * HAL_FLASH_PAGE_SIZE], 0xFF, HAL_FLASH_PAGE_SIZE);
+  halSimRun(HAL_SIM_MS(20));
+}
+
+uint8 osal_snv_read(osalSnvId_t id, osalSnvLen_t len, void *pBuf)
+{
+  for (uint8 i = 0; i < stackSnvCnt; i++)
+  {
+    if (stackSnv[i].id == id)
+    {
+      memcpy(pBuf, stackSnv[i].data, (len < stackSnv[i].len) ? len : stackSnv[i].len);
+      return SUCCESS;
+    }
+  }
+
+  return NV_OPER_FAILED;
+}
+
+uint8 osal_snv_write(osalSnvId_t id, osalSnvLen_t len, void *pBuf)
+{
+  uint8 i;
+
+  if (len > STACK_SNV_ITEM_MAX)
+  {
+    return NV_OPER_FAILED;
+  }
+
+  for (i = 0; i < stackSnvCnt && stackSnv[i].id != id; i++);
+  if (i == stackSnvCnt)
+  {
+    if (stackSnvCnt == STACK_SNV_ITEMS_MAX)
+    {
+      return NV_OPER_FAILED;
+    }
+    stackSnvCnt++;
+  }
+
+  stackSnv[i].id = id;
+  stackSnv[i].len = (uint8)len;
+  memcpy(stackSnv[i].data, pBuf, len);
+
+  return SUCCESS;
+}
+
+/*********************************************************************
+ * NPI, no UART peer in this bench
+ */
+
+void NPI_InitTransport(npiCBack_t npiCBack)
+{
+  (void)npiCBack;
+}
+
+uint16 NPI_ReadTransport(uint8 *buf, uint16 len)
+{
+  (void)buf;
+  (void)len;
+  return 0;
+}
+
+uint16 NPI_WriteTransport(uint8 *buf, uint16 len)
+{
+  (void)buf;
+  return len;
+}
+
+uint16 NPI_RxBufLen(void)
+{
+  return 0;
+}
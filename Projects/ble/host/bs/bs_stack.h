@@ -0,0 +1,73 @@
+/**************************************************************************************************
+  Filename:       bs_stack.h
+
+  Description:
+
+  Stand-ins for the BLE stack and the board under BSBLEPeripheral on a Linux host, see
+  bs_stack.c, and the link to the central that bs_bench.c drives through them.
+**************************************************************************************************/
+
+#ifndef BS_STACK_H
+#define BS_STACK_H
+
+#include "hal_types.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define BS_STACK_CONN_HANDLE      0x0000
+
+// Notifications the stack holds for the link until they are sent; GATT_Notification() refuses
+// more with MSG_BUFFER_NOT_AVAIL.
+#define BS_STACK_TX_BUFS          8
+
+// PDUs the peripheral sends in one connection event, the write response included.
+#define BS_STACK_TX_PER_EVENT     4
+
+// Air time of one central PDU, its answer and the interframe spaces, for a PDU of 27 bytes.
+#define BS_STACK_PDU_PAIR_US      800
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+// The central at the other end of the link, called in the connection events.
+typedef struct
+{
+  void (*writeRsp)(uint8 status);                     // a Write Response, or the ATT error
+  void (*notify)(uint16 handle, uint8 *pValue, uint8 len);
+  void (*connEvent)(uint32 eventCnt);                 // a connection event starts
+} bsStackCentral_t;
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+// Most OSAL heap bytes in use when GATT_Notification() took a notification, needs
+// OSALMEM_METRICS. The bench resets it.
+extern uint16 bsStackHeapMax;
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+// Before osal_init_system().
+void bsStackInit(const bsStackCentral_t *pCentral);
+
+// Connect while the peripheral advertises, the first connection event one interval on.
+// 'interval' in units of 1.25 ms. FALSE if the peripheral does not advertise.
+bool bsStackConnect(uint16 interval);
+void bsStackDisconnect(void);
+bool bsStackConnected(void);
+
+// A Write Request for the next connection event. FALSE while one waits for its response.
+bool bsStackWrite(uint16 handle, const uint8 *pValue, uint8 len);
+
+// Handle of the first attribute with the 16-bit UUID, 0 if none.
+uint16 bsStackFindHandle(uint16 uuid);
+
+// Notifications the stack holds now.
+uint8 bsStackTxPending(void);
+
+#endif
@@ -0,0 +1,10 @@
+/**************************************************************************************************
+  Filename:       osal.h
+
+  Description:
+
+  OnBoard.h of Projects/ble/common/cc2540 includes "osal.h", which only a file system that
+  ignores case finds as OSAL.h.
+**************************************************************************************************/
+
+#include "OSAL.h"
@@ -0,0 +1,297 @@
+/**************************************************************************************************
+  Filename:       hal_mcu.h
+
+  Description:    Components/hal/target/CC2540EB/hal_mcu.h for the host build: the SFRs, bits and
+                  interrupt vectors of ioCC2540.h are those of the register model in hal_sim.h.
+**************************************************************************************************/
+
+#ifndef _HAL_MCU_H
+#define _HAL_MCU_H
+
+/* ------------------------------------------------------------------------------------------------
+ *                                           Includes
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#include "hal_defs.h"
+#include "hal_types.h"
+#include "hal_sim.h"
+
+/* ------------------------------------------------------------------------------------------------
+ *                                        Target Defines
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#define HAL_MCU_CC2540
+
+/* ------------------------------------------------------------------------------------------------
+ *                                     Compiler Abstraction
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#define HAL_COMPILER_HOST
+#define HAL_MCU_LITTLE_ENDIAN()   1
+
+#define HAL_ISR_FUNC_DECLARATION(f,v)   void f(void)
+#define HAL_ISR_FUNC_PROTOTYPE(f,v)     void f(void)
+#define HAL_ISR_FUNCTION(f,v) \
+  HAL_ISR_FUNC_PROTOTYPE(f,v); \
+  static void __attribute__((constructor)) f##_vector(void) { halSimSetVector((v), f); } \
+  HAL_ISR_FUNC_DECLARATION(f,v)
+
+/* ------------------------------------------------------------------------------------------------
+ *                                    Special Function Registers
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#define P0          HAL_SIM_SFR(P0)
+#define P1          HAL_SIM_SFR(P1)
+#define P2          HAL_SIM_SFR(P2)
+#define P0DIR       HAL_SIM_SFR(P0DIR)
+#define P1DIR       HAL_SIM_SFR(P1DIR)
+#define P2DIR       HAL_SIM_SFR(P2DIR)
+#define P0SEL       HAL_SIM_SFR(P0SEL)
+#define P1SEL       HAL_SIM_SFR(P1SEL)
+#define P2SEL       HAL_SIM_SFR(P2SEL)
+#define P0INP       HAL_SIM_SFR(P0INP)
+#define P1INP       HAL_SIM_SFR(P1INP)
+#define P2INP       HAL_SIM_SFR(P2INP)
+#define P0IEN       HAL_SIM_SFR(P0IEN)
+#define P1IEN       HAL_SIM_SFR(P1IEN)
+#define P2IEN       HAL_SIM_SFR(P2IEN)
+#define P0IFG       HAL_SIM_SFR(P0IFG)
+#define P1IFG       HAL_SIM_SFR(P1IFG)
+#define P2IFG       HAL_SIM_SFR(P2IFG)
+#define PICTL       HAL_SIM_SFR(PICTL)
+#define PERCFG      HAL_SIM_SFR(PERCFG)
+#define APCFG       HAL_SIM_SFR(APCFG)
+#define ADCCFG      APCFG
+#define IEN0        HAL_SIM_SFR(IEN0)
+#define IEN1        HAL_SIM_SFR(IEN1)
+#define IEN2        HAL_SIM_SFR(IEN2)
+#define IP0         HAL_SIM_SFR(IP0)
+#define IP1         HAL_SIM_SFR(IP1)
+#define TCON        HAL_SIM_SFR(TCON)
+#define S0CON       HAL_SIM_SFR(S0CON)
+#define S1CON       HAL_SIM_SFR(S1CON)
+#define IRCON       HAL_SIM_SFR(IRCON)
+#define IRCON2      HAL_SIM_SFR(IRCON2)
+#define U0CSR       HAL_SIM_SFR(U0CSR)
+#define U0UCR       HAL_SIM_SFR(U0UCR)
+#define U0GCR       HAL_SIM_SFR(U0GCR)
+#define U0BAUD      HAL_SIM_SFR(U0BAUD)
+#define U0DBUF      HAL_SIM_SFR_DATA(U0DBUF)
+#define U1CSR       HAL_SIM_SFR(U1CSR)
+#define U1UCR       HAL_SIM_SFR(U1UCR)
+#define U1GCR       HAL_SIM_SFR(U1GCR)
+#define U1BAUD      HAL_SIM_SFR(U1BAUD)
+#define U1DBUF      HAL_SIM_SFR_DATA(U1DBUF)
+#define DMAARM      HAL_SIM_SFR(DMAARM)
+#define DMAREQ      HAL_SIM_SFR(DMAREQ)
+#define DMAIRQ      HAL_SIM_SFR(DMAIRQ)
+#define DMA0CFGH    HAL_SIM_SFR(DMA0CFGH)
+#define DMA0CFGL    HAL_SIM_SFR(DMA0CFGL)
+#define DMA1CFGH    HAL_SIM_SFR(DMA1CFGH)
+#define DMA1CFGL    HAL_SIM_SFR(DMA1CFGL)
+#define FCTL        HAL_SIM_SFR(FCTL)
+#define FADDRL      HAL_SIM_SFR(FADDRL)
+#define FADDRH      HAL_SIM_SFR(FADDRH)
+#define FWDATA      HAL_SIM_SFR_DATA(FWDATA)
+#define MEMCTR      HAL_SIM_SFR(MEMCTR)
+#define FMAP        HAL_SIM_SFR(FMAP)
+#define ST0         HAL_SIM_SFR(ST0)
+#define ST1         HAL_SIM_SFR(ST1)
+#define ST2         HAL_SIM_SFR(ST2)
+#define STLOAD      HAL_SIM_SFR(STLOAD)
+#define SLEEPCMD    HAL_SIM_SFR(SLEEPCMD)
+#define SLEEPSTA    HAL_SIM_SFR(SLEEPSTA)
+#define CLKCONCMD   HAL_SIM_SFR(CLKCONCMD)
+#define CLKCONSTA   HAL_SIM_SFR(CLKCONSTA)
+#define PCON        HAL_SIM_SFR(PCON)
+#define WDCTL       HAL_SIM_SFR(WDCTL)
+#define T1CNTL      HAL_SIM_SFR(T1CNTL)
+#define T1CNTH      HAL_SIM_SFR(T1CNTH)
+#define T1CTL       HAL_SIM_SFR(T1CTL)
+#define T1STAT      HAL_SIM_SFR(T1STAT)
+#define T1CCTL0     HAL_SIM_SFR(T1CCTL0)
+#define T1CCTL1     HAL_SIM_SFR(T1CCTL1)
+#define T1CCTL2     HAL_SIM_SFR(T1CCTL2)
+#define T1CCTL3     HAL_SIM_SFR(T1CCTL3)
+#define T1CCTL4     HAL_SIM_SFR(T1CCTL4)
+#define T1CC0L      HAL_SIM_SFR(T1CC0L)
+#define T1CC0H      HAL_SIM_SFR(T1CC0H)
+#define T1CC1L      HAL_SIM_SFR(T1CC1L)
+#define T1CC1H      HAL_SIM_SFR(T1CC1H)
+#define T1CC2L      HAL_SIM_SFR(T1CC2L)
+#define T1CC2H      HAL_SIM_SFR(T1CC2H)
+#define T1CC3L      HAL_SIM_SFR(T1CC3L)
+#define T1CC3H      HAL_SIM_SFR(T1CC3H)
+#define T1CC4L      HAL_SIM_SFR(T1CC4L)
+#define T1CC4H      HAL_SIM_SFR(T1CC4H)
+#define T3CNT       HAL_SIM_SFR(T3CNT)
+#define T3CTL       HAL_SIM_SFR(T3CTL)
+#define T3CCTL0     HAL_SIM_SFR(T3CCTL0)
+#define T3CC0       HAL_SIM_SFR(T3CC0)
+#define T3CCTL1     HAL_SIM_SFR(T3CCTL1)
+#define T3CC1       HAL_SIM_SFR(T3CC1)
+#define T4CNT       HAL_SIM_SFR(T4CNT)
+#define T4CTL       HAL_SIM_SFR(T4CTL)
+#define T4CCTL0     HAL_SIM_SFR(T4CCTL0)
+#define T4CC0       HAL_SIM_SFR(T4CC0)
+#define T4CCTL1     HAL_SIM_SFR(T4CCTL1)
+#define T4CC1       HAL_SIM_SFR(T4CC1)
+#define TIMIF       HAL_SIM_SFR(TIMIF)
+#define ENCCS       HAL_SIM_SFR(ENCCS)
+#define ENCDI       HAL_SIM_SFR_DATA(ENCDI)
+#define ENCDO       HAL_SIM_SFR(ENCDO)
+#define ADCCON1     HAL_SIM_SFR(ADCCON1)
+#define ADCCON2     HAL_SIM_SFR(ADCCON2)
+#define ADCCON3     HAL_SIM_SFR(ADCCON3)
+#define ADCL        HAL_SIM_SFR(ADCL)
+#define ADCH        HAL_SIM_SFR(ADCH)
+#define RNDL        HAL_SIM_SFR_RND(RNDL)
+#define RNDH        HAL_SIM_SFR_RND(RNDH)
+#define CHVER       HAL_SIM_SFR(CHVER)
+#define RFD         HAL_SIM_SFR(RFD)
+#define RFST        HAL_SIM_SFR(RFST)
+
+// The XDATA-mapped SFRs are the same slots.
+#define X_T1CCTL0   T1CCTL0
+#define X_T1CC0L    T1CC0L
+#define X_T1CC0H    T1CC0H
+#define X_TIMIF     TIMIF
+#define X_T3CCTL0   T3CCTL0
+#define X_T3CC0     T3CC0
+#define X_T3CTL     T3CTL
+#define X_T4CCTL0   T4CCTL0
+#define X_T4CC0     T4CC0
+#define X_T4CTL     T4CTL
+
+// Bit-addressable SFRs.
+#define EA          HAL_SIM_SBIT(IEN0, 7)
+#define STIE        HAL_SIM_SBIT(IEN0, 5)
+#define ENCIE       HAL_SIM_SBIT(IEN0, 4)
+#define URX1IE      HAL_SIM_SBIT(IEN0, 3)
+#define URX0IE      HAL_SIM_SBIT(IEN0, 2)
+#define ADCIE       HAL_SIM_SBIT(IEN0, 1)
+#define RFERRIE     HAL_SIM_SBIT(IEN0, 0)
+#define P0IE        HAL_SIM_SBIT(IEN1, 5)
+#define T4IE        HAL_SIM_SBIT(IEN1, 4)
+#define T3IE        HAL_SIM_SBIT(IEN1, 3)
+#define T2IE        HAL_SIM_SBIT(IEN1, 2)
+#define T1IE        HAL_SIM_SBIT(IEN1, 1)
+#define DMAIE       HAL_SIM_SBIT(IEN1, 0)
+#define URX1IF      HAL_SIM_SBIT(TCON, 7)
+#define ADCIF       HAL_SIM_SBIT(TCON, 5)
+#define URX0IF      HAL_SIM_SBIT(TCON, 3)
+#define IT1         HAL_SIM_SBIT(TCON, 2)
+#define RFERRIF     HAL_SIM_SBIT(TCON, 1)
+#define IT0         HAL_SIM_SBIT(TCON, 0)
+#define ENCIF_1     HAL_SIM_SBIT(S0CON, 1)
+#define ENCIF_0     HAL_SIM_SBIT(S0CON, 0)
+#define RFIF_1      HAL_SIM_SBIT(S1CON, 1)
+#define RFIF_0      HAL_SIM_SBIT(S1CON, 0)
+#define STIF        HAL_SIM_SBIT(IRCON, 7)
+#define P0IF        HAL_SIM_SBIT(IRCON, 5)
+#define T4IF        HAL_SIM_SBIT(IRCON, 4)
+#define T3IF        HAL_SIM_SBIT(IRCON, 3)
+#define T2IF        HAL_SIM_SBIT(IRCON, 2)
+#define T1IF        HAL_SIM_SBIT(IRCON, 1)
+#define DMAIF       HAL_SIM_SBIT(IRCON, 0)
+#define WDTIF       HAL_SIM_SBIT(IRCON2, 4)
+#define P1IF        HAL_SIM_SBIT(IRCON2, 3)
+#define UTX1IF      HAL_SIM_SBIT(IRCON2, 2)
+#define UTX0IF      HAL_SIM_SBIT(IRCON2, 1)
+#define P2IF        HAL_SIM_SBIT(IRCON2, 0)
+#define P0_0        HAL_SIM_SBIT(P0, 0)
+#define P0_1        HAL_SIM_SBIT(P0, 1)
+#define P0_2        HAL_SIM_SBIT(P0, 2)
+#define P0_3        HAL_SIM_SBIT(P0, 3)
+#define P0_4        HAL_SIM_SBIT(P0, 4)
+#define P0_5        HAL_SIM_SBIT(P0, 5)
+#define P0_6        HAL_SIM_SBIT(P0, 6)
+#define P0_7        HAL_SIM_SBIT(P0, 7)
+#define P1_0        HAL_SIM_SBIT(P1, 0)
+#define P1_1        HAL_SIM_SBIT(P1, 1)
+#define P1_2        HAL_SIM_SBIT(P1, 2)
+#define P1_3        HAL_SIM_SBIT(P1, 3)
+#define P1_4        HAL_SIM_SBIT(P1, 4)
+#define P1_5        HAL_SIM_SBIT(P1, 5)
+#define P1_6        HAL_SIM_SBIT(P1, 6)
+#define P1_7        HAL_SIM_SBIT(P1, 7)
+#define P2_0        HAL_SIM_SBIT(P2, 0)
+#define P2_1        HAL_SIM_SBIT(P2, 1)
+#define P2_2        HAL_SIM_SBIT(P2, 2)
+#define P2_3        HAL_SIM_SBIT(P2, 3)
+#define P2_4        HAL_SIM_SBIT(P2, 4)
+
+/* ------------------------------------------------------------------------------------------------
+ *                                        Interrupt Macros
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#define HAL_ENABLE_INTERRUPTS()         st( EA = 1; )
+#define HAL_DISABLE_INTERRUPTS()        st( EA = 0; )
+#define HAL_INTERRUPTS_ARE_ENABLED()    (EA)
+
+typedef unsigned char halIntState_t;
+#define HAL_ENTER_CRITICAL_SECTION(x)   st( x = EA;  HAL_DISABLE_INTERRUPTS(); )
+#define HAL_EXIT_CRITICAL_SECTION(x)    st( EA = x; )
+#define HAL_CRITICAL_STATEMENT(x)       st( halIntState_t _s; HAL_ENTER_CRITICAL_SECTION(_s); x; HAL_EXIT_CRITICAL_SECTION(_s); )
+
+#define HAL_ENTER_ISR()
+#define HAL_EXIT_ISR()
+
+/* ------------------------------------------------------------------------------------------------
+ *                                        Reset Macro
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#define WD_EN               BV(3)
+#define WD_MODE             BV(2)
+#define WD_INT_1900_USEC    (BV(0) | BV(1))
+#define WD_RESET1           (0xA0 | WD_EN | WD_INT_1900_USEC)
+#define WD_RESET2           (0x50 | WD_EN | WD_INT_1900_USEC)
+#define WD_KICK()           st( WDCTL = (0xA0 | WDCTL & 0x0F); WDCTL = (0x50 | WDCTL & 0x0F); )
+
+#define HAL_SYSTEM_RESET()  halSimReset()
+
+/* ------------------------------------------------------------------------------------------------
+ *                                        CC2540 rev numbers
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#define REV_A          0x00    /* workaround turned off */
+#define REV_B          0x11    /* PG1.1 */
+#define REV_C          0x20    /* PG2.0 */
+#define REV_D          0x21    /* PG2.1 */
+
+/* ------------------------------------------------------------------------------------------------
+ *                                        CC2540 sleep common code
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#define PCON_IDLE  BV(0)
+#define OSC_PD     BV(2)
+#define PMODE     (BV(1) | BV(0))
+#define XOSC_STB   BV(6)
+#define HFRC_STB   BV(5)
+
+#define OSC              BV(6)
+#define TICKSPD(x)       (x << 3)
+#define CLKSPD(x)        (x << 0)
+#define CLKCONCMD_32MHZ  (0)
+#define CLKCONCMD_16MHZ  (CLKSPD(1) | TICKSPD(1) | OSC)
+
+#define LDRDY            BV(0)
+
+#ifdef POWER_SAVING
+extern volatile uint8 halSleepPconValue;
+#define CLEAR_SLEEP_MODE()        st( halSleepPconValue = 0; )
+#define ALLOW_SLEEP_MODE()        st( halSleepPconValue = PCON_IDLE; )
+#else
+#define CLEAR_SLEEP_MODE()
+#define ALLOW_SLEEP_MODE()
+#endif
+
+#endif
@@ -0,0 +1,1470 @@
+/**************************************************************************************************
+  Filename:       hal_sim.c
+
+  Description:    Register-level model of the CC2540 for the host build. See hal_sim.h.
+**************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal_sim.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define SIM_RING_LEN              8
+#define SIM_EVT_MAX               256
+
+// The descriptor of hal_dma.h as it is in the host build.
+typedef struct
+{
+  uintptr_t srcAddr;
+  uintptr_t dstAddr;
+  uint8_t xferLenV;
+  uint8_t xferLenL;
+  uint8_t ctrlA;
+  uint8_t ctrlB;
+} simDesc_t;
+
+#define DMA_TRIG_URX0             14
+#define DMA_TRIG_UTX0             15
+#define DMA_TRIG_URX1             16
+#define DMA_TRIG_UTX1             17
+#define DMA_TRIG_FLASH            18
+
+// CPU cycles from a DMA trigger to its transfer.
+#define DMA_TRIG_CYCLES           2
+
+#define CSR_MODE                  0x80
+#define CSR_RE                    0x40
+#define CSR_SLAVE                 0x20
+#define CSR_RX_BYTE               0x04
+#define CSR_TX_BYTE               0x02
+#define CSR_ACTIVE                0x01
+
+#define UCR_FLUSH                 0x80
+#define UCR_FLOW                  0x40
+#define UCR_BIT9                  0x10
+#define UCR_SPB                   0x04
+
+#define FCTL_BUSY                 0x80
+#define FCTL_FULL                 0x40
+#define FCTL_CM                   0x0C
+#define FCTL_WRITE                0x02
+#define FCTL_ERASE                0x01
+
+#define T1CTL_MODE                0x03
+#define T1CTL_DIV                 0x0C
+#define T1STAT_OVFIF              0x20
+#define T1CCTL_IM                 0x40
+#define T1CCTL_MODE               0x04
+#define TIMIF_T1OVFIM             0x40
+
+#define FLASH_PAGE_SIZE           2048
+#define FLASH_BANK_SIZE           0x8000
+#define FLASH_XDATA_MAP           0x8000   // where MEMCTR maps a flash bank into XDATA
+#define FLASH_WORD_PS             HAL_SIM_US(20)
+#define FLASH_ERASE_PS            HAL_SIM_MS(20)
+
+#define RND_MARK                  0x01000000UL
+#define RND_CRC_POLY              0x8005
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  uint64_t t;
+  uint64_t seq;
+  void (*fn)(void *);
+  void *arg;
+} simEvt_t;
+
+typedef struct
+{
+  uintptr_t src;
+  uintptr_t dst;
+  uint16_t len;
+  uint16_t cnt;
+  uint8_t ctrlA;
+  uint8_t ctrlB;
+} simDma_t;
+
+typedef struct
+{
+  const halSimUartPeer_t *peer;
+  uint8_t csr, ucr, gcr, baud, dbuf;  // SFR indices.
+  uint8_t port;                       // GPIO port of the Rx/Tx/CT/RT or SSN pins.
+  uint8_t ctBit, rtBit, ssnBit;
+  uint8_t urxFlag, urxBit;            // Where URXxIF is.
+  uint8_t utxFlag, utxBit;
+  uint8_t urxTrig, utxTrig;
+  uint8_t txBuf, txFull, txShift, txBusy;
+  uint8_t rxData, rxPending, rxShift, rxBusy;
+  uint8_t spiOut;                     // Byte shifted out to the SPI master at its next clock.
+  uint32_t gen;                       // Tags the scheduled events; bumped by a flush.
+} simUart_t;
+
+typedef struct
+{
+  uint8_t busy, writing, erasing, full;
+  uint32_t addr;
+  uint8_t buf[4];
+  uint8_t bufCnt;
+  uint8_t prog[4];
+  uint8_t progging;
+} simFlash_t;
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+uint8_t halSimFlash[HAL_SIM_FLASH_SIZE];
+halSimStats_t halSimStats;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static volatile uint16_t simSlot[HAL_SIM_SFR_CNT];
+static uint16_t simShadow[HAL_SIM_SFR_CNT];
+static uint8_t simRead[HAL_SIM_SFR_CNT];
+static uint8_t simRing[SIM_RING_LEN];
+static uint8_t simRingIdx;
+static volatile uint32_t simRnd[2];   // RNDL, RNDH
+static uint16_t simCrc;
+
+static uint64_t simNow;
+static uint64_t simSeq;
+static simEvt_t simEvt[SIM_EVT_MAX];
+static uint16_t simEvtCnt;
+
+static uint8_t simIsr;
+static void (*simVector[HAL_SIM_VECTOR_CNT])(void);
+static void (*simResetFn)(void);
+
+static simDesc_t *simDesc[2];
+static simDma_t simDma[5];
+
+static uint8_t simLatch[3];
+static uint8_t simPinExt[3];
+static uint8_t simPinLvl[3];
+static void (*simPinFn)(uint8_t port, uint8_t pin, uint8_t level);
+
+static simUart_t simUart[2];
+static simFlash_t simFl;
+static uint16_t simT1Cnt;
+static uintptr_t simT1Gen;        // Tags the scheduled ticks; bumped by a write to T1CTL.
+
+static const uint8_t simPortSfr[3] = { HAL_SIM_P0, HAL_SIM_P1, HAL_SIM_P2 };
+static const uint8_t simDirSfr[3] = { HAL_SIM_P0DIR, HAL_SIM_P1DIR, HAL_SIM_P2DIR };
+static const uint8_t simIenSfr[3] = { HAL_SIM_P0IEN, HAL_SIM_P1IEN, HAL_SIM_P2IEN };
+static const uint8_t simIfgSfr[3] = { HAL_SIM_P0IFG, HAL_SIM_P1IFG, HAL_SIM_P2IFG };
+
+// Enable bit, flag bit and whether the flag is cleared when the CPU vectors to the ISR.
+static const struct
+{
+  uint8_t ien, ienBit, flag, flagBit, autoClr;
+} simIrq[HAL_SIM_VECTOR_CNT] =
+{
+  { HAL_SIM_IEN0, 0, HAL_SIM_TCON,   1, 1 },  // RFERR
+  { HAL_SIM_IEN0, 1, HAL_SIM_TCON,   5, 1 },  // ADC
+  { HAL_SIM_IEN0, 2, HAL_SIM_TCON,   3, 1 },  // URX0
+  { HAL_SIM_IEN0, 3, HAL_SIM_TCON,   7, 1 },  // URX1
+  { HAL_SIM_IEN0, 4, HAL_SIM_S0CON,  0, 0 },  // ENC
+  { HAL_SIM_IEN0, 5, HAL_SIM_IRCON,  7, 0 },  // ST
+  { HAL_SIM_IEN2, 1, HAL_SIM_IRCON2, 0, 0 },  // P2INT
+  { HAL_SIM_IEN2, 2, HAL_SIM_IRCON2, 1, 0 },  // UTX0
+  { HAL_SIM_IEN1, 0, HAL_SIM_IRCON,  0, 0 },  // DMA
+  { HAL_SIM_IEN1, 1, HAL_SIM_IRCON,  1, 1 },  // T1
+  { HAL_SIM_IEN1, 2, HAL_SIM_IRCON,  2, 1 },  // T2
+  { HAL_SIM_IEN1, 3, HAL_SIM_IRCON,  3, 1 },  // T3
+  { HAL_SIM_IEN1, 4, HAL_SIM_IRCON,  4, 1 },  // T4
+  { HAL_SIM_IEN1, 5, HAL_SIM_IRCON,  5, 0 },  // P0INT
+  { HAL_SIM_IEN2, 3, HAL_SIM_IRCON2, 2, 0 },  // UTX1
+  { HAL_SIM_IEN2, 4, HAL_SIM_IRCON2, 3, 0 },  // P1INT
+  { HAL_SIM_IEN2, 0, HAL_SIM_S1CON,  0, 0 },  // RF
+  { HAL_SIM_IEN2, 5, HAL_SIM_IRCON2, 4, 0 },  // WDT
+};
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void simAccess(uint8_t idx);
+static void simCommit(uint8_t idx);
+static void simCommitRing(void);
+static void simSet(uint8_t idx, uint8_t val);
+static void simSetBit(uint8_t idx, uint8_t bit, uint8_t val);
+static void simWrite(uint8_t idx, uint8_t old, uint8_t val);
+static void simDispatch(void);
+static void simRunTo(uint64_t t);
+
+static void simPins(uint8_t port);
+static simUart_t *simUartOf(uint8_t idx);
+static uint8_t simUartRts(simUart_t *pU);
+static void simUartTxWrite(simUart_t *pU, uint8_t val);
+static void simUartTxStart(simUart_t *pU);
+static void simUartTxDone(void *arg);
+static void simUartRxNext(simUart_t *pU);
+static void simUartRxDone(void *arg);
+static void simUartRxByte(simUart_t *pU, uint8_t val);
+static void simUartFlush(simUart_t *pU);
+static void simUartCsr(simUart_t *pU);
+
+static void simDmaArm(uint8_t ch);
+static void simDmaTrig(uint8_t trig);
+static void simDmaTrigCh(uint8_t ch);
+static void simDmaEvt(void *arg);
+static void simDmaXfer(uint8_t ch);
+static int simDmaReg(uintptr_t addr);
+static uint8_t *simDmaMem(uintptr_t addr, uint8_t write);
+static uint8_t simRegRead(uint8_t idx);
+static void simRegWrite(uint8_t idx, uint8_t val);
+
+static void simT1Start(void);
+static void simT1Tick(void *arg);
+
+static void simFlashCtl(uint8_t val);
+static void simFlashData(uint8_t val);
+static void simFlashWordDone(void *arg);
+static void simFlashEraseDone(void *arg);
+static void simFlashFctl(void);
+
+static void simRndCommit(uint8_t idx);
+static void simRndWrite(uint8_t idx, uint8_t val);
+
+/*********************************************************************
+ * SFR ACCESS
+ */
+
+volatile uint8_t *halSimSfr(uint8_t idx)
+{
+  simAccess(idx);
+
+  if (idx == HAL_SIM_ST0)
+  {
+    // Reading ST0 latches ST1 and ST2.
+    uint32_t st = (uint32_t)((simNow / 1000000ULL) * HAL_SIM_ST_HZ / 1000000ULL);
+
+    simSet(HAL_SIM_ST0, (uint8_t)st);
+    simSet(HAL_SIM_ST1, (uint8_t)(st >> 8));
+    simSet(HAL_SIM_ST2, (uint8_t)(st >> 16));
+  }
+
+  return (volatile uint8_t *)&simSlot[idx];
+}
+
+/*
+ * The data registers (UxDBUF, FWDATA, ENCDI) are 16-bit slots with a marker in the upper byte,
+ * so that a write is taken up even when it writes the value that a read would have returned.
+ */
+volatile uint16_t *halSimSfrData(uint8_t idx)
+{
+  uint8_t val = 0;
+  simUart_t *pU = simUartOf(idx);
+
+  simAccess(idx);
+
+  if (pU != NULL)
+  {
+    val = pU->rxData;
+  }
+  simSlot[idx] = simShadow[idx] = 0x100 | val;
+  simRead[idx] = 1;
+
+  return &simSlot[idx];
+}
+
+/*
+ * RNDL and RNDH are wider still. The CRC takes in every byte written to RNDH, whatever its value,
+ * and a read is assigned to a 16-bit variable, so the marker is above the bits that reach it.
+ */
+volatile uint32_t *halSimSfrRnd(uint8_t idx)
+{
+  uint8_t hi = (idx == HAL_SIM_RNDH);
+
+  simAccess(idx);
+  simRnd[hi] = RND_MARK | (uint8_t)(simCrc >> (8 * hi));
+
+  return &simRnd[hi];
+}
+
+static void simAccess(uint8_t idx)
+{
+  halSimCpu(HAL_SIM_SFR_CYCLES);
+  simRing[simRingIdx++ % SIM_RING_LEN] = idx + 1;
+}
+
+static void simCommitRing(void)
+{
+  for (uint8_t i = 0; i < SIM_RING_LEN; i++)
+  {
+    if (simRing[i] != 0)
+    {
+      simCommit(simRing[i] - 1);
+    }
+  }
+}
+
+static void simCommit(uint8_t idx)
+{
+  uint16_t val = simSlot[idx];
+
+  if ((idx == HAL_SIM_RNDL) || (idx == HAL_SIM_RNDH))
+  {
+    simRndCommit(idx);
+    return;
+  }
+
+  if (val != simShadow[idx])
+  {
+    uint8_t old = (uint8_t)simShadow[idx];
+
+    simShadow[idx] = val;
+    simRead[idx] = 0;
+    simWrite(idx, old, (uint8_t)val);
+  }
+  else if (simRead[idx])
+  {
+    simUart_t *pU = simUartOf(idx);
+
+    // A data register that was accessed but not written was read.
+    simRead[idx] = 0;
+    if ((pU != NULL) && pU->rxPending)
+    {
+      pU->rxPending = 0;
+      simUartCsr(pU);
+      simPins(pU->port);
+    }
+  }
+}
+
+static void simSet(uint8_t idx, uint8_t val)
+{
+  simCommit(idx);
+
+  if (simUartOf(idx) != NULL || idx == HAL_SIM_FWDATA || idx == HAL_SIM_ENCDI)
+  {
+    simSlot[idx] = simShadow[idx] = 0x100 | val;
+  }
+  else
+  {
+    simSlot[idx] = simShadow[idx] = val;
+  }
+}
+
+static void simSetBit(uint8_t idx, uint8_t bit, uint8_t val)
+{
+  uint8_t reg;
+
+  simCommit(idx);
+  reg = (uint8_t)simSlot[idx];
+  simSet(idx, val ? (reg | (1 << bit)) : (reg & ~(1 << bit)));
+}
+
+static void simWrite(uint8_t idx, uint8_t old, uint8_t val)
+{
+  simUart_t *pU;
+
+  switch (idx)
+  {
+  case HAL_SIM_P0:
+  case HAL_SIM_P1:
+  case HAL_SIM_P2:
+    simLatch[idx - HAL_SIM_P0] = val;
+    simPins(idx - HAL_SIM_P0);
+    break;
+
+  case HAL_SIM_P0DIR:
+  case HAL_SIM_P0SEL:
+  case HAL_SIM_PERCFG:
+    simPins(0);
+    break;
+
+  case HAL_SIM_P1DIR:
+  case HAL_SIM_P1SEL:
+    simPins(1);
+    break;
+
+  case HAL_SIM_P2DIR:
+    simPins(2);
+    break;
+
+  case HAL_SIM_P0IFG:
+  case HAL_SIM_P1IFG:
+  case HAL_SIM_P2IFG:
+    simSet(idx, old & val);  // Writing a 1 has no effect.
+    break;
+
+  case HAL_SIM_DMAIRQ:
+    simSet(idx, old & val);
+    break;
+
+  case HAL_SIM_U0CSR:
+  case HAL_SIM_U1CSR:
+    pU = &simUart[idx == HAL_SIM_U1CSR];
+    simSet(idx, (val & ~CSR_ACTIVE) | (old & CSR_ACTIVE));
+    simUartRxNext(pU);
+    break;
+
+  case HAL_SIM_U0UCR:
+  case HAL_SIM_U1UCR:
+    pU = &simUart[idx == HAL_SIM_U1UCR];
+    if (val & UCR_FLUSH)
+    {
+      simSet(idx, val & ~UCR_FLUSH);
+      simUartFlush(pU);
+    }
+    simPins(pU->port);
+    simUartTxStart(pU);
+    simUartRxNext(pU);
+    break;
+
+  case HAL_SIM_U0DBUF:
+  case HAL_SIM_U1DBUF:
+    simUartTxWrite(simUartOf(idx), val);
+    break;
+
+  case HAL_SIM_DMAARM:
+    if (val & 0x80)
+    {
+      simSet(idx, old & ~val & 0x1F);
+    }
+    else
+    {
+      simSet(idx, old | (val & 0x1F));
+      for (uint8_t ch = 0; ch < 5; ch++)
+      {
+        if ((val & ~old) & (1 << ch))
+        {
+          simDmaArm(ch);
+        }
+      }
+    }
+    break;
+
+  case HAL_SIM_DMAREQ:
+    // A request stands until its channel is served.
+    simSet(idx, (old | val) & (uint8_t)simSlot[HAL_SIM_DMAARM] & 0x1F);
+    for (uint8_t ch = 0; ch < 5; ch++)
+    {
+      if (val & (1 << ch))
+      {
+        simDmaTrigCh(ch);
+      }
+    }
+    break;
+
+  case HAL_SIM_T1CTL:
+    simT1Start();
+    break;
+
+  case HAL_SIM_T1CNTL:
+    simT1Cnt = 0;  // Any write clears the counter.
+    simSet(HAL_SIM_T1CNTL, 0);
+    simSet(HAL_SIM_T1CNTH, 0);
+    break;
+
+  case HAL_SIM_T1STAT:
+    simSet(idx, old & val);  // Writing a 1 has no effect.
+    break;
+
+  case HAL_SIM_FCTL:
+    simFlashCtl(val);
+    break;
+
+  case HAL_SIM_FWDATA:
+    simFlashData(val);
+    break;
+
+  case HAL_SIM_CLKCONCMD:
+    simSet(HAL_SIM_CLKCONSTA, val);  // The oscillators are stable at once.
+    break;
+
+  default:
+    break;
+  }
+}
+
+/*********************************************************************
+ * CLOCK AND INTERRUPTS
+ */
+
+void halSimInit(void)
+{
+  memset((void *)simSlot, 0, sizeof(simSlot));
+  memset(simShadow, 0, sizeof(simShadow));
+  memset(simRead, 0, sizeof(simRead));
+  memset(simRing, 0, sizeof(simRing));
+  simRnd[0] = simRnd[1] = RND_MARK;
+  simCrc = 0;
+  memset(simDma, 0, sizeof(simDma));
+  memset(simUart, 0, sizeof(simUart));
+  memset(&simFl, 0, sizeof(simFl));
+  simT1Cnt = 0;
+  simT1Gen++;
+  memset(&halSimStats, 0, sizeof(halSimStats));
+  memset(halSimFlash, 0xFF, sizeof(halSimFlash));
+  simNow = 0;
+  simEvtCnt = 0;
+  simIsr = 0;
+
+  for (uint8_t p = 0; p < 3; p++)
+  {
+    simLatch[p] = simPinExt[p] = simPinLvl[p] = 0xFF;
+    simSlot[simPortSfr[p]] = simShadow[simPortSfr[p]] = 0xFF;
+  }
+
+  for (uint8_t u = 0; u < 2; u++)
+  {
+    simUart_t *pU = &simUart[u];
+
+    pU->csr = u ? HAL_SIM_U1CSR : HAL_SIM_U0CSR;
+    pU->ucr = u ? HAL_SIM_U1UCR : HAL_SIM_U0UCR;
+    pU->gcr = u ? HAL_SIM_U1GCR : HAL_SIM_U0GCR;
+    pU->baud = u ? HAL_SIM_U1BAUD : HAL_SIM_U0BAUD;
+    pU->dbuf = u ? HAL_SIM_U1DBUF : HAL_SIM_U0DBUF;
+    // USART 0 at Alt. 1 on P0 and USART 1 at Alt. 2 on P1: CT/SSN on pin 4, RT on pin 5.
+    pU->port = u;
+    pU->ctBit = pU->ssnBit = 4;
+    pU->rtBit = 5;
+    pU->urxFlag = HAL_SIM_TCON;
+    pU->urxBit = u ? 7 : 3;
+    pU->utxFlag = HAL_SIM_IRCON2;
+    pU->utxBit = u ? 2 : 1;
+    pU->urxTrig = u ? DMA_TRIG_URX1 : DMA_TRIG_URX0;
+    pU->utxTrig = u ? DMA_TRIG_UTX1 : DMA_TRIG_UTX0;
+    simSlot[pU->dbuf] = simShadow[pU->dbuf] = 0x100;
+  }
+  simSlot[HAL_SIM_FWDATA] = simShadow[HAL_SIM_FWDATA] = 0x100;
+  simSlot[HAL_SIM_ENCDI] = simShadow[HAL_SIM_ENCDI] = 0x100;
+  simSlot[HAL_SIM_CHVER] = simShadow[HAL_SIM_CHVER] = 0x21;
+  simSlot[HAL_SIM_SLEEPSTA] = simShadow[HAL_SIM_SLEEPSTA] = 0x40;  // XOSC stable.
+}
+
+void halSimSetVector(uint8_t vec, void (*isr)(void))
+{
+  simVector[vec] = isr;
+}
+
+void halSimDmaDesc(uint8_t set, void *pDesc)
+{
+  simDesc[set] = (simDesc_t *)pDesc;
+}
+
+void halSimResetHook(void (*fn)(void))
+{
+  simResetFn = fn;
+}
+
+void halSimReset(void)
+{
+  if (simResetFn == NULL)
+  {
+    fprintf(stderr, "hal_sim: HAL_SYSTEM_RESET() at %.3f ms\n", simNow / 1e9);
+    exit(2);
+  }
+  simResetFn();
+}
+
+uint64_t halSimTime(void)
+{
+  return simNow;
+}
+
+uint8_t halSimInIsr(void)
+{
+  return simIsr;
+}
+
+void halSimNop(void)
+{
+  halSimCpu(1);
+}
+
+void halSimCpu(uint32_t cycles)
+{
+  simCommitRing();  // Nothing runs before the writes so far are taken up.
+  simDispatch();
+  simRunTo(simNow + cycles * HAL_SIM_PS_PER_CYCLE);
+}
+
+void halSimRun(uint64_t ps)
+{
+  simCommitRing();
+  simDispatch();
+  simRunTo(simNow + ps);
+}
+
+void halSimAt(uint64_t ps, void (*fn)(void *), void *arg)
+{
+  if (simEvtCnt == SIM_EVT_MAX)
+  {
+    fprintf(stderr, "hal_sim: event queue overflow\n");
+    exit(2);
+  }
+  simEvt[simEvtCnt].t = (ps < simNow) ? simNow : ps;
+  simEvt[simEvtCnt].seq = simSeq++;
+  simEvt[simEvtCnt].fn = fn;
+  simEvt[simEvtCnt].arg = arg;
+  simEvtCnt++;
+}
+
+static void simRunTo(uint64_t t)
+{
+  while (simEvtCnt != 0)
+  {
+    uint16_t min = 0;
+    simEvt_t evt;
+
+    for (uint16_t i = 1; i < simEvtCnt; i++)
+    {
+      if ((simEvt[i].t < simEvt[min].t) ||
+          ((simEvt[i].t == simEvt[min].t) && (simEvt[i].seq < simEvt[min].seq)))
+      {
+        min = i;
+      }
+    }
+    if (simEvt[min].t > t)
+    {
+      break;
+    }
+
+    evt = simEvt[min];
+    simEvt[min] = simEvt[--simEvtCnt];
+    if (evt.t > simNow)
+    {
+      simNow = evt.t;
+    }
+    evt.fn(evt.arg);
+
+    if (!simIsr)
+    {
+      // The time spent in an ISR is not time of the interrupted code.
+      uint64_t before = simNow;
+      simDispatch();
+      t += simNow - before;
+    }
+  }
+
+  if (t > simNow)
+  {
+    simNow = t;
+  }
+}
+
+static void simDispatch(void)
+{
+  while (!simIsr && ((uint8_t)simSlot[HAL_SIM_IEN0] & 0x80))
+  {
+    uint8_t ring[SIM_RING_LEN];
+    uint64_t start = simNow;
+    uint8_t vec;
+
+    for (vec = 0; vec < HAL_SIM_VECTOR_CNT; vec++)
+    {
+      if ((simVector[vec] != NULL) &&
+          ((uint8_t)simSlot[simIrq[vec].ien] & (1 << simIrq[vec].ienBit)) &&
+          ((uint8_t)simSlot[simIrq[vec].flag] & (1 << simIrq[vec].flagBit)))
+      {
+        break;
+      }
+    }
+    if (vec == HAL_SIM_VECTOR_CNT)
+    {
+      break;
+    }
+
+    if (simIrq[vec].autoClr)
+    {
+      simSetBit(simIrq[vec].flag, simIrq[vec].flagBit, 0);
+    }
+
+    simIsr = 1;
+    memcpy(ring, simRing, sizeof(ring));
+    memset(simRing, 0, sizeof(simRing));
+    simRunTo(simNow + (HAL_SIM_ISR_CYCLES / 2) * HAL_SIM_PS_PER_CYCLE);
+
+    simVector[vec]();
+
+    simCommitRing();
+    memcpy(simRing, ring, sizeof(ring));
+    simRunTo(simNow + (HAL_SIM_ISR_CYCLES / 2) * HAL_SIM_PS_PER_CYCLE);
+    simIsr = 0;
+
+    halSimStats.isrCnt[vec]++;
+    halSimStats.isrPs[vec] += simNow - start;
+  }
+}
+
+/*********************************************************************
+ * GPIO
+ */
+
+void halSimPinSet(uint8_t port, uint8_t pin, uint8_t level)
+{
+  if (level)
+  {
+    simPinExt[port] |= (1 << pin);
+  }
+  else
+  {
+    simPinExt[port] &= ~(1 << pin);
+  }
+  simPins(port);
+}
+
+uint8_t halSimPinGet(uint8_t port, uint8_t pin)
+{
+  return (simPinLvl[port] >> pin) & 1;
+}
+
+void halSimPinHook(void (*fn)(uint8_t port, uint8_t pin, uint8_t level))
+{
+  simPinFn = fn;
+}
+
+static void simPins(uint8_t port)
+{
+  uint8_t dir = (uint8_t)simSlot[simDirSfr[port]];
+  uint8_t lvl = (simLatch[port] & dir) | (simPinExt[port] & ~dir);
+  uint8_t chg;
+
+  if (port < 2)
+  {
+    simUart_t *pU = &simUart[port];
+    uint8_t sel = (uint8_t)simSlot[port ? HAL_SIM_P1SEL : HAL_SIM_P0SEL];
+
+    // The USART drives RT itself when the pin is selected for the peripheral in UART mode.
+    if (((uint8_t)simSlot[pU->csr] & CSR_MODE) && ((uint8_t)simSlot[pU->ucr] & UCR_FLOW) &&
+        (sel & (1 << pU->rtBit)))
+    {
+      lvl = pU->rxPending ? (lvl | (1 << pU->rtBit)) : (lvl & ~(1 << pU->rtBit));
+    }
+  }
+
+  chg = lvl ^ simPinLvl[port];
+  simPinLvl[port] = lvl;
+  simSet(simPortSfr[port], lvl);
+
+  if (chg == 0)
+  {
+    return;
+  }
+
+  for (uint8_t pin = 0; pin < 8; pin++)
+  {
+    uint8_t bit = 1 << pin;
+    uint8_t pictl = (uint8_t)simSlot[HAL_SIM_PICTL];
+    uint8_t falling;
+
+    if (!(chg & bit))
+    {
+      continue;
+    }
+
+    falling = (port == 0) ? (pictl & 0x01) : (port == 2) ? (pictl & 0x08) :
+              (pin < 4) ? (pictl & 0x02) : (pictl & 0x04);
+
+    if (((uint8_t)simSlot[simIenSfr[port]] & bit) && ((falling != 0) == !(lvl & bit)))
+    {
+      simSet(simIfgSfr[port], (uint8_t)simSlot[simIfgSfr[port]] | bit);
+      if (port == 0)
+      {
+        simSetBit(HAL_SIM_IRCON, 5, 1);
+      }
+      else if (port == 1)
+      {
+        simSetBit(HAL_SIM_IRCON2, 3, 1);
+      }
+      else
+      {
+        simSetBit(HAL_SIM_IRCON2, 0, 1);
+      }
+    }
+
+    if (port < 2)
+    {
+      simUart_t *pU = &simUart[port];
+
+      if (pin == pU->ctBit)
+      {
+        simUartTxStart(pU);
+      }
+      else if (pin == pU->rtBit)
+      {
+        simUartRxNext(pU);
+      }
+    }
+
+    if (simPinFn != NULL)
+    {
+      simPinFn(port, pin, (lvl & bit) != 0);
+    }
+  }
+}
+
+/*********************************************************************
+ * USART
+ */
+
+void halSimUartPeer(uint8_t port, const halSimUartPeer_t *pPeer)
+{
+  simUart[port].peer = pPeer;
+}
+
+void halSimUartKick(uint8_t port)
+{
+  simUartRxNext(&simUart[port]);
+}
+
+uint64_t halSimUartByteTime(uint8_t port)
+{
+  simUart_t *pU = &simUart[port];
+  uint8_t ucr = (uint8_t)simSlot[pU->ucr];
+  uint8_t e = (uint8_t)simSlot[pU->gcr] & 0x1F;
+  double baud = (256.0 + (uint8_t)simSlot[pU->baud]) * (double)(1UL << e) / 268435456.0 *
+                HAL_SIM_CPU_HZ;
+  uint8_t bits = 10 + ((ucr & UCR_BIT9) ? 1 : 0) + ((ucr & UCR_SPB) ? 1 : 0);
+
+  return (uint64_t)(bits * 1e12 / baud);
+}
+
+static simUart_t *simUartOf(uint8_t idx)
+{
+  if (idx == HAL_SIM_U0DBUF)
+  {
+    return &simUart[0];
+  }
+  if (idx == HAL_SIM_U1DBUF)
+  {
+    return &simUart[1];
+  }
+  return NULL;
+}
+
+static uint8_t simUartMode(simUart_t *pU)
+{
+  return (uint8_t)simSlot[pU->csr] & CSR_MODE;
+}
+
+// The level of the target's ready-to-receive output as the peer sees it: 1 for asserted.
+static uint8_t simUartRts(simUart_t *pU)
+{
+  if (!((uint8_t)simSlot[pU->ucr] & UCR_FLOW))
+  {
+    return 1;
+  }
+  return !(simPinLvl[pU->port] & (1 << pU->rtBit));
+}
+
+static void simUartCsr(simUart_t *pU)
+{
+  uint8_t csr = (uint8_t)simSlot[pU->csr] & ~(CSR_ACTIVE | CSR_RX_BYTE);
+
+  if (pU->txBusy || pU->rxBusy)
+  {
+    csr |= CSR_ACTIVE;
+  }
+  if (pU->rxPending)
+  {
+    csr |= CSR_RX_BYTE;
+  }
+  simSet(pU->csr, csr);
+}
+
+static void simUartFlush(simUart_t *pU)
+{
+  pU->gen++;
+  pU->txFull = pU->txBusy = 0;
+  pU->rxBusy = pU->rxPending = 0;
+  simUartCsr(pU);
+}
+
+static void simUartTxWrite(simUart_t *pU, uint8_t val)
+{
+  if (!simUartMode(pU))
+  {
+    pU->spiOut = val;
+    return;
+  }
+
+  pU->txBuf = val;
+  pU->txFull = 1;
+  simUartTxStart(pU);
+}
+
+static void simUartTxStart(simUart_t *pU)
+{
+  if (pU->txBusy || !pU->txFull || !simUartMode(pU))
+  {
+    return;
+  }
+  if (((uint8_t)simSlot[pU->ucr] & UCR_FLOW) && (simPinLvl[pU->port] & (1 << pU->ctBit)))
+  {
+    return;  // CTS is de-asserted: the byte waits in the buffer.
+  }
+
+  pU->txShift = pU->txBuf;
+  pU->txFull = 0;
+  pU->txBusy = 1;
+  simUartCsr(pU);
+  halSimAt(simNow + halSimUartByteTime(pU == &simUart[1]), simUartTxDone,
+           (void *)(uintptr_t)(((uintptr_t)pU->gen << 1) | (pU == &simUart[1])));
+
+  // The buffer is free as soon as the shifting starts.
+  simSetBit(pU->utxFlag, pU->utxBit, 1);
+  simDmaTrig(pU->utxTrig);
+}
+
+static void simUartTxDone(void *arg)
+{
+  simUart_t *pU = &simUart[(uintptr_t)arg & 1];
+
+  if (((uintptr_t)arg >> 1) != (pU->gen & (UINTPTR_MAX >> 1)))
+  {
+    return;
+  }
+
+  pU->txBusy = 0;
+  simSet(pU->csr, (uint8_t)simSlot[pU->csr] | CSR_TX_BYTE);
+  simUartCsr(pU);
+
+  if (pU->peer != NULL)
+  {
+    pU->peer->rx(pU == &simUart[1], pU->txShift);
+  }
+  simUartTxStart(pU);
+}
+
+static void simUartRxNext(simUart_t *pU)
+{
+  int byte;
+
+  if (pU->rxBusy || (pU->peer == NULL) || !simUartMode(pU) ||
+      !((uint8_t)simSlot[pU->csr] & CSR_RE))
+  {
+    return;
+  }
+
+  byte = pU->peer->tx(pU == &simUart[1], simUartRts(pU));
+  if (byte < 0)
+  {
+    return;
+  }
+
+  pU->rxShift = (uint8_t)byte;
+  pU->rxBusy = 1;
+  simUartCsr(pU);
+  halSimAt(simNow + halSimUartByteTime(pU == &simUart[1]), simUartRxDone,
+           (void *)(uintptr_t)(((uintptr_t)pU->gen << 1) | (pU == &simUart[1])));
+}
+
+static void simUartRxDone(void *arg)
+{
+  simUart_t *pU = &simUart[(uintptr_t)arg & 1];
+
+  if (((uintptr_t)arg >> 1) != (pU->gen & (UINTPTR_MAX >> 1)))
+  {
+    return;
+  }
+
+  pU->rxBusy = 0;
+  simUartRxByte(pU, pU->rxShift);
+  simUartRxNext(pU);
+}
+
+static void simUartRxByte(simUart_t *pU, uint8_t val)
+{
+  if (!((uint8_t)simSlot[pU->csr] & CSR_RE))
+  {
+    simUartCsr(pU);
+    return;
+  }
+
+  if (pU->rxPending)
+  {
+    halSimStats.rxLost[pU == &simUart[1]]++;
+  }
+  pU->rxData = val;
+  pU->rxPending = 1;
+  simUartCsr(pU);
+  simPins(pU->port);
+
+  simSetBit(pU->urxFlag, pU->urxBit, 1);
+  simDmaTrig(pU->urxTrig);
+}
+
+int halSimSpiXfer(uint8_t port, uint8_t mosi)
+{
+  simUart_t *pU = &simUart[port];
+  uint8_t miso;
+
+  if (simUartMode(pU) || !((uint8_t)simSlot[pU->csr] & CSR_SLAVE) ||
+      (simPinLvl[pU->port] & (1 << pU->ssnBit)))
+  {
+    return -1;
+  }
+
+  miso = pU->spiOut;
+  simUartRxByte(pU, mosi);
+  simSetBit(pU->utxFlag, pU->utxBit, 1);
+  simDmaTrig(pU->utxTrig);
+
+  return miso;
+}
+
+/*********************************************************************
+ * DMA
+ */
+
+static void simDmaArm(uint8_t ch)
+{
+  simDesc_t *pD = (ch == 0) ? simDesc[0] : ((simDesc[1] != NULL) ? simDesc[1] + (ch - 1) : NULL);
+  simDma_t *pC = &simDma[ch];
+
+  if (pD == NULL)
+  {
+    fprintf(stderr, "hal_sim: DMA channel %u armed without a descriptor\n", ch);
+    exit(2);
+  }
+
+  // The channel takes its configuration from the descriptor when armed.
+  pC->src = pD->srcAddr;
+  pC->dst = pD->dstAddr;
+  pC->len = (uint16_t)(((pD->xferLenV & 0x1F) << 8) | pD->xferLenL);
+  pC->ctrlA = pD->ctrlA;
+  pC->ctrlB = pD->ctrlB;
+  pC->cnt = 0;
+
+  if ((pD->xferLenV >> 5) != 0)
+  {
+    fprintf(stderr, "hal_sim: DMA channel %u VLEN mode is not modelled\n", ch);
+    exit(2);
+  }
+}
+
+static void simDmaTrig(uint8_t trig)
+{
+  for (uint8_t ch = 0; ch < 5; ch++)
+  {
+    if ((simDma[ch].ctrlA & 0x1F) == trig)
+    {
+      simDmaTrigCh(ch);
+    }
+  }
+}
+
+// A trigger is served a few cycles later, after the access that raised it, as by the hardware;
+// the write of a transfer into UxDBUF may itself raise the next trigger of the same channel.
+static void simDmaTrigCh(uint8_t ch)
+{
+  if ((uint8_t)simSlot[HAL_SIM_DMAARM] & (1 << ch))
+  {
+    halSimAt(simNow + DMA_TRIG_CYCLES * HAL_SIM_PS_PER_CYCLE, simDmaEvt, (void *)(uintptr_t)ch);
+  }
+}
+
+static void simDmaEvt(void *arg)
+{
+  uint8_t ch = (uint8_t)(uintptr_t)arg;
+
+  if ((uint8_t)simSlot[HAL_SIM_DMAARM] & (1 << ch))
+  {
+    simSet(HAL_SIM_DMAREQ, (uint8_t)simSlot[HAL_SIM_DMAREQ] & ~(1 << ch));
+    simDmaXfer(ch);
+  }
+}
+
+static void simDmaXfer(uint8_t ch)
+{
+  simDma_t *pC = &simDma[ch];
+  uint8_t word = (pC->ctrlA & 0x80) != 0;
+  uint8_t tmode = (pC->ctrlA >> 5) & 0x03;
+  uint16_t cnt = (tmode & 0x01) ? pC->len : 1;  // Block or single.
+  static const int8_t inc[4] = { 0, 1, 2, -1 };
+
+  while (cnt-- && (pC->cnt < pC->len))
+  {
+    for (uint8_t b = 0; b <= word; b++)
+    {
+      int sReg = simDmaReg(pC->src + b);
+      int dReg = simDmaReg(pC->dst + b);
+      uint8_t val = (sReg >= 0) ? simRegRead((uint8_t)sReg) : *simDmaMem(pC->src + b, 0);
+
+      if (dReg >= 0)
+      {
+        simRegWrite((uint8_t)dReg, val);
+      }
+      else
+      {
+        *simDmaMem(pC->dst + b, 1) = val;
+      }
+    }
+
+    pC->src += inc[pC->ctrlB >> 6] * (word + 1);
+    pC->dst += inc[(pC->ctrlB >> 4) & 0x03] * (word + 1);
+    pC->cnt++;
+  }
+
+  if (pC->cnt >= pC->len)
+  {
+    simSet(HAL_SIM_DMAIRQ, (uint8_t)simSlot[HAL_SIM_DMAIRQ] | (1 << ch));
+    if (pC->ctrlB & 0x08)
+    {
+      simSetBit(HAL_SIM_IRCON, 0, 1);
+    }
+
+    if (tmode & 0x02)
+    {
+      simDmaArm(ch);  // Repeated: re-armed from the descriptor.
+    }
+    else
+    {
+      simSet(HAL_SIM_DMAARM, (uint8_t)simSlot[HAL_SIM_DMAARM] & ~(1 << ch));
+    }
+  }
+}
+
+// The SFR that a DMA address is: a slot of the model, or the XDATA mapping of the SFR; -1 for
+// memory.
+static int simDmaReg(uintptr_t addr)
+{
+  static const struct
+  {
+    uint16_t xaddr;
+    uint8_t idx;
+  } xregs[] =
+  {
+    { 0x70C1, HAL_SIM_U0DBUF }, { 0x70C2, HAL_SIM_U0BAUD },
+    { 0x70F9, HAL_SIM_U1DBUF }, { 0x70FA, HAL_SIM_U1BAUD },
+    { 0x6273, HAL_SIM_FWDATA }, { 0x70AF, HAL_SIM_FWDATA },
+    { 0x70B1, HAL_SIM_ENCDI },  { 0x70B2, HAL_SIM_ENCDO },
+    { 0x70BC, HAL_SIM_RNDL },   { 0x70BD, HAL_SIM_RNDH },
+  };
+
+  if ((addr >= (uintptr_t)simSlot) && (addr < (uintptr_t)(simSlot + HAL_SIM_SFR_CNT)))
+  {
+    return (int)((addr - (uintptr_t)simSlot) / sizeof(simSlot[0]));
+  }
+
+  if ((addr >= FLASH_XDATA_MAP) && (addr < 0x10000))
+  {
+    return -1;
+  }
+
+  if (addr < 0x10000)
+  {
+    for (uint8_t i = 0; i < sizeof(xregs) / sizeof(xregs[0]); i++)
+    {
+      if (xregs[i].xaddr == addr)
+      {
+        return xregs[i].idx;
+      }
+    }
+    fprintf(stderr, "hal_sim: DMA to XDATA 0x%04X is not modelled\n", (unsigned)addr);
+    exit(2);
+  }
+
+  return -1;
+}
+
+// Host memory, or the flash bank that MEMCTR maps into the upper 32 KB of XDATA.
+static uint8_t *simDmaMem(uintptr_t addr, uint8_t write)
+{
+  if (addr < 0x10000)
+  {
+    uint32_t bank = (uint8_t)simSlot[HAL_SIM_MEMCTR] & 0x07;
+
+    if (write)
+    {
+      fprintf(stderr, "hal_sim: DMA to the flash mapped at XDATA 0x%04X\n", (unsigned)addr);
+      exit(2);
+    }
+    return &halSimFlash[(bank * FLASH_BANK_SIZE + (addr - FLASH_XDATA_MAP)) % HAL_SIM_FLASH_SIZE];
+  }
+
+  return (uint8_t *)addr;
+}
+
+static uint8_t simRegRead(uint8_t idx)
+{
+  simUart_t *pU = simUartOf(idx);
+
+  if ((idx == HAL_SIM_RNDL) || (idx == HAL_SIM_RNDH))
+  {
+    return (uint8_t)simRnd[idx == HAL_SIM_RNDH];
+  }
+
+  if (pU != NULL)
+  {
+    pU->rxPending = 0;
+    simUartCsr(pU);
+    simPins(pU->port);
+    return pU->rxData;
+  }
+
+  return (uint8_t)simSlot[idx];
+}
+
+static void simRegWrite(uint8_t idx, uint8_t val)
+{
+  uint8_t old = (uint8_t)simSlot[idx];
+
+  if ((idx == HAL_SIM_RNDL) || (idx == HAL_SIM_RNDH))
+  {
+    simRndWrite(idx, val);
+  }
+  else if (simUartOf(idx) != NULL || idx == HAL_SIM_FWDATA)
+  {
+    simWrite(idx, old, val);
+  }
+  else
+  {
+    simSet(idx, val);
+    simWrite(idx, old, val);
+  }
+}
+
+/*********************************************************************
+ * TIMER 1
+ */
+
+static uint64_t simT1TickPs(void)
+{
+  static const uint8_t div[4] = { 1, 8, 32, 128 };
+
+  return div[((uint8_t)simSlot[HAL_SIM_T1CTL] & T1CTL_DIV) >> 2] * HAL_SIM_PS_PER_CYCLE;
+}
+
+static void simT1Start(void)
+{
+  uint8_t mode = (uint8_t)simSlot[HAL_SIM_T1CTL] & T1CTL_MODE;
+
+  if (mode == 3)
+  {
+    fprintf(stderr, "hal_sim: Timer 1 up/down mode is not modelled\n");
+    exit(2);
+  }
+
+  simT1Gen++;
+  if (mode != 0)
+  {
+    halSimAt(simNow + simT1TickPs(), simT1Tick, (void *)simT1Gen);
+  }
+}
+
+// One tick of the prescaled clock: count, then flag the overflow and the compare matches.
+static void simT1Tick(void *arg)
+{
+  static const uint8_t cctl[5] =
+  {
+    HAL_SIM_T1CCTL0, HAL_SIM_T1CCTL1, HAL_SIM_T1CCTL2, HAL_SIM_T1CCTL3, HAL_SIM_T1CCTL4
+  };
+  static const uint8_t ccl[5] =
+  {
+    HAL_SIM_T1CC0L, HAL_SIM_T1CC1L, HAL_SIM_T1CC2L, HAL_SIM_T1CC3L, HAL_SIM_T1CC4L
+  };
+  static const uint8_t cch[5] =
+  {
+    HAL_SIM_T1CC0H, HAL_SIM_T1CC1H, HAL_SIM_T1CC2H, HAL_SIM_T1CC3H, HAL_SIM_T1CC4H
+  };
+  uint16_t top;
+  uint8_t flags = 0;
+  uint8_t irq = 0;
+
+  if ((uintptr_t)arg != simT1Gen)
+  {
+    return;
+  }
+
+  top = (((uint8_t)simSlot[HAL_SIM_T1CTL] & T1CTL_MODE) == 2) ?
+        (uint16_t)(((uint8_t)simSlot[HAL_SIM_T1CC0H] << 8) | (uint8_t)simSlot[HAL_SIM_T1CC0L]) :
+        0xFFFF;
+
+  if (simT1Cnt == top)
+  {
+    simT1Cnt = 0;
+    flags |= T1STAT_OVFIF;
+    irq |= ((uint8_t)simSlot[HAL_SIM_TIMIF] & TIMIF_T1OVFIM) ? 1 : 0;
+  }
+  else
+  {
+    simT1Cnt++;
+  }
+  simSet(HAL_SIM_T1CNTL, (uint8_t)simT1Cnt);
+  simSet(HAL_SIM_T1CNTH, (uint8_t)(simT1Cnt >> 8));
+
+  for (uint8_t ch = 0; ch < 5; ch++)
+  {
+    uint8_t ctl = (uint8_t)simSlot[cctl[ch]];
+    uint16_t cc = (uint16_t)(((uint8_t)simSlot[cch[ch]] << 8) | (uint8_t)simSlot[ccl[ch]]);
+
+    if ((ctl & T1CCTL_MODE) && (simT1Cnt == cc))
+    {
+      flags |= 1 << ch;
+      irq |= (ctl & T1CCTL_IM) ? 1 : 0;
+    }
+  }
+
+  if (flags)
+  {
+    simSet(HAL_SIM_T1STAT, (uint8_t)simSlot[HAL_SIM_T1STAT] | flags);
+  }
+  if (irq)
+  {
+    simSetBit(HAL_SIM_IRCON, 1, 1);
+  }
+
+  halSimAt(simNow + simT1TickPs(), simT1Tick, arg);
+}
+
+/*********************************************************************
+ * FLASH CONTROLLER
+ */
+
+static void simFlashFctl(void)
+{
+  uint8_t fctl = (uint8_t)simSlot[HAL_SIM_FCTL] & FCTL_CM;
+
+  fctl |= (simFl.busy ? FCTL_BUSY : 0) | (simFl.full ? FCTL_FULL : 0);
+  fctl |= (simFl.writing ? FCTL_WRITE : 0) | (simFl.erasing ? FCTL_ERASE : 0);
+  simSet(HAL_SIM_FCTL, fctl);
+}
+
+static void simFlashCtl(uint8_t val)
+{
+  uint32_t faddr = ((uint32_t)(uint8_t)simSlot[HAL_SIM_FADDRH] << 8) |
+                    (uint8_t)simSlot[HAL_SIM_FADDRL];
+
+  if (!simFl.busy && (val & FCTL_ERASE))
+  {
+    simFl.busy = simFl.erasing = 1;
+    simFl.addr = (faddr * 4) & ~(FLASH_PAGE_SIZE - 1UL);
+    halSimAt(simNow + FLASH_ERASE_PS, simFlashEraseDone, NULL);
+  }
+  else if (!simFl.busy && (val & FCTL_WRITE))
+  {
+    simFl.busy = simFl.writing = 1;
+    simFl.addr = faddr * 4;
+    simFl.bufCnt = 0;
+    simFl.progging = 0;
+    simFlashFctl();
+    simDmaTrig(DMA_TRIG_FLASH);  // Ask for the first word.
+  }
+  simFlashFctl();
+}
+
+static void simFlashData(uint8_t val)
+{
+  if (!simFl.writing || simFl.full)
+  {
+    return;
+  }
+
+  simFl.buf[simFl.bufCnt++] = val;
+  if (simFl.bufCnt < 4)
+  {
+    simDmaTrig(DMA_TRIG_FLASH);
+    return;
+  }
+
+  if (simFl.progging)
+  {
+    simFl.full = 1;
+    simFlashFctl();
+    return;
+  }
+
+  memcpy(simFl.prog, simFl.buf, 4);
+  simFl.bufCnt = 0;
+  simFl.progging = 1;
+  halSimAt(simNow + FLASH_WORD_PS, simFlashWordDone, NULL);
+  simDmaTrig(DMA_TRIG_FLASH);  // Ask for the next word while this one is programmed.
+}
+
+static void simFlashWordDone(void *arg)
+{
+  (void)arg;
+
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    halSimFlash[(simFl.addr + i) % HAL_SIM_FLASH_SIZE] &= simFl.prog[i];
+  }
+  simFl.addr += 4;
+  simFl.progging = 0;
+  halSimStats.flashWords++;
+
+  if (simFl.full)
+  {
+    simFl.full = 0;
+    memcpy(simFl.prog, simFl.buf, 4);
+    simFl.bufCnt = 0;
+    simFl.progging = 1;
+    halSimAt(simNow + FLASH_WORD_PS, simFlashWordDone, NULL);
+    simFlashFctl();
+    simDmaTrig(DMA_TRIG_FLASH);
+  }
+  else
+  {
+    // Nothing more was written in time: the write ends.
+    simFl.busy = simFl.writing = 0;
+    simFl.bufCnt = 0;
+    simFlashFctl();
+  }
+}
+
+static void simFlashEraseDone(void *arg)
+{
+  (void)arg;
+
+  memset(&halSimFlash[simFl.addr % HAL_SIM_FLASH_SIZE], 0xFF, FLASH_PAGE_SIZE);
+  simFl.busy = simFl.erasing = 0;
+  halSimStats.flashErases++;
+  simFlashFctl();
+}
+
+/*********************************************************************
+ * CRC OF THE RANDOM NUMBER GENERATOR
+ */
+
+// A write takes up the marker.
+static void simRndCommit(uint8_t idx)
+{
+  uint32_t val = simRnd[idx == HAL_SIM_RNDH];
+
+  if (!(val & RND_MARK))
+  {
+    simRndWrite(idx, (uint8_t)val);
+  }
+}
+
+// The LFSR in its CRC configuration: RNDL shifts in a byte of the seed, high byte first, and
+// RNDH runs a byte through CRC16 with polynomial 0x8005, most significant bit first.
+static void simRndWrite(uint8_t idx, uint8_t val)
+{
+  if (idx == HAL_SIM_RNDL)
+  {
+    simCrc = (uint16_t)((simCrc << 8) | val);
+  }
+  else
+  {
+    for (uint8_t bit = 0x80; bit != 0; bit >>= 1)
+    {
+      uint8_t fb = ((simCrc & 0x8000) != 0) != ((val & bit) != 0);
+
+      simCrc = (uint16_t)(simCrc << 1);
+      if (fb)
+      {
+        simCrc ^= RND_CRC_POLY;
+      }
+    }
+  }
+
+  simRnd[0] = RND_MARK | (uint8_t)simCrc;
+  simRnd[1] = RND_MARK | (uint8_t)(simCrc >> 8);
+}
@@ -0,0 +1,175 @@
+/**************************************************************************************************
+  Filename:       hal_sim.h
+
+  Description:
+
+  Register-level model of the CC2540 for running the HAL and boot loader sources on a Linux
+  host. Every SFR is an access function into a table of slots: each access costs CPU cycles of
+  a virtual clock, runs the peripheral events that are due and vectors to the ISRs registered
+  with HAL_ISR_FUNCTION() the way the 8051 would. Writes are taken up at the following access.
+
+  Modelled: the interrupt controller, the 5 DMA channels, USART 0 (Alt. 1) and USART 1 (Alt. 2)
+  in UART and in SPI Slave mode, the GPIO ports with edge interrupts, Timer 1 in free-running
+  and modulo mode with its compare channels, the flash controller, the flash banks that MEMCTR
+  maps into XDATA for DMA, the CRC of the random number generator, the clock switch and the
+  sleep timer. Other SFRs are plain storage.
+
+  The peer at the far end of a USART and any other stimulus run as events of the same clock.
+**************************************************************************************************/
+
+#ifndef HAL_SIM_H
+#define HAL_SIM_H
+
+#include <stdint.h>
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define HAL_SIM_CPU_HZ            32000000UL
+#define HAL_SIM_ST_HZ             32768UL
+#define HAL_SIM_FLASH_SIZE       (256UL * 1024UL)
+
+// The virtual clock runs in pico-seconds.
+#define HAL_SIM_PS_PER_CYCLE      31250ULL
+#define HAL_SIM_NS(x)            ((uint64_t)(x) * 1000ULL)
+#define HAL_SIM_US(x)            ((uint64_t)(x) * 1000000ULL)
+#define HAL_SIM_MS(x)            ((uint64_t)(x) * 1000000000ULL)
+
+// CPU cycles charged for each SFR access, which stands for the instructions around it.
+#if !defined HAL_SIM_SFR_CYCLES
+#define HAL_SIM_SFR_CYCLES        4
+#endif
+
+// CPU cycles from an interrupt request to the first instruction of its ISR and back.
+#if !defined HAL_SIM_ISR_CYCLES
+#define HAL_SIM_ISR_CYCLES        20
+#endif
+
+#define HAL_SIM_SFRS(X) \
+  X(P0)       X(P1)       X(P2)       X(P0DIR)    X(P1DIR)    X(P2DIR)    X(P0SEL)    \
+  X(P1SEL)    X(P2SEL)    X(P0INP)    X(P1INP)    X(P2INP)    X(P0IEN)    X(P1IEN)    \
+  X(P2IEN)    X(P0IFG)    X(P1IFG)    X(P2IFG)    X(PICTL)    X(PERCFG)   X(APCFG)    \
+  X(IEN0)     X(IEN1)     X(IEN2)     X(IP0)      X(IP1)      X(TCON)     X(S0CON)    \
+  X(S1CON)    X(IRCON)    X(IRCON2)   X(U0CSR)    X(U0UCR)    X(U0GCR)    X(U0BAUD)   \
+  X(U0DBUF)   X(U1CSR)    X(U1UCR)    X(U1GCR)    X(U1BAUD)   X(U1DBUF)   X(DMAARM)   \
+  X(DMAREQ)   X(DMAIRQ)   X(DMA0CFGH) X(DMA0CFGL) X(DMA1CFGH) X(DMA1CFGL) X(FCTL)     \
+  X(FADDRL)   X(FADDRH)   X(FWDATA)   X(MEMCTR)   X(FMAP)     X(ST0)      X(ST1)      \
+  X(ST2)      X(STLOAD)   X(SLEEPCMD) X(SLEEPSTA) X(CLKCONCMD) X(CLKCONSTA) X(PCON)   \
+  X(WDCTL)    X(T1CNTL)   X(T1CNTH)   X(T1CTL)    X(T1STAT)   X(T1CCTL0)  X(T1CCTL1)  \
+  X(T1CCTL2)  X(T1CCTL3)  X(T1CCTL4)  X(T1CC0L)   X(T1CC0H)   X(T1CC1L)   X(T1CC1H)   \
+  X(T1CC2L)   X(T1CC2H)   X(T1CC3L)   X(T1CC3H)   X(T1CC4L)   X(T1CC4H)   X(T3CNT)    \
+  X(T3CTL)    X(T3CCTL0)  X(T3CC0)    X(T3CCTL1)  X(T3CC1)    X(T4CNT)    X(T4CTL)    \
+  X(T4CCTL0)  X(T4CC0)    X(T4CCTL1)  X(T4CC1)    X(TIMIF)    X(ENCCS)    X(ENCDI)    \
+  X(ENCDO)    X(ADCCON1)  X(ADCCON2)  X(ADCCON3)  X(ADCL)     X(ADCH)     X(RNDL)     \
+  X(RNDH)     X(CHVER)    X(RFD)      X(RFST)
+
+#define HAL_SIM_SFR_ENUM(N)  HAL_SIM_##N,
+enum
+{
+  HAL_SIM_SFRS(HAL_SIM_SFR_ENUM)
+  HAL_SIM_SFR_CNT
+};
+
+// Interrupt vectors, numbered in the order of their natural priority.
+#define RFERR_VECTOR              0
+#define ADC_VECTOR                1
+#define URX0_VECTOR               2
+#define URX1_VECTOR               3
+#define ENC_VECTOR                4
+#define ST_VECTOR                 5
+#define P2INT_VECTOR              6
+#define UTX0_VECTOR               7
+#define DMA_VECTOR                8
+#define T1_VECTOR                 9
+#define T2_VECTOR                 10
+#define T3_VECTOR                 11
+#define T4_VECTOR                 12
+#define P0INT_VECTOR              13
+#define UTX1_VECTOR               14
+#define P1INT_VECTOR              15
+#define RF_VECTOR                 16
+#define WDT_VECTOR                17
+#define HAL_SIM_VECTOR_CNT        18
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  uint8_t b0 : 1;
+  uint8_t b1 : 1;
+  uint8_t b2 : 1;
+  uint8_t b3 : 1;
+  uint8_t b4 : 1;
+  uint8_t b5 : 1;
+  uint8_t b6 : 1;
+  uint8_t b7 : 1;
+} halSimBits_t;
+
+// The far end of a USART in UART mode. rx() gets every byte that the target shifts out; tx()
+// is asked for the next byte to shift in whenever the line is idle and returns -1 for none.
+// 'rts' is the level of the target's ready-to-receive output (1 when it asserts it).
+typedef struct
+{
+  void (*rx)(uint8_t port, uint8_t byte);
+  int (*tx)(uint8_t port, uint8_t rts);
+} halSimUartPeer_t;
+
+typedef struct
+{
+  uint32_t isrCnt[HAL_SIM_VECTOR_CNT];
+  uint64_t isrPs[HAL_SIM_VECTOR_CNT];  // Time spent in each ISR, including the entry and exit.
+  uint32_t rxLost[2];                  // Bytes received by a USART before the last one was read.
+  uint32_t flashWords;
+  uint32_t flashErases;
+} halSimStats_t;
+
+/*********************************************************************
+ * MACROS
+ */
+
+#define HAL_SIM_SFR(N)            (*halSimSfr(HAL_SIM_##N))
+#define HAL_SIM_SFR_DATA(N)       (*halSimSfrData(HAL_SIM_##N))
+#define HAL_SIM_SFR_RND(N)        (*halSimSfrRnd(HAL_SIM_##N))
+#define HAL_SIM_SBIT(N, B)        (((volatile halSimBits_t *)halSimSfr(HAL_SIM_##N))->b##B)
+
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+
+extern uint8_t halSimFlash[HAL_SIM_FLASH_SIZE];
+extern halSimStats_t halSimStats;
+
+/*********************************************************************
+ * FUNCTIONS
+ */
+
+volatile uint8_t *halSimSfr(uint8_t idx);
+volatile uint16_t *halSimSfrData(uint8_t idx);
+volatile uint32_t *halSimSfrRnd(uint8_t idx);
+
+void halSimInit(void);
+void halSimSetVector(uint8_t vec, void (*isr)(void));
+void halSimDmaDesc(uint8_t set, void *pDesc);
+void halSimReset(void);
+void halSimResetHook(void (*fn)(void));
+
+uint64_t halSimTime(void);
+void halSimCpu(uint32_t cycles);
+void halSimRun(uint64_t ps);
+void halSimAt(uint64_t ps, void (*fn)(void *), void *arg);
+uint8_t halSimInIsr(void);
+void halSimNop(void);
+
+void halSimUartPeer(uint8_t port, const halSimUartPeer_t *pPeer);
+void halSimUartKick(uint8_t port);
+uint64_t halSimUartByteTime(uint8_t port);
+int halSimSpiXfer(uint8_t port, uint8_t mosi);
+
+void halSimPinSet(uint8_t port, uint8_t pin, uint8_t level);
+uint8_t halSimPinGet(uint8_t port, uint8_t pin);
+void halSimPinHook(void (*fn)(uint8_t port, uint8_t pin, uint8_t level));
+
+#endif
@@ -0,0 +1,66 @@
+/**************************************************************************************************
+  Filename:       hal_types.h
+
+  Description:    The HAL types of Components/hal/target/CC2540EB/hal_types.h for the host build:
+                  the same widths on an LP64 host and the IAR memory attributes compiled out.
+**************************************************************************************************/
+
+#ifndef _HAL_TYPES_H
+#define _HAL_TYPES_H
+
+#include <stdint.h>
+
+/* ------------------------------------------------------------------------------------------------
+ *                                               Types
+ * ------------------------------------------------------------------------------------------------
+ */
+
+typedef int8_t          int8;
+typedef uint8_t         uint8;
+typedef int16_t         int16;
+typedef uint16_t        uint16;
+typedef int32_t         int32;
+typedef uint32_t        uint32;
+typedef unsigned char   bool;
+typedef uint8           halDataAlign_t;
+
+/* ------------------------------------------------------------------------------------------------
+ *                               Memory Attributes and Compiler Macros
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#define CODE
+#define XDATA
+#define DATA
+#define NEAR_FUNC
+
+#define __code
+#define __xdata
+#define __data
+#define __idata
+#define __near_func
+#define __no_init
+#define __interrupt
+
+extern void halSimNop(void);
+#define ASM_NOP   halSimNop()
+#define asm(x)    halSimNop()
+
+/* ------------------------------------------------------------------------------------------------
+ *                                        Standard Defines
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#ifndef NULL
+#define NULL 0
+#endif
+
+#endif
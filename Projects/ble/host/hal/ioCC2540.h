@@ -0,0 +1,13 @@
+/**************************************************************************************************
+  Filename:       ioCC2540.h
+
+  Description:    The IAR register header for the host build: the SFRs are the slots of the
+                  register model, see hal_mcu.h.
+**************************************************************************************************/
+
+#ifndef IOCC2540_H
+#define IOCC2540_H
+
+#include "hal_mcu.h"
+
+#endif
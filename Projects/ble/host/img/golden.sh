@@ -0,0 +1,62 @@
+#!/bin/sh
+##################################################################################################
+#  Golden images of cc254x_img_tool, one for each boot loader, with the dummy key:
+#
+#    oad.bin      oad_in.bin stamped with -v 0x0002 -u 42535732, CRC 38F2; the tool pads the
+#                 half page of oad_in.bin to the one page of its header.
+#    boad.bin     boad_in.bin with -v 0x0002 -n 000102030405060708090A0B, signature
+#                 0d0b31f4fe494fd75bcb6af8e40ba7bc.
+#    ubl.bin      ubl_in.bin, CRC 7720.
+#    ubl_sec.bin  ubl_in.bin with -e -n 00112233445566778899, CRC 7720, signature
+#                 208c4c8044a54eee0659c880c1f60895.
+#    sbl.bin      sbl_in.bin, CRC 0863.
+#
+#  The signatures were checked against OpenSSL AES-128 CTR and CBC when the images were made;
+#  img_crc checks the OAD and SBL CRCs against the BIM and the SBL. Each input is stamped again
+#  and must give its golden image byte for byte, each golden image must pass "check", and with
+#  one byte flipped must fail it.
+#
+#    sh golden.sh <cc254x_img_tool> <scratch dir>
+##################################################################################################
+
+set -e
+
+TOOL=$1
+DIR=$(dirname "$0")
+OUT=$2
+FAILS=0
+
+mkdir -p "$OUT"
+
+# $1 variant and options, $2 input, $3 golden image, $4 its CRC, $5 offset of the byte to flip
+golden()
+{
+  opts=$1
+
+  if ! $TOOL $opts "$DIR/$2" "$OUT/$3" | grep -q "CRC $4\$" || ! cmp -s "$DIR/$3" "$OUT/$3"; then
+    echo "$3: not the golden image"
+    FAILS=$((FAILS + 1))
+  fi
+
+  if ! $TOOL check $opts "$DIR/$3" > /dev/null 2>&1; then
+    $TOOL check $opts "$DIR/$3" || true
+    FAILS=$((FAILS + 1))
+  fi
+
+  cp "$DIR/$3" "$OUT/bad_$3"
+  val=$(od -An -tu1 -j "$5" -N1 "$DIR/$3")
+  printf "\\$(printf %o $((val ^ 1)))" | dd of="$OUT/bad_$3" bs=1 seek="$5" conv=notrunc 2>/dev/null
+  if $TOOL check $opts "$OUT/bad_$3" > /dev/null 2>&1; then
+    echo "bad_$3: passes check with byte $5 flipped"
+    FAILS=$((FAILS + 1))
+  fi
+}
+
+golden "oad -v 0x0002 -u 42535732" oad_in.bin oad.bin 38F2 512
+golden "boad -v 0x0002 -n 000102030405060708090A0B" boad_in.bin boad.bin 5A5A 2048
+golden "ubl" ubl_in.bin ubl.bin 7720 256
+golden "ubl -e -n 00112233445566778899" ubl_in.bin ubl_sec.bin 7720 2304
+golden "sbl" sbl_in.bin sbl.bin 0863 512
+
+if [ $FAILS -eq 0 ]; then echo "PASS"; else echo "FAIL"; fi
+[ $FAILS -eq 0 ]
@@ -0,0 +1,293 @@
+/**************************************************************************************************
+  Filename:       img_crc.c
+
+  Description:
+
+  Checks the CRCs that cc254x_img_tool puts in OAD and SBL images against the boot loaders that
+  check them: crcCalcDMA() of bim_main.c (through oad_bim.c, on the CRC of the random number
+  generator and the DMA of hal_sim.c) and calcCRC() of sbl_exec.c (included here), each run over
+  the image as it lies in flash:
+
+    img_crc <cc254x_img_tool> <golden image dir> <scratch dir>
+
+  An OAD image is placed at Image-B, or at Image-A with the pages past the Image-B start moved
+  past its area as the BIM reads them, on a flash of 0xFF; an SBL image at HAL_SBL_IMG_BEG with
+  the rest of the image area erased, as SBL_STREAM_CMD leaves it. Each image is one of img/, as
+  golden.sh checks it byte for byte, or a random one of a given length stamped by the tool for
+  the run. Fails unless the CRC in every image is the one the boot loader calculates.
+**************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal_flash.h"
+#include "hal_mcu.h"
+#include "hal_types.h"
+#include "sbl_app.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// As in bim_main.c and cc254x_img_tool.c.
+#define BIM_IMG_A_PAGE            1
+#define BIM_IMG_B_PAGE            8
+#define BIM_IMG_B_AREA           (124 - 62)
+#define OAD_LEN_OSET              6
+
+#define SBL_IMG_BYTES            ((HAL_SBL_IMG_END - HAL_SBL_IMG_BEG) * HAL_FLASH_WORD_SIZE)
+#define SBL_CRC_OSET             ((HAL_SBL_IMG_CRC - HAL_SBL_IMG_BEG) * HAL_FLASH_WORD_SIZE)
+
+enum { CRC_OAD, CRC_SBL };
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  const char *name;
+  uint8 var;
+  const char *golden;             // an image of img/, or NULL for a random one stamped here
+  uint32 len;                     // bytes of a random image
+  uint8 page;                     // first page of an OAD image
+} crcScenario_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static const crcScenario_t scenarios[] =
+{
+  { "oad golden",      CRC_OAD, "oad.bin",        0, BIM_IMG_B_PAGE },
+  { "oad B 1 page",    CRC_OAD, NULL,          2048, BIM_IMG_B_PAGE },
+  { "oad B area",      CRC_OAD, NULL,  BIM_IMG_B_AREA * 2048UL, BIM_IMG_B_PAGE },
+  { "oad A 7 pages",   CRC_OAD, NULL,  7 * 2048UL,   BIM_IMG_A_PAGE },
+  { "oad A 20 pages",  CRC_OAD, NULL, 20 * 2048UL,   BIM_IMG_A_PAGE },
+  { "sbl golden",      CRC_SBL, "sbl.bin",        0, 0 },
+  { "sbl 1K",          CRC_SBL, NULL,          1024, 0 },
+  { "sbl 64K",         CRC_SBL, NULL,   64 * 1024UL, 0 },
+  { "sbl area",        CRC_SBL, NULL,  SBL_IMG_BYTES, 0 },
+};
+
+static const char *tool, *goldenDir, *scratchDir;
+static uint8 fails;
+
+static uint8 img[HAL_SIM_FLASH_SIZE];
+static uint32 imgLen;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+uint16 bimCrcCalc(uint8 page);
+
+/*********************************************************************
+ * HOST STUBS
+ */
+
+void HalFlashRead(uint8 pg, uint16 offset, uint8 *buf, uint16 cnt)
+{
+  memcpy(buf, &halSimFlash[(uint32)pg * HAL_FLASH_PAGE_SIZE + offset], cnt);
+}
+
+// Neither CRC writes to flash; these only complete the boot loaders.
+void HalFlashWrite(uint16 addr, uint8 *buf, uint16 cnt)
+{
+  memcpy(&halSimFlash[(uint32)addr * HAL_FLASH_WORD_SIZE], buf, cnt * HAL_FLASH_WORD_SIZE);
+}
+
+void HalFlashWriteStart(uint16 addr, uint8 *buf, uint16 cnt)
+{
+  HalFlashWrite(addr, buf, cnt);
+}
+
+void HalFlashErase(uint8 pg)
+{
+  memset(&halSimFlash[(uint32)pg * HAL_FLASH_PAGE_SIZE], 0xFF, HAL_FLASH_PAGE_SIZE);
+}
+
+uint16 HalUARTRead(uint8 port, uint8 *pBuffer, uint16 length)
+{
+  (void)port;
+  (void)pBuffer;
+  (void)length;
+  return 0;
+}
+
+uint16 HalUARTWrite(uint8 port, uint8 *pBuffer, uint16 length)
+{
+  (void)port;
+  (void)pBuffer;
+  return length;
+}
+
+void halAssertHandler(void)
+{
+  fprintf(stderr, "img_crc: HAL_ASSERT failed\n");
+  exit(2);
+}
+
+/*********************************************************************
+ * THE SERIAL BOOT LOADER
+ */
+
+#include "sbl_exec.c"
+
+/*********************************************************************
+ * CHECK
+ */
+
+static uint8 fileRead(const char *path, uint8 *buf, uint32 size, uint32 *pLen)
+{
+  FILE *f = fopen(path, "rb");
+
+  if (f == NULL)
+  {
+    return FALSE;
+  }
+  *pLen = (uint32)fread(buf, 1, size, f);
+  fclose(f);
+  return (*pLen != 0);
+}
+
+// A random image of 'len' bytes, with an OAD header for the BIM, stamped by the tool.
+static uint8 imgStamp(const crcScenario_t *sc)
+{
+  char inPath[256], outPath[256], cmd[1024], line[256];
+  uint32 rnd = 0x2545F491 ^ sc->len;
+  FILE *f;
+  unsigned crc = 0x10000;
+
+  for (uint32 i = 0; i < sc->len; i++)
+  {
+    rnd ^= rnd << 13;
+    rnd ^= rnd >> 17;
+    rnd ^= rnd << 5;
+    img[i] = (uint8)rnd;
+  }
+  if (sc->var == CRC_OAD)
+  {
+    img[OAD_LEN_OSET] = LO_UINT16(sc->len / HAL_FLASH_WORD_SIZE);
+    img[OAD_LEN_OSET + 1] = HI_UINT16(sc->len / HAL_FLASH_WORD_SIZE);
+  }
+
+  snprintf(inPath, sizeof(inPath), "%s/crc_in.bin", scratchDir);
+  snprintf(outPath, sizeof(outPath), "%s/crc_out.bin", scratchDir);
+  if (((f = fopen(inPath, "wb")) == NULL) || (fwrite(img, 1, sc->len, f) != sc->len) ||
+      (fclose(f) != 0))
+  {
+    printf("FAIL %s: cannot write %s\n", sc->name, inPath);
+    return FALSE;
+  }
+
+  snprintf(cmd, sizeof(cmd), "%s %s %s %s", tool, (sc->var == CRC_OAD) ? "oad" : "sbl",
+           inPath, outPath);
+  if ((f = popen(cmd, "r")) != NULL)
+  {
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+      char *pCrc = strstr(line, "CRC ");
+
+      if (pCrc != NULL)
+      {
+        sscanf(pCrc + 4, "%x", &crc);
+      }
+    }
+    if (pclose(f) != 0)
+    {
+      crc = 0x10000;
+    }
+  }
+  if ((crc > 0xFFFF) || !fileRead(outPath, img, sizeof(img), &imgLen))
+  {
+    printf("FAIL %s: no image from %s\n", sc->name, cmd);
+    return FALSE;
+  }
+  if (crc != BUILD_UINT16(img[(sc->var == CRC_OAD) ? 0 : SBL_CRC_OSET],
+                          img[(sc->var == CRC_OAD) ? 1 : SBL_CRC_OSET + 1]))
+  {
+    printf("FAIL %s: CRC %04X printed, not the one in %s\n", sc->name, crc, outPath);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static void runScenario(const crcScenario_t *sc)
+{
+  uint16 crc, fw;
+
+  if (sc->golden != NULL)
+  {
+    char path[256];
+
+    snprintf(path, sizeof(path), "%s/%s", goldenDir, sc->golden);
+    if (!fileRead(path, img, sizeof(img), &imgLen))
+    {
+      printf("FAIL %s: cannot read %s\n", sc->name, path);
+      fails++;
+      return;
+    }
+  }
+  else if (!imgStamp(sc))
+  {
+    fails++;
+    return;
+  }
+
+  halSimInit();
+
+  if (sc->var == CRC_OAD)
+  {
+    for (uint32 pg = 0; pg < (imgLen + HAL_FLASH_PAGE_SIZE - 1) / HAL_FLASH_PAGE_SIZE; pg++)
+    {
+      uint32 dst = sc->page + pg;
+
+      if ((sc->page == BIM_IMG_A_PAGE) && (dst >= BIM_IMG_B_PAGE))
+      {
+        dst += BIM_IMG_B_AREA;
+      }
+      memcpy(&halSimFlash[dst * HAL_FLASH_PAGE_SIZE], &img[pg * HAL_FLASH_PAGE_SIZE],
+             (imgLen - pg * HAL_FLASH_PAGE_SIZE < HAL_FLASH_PAGE_SIZE) ?
+             imgLen - pg * HAL_FLASH_PAGE_SIZE : HAL_FLASH_PAGE_SIZE);
+    }
+    crc = BUILD_UINT16(img[0], img[1]);
+    fw = bimCrcCalc(sc->page);
+  }
+  else
+  {
+    memcpy(&halSimFlash[HAL_SBL_IMG_BEG * HAL_FLASH_WORD_SIZE], img, imgLen);
+    crc = BUILD_UINT16(img[SBL_CRC_OSET], img[SBL_CRC_OSET + 1]);
+    fw = calcCRC();
+  }
+
+  printf("%-16s %7u   %04X   %04X\n", sc->name, imgLen, crc, fw);
+  if (crc != fw)
+  {
+    printf("FAIL %s: the image holds CRC %04X, the boot loader calculates %04X\n",
+           sc->name, crc, fw);
+    fails++;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 4)
+  {
+    fprintf(stderr, "usage: img_crc <cc254x_img_tool> <golden image dir> <scratch dir>\n");
+    return 2;
+  }
+  tool = argv[1];
+  goldenDir = argv[2];
+  scratchDir = argv[3];
+
+  printf("%-16s %7s %6s %6s\n", "image", "bytes", "tool", "loader");
+  for (uint8 i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+  {
+    runScenario(&scenarios[i]);
+  }
+
+  printf("%s\n", fails ? "FAIL" : "PASS");
+  return fails ? 1 : 0;
+}
@@ -0,0 +1,1221 @@
+/**************************************************************************************************
+  Filename:       oad_bench.c
+
+  Description:
+
+  Runs the OAD target of Projects/ble/Profiles/OAD (oad_target.c, included here, built with
+  FEATURE_OAD_BIM as Image-A or as Image-B) on the register model of hal_sim.c, against a
+  client that writes the Image Identify and Image Block characteristics the way the OAD
+  manager would:
+
+    oad_bench         Blocks, requests and repeated requests of each download.
+    oad_bench -t      Test. Fails unless every check below holds.
+
+  With OAD_CODED_IMAGES the target also takes coded images, and the downloads below follow
+  each of the above:
+
+    oad_bench [-t] -c <cc254x_oad_code> <image dir>
+
+  <image dir> holds binaries of firmware hex files of the repo. The bench sets an OAD header
+  over their first 16 bytes, saves the image and the running image next to them, has
+  cc254x_oad_code code the one against the other and sends the stream it makes with the Image
+  Identify it prints. The checks are those below, on the decoded image; x in the results is
+  the ratio of image blocks to blocks sent.
+
+  The client enables both notifications and writes the Image Identify with its window size.
+  For each block request it then writes the blocks that the request names as missing, in
+  order, backwards or shuffled; with a window of 0 it writes the one block requested. A block
+  is lost by not writing it, the first time only. When no request follows, the client writes
+  the 2-byte block number to have the request repeated, as it would after its timeout, or
+  writes the block requested again with a window of 0.
+
+  Once the target has reset, the BIM of Projects/ble/util/BIM (bim_main.c, built in oad_bim.c)
+  boots from the same flash.
+
+  Checks of the test:
+    - Every request names the first block the client has not delivered and, in a window, the
+      window size and exactly the blocks of the window not delivered. The target drops the
+      blocks of the first window until block 0 is in, which the client takes into account.
+    - Every block is written to flash once and every page of the image erased once.
+    - The target resets once the last block is in, and the image is in the download area as
+      sent, with its CRC shadow set. Image-B downloads into Image-A around the Image-B area.
+    - The running CRC of the target, its crcCalcDLDMA() over the download area and the
+      crcCalcDMA() of the BIM all equal the CRC of the image as sent, a byte at a time.
+    - The BIM runs the new image, or the running one if the CRC in the new image is wrong; the
+      target does not reset then, and the BIM marks a wrong Image-B as failed.
+    - Power lost partway through a page: the BIM runs the running image, and the download of
+      the same image picks up after the last finished page, with the running CRC it had there.
+      A newer image, or one whose finished pages no longer match their CRC, starts over from
+      block 0.
+
+  Each boot runs in its own process, so that the target and the model start from reset; the
+  flash and SNV outlive it in memory shared with the bench.
+
+  HalFlashRead() of hal_flash.c maps the flash bank into XDATA, which the model has not, so the
+  flash functions are stand-ins here, on the flash controller of hal_sim.c as hal_flash.c uses
+  it. The CPU stalls while a page is erased, so HalFlashErase() waits for it.
+**************************************************************************************************/
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "hal_types.h"
+#include "hal_mcu.h"
+#include "hal_sim.h"
+
+/*********************************************************************
+ * THE OAD TARGET
+ */
+
+#include "oad_target.c"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define BENCH_CONN_HANDLE         0x0000
+#define BENCH_SNV_ITEMS_MAX       4
+#define BENCH_SNV_ITEM_MAX        32
+
+// The image offered: the other image of the pair, version 2.
+#define BENCH_RUN_VER             OAD_IMG_VER(1)
+#define BENCH_NEW_VER            (OAD_IMG_VER(2) ^ 0x01)
+#define BENCH_RUN_CRC             0x5A5A
+#if defined HAL_IMAGE_A
+#define BENCH_RUN_IMG             0       // JumpToImageAorB
+#define BENCH_VARIANT            "a"
+#else
+#define BENCH_RUN_IMG             1
+#define BENCH_VARIANT            "b"
+#endif
+#define BENCH_BIM_SLEEP           0xFF
+
+#define BENCH_RUN_SEED            0x2545F491
+#define BENCH_IMG_SEED            0x9E3779B9
+
+#define BENCH_IMG_MAX            (OAD_IMG_D_AREA * HAL_FLASH_PAGE_SIZE)
+// The most cc254x_oad_code can make of it: a literal op per 128 bytes and the padding.
+#define BENCH_CODE_MAX           (BENCH_IMG_MAX + BENCH_IMG_MAX / 128 + 2 * OAD_BLOCK_SIZE)
+
+enum { ORDER_FWD, ORDER_BACK, ORDER_SHUFFLE };
+enum { CUT_SAME, CUT_NEWER, CUT_CORRUPT };
+enum { RUN_RESET = 1, RUN_CUT, RUN_FAIL };
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  const char *name;
+  uint8 pages;                    // of the image offered
+  uint8 window;                   // asked for in the Image Identify, 0 for a block per request
+  uint8 order;                    // of the blocks of a window
+  uint8 loseEvery;                // lose every n-th block the first time, 0 for none
+  uint8 badCrc;                   // an image with a wrong CRC
+  uint16 cutBlk;                  // power lost once this block is written, 0 for never
+  uint8 afterCut;                 // what the client offers after power is back
+  uint8 coding;                   // of the stream sent, with the images of the -c directory
+  const char *newImg;
+  const char *runImg;             // the running image for a delta
+} benchScenario_t;
+
+typedef struct
+{
+  uint32 writes;                  // Image Block writes with a block
+  uint32 lost;
+  uint32 reqs;                    // block requests
+  uint32 repeats;                 // requests asked again, or blocks sent again with no window
+  uint32 stores;                  // blocks written to flash
+  uint32 erases;
+  uint64_t ps;                    // from the Image Identify to the reset
+  uint16 blks;                    // of the image
+  uint16 sent;                    // blocks of the stream sent, coded or not
+} benchResult_t;
+
+// What outlives a reset: the flash, SNV and the counts of the bench.
+typedef struct
+{
+  uint8 flash[HAL_SIM_FLASH_SIZE];
+  struct
+  {
+    osalSnvId_t id;
+    uint8 len;
+    uint8 data[BENCH_SNV_ITEM_MAX];
+  } snv[BENCH_SNV_ITEMS_MAX];
+  uint8 snvCnt;
+  benchResult_t res;
+  benchResult_t cut;              // the counts when power was lost
+  uint16 resumeBlk;               // the block the download must go on from after that
+} benchNv_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static const benchScenario_t testScenarios[] =
+{
+  { "in order",          12, 16, ORDER_FWD,     0, FALSE, 0,   CUT_SAME    },
+  { "no window",          3,  0, ORDER_FWD,     0, FALSE, 0,   CUT_SAME    },
+  { "no window lost",     3,  0, ORDER_FWD,     5, FALSE, 0,   CUT_SAME    },
+  { "shuffled",          12, 32, ORDER_SHUFFLE, 0, FALSE, 0,   CUT_SAME    },
+  { "lost",              12, 16, ORDER_FWD,     7, FALSE, 0,   CUT_SAME    },
+  { "lost backwards",    12, 32, ORDER_BACK,    5, FALSE, 0,   CUT_SAME    },
+  { "lost shuffled",     12, 24, ORDER_SHUFFLE, 3, FALSE, 0,   CUT_SAME    },
+  { "one page",           1, 16, ORDER_FWD,     0, FALSE, 0,   CUT_SAME    },
+  { "whole area",        62, 32, ORDER_FWD,     0, FALSE, 0,   CUT_SAME    },
+  { "bad crc",           12, 16, ORDER_FWD,     0, TRUE , 0,   CUT_SAME    },
+  { "resume",            12, 16, ORDER_FWD,     0, FALSE, 677, CUT_SAME    },
+  { "resume no window",   3,  0, ORDER_FWD,     0, FALSE, 133, CUT_SAME    },
+  { "resume lost",       12, 32, ORDER_SHUFFLE, 7, FALSE, 900, CUT_SAME    },
+  { "resume newer",      12, 16, ORDER_FWD,     0, FALSE, 677, CUT_NEWER   },
+  { "resume corrupt",    12, 16, ORDER_FWD,     0, FALSE, 677, CUT_CORRUPT },
+};
+
+static const benchScenario_t benchScenarios[] =
+{
+  { "no window",         62,  0, ORDER_FWD,     0, FALSE, 0,   CUT_SAME    },
+  { "window 8",          62,  8, ORDER_FWD,     0, FALSE, 0,   CUT_SAME    },
+  { "window 32",         62, 32, ORDER_FWD,     0, FALSE, 0,   CUT_SAME    },
+  { "window 32 lost",    62, 32, ORDER_FWD,    50, FALSE, 0,   CUT_SAME    },
+  { "window 32 shuffled",62, 32, ORDER_SHUFFLE, 0, FALSE, 0,   CUT_SAME    },
+};
+
+#if OAD_CODED_IMAGES
+// Binaries of the hex files of the repo, with an OAD header set over their first 16 bytes.
+static const benchScenario_t codedScenarios[] =
+{
+  { "lz bs",              0, 16, ORDER_FWD,     0, FALSE, 0,   CUT_SAME, OAD_CODING_LZ,
+    "bs_new.bin", NULL },
+  { "delta bs",           0, 16, ORDER_FWD,     0, FALSE, 0,   CUT_SAME, OAD_CODING_DELTA,
+    "bs_new.bin", "bs_run.bin" },
+  { "delta bs lost",      0, 16, ORDER_FWD,     7, FALSE, 0,   CUT_SAME, OAD_CODING_DELTA,
+    "bs_new.bin", "bs_run.bin" },
+  { "delta bs no window", 0,  0, ORDER_FWD,     5, FALSE, 0,   CUT_SAME, OAD_CODING_DELTA,
+    "bs_new.bin", "bs_run.bin" },
+  { "lz sbp",             0, 16, ORDER_FWD,     0, FALSE, 0,   CUT_SAME, OAD_CODING_LZ,
+    "sbp_new.bin", NULL },
+  { "delta sbp",          0, 16, ORDER_FWD,     0, FALSE, 0,   CUT_SAME, OAD_CODING_DELTA,
+    "sbp_new.bin", "sbp_run.bin" },
+  { "delta same code",    0, 16, ORDER_FWD,     0, FALSE, 0,   CUT_SAME, OAD_CODING_DELTA,
+    "bs_new.bin", "bs_new.bin" },
+};
+#endif
+
+static const benchScenario_t *sc;
+static uint8 isTest;
+static uint8 fails;
+static jmp_buf runJmp;
+
+// The BIM of oad_bim.c, whose dmaCh0 the target uses as well.
+extern uint8 JumpToImageAorB;
+void bimMain(void);
+uint16 bimCrcCalc(uint8 page);
+
+static uint8 img[BENCH_IMG_MAX];
+static uint32 imgLen;
+static uint16 imgBlks;
+static uint16 imgCrc;
+
+// What the client sends: the image, or the stream cc254x_oad_code made of it.
+static uint8 code[BENCH_CODE_MAX];
+static const uint8 *sent;
+static uint16 sentBlks;
+static uint8 identify[OAD_DELTA_REQ_SIZE];
+static uint8 identifyLen;
+static const char *codeTool;
+static const char *codeDir;
+
+// The OAD service as registered, and the configurations of the client.
+static gattAttribute_t *svcAttrs;
+static uint16 svcAttrCnt;
+static CONST gattServiceCBs_t *svcCBs;
+static gattAttribute_t *svcIdentify, *svcBlock;
+
+static benchNv_t *nv;
+static uint8 bootNum;
+
+// Client: the last block request, the blocks delivered and those lost once.
+static uint8 reqNew;
+static uint8 reqLen;
+static uint8 reqVal[ATT_MTU_SIZE];
+static uint8 identifyNew;
+static uint8 reqFirst = TRUE;
+static uint16 reqStart;           // the block the first request must name
+static uint8 delivered[OAD_BLOCK_MAX];
+static uint8 lostOnce[OAD_BLOCK_MAX];
+static uint32 rnd;
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void fail(const char *fmt, ...);
+
+/*********************************************************************
+ * HOST STUBS
+ */
+
+void *osal_memcpy(void *dst, const void GENERIC *src, unsigned int len)
+{
+  return (uint8 *)memcpy(dst, src, len) + len;
+}
+
+uint8 osal_memcmp(const void GENERIC *src1, const void GENERIC *src2, unsigned int len)
+{
+  return memcmp(src1, src2, len) == 0;
+}
+
+uint8 osal_snv_read(osalSnvId_t id, osalSnvLen_t len, void *pBuf)
+{
+  for (uint8 i = 0; i < nv->snvCnt; i++)
+  {
+    if (nv->snv[i].id == id)
+    {
+      memcpy(pBuf, nv->snv[i].data, (len < nv->snv[i].len) ? len : nv->snv[i].len);
+      return SUCCESS;
+    }
+  }
+
+  return NV_OPER_FAILED;
+}
+
+uint8 osal_snv_write(osalSnvId_t id, osalSnvLen_t len, void *pBuf)
+{
+  uint8 i;
+
+  for (i = 0; i < nv->snvCnt && nv->snv[i].id != id; i++);
+  if (len > BENCH_SNV_ITEM_MAX || i == BENCH_SNV_ITEMS_MAX)
+  {
+    return NV_OPER_FAILED;
+  }
+
+  nv->snvCnt += (i == nv->snvCnt);
+  nv->snv[i].id = id;
+  nv->snv[i].len = len;
+  memcpy(nv->snv[i].data, pBuf, len);
+
+  return SUCCESS;
+}
+
+uint8 linkDB_Register(pfnLinkDBCB_t pFunc)
+{
+  (void)pFunc;
+  return SUCCESS;
+}
+
+uint8 linkDB_State(uint16 connectionHandle, uint8 state)
+{
+  (void)state;
+  return connectionHandle == BENCH_CONN_HANDLE;
+}
+
+bStatus_t GATTServApp_RegisterService(gattAttribute_t *pAttrs, uint16 numAttrs,
+                                      CONST gattServiceCBs_t *pServiceCBs)
+{
+  for (uint16 i = 0; i < numAttrs; i++)
+  {
+    pAttrs[i].handle = i + 1;
+
+    // The Image Identify value comes first, then the Image Block value.
+    if (pAttrs[i].type.len == ATT_UUID_SIZE)
+    {
+      *((svcIdentify == NULL) ? &svcIdentify : &svcBlock) = &pAttrs[i];
+    }
+  }
+
+  svcAttrs = pAttrs;
+  svcAttrCnt = numAttrs;
+  svcCBs = pServiceCBs;
+
+  return SUCCESS;
+}
+
+gattAttribute_t *GATTServApp_FindAttr(gattAttribute_t *pAttrTbl, uint16 numAttrs, uint8 *pValue)
+{
+  for (uint16 i = 0; i < numAttrs; i++)
+  {
+    if (pAttrTbl[i].pValue == pValue)
+    {
+      return &pAttrTbl[i];
+    }
+  }
+
+  return NULL;
+}
+
+void GATTServApp_InitCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl)
+{
+  for (uint8 i = 0; i < GATT_MAX_NUM_CONN; i++)
+  {
+    if (connHandle == INVALID_CONNHANDLE || charCfgTbl[i].connHandle == connHandle)
+    {
+      charCfgTbl[i].connHandle = INVALID_CONNHANDLE;
+      charCfgTbl[i].value = GATT_CFG_NO_OPERATION;
+    }
+  }
+}
+
+uint16 GATTServApp_ReadCharCfg(uint16 connHandle, gattCharCfg_t *charCfgTbl)
+{
+  for (uint8 i = 0; i < GATT_MAX_NUM_CONN; i++)
+  {
+    if (charCfgTbl[i].connHandle == connHandle)
+    {
+      return charCfgTbl[i].value;
+    }
+  }
+
+  return GATT_CFG_NO_OPERATION;
+}
+
+bStatus_t GATTServApp_ProcessCCCWriteReq(uint16 connHandle, gattAttribute_t *pAttr,
+                                         uint8 *pValue, uint8 len, uint16 offset,
+                                         uint16 validCfg)
+{
+  gattCharCfg_t *pCfg = (gattCharCfg_t *)pAttr->pValue;
+
+  if (offset != 0 || len != 2 || BUILD_UINT16(pValue[0], pValue[1]) != validCfg)
+  {
+    return ATT_ERR_INVALID_VALUE;
+  }
+
+  pCfg[0].connHandle = connHandle;
+  pCfg[0].value = (uint8)validCfg;
+
+  return SUCCESS;
+}
+
+bStatus_t GATT_Notification(uint16 connHandle, attHandleValueNoti_t *pNoti, uint8 authenticated)
+{
+  (void)authenticated;
+
+  if (connHandle != BENCH_CONN_HANDLE)
+  {
+    return bleNotConnected;
+  }
+
+  if (pNoti->handle == svcBlock->handle)
+  {
+    if (reqNew)
+    {
+      fail("a block request before the client took the last one");
+    }
+    reqNew = TRUE;
+    reqLen = pNoti->len;
+    memcpy(reqVal, pNoti->value, pNoti->len);
+    nv->res.reqs++;
+  }
+  else if (pNoti->handle == svcIdentify->handle)
+  {
+    identifyNew = TRUE;
+  }
+  else
+  {
+    fail("notification on handle %u", pNoti->handle);
+  }
+
+  return SUCCESS;
+}
+
+void HalFlashRead(uint8 pg, uint16 offset, uint8 *buf, uint16 cnt)
+{
+  memcpy(buf, &halSimFlash[(uint32)pg * HAL_FLASH_PAGE_SIZE + offset], cnt);
+}
+
+void HalFlashWrite(uint16 addr, uint8 *buf, uint16 cnt)
+{
+  halDMADesc_t *ch = HAL_NV_DMA_GET_DESC();
+
+  // Single words are the CRC and its shadow; block 0 is written without its first word.
+  if (cnt > 1)
+  {
+    nv->res.stores++;
+  }
+
+  HAL_DMA_SET_SOURCE(ch, buf);
+  HAL_DMA_SET_DEST(ch, &FWDATA);
+  HAL_DMA_SET_VLEN(ch, HAL_DMA_VLEN_USE_LEN);
+  HAL_DMA_SET_LEN(ch, (cnt * HAL_FLASH_WORD_SIZE));
+  HAL_DMA_SET_WORD_SIZE(ch, HAL_DMA_WORDSIZE_BYTE);
+  HAL_DMA_SET_TRIG_MODE(ch, HAL_DMA_TMODE_SINGLE);
+  HAL_DMA_SET_TRIG_SRC(ch, HAL_DMA_TRIG_FLASH);
+  HAL_DMA_SET_SRC_INC(ch, HAL_DMA_SRCINC_1);
+  HAL_DMA_SET_DST_INC(ch, HAL_DMA_DSTINC_0);
+  HAL_DMA_SET_IRQ(ch, HAL_DMA_IRQMASK_DISABLE);
+  HAL_DMA_SET_M8( ch, HAL_DMA_M8_USE_8_BITS);
+  HAL_DMA_SET_PRIORITY(ch, HAL_DMA_PRI_HIGH);
+  HAL_DMA_CLEAR_IRQ(HAL_NV_DMA_CH);
+  HAL_DMA_ARM_CH(HAL_NV_DMA_CH);
+
+  FADDRL = (uint8)addr;
+  FADDRH = (uint8)(addr >> 8);
+  FCTL |= 0x02;
+  while (FCTL & 0x80);
+}
+
+void HalFlashErase(uint8 pg)
+{
+  nv->res.erases++;
+
+  FADDRH = pg * (HAL_FLASH_PAGE_SIZE / HAL_FLASH_WORD_SIZE / 256);
+  FCTL |= 0x01;
+  while (FCTL & 0x80);  // The CPU stalls until the page is erased.
+}
+
+void halAssertHandler(void)
+{
+  fprintf(stderr, "oad_bench: HAL_ASSERT failed\n");
+  exit(2);
+}
+
+/*********************************************************************
+ * IMAGES
+ */
+
+static uint8 nextRnd(void)
+{
+  rnd ^= rnd << 13;
+  rnd ^= rnd >> 17;
+  rnd ^= rnd << 5;
+  return (uint8)rnd;
+}
+
+// Flash page of a page of an image area, around the Image-B area for Image-A.
+static uint8 areaPage(uint8 first, uint8 idx)
+{
+  uint8 page = first + idx;
+
+  if (first == OAD_IMG_A_PAGE && page >= OAD_IMG_B_PAGE)
+  {
+    page += OAD_IMG_B_AREA;
+  }
+
+  return page;
+}
+
+// The image CRC the way crcCalc() of bim_main.c runs it, a byte at a time through the CRC of
+// the model, skipping the CRC and its shadow.
+static uint16 imgCalcCrc(const uint8 *pImg, uint32 len)
+{
+  HalCRCInit(0x0000);
+  for (uint32 i = 4; i < len; i++)
+  {
+    HalCRCExec(pImg[i]);
+  }
+
+  return HalCRCCalc();
+}
+
+static void imgHeader(uint8 *pImg, uint16 ver, uint16 len, const char *uid)
+{
+  memset(pImg, 0xFF, 16);
+  pImg[4] = LO_UINT16(ver);
+  pImg[5] = HI_UINT16(ver);
+  pImg[6] = LO_UINT16(len);
+  pImg[7] = HI_UINT16(len);
+  memcpy(&pImg[8], uid, OAD_IMG_ID_SIZE);
+}
+
+// A binary of the -c directory into 'buf', padded with 0xFF to whole pages; returns its length.
+static uint32 fileLoad(const char *name, uint8 *buf, uint32 max)
+{
+  char path[256];
+  FILE *f;
+  size_t len;
+
+  snprintf(path, sizeof(path), "%s/%s", codeDir, name);
+  memset(buf, 0xFF, max);
+  if ((f = fopen(path, "rb")) == NULL)
+  {
+    fail("cannot read %s", path);
+    exit(1);
+  }
+  len = fread(buf, 1, max, f);
+  if (!feof(f) || len <= 16)
+  {
+    fail("%s does not fit the image area", path);
+    exit(1);
+  }
+  fclose(f);
+
+  return (uint32)(len + HAL_FLASH_PAGE_SIZE - 1) / HAL_FLASH_PAGE_SIZE * HAL_FLASH_PAGE_SIZE;
+}
+
+static void fileSave(const char *path, const uint8 *buf, uint32 len)
+{
+  FILE *f = fopen(path, "wb");
+
+  if ((f == NULL) || (fwrite(buf, 1, len, f) != len) || (fclose(f) != 0))
+  {
+    fail("cannot write %s", path);
+    exit(1);
+  }
+}
+
+// The running image, valid as the BIM leaves it. For a delta it is also saved the way the
+// build made it, with no CRC shadow, for cc254x_oad_code to code against.
+static void runMake(void)
+{
+  uint8 run[OAD_IMG_R_AREA * HAL_FLASH_PAGE_SIZE];
+  uint32 len = sizeof(run);
+  uint16 crc = BENCH_RUN_CRC;
+
+  if (sc->runImg != NULL)
+  {
+    char path[256];
+
+    len = fileLoad(sc->runImg, run, sizeof(run));
+    imgHeader(run, BENCH_RUN_VER, (uint16)(len / HAL_FLASH_WORD_SIZE), "BSW1");
+    crc = imgCalcCrc(run, len);
+    run[0] = LO_UINT16(crc);
+    run[1] = HI_UINT16(crc);
+    snprintf(path, sizeof(path), "%s/%s_run.bin", codeDir, BENCH_VARIANT);
+    fileSave(path, run, len);
+  }
+  else
+  {
+    rnd = BENCH_RUN_SEED;
+    for (uint32 i = 0; i < sizeof(run); i++)
+    {
+      run[i] = nextRnd();
+    }
+    imgHeader(run, BENCH_RUN_VER, OAD_IMG_R_AREA * OAD_FLASH_PAGE_MULT, "BSW1");
+  }
+
+  run[0] = run[2] = LO_UINT16(crc);
+  run[1] = run[3] = HI_UINT16(crc);
+  for (uint8 idx = 0; idx < OAD_IMG_R_AREA; idx++)
+  {
+    memcpy(&halSimFlash[(uint32)areaPage(OAD_IMG_R_PAGE, idx) * HAL_FLASH_PAGE_SIZE],
+           &run[(uint32)idx * HAL_FLASH_PAGE_SIZE], HAL_FLASH_PAGE_SIZE);
+  }
+}
+
+// The stream cc254x_oad_code makes of the image, and the Image Identify write it prints.
+static void codeMake(void)
+{
+  char newPath[256], outPath[256], runPath[256], cmd[1024], line[256];
+  FILE *f;
+  long len;
+
+  snprintf(newPath, sizeof(newPath), "%s/%s_new.bin", codeDir, BENCH_VARIANT);
+  snprintf(outPath, sizeof(outPath), "%s/%s_code.bin", codeDir, BENCH_VARIANT);
+  snprintf(runPath, sizeof(runPath), "%s/%s_run.bin", codeDir, BENCH_VARIANT);
+  fileSave(newPath, img, imgLen);
+  if (sc->coding == OAD_CODING_DELTA)
+  {
+    snprintf(cmd, sizeof(cmd), "%s delta %s %s %s", codeTool, newPath, runPath, outPath);
+  }
+  else
+  {
+    snprintf(cmd, sizeof(cmd), "%s lz %s %s", codeTool, newPath, outPath);
+  }
+
+  identifyLen = 0;
+  if ((f = popen(cmd, "r")) != NULL)
+  {
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+      char *pHex = strstr(line, "Image Identify:");
+      unsigned val;
+      int used;
+
+      for (pHex = pHex ? pHex + 15 : NULL;
+           pHex && identifyLen < sizeof(identify) && sscanf(pHex, " %x%n", &val, &used) == 1;
+           pHex += used)
+      {
+        identify[identifyLen++] = (uint8)val;
+      }
+    }
+    if (pclose(f) != 0)
+    {
+      identifyLen = 0;
+    }
+  }
+  if (identifyLen < OAD_CODED_REQ_SIZE)
+  {
+    fail("no Image Identify from %s", cmd);
+    exit(1);
+  }
+
+  f = fopen(outPath, "rb");
+  len = (f != NULL) ? (long)fread(code, 1, sizeof(code), f) : 0;
+  if (f != NULL)
+  {
+    fclose(f);
+  }
+  if ((len == 0) || (len % OAD_BLOCK_SIZE) ||
+      (len / OAD_BLOCK_SIZE != BUILD_UINT16(identify[OAD_IMG_HDR_SIZE + 2],
+                                            identify[OAD_IMG_HDR_SIZE + 3])))
+  {
+    fail("%s is not the stream announced", outPath);
+    exit(1);
+  }
+
+  sent = code;
+  sentBlks = (uint16)(len / OAD_BLOCK_SIZE);
+}
+
+// The image offered, the same on every boot but for the version of a newer one, with its CRC,
+// and the stream the client sends for it.
+static void imgMake(void)
+{
+  uint16 ver = BENCH_NEW_VER;
+
+  if (bootNum != 0 && sc->afterCut == CUT_NEWER)
+  {
+    ver = OAD_IMG_VER(3) ^ 0x01;
+  }
+
+  if (sc->newImg != NULL)
+  {
+    imgLen = fileLoad(sc->newImg, img, sizeof(img));
+  }
+  else
+  {
+    rnd = BENCH_IMG_SEED;
+    imgLen = (uint32)sc->pages * HAL_FLASH_PAGE_SIZE;
+    for (uint32 i = 0; i < imgLen; i++)
+    {
+      img[i] = nextRnd();
+    }
+  }
+  imgBlks = (uint16)(imgLen / OAD_BLOCK_SIZE);
+  imgHeader(img, ver, (uint16)(imgLen / HAL_FLASH_WORD_SIZE), "BSW2");
+  imgCrc = imgCalcCrc(img, imgLen);
+  img[0] = LO_UINT16(imgCrc ^ (sc->badCrc ? 0x0100 : 0));
+  img[1] = HI_UINT16(imgCrc ^ (sc->badCrc ? 0x0100 : 0));
+
+  sent = img;
+  sentBlks = imgBlks;
+  memcpy(identify, &img[4], OAD_IMG_HDR_SIZE);
+  identifyLen = OAD_IMG_HDR_SIZE + 1;
+  if (sc->coding != OAD_CODING_NONE)
+  {
+    codeMake();
+  }
+  identify[OAD_IMG_HDR_SIZE] = sc->window;
+}
+
+/*********************************************************************
+ * CLIENT
+ */
+
+static bStatus_t cliWrite(gattAttribute_t *pAttr, uint8 *pValue, uint8 len)
+{
+  return svcCBs->pfnWriteAttrCB(BENCH_CONN_HANDLE, pAttr, pValue, len, 0);
+}
+
+static void cliEnable(void)
+{
+  uint8 on[2] = { LO_UINT16(GATT_CLIENT_CFG_NOTIFY), HI_UINT16(GATT_CLIENT_CFG_NOTIFY) };
+
+  // The configuration follows each value.
+  if (cliWrite(svcIdentify + 1, on, 2) != SUCCESS || cliWrite(svcBlock + 1, on, 2) != SUCCESS)
+  {
+    fail("notifications not enabled");
+  }
+}
+
+static void cliIdentify(void)
+{
+  if (cliWrite(svcIdentify, identify, identifyLen) != SUCCESS)
+  {
+    fail("Image Identify refused");
+  }
+}
+
+// The first block not delivered.
+static uint16 cliFirst(void)
+{
+  uint16 first = 0;
+
+  while (first < sentBlks && delivered[first])
+  {
+    first++;
+  }
+
+  return first;
+}
+
+static void cliBlock(uint16 blk)
+{
+  uint8 buf[2 + OAD_BLOCK_SIZE];
+  bStatus_t status;
+
+  if (sc->loseEvery != 0 && (blk % sc->loseEvery) == sc->loseEvery - 1 && !lostOnce[blk])
+  {
+    lostOnce[blk] = TRUE;
+    nv->res.lost++;
+    return;
+  }
+
+  // Until block 0 is in the target takes no other, and a coded stream is taken in order only.
+  if ((sc->coding != OAD_CODING_NONE) ? (blk == cliFirst()) : (blk == 0 || delivered[0]))
+  {
+    delivered[blk] = TRUE;
+  }
+
+  buf[0] = LO_UINT16(blk);
+  buf[1] = HI_UINT16(blk);
+  memcpy(&buf[2], &sent[(uint32)blk * OAD_BLOCK_SIZE], OAD_BLOCK_SIZE);
+  nv->res.writes++;
+  status = cliWrite(svcBlock, buf, sizeof(buf));
+  if (status != SUCCESS)
+  {
+    fail("block %u answered status 0x%02x", blk, status);
+    longjmp(runJmp, RUN_FAIL);
+  }
+
+  if (bootNum == 0 && sc->cutBlk != 0 && blk == sc->cutBlk)
+  {
+    longjmp(runJmp, RUN_CUT);
+  }
+}
+
+// The request must name what the client has not delivered; returns its first block.
+static uint16 cliCheckReq(void)
+{
+  uint16 blk = BUILD_UINT16(reqVal[0], reqVal[1]);
+  uint16 first;
+  uint8 window = (sc->window > OAD_WINDOW_MAX) ? OAD_WINDOW_MAX : sc->window;
+
+  // The target may have kept blocks from before a reset.
+  if (reqFirst)
+  {
+    reqFirst = FALSE;
+    if (blk != reqStart)
+    {
+      fail("the download starts at block %u, not %u", blk, reqStart);
+    }
+    for (uint16 b = 0; b < blk && b < sentBlks; b++)
+    {
+      delivered[b] = TRUE;
+    }
+  }
+
+  first = cliFirst();
+  if (blk != first)
+  {
+    fail("request of block %u, the first not delivered is %u", blk, first);
+  }
+
+  if (window == 0)
+  {
+    if (reqLen != 2)
+    {
+      fail("request of %u bytes with no window", reqLen);
+    }
+    return blk;
+  }
+
+  if (reqLen != 3 + OAD_WINDOW_BYTES(window) || reqVal[2] != window)
+  {
+    fail("request of %u bytes with a window of %u", reqLen, reqVal[2]);
+    return blk;
+  }
+  for (uint8 idx = 0; idx < window; idx++)
+  {
+    uint8 missing = (reqVal[3 + idx / 8] >> (idx % 8)) & 1;
+
+    if (missing != (blk + idx < sentBlks && !delivered[blk + idx]))
+    {
+      fail("request of block %u names block %u %s", blk, blk + idx,
+           missing ? "missing" : "received");
+      break;
+    }
+  }
+
+  return blk;
+}
+
+static void cliSendWindow(uint16 blk)
+{
+  uint8 list[OAD_WINDOW_MAX];
+  uint8 cnt = 0;
+
+  if (sc->window == 0)
+  {
+    cliBlock(blk);
+    return;
+  }
+
+  for (uint8 idx = 0; idx < reqVal[2]; idx++)
+  {
+    if ((reqVal[3 + idx / 8] >> (idx % 8)) & 1)
+    {
+      list[cnt++] = idx;
+    }
+  }
+
+  if (sc->order == ORDER_BACK)
+  {
+    for (uint8 i = 0; i < cnt / 2; i++)
+    {
+      uint8 tmp = list[i];
+      list[i] = list[cnt - 1 - i];
+      list[cnt - 1 - i] = tmp;
+    }
+  }
+  else if (sc->order == ORDER_SHUFFLE)
+  {
+    for (uint8 i = cnt; i > 1; i--)
+    {
+      uint8 j = nextRnd() % i;
+      uint8 tmp = list[i - 1];
+      list[i - 1] = list[j];
+      list[j] = tmp;
+    }
+  }
+
+  for (uint8 i = 0; i < cnt; i++)
+  {
+    cliBlock(blk + list[i]);
+  }
+}
+
+// Runs until the target resets, or fails.
+static void cliRun(void)
+{
+  uint16 blk = 0;
+  uint8 waits = 0;
+
+  cliEnable();
+  cliIdentify();
+
+  for (;;)
+  {
+    if (identifyNew)
+    {
+      fail("the image was refused");
+      return;
+    }
+
+    if (reqNew)
+    {
+      reqNew = FALSE;
+      waits = 0;
+      blk = cliCheckReq();
+      if (blk >= sentBlks)
+      {
+        if (!sc->badCrc)
+        {
+          fail("no reset after the last block");
+        }
+        return;
+      }
+      cliSendWindow(blk);
+    }
+    else if (++waits > 2)
+    {
+      fail("no block request after block %u", blk);
+      return;
+    }
+    else if (sc->window == 0)
+    {
+      nv->res.repeats++;
+      cliBlock(blk);
+    }
+    else
+    {
+      uint8 buf[2] = { LO_UINT16(blk), HI_UINT16(blk) };
+
+      nv->res.repeats++;
+      (void)cliWrite(svcBlock, buf, 2);
+    }
+  }
+}
+
+/*********************************************************************
+ * BENCH
+ */
+
+static void fail(const char *fmt, ...)
+{
+  va_list ap;
+
+  va_start(ap, fmt);
+  printf("FAIL %s: ", sc->name);
+  vprintf(fmt, ap);
+  printf("\n");
+  va_end(ap);
+  fails++;
+}
+
+static void onReset(void)
+{
+  longjmp(runJmp, RUN_RESET);
+}
+
+static void checkFlash(void)
+{
+  for (uint32 i = 0; i < imgLen; i++)
+  {
+    uint32 addr = (uint32)areaPage(OAD_IMG_D_PAGE, i / HAL_FLASH_PAGE_SIZE) *
+                  HAL_FLASH_PAGE_SIZE + i % HAL_FLASH_PAGE_SIZE;
+    // checkDL() sets the CRC shadow to the CRC it calculated.
+    uint8 want = (i == 2) ? LO_UINT16(imgCrc) : (i == 3) ? HI_UINT16(imgCrc) : img[i];
+
+    if (halSimFlash[addr] != want)
+    {
+      fail("flash at 0x%05x is 0x%02x, not 0x%02x", addr, halSimFlash[addr], want);
+      return;
+    }
+  }
+}
+
+static void checkCrc(void)
+{
+  uint16 dma = crcCalcDLDMA(imgLen / HAL_FLASH_PAGE_SIZE);
+  uint16 bim = bimCrcCalc(OAD_IMG_D_PAGE);
+
+  if (oadCrcBlk != imgBlks || oadCrc != imgCrc || dma != imgCrc || bim != imgCrc)
+  {
+    fail("CRC 0x%04x over %u blocks, by DMA 0x%04x and by the BIM 0x%04x, not 0x%04x",
+         oadCrc, oadCrcBlk, dma, bim, imgCrc);
+  }
+}
+
+// Boots the BIM until it runs an image: returns JumpToImageAorB, or BENCH_BIM_SLEEP.
+static uint8 bimBoot(void)
+{
+  for (uint8 boot = 0; boot < 3; boot++)
+  {
+    JumpToImageAorB = BENCH_BIM_SLEEP;
+    PCON = 0;
+
+    // An image is run by a jump, which is a no-op here and followed by HAL_SYSTEM_RESET().
+    if (setjmp(runJmp) == 0)
+    {
+      bimMain();
+    }
+    if (JumpToImageAorB != BENCH_BIM_SLEEP || (PCON & 0x01))
+    {
+      return JumpToImageAorB;
+    }
+  }
+
+  fail("the BIM resets over and over");
+  return BENCH_BIM_SLEEP;
+}
+
+static void runBoot(void)
+{
+  volatile int run;
+
+  halSimInit();
+  memcpy(halSimFlash, nv->flash, sizeof(halSimFlash));
+  halSimResetHook(onReset);
+  HAL_DMA_SET_ADDR_DESC0(&dmaCh0);
+  if (bootNum == 0)
+  {
+    runMake();
+  }
+  else
+  {
+    // The BIM runs first after any reset, and must not take the partial download for an image.
+    uint8 boot = bimBoot();
+
+    if (boot != BENCH_RUN_IMG)
+    {
+      fail("the BIM runs image %u after the reset", boot);
+    }
+    if (sc->afterCut == CUT_CORRUPT)
+    {
+      halSimFlash[(uint32)areaPage(OAD_IMG_D_PAGE, 1) * HAL_FLASH_PAGE_SIZE + 100] ^= 0x01;
+    }
+  }
+  imgMake();
+  nv->res.blks = imgBlks;
+  nv->res.sent = sentBlks;
+  reqStart = (bootNum == 0) ? 0 : nv->resumeBlk;
+  VOID OADTarget_AddService();
+
+  if ((run = setjmp(runJmp)) == 0)
+  {
+    cliRun();
+  }
+  nv->res.ps += halSimTime();
+
+  if (run == RUN_CUT)
+  {
+    // The target stands at the first block the client has not delivered.
+    nv->resumeBlk = 0;
+    if (sc->afterCut == CUT_SAME)
+    {
+      nv->resumeBlk = cliFirst() / OAD_BLOCKS_PER_PAGE * OAD_BLOCKS_PER_PAGE;
+    }
+    nv->cut = nv->res;
+  }
+  else if (run != RUN_RESET && !sc->badCrc)
+  {
+    if (fails == 0)
+    {
+      fail("no reset after the download");
+    }
+  }
+  else if (run == RUN_RESET && sc->badCrc)
+  {
+    fail("reset after an image with a wrong CRC");
+  }
+  else
+  {
+    uint16 stores = imgBlks - reqStart;
+    uint16 erases = imgLen / HAL_FLASH_PAGE_SIZE - reqStart / OAD_BLOCKS_PER_PAGE;
+    uint8 boot;
+
+    if (nv->res.stores - nv->cut.stores != stores)
+    {
+      fail("%u blocks written to flash for %u", nv->res.stores - nv->cut.stores, stores);
+    }
+    if (nv->res.erases - nv->cut.erases != erases)
+    {
+      fail("%u pages erased for %u", nv->res.erases - nv->cut.erases, erases);
+    }
+    if (sc->loseEvery == 0 && sc->order == ORDER_FWD &&
+        nv->res.writes - nv->cut.writes != sentBlks - reqStart)
+    {
+      fail("%u blocks sent for %u", nv->res.writes - nv->cut.writes, sentBlks - reqStart);
+    }
+    checkFlash();
+    checkCrc();
+
+    boot = bimBoot();
+    if (boot != (sc->badCrc ? BENCH_RUN_IMG : !BENCH_RUN_IMG))
+    {
+      fail("the BIM runs image %u", boot);
+    }
+#if defined HAL_IMAGE_A
+    // Image-B is checked on every boot unless the BIM marks it failed in its reserved word.
+    if (sc->badCrc && (halSimFlash[(uint32)OAD_IMG_D_PAGE * HAL_FLASH_PAGE_SIZE + 12] != 0x00))
+    {
+      fail("the BIM has not marked the image as failed");
+    }
+#endif
+  }
+
+  memcpy(nv->flash, halSimFlash, sizeof(halSimFlash));
+}
+
+static void runScenario(void)
+{
+  nv = mmap(NULL, sizeof(benchNv_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (nv == MAP_FAILED)
+  {
+    perror("oad_bench");
+    exit(2);
+  }
+  memset(nv->flash, 0xFF, sizeof(nv->flash));
+
+  // Each boot in its own process: the target and the model start from reset.
+  for (uint8 boot = 0; boot < ((sc->cutBlk != 0) ? 2 : 1); boot++)
+  {
+    pid_t pid;
+    int status;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0)
+    {
+      bootNum = boot;
+      runBoot();
+      fflush(stdout);
+      _exit(fails ? 1 : 0);
+    }
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+      fails++;
+    }
+  }
+
+  printf("%-18s %5u %5.2f %5u %6u %5u %5u %5u %7.1f\n", sc->name, nv->res.blks,
+         nv->res.sent ? (double)nv->res.blks / nv->res.sent : 0.0, sc->window, nv->res.writes,
+         nv->res.lost, nv->res.reqs, nv->res.repeats, nv->res.ps / 1e9);
+}
+
+// Each download in its own process.
+static void runList(const benchScenario_t *list, uint8 cnt)
+{
+  for (uint8 i = 0; i < cnt; i++)
+  {
+    pid_t pid;
+    int status;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0)
+    {
+      sc = &list[i];
+      runScenario();
+      fflush(stdout);
+      _exit(fails ? 1 : 0);
+    }
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+      fails++;
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-t") == 0)
+    {
+      isTest = TRUE;
+    }
+    else if ((strcmp(argv[i], "-c") == 0) && (i + 2 < argc))
+    {
+      codeTool = argv[++i];
+      codeDir = argv[++i];
+    }
+    else
+    {
+      fprintf(stderr, "usage: oad_bench [-t] [-c <cc254x_oad_code> <image dir>]\n");
+      return 2;
+    }
+  }
+#if OAD_CODED_IMAGES
+  if (codeTool == NULL)
+  {
+    fprintf(stderr, "oad_bench: coded images need -c\n");
+    return 2;
+  }
+#endif
+
+#if defined HAL_IMAGE_A
+  printf("OAD of Image-B by Image-A; x is image blocks per block sent, flash time in ms\n");
+#else
+  printf("OAD of Image-A by Image-B; x is image blocks per block sent, flash time in ms\n");
+#endif
+  printf("%-18s %5s %5s %5s %6s %5s %5s %5s %7s\n", "download", "blks", "x", "win", "writes",
+         "lost", "reqs", "rep", "ms");
+
+  if (isTest)
+  {
+    runList(testScenarios, sizeof(testScenarios) / sizeof(testScenarios[0]));
+  }
+  else
+  {
+    runList(benchScenarios, sizeof(benchScenarios) / sizeof(benchScenarios[0]));
+  }
+#if OAD_CODED_IMAGES
+  runList(codedScenarios, sizeof(codedScenarios) / sizeof(codedScenarios[0]));
+#endif
+
+  if (isTest)
+  {
+    printf("%s\n", fails ? "FAIL" : "PASS");
+  }
+  return fails ? 1 : 0;
+}
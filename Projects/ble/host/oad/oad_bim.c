@@ -0,0 +1,17 @@
+/**************************************************************************************************
+  Filename:       oad_bim.c
+
+  Description:
+
+  bim_main.c of Projects/ble/util/BIM for oad_bench.c, in a unit of its own as the BIM is a
+  program of its own: its main() is bimMain() here, and bimCrcCalc() is its crcCalcDMA().
+**************************************************************************************************/
+
+#define main bimMain
+
+#include "bim_main.c"
+
+uint16 bimCrcCalc(uint8 page)
+{
+  return crcCalcDMA(page);
+}
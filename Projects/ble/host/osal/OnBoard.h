@@ -0,0 +1,13 @@
+/**************************************************************************************************
+  Filename:       OnBoard.h
+
+  Description:    Projects/ble/common/cc2540/OnBoard.h for the host build of the OSAL sources,
+                  which need none of the board: it pulls in the IAR headers of the target.
+**************************************************************************************************/
+
+#ifndef ONBOARD_H
+#define ONBOARD_H
+
+#include "hal_mcu.h"
+
+#endif
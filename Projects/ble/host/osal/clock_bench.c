@@ -0,0 +1,306 @@
+/**************************************************************************************************
+  Filename:       clock_bench.c
+
+  Description:
+
+  Runs the UTC calendar conversion of Components/osal/common/OSAL_ClockBLE.c on the host against
+  a day by day calendar, and against the year and month loops it had before (oldConvertUTCTime()
+  and oldConvertUTCSecs() below, as they were):
+
+    clock_bench       Prints the time per conversion of both, in 2000, 2068 and 2135 and over
+                      all days.
+    clock_bench -t    Calendar test: fails unless every check below holds.
+
+  Checks of the test, for every day from 1 January 2000 to 7 February 2136, the last day that
+  UTCTime holds, at its first and last second and one second in between (06:28:15, the last
+  second of UTCTime, for the last of the last day):
+    - osal_ConvertUTCTime() gives the date and time of the calendar.
+    - osal_ConvertUTCSecs() and OSAL_UTC_SECS() of the calendar give the seconds back.
+    - The old loops give the same for both.
+
+  The times are of the host, so only their ratio says something about the CC2540, where the
+  loops cost the more as the years go by.
+**************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "comdef.h"
+#include "OSAL_Clock.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define BEGYEAR                   2000
+#define DAY                       86400UL
+#define LAST_DAY                  ((uint16)(0xFFFFFFFFUL / DAY))  // 7 February 2136
+
+#define BENCH_DAYS                365
+#define BENCH_ROUNDS              200
+
+#define YearLength(yr)            (IsLeapYear(yr) ? 366 : 365)
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static int fails;
+static volatile uint32 sink;
+
+/*********************************************************************
+ * STUBS
+ */
+
+uint16 ll_McuPrecisionCount(void)
+{
+  return 0;
+}
+
+void osalTimerUpdate(uint32 updateTime)
+{
+  (void)updateTime;
+}
+
+/*********************************************************************
+ * OLD LOOPS
+ */
+
+static uint8 monthLength( uint8 lpyr, uint8 mon )
+{
+  uint8 days = 31;
+
+  if ( mon == 1 ) // feb
+  {
+    days = ( 28 + lpyr );
+  }
+  else
+  {
+    if ( mon > 6 ) // aug-dec
+    {
+      mon--;
+    }
+
+    if ( mon & 1 )
+    {
+      days = 30;
+    }
+  }
+
+  return ( days );
+}
+
+static void oldConvertUTCTime( UTCTimeStruct *tm, UTCTime secTime )
+{
+  // calculate the time less than a day - hours, minutes, seconds
+  {
+    uint32 day = secTime % DAY;
+    tm->seconds = day % 60UL;
+    tm->minutes = (day % 3600UL) / 60UL;
+    tm->hour = day / 3600UL;
+  }
+
+  // Fill in the calendar - day, month, year
+  {
+    uint16 numDays = secTime / DAY;
+    tm->year = BEGYEAR;
+    while ( numDays >= YearLength( tm->year ) )
+    {
+      numDays -= YearLength( tm->year );
+      tm->year++;
+    }
+
+    tm->month = 0;
+    while ( numDays >= monthLength( IsLeapYear( tm->year ), tm->month ) )
+    {
+      numDays -= monthLength( IsLeapYear( tm->year ), tm->month );
+      tm->month++;
+    }
+
+    tm->day = numDays;
+  }
+}
+
+static UTCTime oldConvertUTCSecs( UTCTimeStruct *tm )
+{
+  uint32 seconds;
+
+  /* Seconds for the partial day */
+  seconds = (((tm->hour * 60UL) + tm->minutes) * 60UL) + tm->seconds;
+
+  /* Account for previous complete days */
+  {
+    /* Start with complete days in current month */
+    uint16 days = tm->day;
+
+    /* Next, complete months in current year */
+    {
+      int8 month = tm->month;
+      while ( --month >= 0 )
+      {
+        days += monthLength( IsLeapYear( tm->year ), month );
+      }
+    }
+
+    /* Next, complete years before current year */
+    {
+      uint16 year = tm->year;
+      while ( --year >= BEGYEAR )
+      {
+        days += YearLength( year );
+      }
+    }
+
+    /* Add total seconds before partial day */
+    seconds += (days * DAY);
+  }
+
+  return ( seconds );
+}
+
+/*********************************************************************
+ * TEST
+ */
+
+static int sameTime(const UTCTimeStruct *a, const UTCTimeStruct *b)
+{
+  return (a->year == b->year) && (a->month == b->month) && (a->day == b->day) &&
+         (a->hour == b->hour) && (a->minutes == b->minutes) && (a->seconds == b->seconds);
+}
+
+static void check(const char *what, const UTCTimeStruct *cal, UTCTime secs, int ok)
+{
+  if (!ok && (fails++ < 10))
+  {
+    printf("FAIL %s %04u-%02u-%02u %02u:%02u:%02u (%lu s)\n", what, cal->year, cal->month + 1,
+           cal->day + 1, cal->hour, cal->minutes, cal->seconds, (unsigned long)secs);
+  }
+}
+
+static void testCalendar(void)
+{
+  static const uint8 mdays[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+  static const uint32 daySecs[3] = { 0, 45296, DAY - 1 };   // 00:00:00, 12:34:56, 23:59:59
+  UTCTimeStruct cal = { 0, 0, 0, 0, 0, BEGYEAR };
+  uint32 d;
+  uint8 s;
+
+  for (d = 0; d <= LAST_DAY; d++)
+  {
+    for (s = 0; s < 3; s++)
+    {
+      uint32 daySec = daySecs[s];
+      UTCTime secs;
+      UTCTimeStruct tm;
+
+      if (daySec > 0xFFFFFFFFUL - d * DAY)
+      {
+        daySec = 0xFFFFFFFFUL - d * DAY;
+      }
+      secs = d * DAY + daySec;
+
+      cal.hour = daySec / 3600;
+      cal.minutes = (daySec / 60) % 60;
+      cal.seconds = daySec % 60;
+
+      osal_ConvertUTCTime(&tm, secs);
+      check("osal_ConvertUTCTime", &cal, secs, sameTime(&tm, &cal));
+      check("osal_ConvertUTCSecs", &cal, secs, osal_ConvertUTCSecs(&cal) == secs);
+      check("OSAL_UTC_SECS", &cal, secs, OSAL_UTC_SECS(cal.year, cal.month, cal.day, cal.hour,
+                                                        cal.minutes, cal.seconds) == secs);
+      oldConvertUTCTime(&tm, secs);
+      check("old ConvertUTCTime", &cal, secs, sameTime(&tm, &cal));
+      check("old ConvertUTCSecs", &cal, secs, oldConvertUTCSecs(&cal) == secs);
+    }
+
+    // Next day of the calendar.
+    if (++cal.day == mdays[cal.month] + ((cal.month == 1) && IsLeapYear(cal.year)))
+    {
+      cal.day = 0;
+      if (++cal.month == 12)
+      {
+        cal.month = 0;
+        cal.year++;
+      }
+    }
+  }
+
+  printf("%u days to %04u-%02u-%02u checked\n", LAST_DAY + 1, cal.year, cal.month + 1,
+         cal.day);
+}
+
+/*********************************************************************
+ * BENCH
+ */
+
+static double nowNs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Nanoseconds per call of toTime and of toSecs over nDays days from day0.
+static void benchOne(uint16 day0, uint16 nDays, void (*toTime)(UTCTimeStruct *, UTCTime),
+                     UTCTime (*toSecs)(UTCTimeStruct *), double *timeNs, double *secsNs)
+{
+  static UTCTimeStruct tm[LAST_DAY + 1];
+  uint16 rounds = (uint16)((uint32)BENCH_ROUNDS * BENCH_DAYS / nDays) + 1;
+  double t0;
+  uint16 r, d;
+
+  t0 = nowNs();
+  for (r = 0; r < rounds; r++)
+  {
+    for (d = 0; d < nDays; d++)
+    {
+      toTime(&tm[d], (day0 + d) * DAY + 45296);
+    }
+    sink += tm[r % nDays].day;
+  }
+  *timeNs = (nowNs() - t0) / ((double)rounds * nDays);
+
+  t0 = nowNs();
+  for (r = 0; r < rounds; r++)
+  {
+    for (d = 0; d < nDays; d++)
+    {
+      sink += toSecs(&tm[d]);
+    }
+  }
+  *secsNs = (nowNs() - t0) / ((double)rounds * nDays);
+}
+
+static void benchRange(const char *name, uint16 day0, uint16 nDays)
+{
+  double newTime, newSecs, oldTime, oldSecs;
+
+  benchOne(day0, nDays, osal_ConvertUTCTime, osal_ConvertUTCSecs, &newTime, &newSecs);
+  benchOne(day0, nDays, oldConvertUTCTime, oldConvertUTCSecs, &oldTime, &oldSecs);
+
+  printf("%-10s %10.1f %10.1f %6.1fx %10.1f %10.1f %6.1fx\n", name, oldTime, newTime,
+         oldTime / newTime, oldSecs, newSecs, oldSecs / newSecs);
+}
+
+int main(int argc, char **argv)
+{
+  uint8 test = (argc > 1) && (strcmp(argv[1], "-t") == 0);
+
+  if (test)
+  {
+    testCalendar();
+    printf("%s\n", fails ? "FAIL" : "PASS");
+    return fails ? 1 : 0;
+  }
+
+  printf("ns per call  %10s %10s %7s %10s %10s %7s\n", "Time old", "new", "", "Secs old", "new",
+         "");
+  benchRange("2000", OSAL_UTC_DAYS(2000, 0, 0), BENCH_DAYS);
+  benchRange("2068", OSAL_UTC_DAYS(2068, 0, 0), BENCH_DAYS);
+  benchRange("2135", OSAL_UTC_DAYS(2135, 0, 0), BENCH_DAYS);
+  benchRange("all days", 0, LAST_DAY);
+  return 0;
+}
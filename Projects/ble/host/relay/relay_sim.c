@@ -0,0 +1,891 @@
+/**************************************************************************************************
+  Filename:       relay_sim.c
+
+  Description:
+
+  Discrete-event simulation of the advertising relay of
+  Projects/ble/BSBLEPeripheral/Source/lightRelay.c (BS_RELAY) between up to SIM_NODES_MAX
+  switches. Each switch runs its own copy of the module, loaded from lightRelay.so, on the
+  stand-ins below for OSAL, GAP and the peripheral role, and the advertising channels are
+  modelled packet by packet:
+
+    relay_sim         Delivery, latency and airtime of commands on grids of 10, 25 and 50
+                      switches, one command every 5 s and, on 50, every second.
+    relay_sim -t      Relay test: fails unless every check below holds.
+
+  Model:
+    - Switches sit on a row or a square grid one spacing apart and hear the switches within
+      the range of the scenario.
+    - An advertising event sends the PDU on channels 37, 38 and 39 in turn, every advertising
+      interval plus 0 - 10 ms, the first one 0 - 10 ms after advertising is turned on.
+    - A discovery scans all the time and moves to the next channel every scan interval.
+    - A PDU is received by a switch that hears its sender, scans on its channel from its first
+      bit to its last, is not sending itself and hears no other PDU on that channel meanwhile.
+    - The phone hands each command to its origin switch as a TYPE_RELAY packet. The target
+      takes it in parsingDataPacket(), and its state packet coming back to the origin in
+      BSProfile_SetParameter() is the ack.
+    - The switches start with advertising off, as BSBLEPeripheral does.
+
+  Checks of the test, on a row of six switches that only hear their neighbours:
+    - A command from the end of the row reaches the switches 1 to RELAY_TTL hops away and
+      its ack comes back, and it never reaches the switch RELAY_TTL + 1 hops away.
+    - After the bursts every switch advertises again exactly as before: its own data and
+      advertising on or off as it was (one switch in the row has it on).
+  and on a grid of 50 switches at one command every 5 s, at least 95 % of the commands to
+  targets up to RELAY_TTL hops away are delivered and acked.
+
+  Printed per scenario: the commands to switches within RELAY_TTL hops delivered and acked, the
+  mean time from the command to its ack, the median time to the target by hops, the time on
+  air of all switches per command, the time on air per advertising channel as a share of the
+  run and the PDUs lost to collisions per command.
+**************************************************************************************************/
+
+#include <dlfcn.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bcomdef.h"
+#include "OSAL.h"
+#include "gap.h"
+#include "peripheral.h"
+
+#include "BSGATTprofile.h"
+#include "parsingData.h"
+#include "lightRelay.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define SIM_NODES_MAX             50
+#define SIM_CMDS_MAX              400
+#define SIM_TX_MAX                1024    // PDUs kept for the collision check
+
+#define SIM_EVT_TX                0x0001
+#define SIM_EVT_SCAN              0x0002
+
+#define SIM_ID_BASE               0x0100
+#define SIM_ADV_INT_US            300000  // DEFAULT_ADVERTISING_INTERVAL of BSBLEPeripheral
+#define SIM_ADV_DELAY_US          10000
+#define SIM_ADV_CH_GAP_US         200     // from the end of a PDU to the next channel
+#define SIM_SCAN_INT_US           10000   // TGAP_GEN_DISC_SCAN_INT, the window is the same
+#define SIM_PDU_OVERHEAD          16      // preamble, access address, header, AdvA and CRC
+#define SIM_WARMUP_US             3000000 // the first discoveries have started
+#define SIM_TAIL_US               10000000
+
+#define SIM_PASS_PCT              95
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  void (*init)(uint8 task_id, uint16 txEvent, uint16 scanEvent);
+  bool (*parse)(uint8 *recvPacket, uint8 packetLength);
+  void (*gapMsg)(gapEventHdr_t *pMsg);
+  void (*tx)(void);
+  void (*scan)(void);
+
+  double x, y;
+  uint16 id;
+  uint32 timerGen[2];             // OSAL timers of the relay task, by SIM_EVT_ bit
+  uint8 advEnabled;
+  uint8 advData[B_MAX_ADV_LEN];
+  uint8 advLen;
+  uint32 advGen;
+  uint16 discScanMs;
+  uint64_t scanStart, scanEnd;    // the discovery running, scanEnd 0 if none
+  uint32 scanGen;
+  uint64_t scanPhase;
+  uint64_t airUs;
+} simNode_t;
+
+typedef struct
+{
+  uint8 node;
+  uint8 ch;
+  uint64_t start, end;
+  uint8 len;
+  uint8 data[B_MAX_ADV_LEN];
+} simTx_t;
+
+enum { EV_TIMER, EV_ADV, EV_RX_END, EV_SCAN_END, EV_CMD };
+
+typedef struct
+{
+  uint64_t t;
+  uint32 seq;
+  uint8 type;
+  uint8 node;
+  uint16 arg;
+  uint32 gen;
+} simEvent_t;
+
+typedef struct
+{
+  uint8 origin, target, hops;
+  uint64_t sentAt, deliveredAt, ackedAt;  // 0 if not
+} simCmd_t;
+
+typedef struct
+{
+  const char *name;
+  uint8 nodes;
+  uint8 isRow;
+  double range;
+  uint16 cmds;
+  uint32 cmdEveryMs;
+  uint8 isTest;
+} simScenario_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static const simScenario_t *sc;
+static simNode_t nodes[SIM_NODES_MAX];
+static uint8 cur;                 // the switch whose code runs
+static uint64_t now;
+static uint64_t rng = 0x2545F4914F6CDD1DULL;
+
+static simEvent_t evq[8192];
+static uint16 evCnt;
+static uint32 evSeq;
+
+static simTx_t txs[SIM_TX_MAX];
+static uint16 txNext;
+
+static uint8 hopTbl[SIM_NODES_MAX][SIM_NODES_MAX];
+static simCmd_t cmds[SIM_CMDS_MAX];
+static uint16 cmdCnt;
+static uint32 rxCnt, collisionCnt;
+static int fails;
+
+static const uint8 ownAdvert[] = { 0x02, GAP_ADTYPE_FLAGS, GAP_ADTYPE_FLAGS_GENERAL,
+                                   0x03, GAP_ADTYPE_LOCAL_NAME_SHORT, 'B', 'S' };
+
+/*********************************************************************
+ * EVENTS
+ */
+
+static uint32 simRand(void)
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return (uint32)(rng >> 16);
+}
+
+static int evBefore(const simEvent_t *a, const simEvent_t *b)
+{
+  return (a->t < b->t) || ((a->t == b->t) && (a->seq < b->seq));
+}
+
+static void simAt(uint64_t t, uint8 type, uint8 node, uint16 arg, uint32 gen)
+{
+  uint16 i = evCnt++;
+
+  if (evCnt > sizeof(evq) / sizeof(evq[0]))
+  {
+    fprintf(stderr, "event queue full\n");
+    exit(2);
+  }
+  evq[i].t = t;
+  evq[i].seq = evSeq++;
+  evq[i].type = type;
+  evq[i].node = node;
+  evq[i].arg = arg;
+  evq[i].gen = gen;
+
+  while (i > 0 && evBefore(&evq[i], &evq[(i - 1) / 2]))
+  {
+    simEvent_t e = evq[i];
+    evq[i] = evq[(i - 1) / 2];
+    evq[(i - 1) / 2] = e;
+    i = (i - 1) / 2;
+  }
+}
+
+static simEvent_t simNext(void)
+{
+  simEvent_t top = evq[0];
+  uint16 i = 0;
+
+  evq[0] = evq[--evCnt];
+  for (;;)
+  {
+    uint16 l = 2 * i + 1, r = l + 1, m = i;
+
+    if (l < evCnt && evBefore(&evq[l], &evq[m])) m = l;
+    if (r < evCnt && evBefore(&evq[r], &evq[m])) m = r;
+    if (m == i) break;
+    {
+      simEvent_t e = evq[i];
+      evq[i] = evq[m];
+      evq[m] = e;
+    }
+    i = m;
+  }
+  return top;
+}
+
+static uint8 evtIdx(uint16 event)
+{
+  return (event == SIM_EVT_TX) ? 0 : 1;
+}
+
+/*********************************************************************
+ * OSAL, GAP AND PERIPHERAL ROLE OF THE SWITCH IN cur
+ */
+
+uint8 osal_start_timerEx(uint8 task_id, uint16 event_id, uint32 timeout_value)
+{
+  simNode_t *n = &nodes[cur];
+
+  (void)task_id;
+  simAt(now + (uint64_t)timeout_value * 1000, EV_TIMER, cur, event_id,
+        ++n->timerGen[evtIdx(event_id)]);
+  return SUCCESS;
+}
+
+uint8 osal_set_event(uint8 task_id, uint16 event_flag)
+{
+  return osal_start_timerEx(task_id, event_flag, 0);
+}
+
+uint16 osal_rand(void)
+{
+  return (uint16)simRand();
+}
+
+void *osal_memcpy(void *dst, const void GENERIC *src, unsigned int len)
+{
+  memcpy(dst, src, len);
+  return (uint8 *)dst + len;
+}
+
+void *osal_memset(void *dest, uint8 value, int len)
+{
+  return memset(dest, value, len);
+}
+
+void *osal_mem_alloc(uint16 size)
+{
+  return malloc(size);
+}
+
+void osal_mem_free(void *ptr)
+{
+  free(ptr);
+}
+
+bStatus_t GAP_SetParamValue(gapParamIDs_t paramID, uint16 paramValue)
+{
+  if (paramID == TGAP_GEN_DISC_SCAN)
+  {
+    nodes[cur].discScanMs = paramValue;
+  }
+  return SUCCESS;
+}
+
+bStatus_t GAP_DeviceDiscoveryRequest(gapDevDiscReq_t *pParams)
+{
+  simNode_t *n = &nodes[cur];
+
+  (void)pParams;
+  if (n->scanEnd != 0)
+  {
+    return bleAlreadyInRequestedMode;
+  }
+  n->scanStart = now;
+  n->scanEnd = now + (uint64_t)n->discScanMs * 1000;
+  simAt(n->scanEnd, EV_SCAN_END, cur, 0, ++n->scanGen);
+  return SUCCESS;
+}
+
+bStatus_t GAPRole_SetParameter(uint16 param, uint8 len, void *pValue)
+{
+  simNode_t *n = &nodes[cur];
+
+  switch (param)
+  {
+  case GAPROLE_ADVERT_DATA:
+    memcpy(n->advData, pValue, len);
+    n->advLen = len;
+    return SUCCESS;
+
+  case GAPROLE_ADVERT_ENABLED:
+    {
+      uint8 enable = *(uint8 *)pValue;
+
+      if (enable && !n->advEnabled)
+      {
+        simAt(now + simRand() % SIM_ADV_DELAY_US, EV_ADV, cur, 0, ++n->advGen);
+      }
+      else if (!enable && n->advEnabled)
+      {
+        n->advGen++;
+      }
+      n->advEnabled = enable;
+    }
+    return SUCCESS;
+  }
+  return INVALIDPARAMETER;
+}
+
+bStatus_t GAPRole_GetParameter(uint16 param, void *pValue)
+{
+  simNode_t *n = &nodes[cur];
+
+  switch (param)
+  {
+  case GAPROLE_ADVERT_DATA:
+    memcpy(pValue, n->advData, n->advLen);
+    return SUCCESS;
+
+  case GAPROLE_ADVERT_ENABLED:
+    *(uint8 *)pValue = n->advEnabled;
+    return SUCCESS;
+
+  case GAPROLE_BD_ADDR:
+    memset(pValue, 0, B_ADDR_LEN);
+    ((uint8 *)pValue)[0] = LO_UINT16(n->id);
+    ((uint8 *)pValue)[1] = HI_UINT16(n->id);
+    return SUCCESS;
+  }
+  return INVALIDPARAMETER;
+}
+
+/*********************************************************************
+ * THE APPLICATION OF THE SWITCH IN cur
+ */
+
+// The command number rides in bytes 3 - 4 of the packet, and back in the state packet.
+static uint16 lastCmd[SIM_NODES_MAX];
+
+bool parsingDataPacket(uint8 *recvPacket, uint8 PacketLength)
+{
+  uint16 k = BUILD_UINT16(recvPacket[3], recvPacket[4]);
+
+  if (PacketLength == PACKET_LENGTH_NORMAL && k < cmdCnt && cmds[k].target == cur &&
+      cmds[k].deliveredAt == 0)
+  {
+    cmds[k].deliveredAt = now;
+  }
+  lastCmd[cur] = k;
+  return true;
+}
+
+uint8 *getWriteStatePacket(void)
+{
+  uint8 *packet = osal_mem_alloc(PACKET_LENGTH_RESPONSE);
+
+  memset(packet, 0, PACKET_LENGTH_RESPONSE);
+  packet[0] = STX;
+  packet[1] = LO_UINT16(lastCmd[cur]);
+  packet[2] = HI_UINT16(lastCmd[cur]);
+  return packet;
+}
+
+bStatus_t BSProfile_SetParameter(uint8 param, uint8 len, void *value)
+{
+  uint8 *packet = value;
+
+  // STX, length, TYPE_RELAY, target id (2), the target's state packet, ETX
+  if (param == BSPROFILE_CHAR1 && len == HEADER_LENGTH + 2 + PACKET_LENGTH_RESPONSE &&
+      packet[2] == TYPE_RELAY)
+  {
+    uint16 k = BUILD_UINT16(packet[6], packet[7]);
+    uint16 from = BUILD_UINT16(packet[4], packet[3]);
+
+    if (k < cmdCnt && cmds[k].origin == cur && nodes[cmds[k].target].id == from &&
+        cmds[k].ackedAt == 0)
+    {
+      cmds[k].ackedAt = now;
+    }
+  }
+  return SUCCESS;
+}
+
+bStatus_t notifyCharateristicChanged(uint8 param)
+{
+  (void)param;
+  return SUCCESS;
+}
+
+/*********************************************************************
+ * RADIO
+ */
+
+static int hears(uint8 a, uint8 b)
+{
+  double dx = nodes[a].x - nodes[b].x, dy = nodes[a].y - nodes[b].y;
+
+  return (a != b) && (sqrt(dx * dx + dy * dy) <= sc->range + 1e-9);
+}
+
+static uint8 scanChannel(uint8 r, uint64_t t)
+{
+  return (uint8)(((t + nodes[r].scanPhase) / SIM_SCAN_INT_US) % 3);
+}
+
+static void advEvent(uint8 a)
+{
+  simNode_t *n = &nodes[a];
+  uint64_t pduUs = (SIM_PDU_OVERHEAD + n->advLen) * 8;
+  uint64_t t = now;
+  uint8 ch;
+
+  for (ch = 0; ch < 3; ch++)
+  {
+    simTx_t *x = &txs[txNext];
+
+    x->node = a;
+    x->ch = ch;
+    x->start = t;
+    x->end = t + pduUs;
+    x->len = n->advLen;
+    memcpy(x->data, n->advData, n->advLen);
+    simAt(x->end, EV_RX_END, a, txNext, 0);
+    txNext = (txNext + 1) % SIM_TX_MAX;
+
+    n->airUs += pduUs;
+    t += pduUs + SIM_ADV_CH_GAP_US;
+  }
+
+  simAt(now + SIM_ADV_INT_US + simRand() % SIM_ADV_DELAY_US, EV_ADV, a, 0, n->advGen);
+}
+
+static int overlaps(const simTx_t *a, const simTx_t *b)
+{
+  return (a->start < b->end) && (b->start < a->end);
+}
+
+static void rxEnd(uint16 xi)
+{
+  const simTx_t *x = &txs[xi];
+  uint8 r;
+
+  for (r = 0; r < sc->nodes; r++)
+  {
+    simNode_t *n = &nodes[r];
+    uint16 j;
+    int lost = 0;
+
+    if (!hears(x->node, r)) continue;
+    if (n->scanEnd == 0 || n->scanStart > x->start || n->scanEnd < x->end) continue;
+    if (scanChannel(r, x->start) != x->ch || scanChannel(r, x->end) != x->ch) continue;
+
+    for (j = 0; j < SIM_TX_MAX && !lost; j++)
+    {
+      const simTx_t *y = &txs[j];
+
+      if (j == xi || y->end == 0 || !overlaps(x, y)) continue;
+      if (y->node == r)
+      {
+        lost = 1;                 // sending itself
+      }
+      else if (y->ch == x->ch && hears(y->node, r))
+      {
+        lost = 1;
+        collisionCnt++;
+      }
+    }
+    if (lost) continue;
+
+    {
+      gapDeviceInfoEvent_t info;
+      uint8 data[B_MAX_ADV_LEN];
+
+      memcpy(data, x->data, x->len);
+      memset(&info, 0, sizeof(info));
+      info.hdr.event = GAP_MSG_EVENT;
+      info.opcode = GAP_DEVICE_INFO_EVENT;
+      info.eventType = GAP_ADRPT_ADV_NONCONN_IND;
+      info.dataLen = x->len;
+      info.pEvtData = data;
+
+      rxCnt++;
+      cur = r;
+      n->gapMsg((gapEventHdr_t *)&info);
+    }
+  }
+}
+
+/*********************************************************************
+ * SCENARIO
+ */
+
+static void loadNodes(const char *argv0)
+{
+  char so[512], dir[] = "/tmp/relay_simXXXXXX", copy[600];
+  const char *slash = strrchr(argv0, '/');
+  FILE *in;
+  static uint8 image[1 << 20];
+  size_t imageLen;
+  uint8 i;
+
+  snprintf(so, sizeof(so), "%.*slightRelay.so", slash ? (int)(slash - argv0 + 1) : 0, argv0);
+  in = fopen(so, "rb");
+  if (in == NULL || mkdtemp(dir) == NULL)
+  {
+    fprintf(stderr, "cannot load %s\n", so);
+    exit(2);
+  }
+  imageLen = fread(image, 1, sizeof(image), in);
+  fclose(in);
+
+  // One copy of the module per switch, each with its own static data.
+  for (i = 0; i < sc->nodes; i++)
+  {
+    FILE *out;
+    void *lib;
+
+    snprintf(copy, sizeof(copy), "%s/node%02u.so", dir, i);
+    out = fopen(copy, "wb");
+    fwrite(image, 1, imageLen, out);
+    fclose(out);
+
+    lib = dlopen(copy, RTLD_NOW | RTLD_LOCAL);
+    unlink(copy);
+    if (lib == NULL)
+    {
+      fprintf(stderr, "%s\n", dlerror());
+      exit(2);
+    }
+    nodes[i].init = (void (*)(uint8, uint16, uint16))dlsym(lib, "lightRelay_Init");
+    nodes[i].parse = (bool (*)(uint8 *, uint8))dlsym(lib, "lightRelay_ParsePacket");
+    nodes[i].gapMsg = (void (*)(gapEventHdr_t *))dlsym(lib, "lightRelay_ProcessGapMsg");
+    nodes[i].tx = (void (*)(void))dlsym(lib, "lightRelay_ProcessTx");
+    nodes[i].scan = (void (*)(void))dlsym(lib, "lightRelay_ProcessScan");
+  }
+  rmdir(dir);
+}
+
+static void placeNodes(void)
+{
+  uint8 side = (uint8)ceil(sqrt(sc->nodes));
+  uint8 i, j, k;
+
+  for (i = 0; i < sc->nodes; i++)
+  {
+    nodes[i].x = sc->isRow ? i : (i % side);
+    nodes[i].y = sc->isRow ? 0 : (i / side);
+    nodes[i].id = SIM_ID_BASE + i;
+    nodes[i].scanPhase = simRand() % (3 * SIM_SCAN_INT_US);
+  }
+
+  // Hops between switches, from the switches each one hears
+  memset(hopTbl, 0xFF, sizeof(hopTbl));
+  for (i = 0; i < sc->nodes; i++)
+  {
+    uint8 queue[SIM_NODES_MAX], head = 0, tail = 0;
+
+    hopTbl[i][i] = 0;
+    queue[tail++] = i;
+    while (head < tail)
+    {
+      j = queue[head++];
+      for (k = 0; k < sc->nodes; k++)
+      {
+        if (hears(j, k) && hopTbl[i][k] == 0xFF)
+        {
+          hopTbl[i][k] = hopTbl[i][j] + 1;
+          queue[tail++] = k;
+        }
+      }
+    }
+  }
+}
+
+static void pickCommands(void)
+{
+  uint16 k;
+
+  cmdCnt = sc->cmds;
+  for (k = 0; k < cmdCnt; k++)
+  {
+    simCmd_t *c = &cmds[k];
+
+    if (sc->isTest && sc->isRow)
+    {
+      c->origin = 0;                                  // 1, 2 .. RELAY_TTL + 1 hops in turn
+      c->target = 1 + k % (RELAY_TTL + 1);
+    }
+    else
+    {
+      do
+      {
+        c->origin = simRand() % sc->nodes;
+        c->target = simRand() % sc->nodes;
+      } while (hopTbl[c->origin][c->target] == 0 || hopTbl[c->origin][c->target] > RELAY_TTL);
+    }
+    c->hops = hopTbl[c->origin][c->target];
+    simAt(SIM_WARMUP_US + (uint64_t)k * sc->cmdEveryMs * 1000, EV_CMD, c->origin, k, 0);
+  }
+}
+
+static void sendCommand(uint16 k)
+{
+  simCmd_t *c = &cmds[k];
+  uint16 target = nodes[c->target].id;
+  // STX, length, TYPE_RELAY, target id (2), a normal packet with the command number, ETX
+  uint8 packet[HEADER_LENGTH + 2 + PACKET_LENGTH_NORMAL];
+
+  memset(packet, 0, sizeof(packet));
+  packet[0] = STX;
+  packet[1] = 2 + PACKET_LENGTH_NORMAL;
+  packet[2] = TYPE_RELAY;
+  packet[3] = HI_UINT16(target);
+  packet[4] = LO_UINT16(target);
+  packet[5] = STX;
+  packet[5 + 3] = LO_UINT16(k);
+  packet[5 + 4] = HI_UINT16(k);
+  packet[5 + PACKET_LENGTH_NORMAL - 1] = ETX;
+  packet[sizeof(packet) - 1] = ETX;
+
+  c->sentAt = now;
+  cur = c->origin;
+  if (!nodes[cur].parse(packet, sizeof(packet)))
+  {
+    printf("FAIL command %u refused by its origin\n", k);
+    fails++;
+  }
+}
+
+static void runEvents(uint64_t until)
+{
+  while (evCnt != 0 && evq[0].t <= until)
+  {
+    simEvent_t e = simNext();
+    simNode_t *n = &nodes[e.node];
+
+    now = e.t;
+    cur = e.node;
+
+    switch (e.type)
+    {
+    case EV_TIMER:
+      if (e.gen != n->timerGen[evtIdx(e.arg)]) break;
+      if (e.arg == SIM_EVT_TX) n->tx();
+      else n->scan();
+      break;
+
+    case EV_ADV:
+      if (e.gen == n->advGen && n->advEnabled) advEvent(e.node);
+      break;
+
+    case EV_RX_END:
+      rxEnd(e.arg);
+      break;
+
+    case EV_SCAN_END:
+      if (e.gen == n->scanGen)
+      {
+        gapDevDiscEvent_t disc;
+
+        memset(&disc, 0, sizeof(disc));
+        disc.hdr.event = GAP_MSG_EVENT;
+        disc.opcode = GAP_DEVICE_DISCOVERY_EVENT;
+        n->scanEnd = 0;
+        n->gapMsg((gapEventHdr_t *)&disc);
+      }
+      break;
+
+    case EV_CMD:
+      sendCommand(e.arg);
+      break;
+    }
+  }
+  now = until;
+}
+
+static int cmpU64(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+static void report(uint64_t runUs)
+{
+  static uint64_t lat[SIM_CMDS_MAX];
+  uint16 delivered = 0, acked = 0, inReach = 0, k;
+  uint64_t airUs = 0, rttSum = 0;
+  uint8 h, i;
+
+  for (i = 0; i < sc->nodes; i++)
+  {
+    airUs += nodes[i].airUs;
+  }
+  for (k = 0; k < cmdCnt; k++)
+  {
+    if (cmds[k].hops > RELAY_TTL) continue;
+    inReach++;
+    delivered += (cmds[k].deliveredAt != 0);
+    acked += (cmds[k].ackedAt != 0);
+    if (cmds[k].ackedAt != 0) rttSum += cmds[k].ackedAt - cmds[k].sentAt;
+  }
+
+  printf("%-10s %5u %6.1f %6.1f %7.0f", sc->name, cmdCnt, 100.0 * delivered / inReach,
+         100.0 * acked / inReach, acked ? rttSum / 1000.0 / acked : 0.0);
+
+  // Median latency to the target by hops
+  for (h = 1; h <= RELAY_TTL; h++)
+  {
+    uint16 m = 0;
+
+    for (k = 0; k < cmdCnt; k++)
+    {
+      if (cmds[k].hops == h && cmds[k].deliveredAt != 0)
+      {
+        lat[m++] = cmds[k].deliveredAt - cmds[k].sentAt;
+      }
+    }
+    qsort(lat, m, sizeof(lat[0]), cmpU64);
+    if (m) printf(" %6.0f", lat[m / 2] / 1000.0);
+    else printf(" %6s", "-");
+  }
+
+  printf(" %7.1f %6.2f %6.1f\n", airUs / 1000.0 / cmdCnt, 100.0 * airUs / runUs / 3,
+         (double)collisionCnt / cmdCnt);
+
+  if (sc->isTest && !sc->isRow && (delivered * 100 < SIM_PASS_PCT * inReach ||
+                                   acked * 100 < SIM_PASS_PCT * inReach))
+  {
+    printf("FAIL %s: delivered %u and acked %u of %u\n", sc->name, delivered, acked, inReach);
+    fails++;
+  }
+}
+
+static void checkRow(void)
+{
+  uint16 k;
+  uint8 i;
+
+  for (k = 0; k < cmdCnt; k++)
+  {
+    const simCmd_t *c = &cmds[k];
+
+    if (c->hops <= RELAY_TTL && (c->deliveredAt == 0 || c->ackedAt == 0))
+    {
+      printf("FAIL command %u over %u hops: delivered %d acked %d\n", k, c->hops,
+             c->deliveredAt != 0, c->ackedAt != 0);
+      fails++;
+    }
+    if (c->hops > RELAY_TTL && c->deliveredAt != 0)
+    {
+      printf("FAIL command %u went %u hops, beyond RELAY_TTL\n", k, c->hops);
+      fails++;
+    }
+  }
+
+  for (i = 0; i < sc->nodes; i++)
+  {
+    const simNode_t *n = &nodes[i];
+
+    if (n->advEnabled != (i == 2) || n->advLen != sizeof(ownAdvert) ||
+        memcmp(n->advData, ownAdvert, sizeof(ownAdvert)) != 0)
+    {
+      printf("FAIL switch %u advertises %s with %u bytes after the bursts\n", i,
+             n->advEnabled ? "on" : "off", n->advLen);
+      fails++;
+    }
+  }
+}
+
+static void runScenario(const char *argv0)
+{
+  uint64_t end;
+  uint8 i;
+
+  loadNodes(argv0);
+  placeNodes();
+
+  for (i = 0; i < sc->nodes; i++)
+  {
+    uint8 on = sc->isTest && sc->isRow && (i == 2);
+
+    cur = i;
+    GAPRole_SetParameter(GAPROLE_ADVERT_DATA, sizeof(ownAdvert), (void *)ownAdvert);
+    GAPRole_SetParameter(GAPROLE_ADVERT_ENABLED, sizeof(uint8), &on);
+    nodes[i].init(i, SIM_EVT_TX, SIM_EVT_SCAN);
+  }
+  pickCommands();
+
+  end = SIM_WARMUP_US + (uint64_t)cmdCnt * sc->cmdEveryMs * 1000 + SIM_TAIL_US;
+  runEvents(end);
+
+  // Only the switch that advertised before may still be on the air: airtime of the
+  // commands is up to here.
+  report(end);
+  if (sc->isTest && sc->isRow)
+  {
+    checkRow();
+  }
+}
+
+/*********************************************************************
+ * MAIN
+ */
+
+static const simScenario_t testScenarios[] =
+{
+  { "row 6",   6, TRUE,  1.2, 5 * (RELAY_TTL + 1), 5000, TRUE },
+  { "grid 50", 50, FALSE, 1.5, 100, 5000, TRUE },
+};
+
+static const simScenario_t benchScenarios[] =
+{
+  { "grid 10", 10, FALSE, 1.5, 100, 5000, FALSE },
+  { "grid 25", 25, FALSE, 1.5, 100, 5000, FALSE },
+  { "grid 50", 50, FALSE, 1.5, 100, 5000, FALSE },
+  { "grid 50/1s", 50, FALSE, 1.5, 200, 1000, FALSE },
+};
+
+int main(int argc, char **argv)
+{
+  uint8 test = (argc > 1) && (strcmp(argv[1], "-t") == 0);
+  const simScenario_t *list = test ? testScenarios : benchScenarios;
+  uint8 cnt = test ? sizeof(testScenarios) / sizeof(testScenarios[0])
+                   : sizeof(benchScenarios) / sizeof(benchScenarios[0]);
+  uint8 i;
+
+  printf("relay ttl=%u burst=%u ms jitter=%u ms scan=%u ms adv=%u ms\n", RELAY_TTL,
+         RELAY_BURST_MS, RELAY_JITTER_MS, RELAY_SCAN_MS, SIM_ADV_INT_US / 1000);
+  printf("%-10s %5s %6s %6s %7s %6s %6s %6s %6s %7s %6s %6s\n", "", "cmds", "dlv %", "ack %",
+         "rtt ms", "1 hop", "2 hops", "3 hops", "4 hops", "air ms", "busy %", "coll");
+
+  // Each scenario in its own process: the modules start from their initial static data.
+  for (i = 0; i < cnt; i++)
+  {
+    pid_t pid;
+    int status;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0)
+    {
+      sc = &list[i];
+      runScenario(argv[0]);
+      fflush(stdout);
+      _exit(fails ? 1 : 0);
+    }
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+      fails++;
+    }
+  }
+
+  if (test)
+  {
+    printf("%s\n", fails ? "FAIL" : "PASS");
+  }
+  return fails ? 1 : 0;
+}
@@ -0,0 +1,771 @@
+/**************************************************************************************************
+  Filename:       sbl_bench.c
+
+  Description:
+
+  Runs the serial boot loader of Projects/ble/util/SBL (sbl_exec.c built with SBL_STREAM=TRUE
+  and its polled UART transport _sbl_uart.c, included here as sbl_main.c does) on the register
+  model of hal_sim.c, against a peer on USART 0 that downloads an image the way the host tool
+  would:
+
+    sbl_bench         Download time of the same image with SBL_WRITE_CMD and a read back of
+                      every block by SBL_READ_CMD, and with the streamed mode.
+    sbl_bench -t      Test of the streamed mode. Fails unless every check below holds.
+
+  The streamed download: SBL_STREAM_CMD, then SBL_STREAM_WRITE_CMD frames back to back as long
+  as fewer than the granted window of frames wait for their ack. An ack holds the address the
+  boot loader expects next and so covers every frame before it. The peer goes back to the acked
+  address when an ack is SBL_IGNORED (a frame before it was lost) or when no ack came for
+  PEER_ACK_TIMEOUT_MS (the last frame sent was lost). A frame is lost by sending it with a bad
+  FCS, the first time only.
+
+  Checks of the test:
+    - SBL_STREAM_CMD clips the frame length asked for to SBL_STREAM_MAX_LEN and grants a window
+      of two frames.
+    - SBL_STREAM_CMD erases the pages of the image and those of an older image left past it, or
+      the whole image area for a host that does not send the image length.
+    - Every SUCCESS ack is the address after its frame, and the acks never go back.
+    - A frame lost mid-stream is answered with SBL_IGNORED at its address and resent from
+      there; a lost last frame is resent after the ack timeout.
+    - No byte is overrun in the USART while a frame is written to flash by DMA.
+    - The image is in flash as sent and the rest of the image area is erased. SBL_ENABLE_CMD
+      validates it by its CRC and the boot loader resets, or answers SBL_VALIDATE_FAILED and
+      does not reset if the CRC in the image is wrong.
+
+  HalFlashRead() of hal_flash.c maps the flash bank into XDATA, which the model has not, so the
+  flash functions are stand-ins here, on the flash controller of hal_sim.c as hal_flash.c uses
+  it. The CPU stalls while a page is erased, so HalFlashErase() waits for it.
+**************************************************************************************************/
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "hal_adc.h"
+#include "hal_dma.h"
+#include "hal_flash.h"
+#include "hal_mcu.h"
+#include "hal_rpc.h"
+#include "sbl_app.h"
+#include "sbl_exec.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+// As in sbl_exec.c.
+#define SBL_WRITE_CMD             0x01
+#define SBL_READ_CMD              0x02
+#define SBL_ENABLE_CMD            0x03
+#define SBL_STREAM_CMD            0x05
+#define SBL_STREAM_WRITE_CMD      0x06
+#define SBL_RSP_MASK              0x80
+#define SBL_SUCCESS               0
+#define SBL_VALIDATE_FAILED       7
+#define SBL_IGNORED               9
+#define SBL_RW_BUF_LEN            64
+#define SBL_STREAM_MAX_LEN        240
+#define SBL_STREAM_WINDOW         2
+
+#define SBL_IMG_WORDS            (HAL_SBL_IMG_END - HAL_SBL_IMG_BEG)
+#define SBL_CRC_OSET            ((HAL_SBL_IMG_CRC - HAL_SBL_IMG_BEG) * HAL_FLASH_WORD_SIZE)
+
+#define PEER_FRAME_MAX            256
+#define PEER_START_MS             1       // after the boot loader set up its UART
+#define PEER_ACK_TIMEOUT_MS       60      // about three frames of 240 bytes at 115200 baud
+#define PEER_RUN_LIMIT_MS         60000
+
+enum { RUN_DONE = 1, RUN_RESET, RUN_LIMIT };
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  const char *name;
+  uint32 imgLen;                  // bytes
+  uint8 stream;                   // FALSE: SBL_WRITE_CMD and read back
+  uint8 frameAsk;                 // frame length asked for by SBL_STREAM_CMD
+  uint8 loseMid;                  // lose a frame in the middle of the stream
+  uint8 loseLast;                 // lose the last frame
+  uint8 badCrc;                   // an image with a wrong CRC
+  uint32 staleLen;                // bytes of an older image in the image area at the start
+  uint8 noLen;                    // SBL_STREAM_CMD without the image length, as an older host
+} benchScenario_t;
+
+typedef struct
+{
+  uint32 frames;                  // commands with data, resends included
+  uint32 resent;
+  uint32 ignored;                 // SBL_IGNORED acks
+  uint32 timeouts;
+  uint64_t erasePs;               // SBL_STREAM_CMD
+  uint64_t ps;                    // from the first command to the SBL_ENABLE_CMD response
+} benchResult_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static const benchScenario_t testScenarios[] =
+{
+  { "stream",          8192, TRUE,  255, FALSE, FALSE, FALSE,     0, FALSE },
+  { "stream lost",     8192, TRUE,  240, TRUE,  TRUE,  FALSE,     0, FALSE },
+  { "stream bad crc",  4096, TRUE,   16, FALSE, FALSE, TRUE,      0, FALSE },
+  { "stream stale",    4096, TRUE,  240, FALSE, FALSE, FALSE, 12000, FALSE },
+  { "stream no len",   4096, TRUE,  240, FALSE, FALSE, FALSE, 12000, TRUE  },
+};
+
+static const benchScenario_t benchScenarios[] =
+{
+  { "legacy 16K",     16384, FALSE,   0, FALSE, FALSE, FALSE,     0, FALSE },
+  { "stream 16K",     16384, TRUE,  240, FALSE, FALSE, FALSE,     0, FALSE },
+  { "stream 16K lost",16384, TRUE,  240, TRUE,  TRUE,  FALSE,     0, FALSE },
+  { "stream 16K stale",16384,TRUE,  240, FALSE, FALSE, FALSE, 65536, FALSE },
+  { "stream 16K nolen",16384,TRUE,  240, FALSE, FALSE, FALSE,     0, TRUE  },
+  { "legacy 64K",     65536, FALSE,   0, FALSE, FALSE, FALSE,     0, FALSE },
+  { "stream 64K",     65536, TRUE,  240, FALSE, FALSE, FALSE,     0, FALSE },
+};
+
+static const benchScenario_t *sc;
+static uint8 isTest;
+static uint8 fails;
+static jmp_buf runJmp;
+
+halDMADesc_t dmaCh0;              // as sbl_main.c sets it up for HalFlashWrite()
+
+static uint8 img[SBL_IMG_WORDS * HAL_FLASH_WORD_SIZE];
+static uint16 imgWords;
+static uint16 imgCrc;
+
+// Peer Tx: the frame being shifted into the boot loader.
+static uint8 peerTxFrame[PEER_FRAME_MAX];
+static uint16 peerTxLen, peerTxIdx;
+static uint8 peerTxPending;           // a command waits for the line
+
+// Peer Rx: the response being parsed.
+static uint8 peerRxFrame[PEER_FRAME_MAX];
+static uint16 peerRxIdx, peerRxLen;
+
+// Download state.
+static uint8 phase;
+static uint8 frameLen;            // granted, bytes
+static uint16 sendAddr;           // next word to send, from the image start
+static uint16 ackAddr;            // word the boot loader expects next
+static uint16 sentEnd;            // end of the furthest frame sent
+static uint16 rewindAddr = 0xFFFF;
+static uint8 lostMid, lostLast;
+static uint32 ackGen;
+static uint64_t startPs;
+static benchResult_t res;
+static uint32 erases;
+
+enum { PHASE_START, PHASE_STREAM, PHASE_WRITE, PHASE_READ, PHASE_ENABLE, PHASE_END };
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+static void peerSend(uint8 cmd1, const uint8 *pData, uint8 len, uint8 corrupt);
+static void peerNext(void);
+static void peerRsp(uint8 cmd1, const uint8 *pData, uint8 len);
+static void fail(const char *fmt, ...);
+
+/*********************************************************************
+ * HOST STUBS
+ */
+
+uint8 HalAdcCheckVdd(uint8 vdd)
+{
+  (void)vdd;
+  return TRUE;
+}
+
+void HalFlashRead(uint8 pg, uint16 offset, uint8 *buf, uint16 cnt)
+{
+  memcpy(buf, &halSimFlash[(uint32)pg * HAL_FLASH_PAGE_SIZE + offset], cnt);
+}
+
+void HalFlashWrite(uint16 addr, uint8 *buf, uint16 cnt)
+{
+  HalFlashWriteStart(addr, buf, cnt);
+  while (FCTL & 0x80);
+}
+
+void HalFlashWriteStart(uint16 addr, uint8 *buf, uint16 cnt)
+{
+  halDMADesc_t *ch = HAL_NV_DMA_GET_DESC();
+
+  HAL_DMA_SET_SOURCE(ch, buf);
+  HAL_DMA_SET_DEST(ch, &FWDATA);
+  HAL_DMA_SET_VLEN(ch, HAL_DMA_VLEN_USE_LEN);
+  HAL_DMA_SET_LEN(ch, (cnt * HAL_FLASH_WORD_SIZE));
+  HAL_DMA_SET_WORD_SIZE(ch, HAL_DMA_WORDSIZE_BYTE);
+  HAL_DMA_SET_TRIG_MODE(ch, HAL_DMA_TMODE_SINGLE);
+  HAL_DMA_SET_TRIG_SRC(ch, HAL_DMA_TRIG_FLASH);
+  HAL_DMA_SET_SRC_INC(ch, HAL_DMA_SRCINC_1);
+  HAL_DMA_SET_DST_INC(ch, HAL_DMA_DSTINC_0);
+  HAL_DMA_SET_IRQ(ch, HAL_DMA_IRQMASK_DISABLE);
+  HAL_DMA_SET_M8( ch, HAL_DMA_M8_USE_8_BITS);
+  HAL_DMA_SET_PRIORITY(ch, HAL_DMA_PRI_HIGH);
+  HAL_DMA_CLEAR_IRQ(HAL_NV_DMA_CH);
+  HAL_DMA_ARM_CH(HAL_NV_DMA_CH);
+
+  FADDRL = (uint8)addr;
+  FADDRH = (uint8)(addr >> 8);
+  FCTL |= 0x02;
+}
+
+void HalFlashErase(uint8 pg)
+{
+  FADDRH = pg * (HAL_FLASH_PAGE_SIZE / HAL_FLASH_WORD_SIZE / 256);
+  FCTL |= 0x01;
+  while (FCTL & 0x80);  // The CPU stalls until the page is erased.
+  erases++;
+}
+
+void halAssertHandler(void)
+{
+  fprintf(stderr, "sbl_bench: HAL_ASSERT failed\n");
+  exit(2);
+}
+
+/*********************************************************************
+ * THE BOOT LOADER
+ */
+
+#include "_sbl_uart.c"
+
+/*********************************************************************
+ * PEER
+ */
+
+static uint16 crc16(uint16 crc, uint8 val)
+{
+  for (uint8 cnt = 0; cnt < 8; cnt++, val <<= 1)
+  {
+    uint8 msb = (crc & 0x8000) ? 1 : 0;
+
+    crc <<= 1;
+    if (val & 0x80)  crc |= 0x0001;
+    if (msb)         crc ^= 0x1021;
+  }
+
+  return crc;
+}
+
+// The CRC of calcCRC() in sbl_exec.c over the whole image area, erased past the image.
+static uint16 imgCalcCrc(void)
+{
+  uint16 crc = 0;
+
+  for (uint32 i = 0; i < sizeof(img); i++)
+  {
+    if (i / HAL_FLASH_WORD_SIZE != SBL_CRC_OSET / HAL_FLASH_WORD_SIZE)
+    {
+      crc = crc16(crc, img[i]);
+    }
+  }
+  crc = crc16(crc, 0);
+  return crc16(crc, 0);
+}
+
+static void imgMake(void)
+{
+  uint32 rnd = 0x2545F491;
+
+  memset(img, 0xFF, sizeof(img));
+  for (uint32 i = 0; i < sc->imgLen; i++)
+  {
+    rnd ^= rnd << 13;
+    rnd ^= rnd >> 17;
+    rnd ^= rnd << 5;
+    img[i] = (uint8)rnd;
+  }
+  imgWords = (uint16)(sc->imgLen / HAL_FLASH_WORD_SIZE);
+
+  // The CRC and its shadow, which SBL_ENABLE_CMD sets once the image is valid.
+  img[SBL_CRC_OSET + 2] = 0xFF;
+  img[SBL_CRC_OSET + 3] = 0xFF;
+  img[SBL_CRC_OSET] = 0;
+  img[SBL_CRC_OSET + 1] = 0;
+  imgCrc = imgCalcCrc();
+  if (sc->badCrc)
+  {
+    imgCrc ^= 0x0100;
+  }
+  img[SBL_CRC_OSET] = LO_UINT16(imgCrc);
+  img[SBL_CRC_OSET + 1] = HI_UINT16(imgCrc);
+}
+
+static void peerSend(uint8 cmd1, const uint8 *pData, uint8 len, uint8 corrupt)
+{
+  uint8 fcs = 0;
+
+  peerTxFrame[0] = RPC_UART_SOF;
+  peerTxFrame[1] = len;
+  peerTxFrame[2] = RPC_CMD_SREQ | RPC_SYS_BOOT;
+  peerTxFrame[3] = cmd1;
+  memcpy(&peerTxFrame[4], pData, len);
+  for (uint16 i = 1; i < 4 + len; i++)
+  {
+    fcs ^= peerTxFrame[i];
+  }
+  peerTxFrame[4 + len] = corrupt ? (uint8)~fcs : fcs;
+  peerTxLen = 5 + len;
+  peerTxIdx = 0;
+}
+
+static void ackTimeout(void *arg)
+{
+  if ((uint32)(uintptr_t)arg != ackGen || phase != PHASE_STREAM || ackAddr == sendAddr)
+  {
+    return;
+  }
+
+  res.timeouts++;
+  sendAddr = rewindAddr = ackAddr;
+  peerNext();
+  halSimUartKick(HAL_UART_PORT_0);
+}
+
+static void ackArm(void)
+{
+  ackGen++;
+  halSimAt(halSimTime() + HAL_SIM_MS(PEER_ACK_TIMEOUT_MS), ackTimeout,
+           (void *)(uintptr_t)ackGen);
+}
+
+// The next command, if the line is free and one is due. Shifted in once the line is kicked,
+// or at once when peerTx() asks for it.
+static void peerNext(void)
+{
+  uint8 buf[PEER_FRAME_MAX];
+
+  if (peerTxIdx < peerTxLen)
+  {
+    return;
+  }
+
+  switch (phase)
+  {
+  case PHASE_START:
+    if (peerTxPending)
+    {
+      peerTxPending = FALSE;
+      buf[0] = 0;
+      buf[1] = 0;
+      if (sc->stream)
+      {
+        buf[2] = sc->frameAsk;
+        buf[3] = LO_UINT16(imgWords);
+        buf[4] = HI_UINT16(imgWords);
+        peerSend(SBL_STREAM_CMD, buf, sc->noLen ? 3 : 5, FALSE);
+      }
+      else
+      {
+        phase = PHASE_WRITE;
+        peerTxPending = TRUE;
+        peerNext();
+      }
+    }
+    break;
+
+  case PHASE_STREAM:
+    if (sendAddr < imgWords &&
+        (sendAddr - ackAddr) < SBL_STREAM_WINDOW * (frameLen / HAL_FLASH_WORD_SIZE))
+    {
+      uint16 cnt = frameLen;
+      uint8 corrupt = FALSE;
+
+      if ((uint32)(sendAddr * HAL_FLASH_WORD_SIZE) + cnt > sc->imgLen)
+      {
+        cnt = (uint16)(sc->imgLen - sendAddr * HAL_FLASH_WORD_SIZE);
+      }
+      if (sc->loseMid && !lostMid && sendAddr == 4 * (frameLen / HAL_FLASH_WORD_SIZE))
+      {
+        lostMid = corrupt = TRUE;
+      }
+      if (sc->loseLast && !lostLast && sendAddr + cnt / HAL_FLASH_WORD_SIZE == imgWords)
+      {
+        lostLast = corrupt = TRUE;
+      }
+
+      buf[0] = LO_UINT16(sendAddr);
+      buf[1] = HI_UINT16(sendAddr);
+      memcpy(&buf[2], &img[sendAddr * HAL_FLASH_WORD_SIZE], cnt);
+      res.frames++;
+      if (sendAddr < sentEnd)
+      {
+        res.resent++;
+      }
+      sendAddr += cnt / HAL_FLASH_WORD_SIZE;
+      if (sendAddr > sentEnd)
+      {
+        sentEnd = sendAddr;
+      }
+      peerSend(SBL_STREAM_WRITE_CMD, buf, (uint8)(2 + cnt), corrupt);
+      ackArm();
+    }
+    else if (ackAddr == imgWords)
+    {
+      phase = PHASE_ENABLE;
+      peerSend(SBL_ENABLE_CMD, buf, 0, FALSE);
+    }
+    break;
+
+  case PHASE_WRITE:
+  case PHASE_READ:
+    if (peerTxPending)
+    {
+      peerTxPending = FALSE;
+      buf[0] = LO_UINT16(sendAddr);
+      buf[1] = HI_UINT16(sendAddr);
+      if (phase == PHASE_WRITE)
+      {
+        memcpy(&buf[2], &img[sendAddr * HAL_FLASH_WORD_SIZE], SBL_RW_BUF_LEN);
+        peerSend(SBL_WRITE_CMD, buf, 2 + SBL_RW_BUF_LEN, FALSE);
+      }
+      else
+      {
+        peerSend(SBL_READ_CMD, buf, 2, FALSE);
+      }
+      res.frames++;
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+static void peerRsp(uint8 cmd1, const uint8 *pData, uint8 len)
+{
+  uint8 status = pData[0];
+
+  switch (cmd1 & ~SBL_RSP_MASK)
+  {
+  case SBL_STREAM_CMD:
+    frameLen = pData[1];
+    if (status != SBL_SUCCESS || len != 3 || pData[2] != SBL_STREAM_WINDOW ||
+        frameLen != ((sc->frameAsk < SBL_RW_BUF_LEN) ? SBL_RW_BUF_LEN :
+                     (sc->frameAsk > SBL_STREAM_MAX_LEN) ? SBL_STREAM_MAX_LEN :
+                     (sc->frameAsk & ~(HAL_FLASH_WORD_SIZE - 1))))
+    {
+      fail("SBL_STREAM_CMD answered status %u, frame %u, window %u for a frame of %u",
+           status, frameLen, pData[2], sc->frameAsk);
+      longjmp(runJmp, RUN_DONE);
+    }
+    phase = PHASE_STREAM;
+    res.erasePs = halSimTime() - startPs;
+    break;
+
+  case SBL_STREAM_WRITE_CMD:
+  {
+    uint16 addr = BUILD_UINT16(pData[1], pData[2]);
+
+    if (status == SBL_IGNORED)
+    {
+      res.ignored++;
+      if (addr != ackAddr)
+      {
+        fail("SBL_IGNORED at word %u, the last ack was %u", addr, ackAddr);
+      }
+      if (addr != rewindAddr)
+      {
+        sendAddr = rewindAddr = addr;
+      }
+    }
+    else if (status != SBL_SUCCESS)
+    {
+      fail("SBL_STREAM_WRITE_CMD answered status %u at word %u", status, addr);
+      longjmp(runJmp, RUN_DONE);
+    }
+    else if (addr <= ackAddr || addr > sendAddr ||
+             (addr != imgWords && (addr % (frameLen / HAL_FLASH_WORD_SIZE)) != 0))
+    {
+      fail("ack of word %u after %u, %u sent", addr, ackAddr, sendAddr);
+    }
+    else
+    {
+      ackAddr = addr;
+      ackArm();
+    }
+    break;
+  }
+
+  case SBL_WRITE_CMD:
+  case SBL_READ_CMD:
+    if (status != SBL_SUCCESS)
+    {
+      fail("command 0x%02x answered status %u", cmd1, status);
+      longjmp(runJmp, RUN_DONE);
+    }
+    if ((cmd1 & ~SBL_RSP_MASK) == SBL_READ_CMD &&
+        memcmp(&pData[3], &img[sendAddr * HAL_FLASH_WORD_SIZE], SBL_RW_BUF_LEN) != 0)
+    {
+      fail("read back of word %u differs", sendAddr);
+    }
+    sendAddr += SBL_RW_BUF_LEN / HAL_FLASH_WORD_SIZE;
+    peerTxPending = TRUE;
+    if (sendAddr >= imgWords)
+    {
+      sendAddr = 0;
+      if (phase == PHASE_WRITE)
+      {
+        phase = PHASE_READ;
+      }
+      else
+      {
+        phase = PHASE_ENABLE;
+        peerTxPending = FALSE;
+        peerSend(SBL_ENABLE_CMD, pData, 0, FALSE);
+      }
+    }
+    break;
+
+  case SBL_ENABLE_CMD:
+    res.ps = halSimTime() - startPs;
+    phase = PHASE_END;
+    if (status != (sc->badCrc ? SBL_VALIDATE_FAILED : SBL_SUCCESS))
+    {
+      fail("SBL_ENABLE_CMD answered status %u", status);
+    }
+    if (status != SBL_SUCCESS)
+    {
+      longjmp(runJmp, RUN_DONE);
+    }
+    break;
+
+  default:
+    fail("response 0x%02x to no command", cmd1);
+    break;
+  }
+}
+
+static void peerRx(uint8_t port, uint8_t byte)
+{
+  (void)port;
+
+  if (peerRxIdx == 0 && byte != RPC_UART_SOF)
+  {
+    return;  // the garbage byte after the SBL_ENABLE_CMD response
+  }
+
+  peerRxFrame[peerRxIdx++] = byte;
+  if (peerRxIdx == 2)
+  {
+    peerRxLen = 5 + byte;
+  }
+  if (peerRxIdx < 2 || peerRxIdx < peerRxLen)
+  {
+    return;
+  }
+
+  peerRxIdx = 0;
+  {
+    uint8 fcs = 0;
+
+    for (uint16 i = 1; i < peerRxLen - 1; i++)
+    {
+      fcs ^= peerRxFrame[i];
+    }
+    if (fcs != peerRxFrame[peerRxLen - 1] || (peerRxFrame[2] & RPC_SUBSYSTEM_MASK) != RPC_SYS_BOOT)
+    {
+      fail("response with a bad FCS");
+      return;
+    }
+  }
+
+  peerRsp(peerRxFrame[3], &peerRxFrame[4], peerRxFrame[1]);
+  peerNext();
+  halSimUartKick(HAL_UART_PORT_0);
+}
+
+static int peerTx(uint8_t port, uint8_t rts)
+{
+  (void)port;
+  (void)rts;
+
+  if (peerTxIdx == peerTxLen)
+  {
+    peerNext();
+    if (peerTxIdx == peerTxLen)
+    {
+      return -1;
+    }
+  }
+
+  return peerTxFrame[peerTxIdx++];
+}
+
+static const halSimUartPeer_t peer = { peerRx, peerTx };
+
+static void peerStart(void *arg)
+{
+  (void)arg;
+
+  startPs = halSimTime();
+  peerTxPending = TRUE;
+  peerNext();
+  halSimUartKick(HAL_UART_PORT_0);
+}
+
+/*********************************************************************
+ * BENCH
+ */
+
+static void fail(const char *fmt, ...)
+{
+  va_list ap;
+
+  va_start(ap, fmt);
+  printf("FAIL %s: ", sc->name);
+  vprintf(fmt, ap);
+  printf("\n");
+  va_end(ap);
+  fails++;
+}
+
+static void onReset(void)
+{
+  longjmp(runJmp, RUN_RESET);
+}
+
+static void onLimit(void *arg)
+{
+  (void)arg;
+  longjmp(runJmp, RUN_LIMIT);
+}
+
+static void checkFlash(void)
+{
+  uint8 *pArea = &halSimFlash[HAL_SBL_IMG_BEG * HAL_FLASH_WORD_SIZE];
+
+  for (uint32 i = 0; i < sizeof(img); i++)
+  {
+    uint8 want = img[i];
+
+    // SBL_ENABLE_CMD copies a valid CRC to its shadow.
+    if (!sc->badCrc && (i == SBL_CRC_OSET + 2 || i == SBL_CRC_OSET + 3))
+    {
+      want = img[i - 2];
+    }
+    if (pArea[i] != want)
+    {
+      fail("flash at 0x%05x is 0x%02x, not 0x%02x",
+           (unsigned)(HAL_SBL_IMG_BEG * HAL_FLASH_WORD_SIZE + i), pArea[i], want);
+      return;
+    }
+  }
+}
+
+static void runScenario(void)
+{
+  volatile int run;
+
+  imgMake();
+  halSimInit();
+  memset(&halSimFlash[HAL_SBL_IMG_BEG * HAL_FLASH_WORD_SIZE], 0x5A, sc->staleLen);
+  halSimUartPeer(HAL_UART_PORT_0, &peer);
+  halSimResetHook(onReset);
+  HAL_DMA_SET_ADDR_DESC0(&dmaCh0);
+  halSimAt(HAL_SIM_MS(PEER_START_MS), peerStart, NULL);
+  halSimAt(HAL_SIM_MS(PEER_RUN_LIMIT_MS), onLimit, NULL);
+
+  if ((run = setjmp(runJmp)) == 0)
+  {
+    sblRun();
+  }
+
+  if (run == RUN_LIMIT)
+  {
+    fail("no SBL_ENABLE_CMD response within %u ms", PEER_RUN_LIMIT_MS);
+  }
+  else if (run == RUN_RESET && (phase != PHASE_END || sc->badCrc))
+  {
+    fail("reset before the image was enabled");
+  }
+  else if (run == RUN_DONE && phase == PHASE_END && !sc->badCrc)
+  {
+    fail("no reset after the image was enabled");
+  }
+  if (halSimStats.rxLost[0] != 0)
+  {
+    fail("%u bytes overrun in the USART", halSimStats.rxLost[0]);
+  }
+  if (sc->stream &&
+      (res.ignored != (sc->loseMid ? 1 : 0) || res.timeouts != (sc->loseLast ? 1 : 0)))
+  {
+    fail("%u SBL_IGNORED acks and %u ack timeouts", res.ignored, res.timeouts);
+  }
+  if (sc->stream && res.frames - res.resent != (sc->imgLen + frameLen - 1) / frameLen)
+  {
+    fail("%u frames sent, %u of them again, for %u bytes", res.frames, res.resent, sc->imgLen);
+  }
+  if (sc->stream)
+  {
+    uint32 end = sc->noLen ? SBL_IMG_WORDS * HAL_FLASH_WORD_SIZE
+                           : (sc->imgLen > sc->staleLen) ? sc->imgLen : sc->staleLen;
+
+    if (erases != (end + HAL_FLASH_PAGE_SIZE - 1) / HAL_FLASH_PAGE_SIZE)
+    {
+      fail("%u pages erased, not %u", erases, (end + HAL_FLASH_PAGE_SIZE - 1) / HAL_FLASH_PAGE_SIZE);
+    }
+  }
+  checkFlash();
+
+  printf("%-16s %6u %5u %6u %6u %4u %4u %8.1f %8.1f %7.0f\n", sc->name, sc->imgLen,
+         sc->stream ? frameLen : SBL_RW_BUF_LEN, res.frames, res.resent, res.ignored,
+         res.timeouts, res.erasePs / 1e9, res.ps / 1e9,
+         (res.ps != 0) ? sc->imgLen * 1e12 / res.ps : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+  const benchScenario_t *list;
+  uint8 cnt;
+
+  isTest = (argc > 1) && (strcmp(argv[1], "-t") == 0);
+  list = isTest ? testScenarios : benchScenarios;
+  cnt = isTest ? sizeof(testScenarios) / sizeof(testScenarios[0])
+               : sizeof(benchScenarios) / sizeof(benchScenarios[0]);
+
+  printf("SBL at 115200 baud, window=%u, ack timeout %u ms; SBL_STREAM_CMD erase and whole "
+         "download in ms\n", SBL_STREAM_WINDOW, PEER_ACK_TIMEOUT_MS);
+  printf("%-16s %6s %5s %6s %6s %4s %4s %8s %8s %7s\n", "download", "bytes", "frame", "frames",
+         "resent", "ign", "tmo", "erase", "ms", "B/s");
+
+  // Each scenario in its own process: the boot loader and the model start from reset.
+  for (uint8 i = 0; i < cnt; i++)
+  {
+    pid_t pid;
+    int status;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0)
+    {
+      sc = &list[i];
+      runScenario();
+      fflush(stdout);
+      _exit(fails ? 1 : 0);
+    }
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+      fails++;
+    }
+  }
+
+  if (isTest)
+  {
+    printf("%s\n", fails ? "FAIL" : "PASS");
+  }
+  return fails ? 1 : 0;
+}
@@ -0,0 +1,525 @@
+/**************************************************************************************************
+  Filename:       spi_bench.c
+
+  Description:
+
+  Runs the SPI Slave transport of Components/hal/target/CC2540EB/_hal_uart_spi.c (USART 1 at
+  Alt. 2, HAL_UART_SPI=2) on the register model of hal_sim.c, against a model of the SPI master
+  of the network processor interface:
+
+    spi_bench         Sweeps the frame size with Tx only and with traffic both ways and prints
+                      the frames/s in each direction.
+    spi_bench -t      Integrity test: frames must arrive whole and in order in both directions
+                      at every frame size, the largest included. Fails otherwise.
+
+  Options:
+    -c <kHz>     SPI clock of the master (2000 by default).
+    -r <msecs>   Virtual time of each run (200 by default).
+
+  The master asserts MRDY when it has a frame to send or when the slave asserts SRDY, waits for
+  SRDY (or its pulse, when the slave has nothing to send), then clocks its own frame while it
+  parses the slave's frames out of MISO. It keeps clocking while SRDY is asserted or a slave
+  frame is under way and ends the transaction by releasing MRDY. HAL_SPI_STREAM is a compile
+  time option, so the Makefile builds one binary with and one without it. Without it the slave
+  parses the master's frames only between its own, so Tx at full rate starves the other way and
+  the test does not ask for frames from the master; with it the master sends its next frame in
+  place of the zeros that it clocks while SRDY stays asserted.
+
+  The application loop polls the driver every APP_LOOP_US, reads what was received and writes
+  frames of the size of the run for as long as the driver takes them.
+
+  Reported for each run:
+    up fr/s     Frames/s from the slave to the master.
+    down fr/s   Frames/s from the master read by the slave application.
+    up B/s      Payload bytes/s from the slave to the master.
+    bad         Frames with a bad FCS, a bad length or out of sequence, in either direction.
+**************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "hal_dma.h"
+#include "hal_mcu.h"
+#include "hal_uart.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#if !defined HAL_SPI_STREAM
+#define HAL_SPI_STREAM            FALSE
+#endif
+
+#if !defined APP_LOOP_US
+#define APP_LOOP_US               100
+#endif
+
+// Time from the end of one master transaction to the next that it may start.
+#if !defined MASTER_GAP_US
+#define MASTER_GAP_US             20
+#endif
+
+// Give up on the slave when it does not answer MRDY within this time.
+#define MASTER_WAIT_MS            10
+
+#define SPI_SOF                   0xFE
+#define SPI_FRM_LEN               3
+#define SPI_DAT_MAX               253
+
+#define APP_READ_MAX              64
+
+enum
+{
+  TRAFFIC_UP,      // Slave to master only.
+  TRAFFIC_BOTH,    // Both ways at once.
+  TRAFFIC_CNT
+};
+
+static const char *const trafficName[TRAFFIC_CNT] = { "up", "both" };
+
+static const uint8 sizeTbl[] = { 8, 32, 128, SPI_DAT_MAX };
+
+#define SIZE_CNT                  (sizeof(sizeTbl) / sizeof(sizeTbl[0]))
+
+enum
+{
+  MASTER_IDLE,
+  MASTER_WAIT,     // MRDY asserted, waiting for SRDY.
+  MASTER_XFER
+};
+
+enum
+{
+  PARSE_SOF,
+  PARSE_LEN,
+  PARSE_DATA,
+  PARSE_FCS
+};
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  double upFps;
+  double downFps;
+  double upBps;
+  uint32 bad;
+  uint32 upCnt;
+  uint32 downCnt;
+  uint8 stall;
+} benchResult_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static uint64_t byteTime = HAL_SIM_NS(4000);
+static uint32 runMs = 200;
+
+static uint8 frameLen;
+static uint8 traffic;
+
+// Master side.
+static uint8 mState;
+static uint8 mPending;
+static uint8 mSrdyEdge;
+static uint64_t mWaitEnd;
+static uint8 mTx[SPI_DAT_MAX + SPI_FRM_LEN];
+static uint16 mTxLen;
+static uint16 mTxIdx;
+static uint32 mTxCnt;           // Frames sent to the slave.
+static uint8 mRxState;
+static uint8 mRxLen;
+static uint8 mRxCnt;
+static uint8 mRxFcs;
+static uint8 mRxBuf[SPI_DAT_MAX];
+static uint32 mRxCnt32;         // Frames received from the slave.
+static uint32 mRxBad;
+static uint8 mStall;
+
+// Application side.
+static uint32 appTxCnt;         // Frames accepted by HalUARTWrite().
+static uint32 appRxCnt;         // Frames read whole.
+static uint16 appRxPos;
+static uint32 appRxBad;
+
+/*********************************************************************
+ * HOST STUBS
+ */
+
+uint32 osal_GetSystemClock(void)
+{
+  return (uint32)(halSimTime() / HAL_SIM_MS(1));
+}
+
+void halAssertHandler(void)
+{
+  fprintf(stderr, "spi_bench: HAL_ASSERT failed\n");
+  exit(2);
+}
+
+/*********************************************************************
+ * MASTER
+ */
+
+static void masterStep(void *arg);
+
+static void masterSched(uint64_t ps)
+{
+  if (!mPending)
+  {
+    mPending = TRUE;
+    halSimAt(halSimTime() + ps, masterStep, NULL);
+  }
+}
+
+static uint8 masterSrdy(void)
+{
+  return !halSimPinGet(0, 5);
+}
+
+static void masterHook(uint8_t port, uint8_t pin, uint8_t level)
+{
+  if ((port == 0) && (pin == 5) && !level)
+  {
+    mSrdyEdge = TRUE;
+    if (mState == MASTER_IDLE)
+    {
+      masterSched(0);
+    }
+  }
+}
+
+static void masterFrame(void)
+{
+  uint8 fcs = frameLen;
+
+  mTx[0] = SPI_SOF;
+  mTx[1] = frameLen;
+  for (uint8 i = 0; i < frameLen; i++)
+  {
+    mTx[2 + i] = (uint8)(mTxCnt + i);
+    fcs ^= mTx[2 + i];
+  }
+  mTx[2 + frameLen] = fcs;
+  mTxLen = frameLen + SPI_FRM_LEN;
+  mTxIdx = 0;
+}
+
+static void masterParse(uint8 ch)
+{
+  switch (mRxState)
+  {
+  case PARSE_SOF:
+    if (ch == SPI_SOF)
+    {
+      mRxState = PARSE_LEN;
+    }
+    break;
+
+  case PARSE_LEN:
+    if ((ch == 0) || (ch > SPI_DAT_MAX))
+    {
+      mRxBad++;
+      mRxState = PARSE_SOF;
+      break;
+    }
+    mRxLen = mRxFcs = ch;
+    mRxCnt = 0;
+    mRxState = PARSE_DATA;
+    break;
+
+  case PARSE_DATA:
+    mRxBuf[mRxCnt] = ch;
+    mRxFcs ^= ch;
+    if (++mRxCnt == mRxLen)
+    {
+      mRxState = PARSE_FCS;
+    }
+    break;
+
+  default:
+    mRxState = PARSE_SOF;
+    if ((ch != mRxFcs) || (mRxLen != frameLen))
+    {
+      mRxBad++;
+      break;
+    }
+    for (uint8 i = 0; i < mRxLen; i++)
+    {
+      if (mRxBuf[i] != (uint8)(mRxCnt32 + i))
+      {
+        mRxBad++;
+        break;
+      }
+    }
+    mRxCnt32++;
+    break;
+  }
+}
+
+static void masterStep(void *arg)
+{
+  (void)arg;
+  mPending = FALSE;
+
+  switch (mState)
+  {
+  case MASTER_IDLE:
+    if ((mTxLen == 0) && (traffic == TRAFFIC_BOTH))
+    {
+      masterFrame();
+    }
+    if ((mTxLen != 0) || masterSrdy())
+    {
+      mSrdyEdge = FALSE;
+      mState = MASTER_WAIT;
+      mWaitEnd = halSimTime() + HAL_SIM_MS(MASTER_WAIT_MS);
+      halSimPinSet(1, 4, 0);
+      masterSched(HAL_SIM_US(1));
+    }
+    break;
+
+  case MASTER_WAIT:
+    if (mSrdyEdge || masterSrdy())
+    {
+      mState = MASTER_XFER;
+      masterSched(0);
+    }
+    else if (halSimTime() >= mWaitEnd)
+    {
+      mStall = TRUE;
+    }
+    else
+    {
+      masterSched(HAL_SIM_US(1));
+    }
+    break;
+
+  default:
+    if ((mTxLen == 0) && (mRxState == PARSE_SOF) && !masterSrdy())
+    {
+      halSimPinSet(1, 4, 1);
+      mState = MASTER_IDLE;
+      masterSched(HAL_SIM_US(MASTER_GAP_US));
+      break;
+    }
+    else
+    {
+      int miso = halSimSpiXfer(HAL_UART_PORT_1, (mTxLen != 0) ? mTx[mTxIdx++] : 0);
+
+      if (miso < 0)
+      {
+        fprintf(stderr, "spi_bench: the slave is not selected\n");
+        exit(2);
+      }
+      masterParse((uint8)miso);
+
+      if ((mTxLen != 0) && (mTxIdx == mTxLen))
+      {
+        mTxLen = 0;
+        mTxCnt++;
+
+#if HAL_SPI_STREAM
+        // Clocking goes on while SRDY is asserted, so send the next frame instead of zeros.
+        if ((traffic == TRAFFIC_BOTH) && masterSrdy())
+        {
+          masterFrame();
+        }
+#endif
+      }
+      masterSched(byteTime);
+    }
+    break;
+  }
+}
+
+/*********************************************************************
+ * APPLICATION
+ */
+
+static void appRead(void)
+{
+  uint8 buf[APP_READ_MAX];
+  uint16 cnt;
+
+  while ((cnt = HalUARTRead(HAL_UART_PORT_1, buf, sizeof(buf))) != 0)
+  {
+    for (uint16 i = 0; i < cnt; i++)
+    {
+      if (buf[i] != (uint8)(appRxCnt + appRxPos))
+      {
+        appRxBad++;
+      }
+      if (++appRxPos == frameLen)
+      {
+        appRxPos = 0;
+        appRxCnt++;
+      }
+    }
+  }
+}
+
+static void appWrite(void)
+{
+  uint8 buf[SPI_DAT_MAX];
+
+  while (1)
+  {
+    for (uint8 i = 0; i < frameLen; i++)
+    {
+      buf[i] = (uint8)(appTxCnt + i);
+    }
+
+    if (HalUARTWrite(HAL_UART_PORT_1, buf, frameLen) == 0)
+    {
+      break;  // All or none: retry at the next loop.
+    }
+    appTxCnt++;
+  }
+}
+
+/*********************************************************************
+ * BENCH
+ */
+
+static benchResult_t benchRun(uint8 size, uint8 traf)
+{
+  halUARTCfg_t cfg;
+  benchResult_t res;
+  uint64_t end;
+
+  frameLen = size;
+  traffic = traf;
+
+  halSimInit();
+  halSimPinHook(masterHook);
+  halSimPinSet(1, 4, 1);  // MRDY released.
+
+  HalDmaInit();
+  HalUARTInit();
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.configured = TRUE;
+  cfg.callBackFunc = NULL;
+  (void)HalUARTOpen(HAL_UART_PORT_1, &cfg);
+  HAL_ENABLE_INTERRUPTS();
+  masterSched(HAL_SIM_US(MASTER_GAP_US));
+
+  end = halSimTime() + HAL_SIM_MS(runMs);
+  while ((halSimTime() < end) && !mStall)
+  {
+    HalUARTPoll();
+    appRead();
+    appWrite();
+    halSimRun(HAL_SIM_US(APP_LOOP_US));
+  }
+
+  memset(&res, 0, sizeof(res));
+  res.upCnt = mRxCnt32;
+  res.downCnt = appRxCnt;
+  res.upFps = mRxCnt32 * 1000.0 / runMs;
+  res.downFps = appRxCnt * 1000.0 / runMs;
+  res.upBps = res.upFps * size;
+  res.bad = mRxBad + appRxBad;
+  res.stall = mStall;
+
+  return res;
+}
+
+// Each run is in a child process, so that the driver and the model start from their reset state.
+static int benchFork(uint8 size, uint8 traf, benchResult_t *pRes)
+{
+  int fd[2];
+  pid_t pid;
+  int status;
+
+  fflush(stdout);
+  if (pipe(fd) != 0 || (pid = fork()) < 0)
+  {
+    perror("spi_bench");
+    exit(2);
+  }
+
+  if (pid == 0)
+  {
+    benchResult_t res = benchRun(size, traf);
+
+    close(fd[0]);
+    if (write(fd[1], &res, sizeof(res)) != sizeof(res))
+    {
+      _exit(2);
+    }
+    _exit(0);
+  }
+
+  close(fd[1]);
+  if (read(fd[0], pRes, sizeof(*pRes)) != sizeof(*pRes))
+  {
+    memset(pRes, 0, sizeof(*pRes));
+  }
+  close(fd[0]);
+  (void)waitpid(pid, &status, 0);
+
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 2;
+}
+
+int main(int argc, char **argv)
+{
+  uint8 test = FALSE;
+  int fails = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "tc:r:")) != -1)
+  {
+    switch (opt)
+    {
+    case 't':
+      test = TRUE;
+      break;
+    case 'c':
+      byteTime = HAL_SIM_NS(8000000UL / strtoul(optarg, NULL, 0));
+      break;
+    case 'r':
+      runMs = (uint32)strtoul(optarg, NULL, 0);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-t] [-c kHz] [-r msecs]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  printf("spi slave stream=%u sck=%llu kHz run=%u ms\n", HAL_SPI_STREAM,
+         (unsigned long long)(8000000000ULL / byteTime), runMs);
+  printf("%5s %-5s %9s %9s %9s %5s\n", "size", "dir", "up fr/s", "down fr/s", "up B/s", "bad");
+
+  for (uint8 t = 0; t < TRAFFIC_CNT; t++)
+  {
+    for (uint8 s = 0; s < SIZE_CNT; s++)
+    {
+      benchResult_t res;
+      int status = benchFork(sizeTbl[s], t, &res);
+      uint8 bad = (status != 0) || res.stall || (res.bad != 0) || (res.upCnt == 0) ||
+                  (HAL_SPI_STREAM && (t == TRAFFIC_BOTH) && (res.downCnt == 0));
+
+      printf("%5u %-5s %9.0f %9.0f %9.0f %5u%s\n", sizeTbl[s], trafficName[t], res.upFps,
+             res.downFps, res.upBps, res.bad,
+             (status != 0) ? "  CRASH" : (res.stall ? "  STALL" : ""));
+
+      if (test && bad)
+      {
+        fails++;
+      }
+    }
+  }
+
+  if (test)
+  {
+    printf("%s\n", fails ? "FAIL" : "PASS");
+  }
+  return fails ? 1 : 0;
+}
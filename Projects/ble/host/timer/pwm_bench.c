@@ -0,0 +1,397 @@
+/**************************************************************************************************
+  Filename:       pwm_bench.c
+
+  Description:
+
+  Runs the Timer1 PWM dimming of Components/hal/target/CC2540EB/hal_timer.c (HAL_TIMER_PWM) on
+  the register model of hal_sim.c with the three lights of the 3-gang board on P1.5 - P1.7, and
+  measures the on-time of every pin in every PWM frame from its edges:
+
+    pwm_bench         Prints the gamma curve as driven, a 1 s fade and the Timer1 ISR cost.
+    pwm_bench -t      Fade test: fails unless every check below holds.
+
+  Checks of the test:
+    - A level set without a fade is driven at the gamma 2.2 duty of the level, within
+      CURVE_TOL_TICKS plus CURVE_TOL_PCT percent, after two frames.
+    - A fade moves the duty one way only, follows the gamma curve of a level that goes linearly
+      in time and ends at its level no later than two frames after the fade time.
+    - A new fade started half way starts from where the running one got to, with no jump.
+    - Three lights fading at once, two up and one down, each do the above.
+
+  The ISR cost is the time spent in the Timer1 ISR, entry and exit included, per second and
+  per interrupt, with the three lights at mid levels and with the three fading. The model only
+  charges the SFR accesses and the entry and exit of an ISR, so it is a lower bound.
+**************************************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal_mcu.h"
+#include "hal_timer.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define PWM_CH                    3
+#define PWM_TICK_PS               (128 * HAL_SIM_PS_PER_CYCLE)   // Timer1 at 32 MHz / 128.
+#define PWM_TICKS                 ((uint16)HAL_TIMER_PWM_FRAME_MS * 250)
+#define PWM_DUTY_FULL             (PWM_TICKS - 1)
+#define PWM_FRAME_PS              (PWM_TICKS * PWM_TICK_PS)
+
+#define FRAME_MAX                 1024
+
+#define CURVE_TOL_TICKS           2
+#define CURVE_TOL_PCT             3
+
+static const uint8 pwmPins[PWM_CH] = { BV(5), BV(6), BV(7) };
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static uint64_t frameStart;     // Time of the Timer1 overflow that starts the next frame.
+static uint64_t riseAt[PWM_CH];
+static uint64_t onPs[PWM_CH];
+static uint16 duty[PWM_CH][FRAME_MAX];  // Measured duty of each frame, in Timer1 ticks.
+static uint16 frameCnt;
+static int fails;
+
+/*********************************************************************
+ * HOST STUBS
+ */
+
+void halAssertHandler(void)
+{
+  fprintf(stderr, "pwm_bench: HAL_ASSERT failed\n");
+  exit(2);
+}
+
+/*********************************************************************
+ * MEASUREMENT
+ */
+
+static void pinHook(uint8_t port, uint8_t pin, uint8_t level)
+{
+  for (uint8 ch = 0; ch < PWM_CH; ch++)
+  {
+    if ((port == 1) && (pwmPins[ch] == (1 << pin)))
+    {
+      if (level)
+      {
+        riseAt[ch] = halSimTime();
+      }
+      else
+      {
+        onPs[ch] += halSimTime() - riseAt[ch];
+      }
+    }
+  }
+}
+
+// At each overflow: close the frame that ends, the edges of the ISR come after it.
+static void frameEnd(void *arg)
+{
+  (void)arg;
+
+  for (uint8 ch = 0; ch < PWM_CH; ch++)
+  {
+    if (halSimPinGet(1, 5 + ch))
+    {
+      onPs[ch] += halSimTime() - riseAt[ch];
+      riseAt[ch] = halSimTime();
+    }
+    if (frameCnt < FRAME_MAX)
+    {
+      duty[ch][frameCnt] = (uint16)((onPs[ch] + PWM_TICK_PS / 2) / PWM_TICK_PS);
+    }
+    onPs[ch] = 0;
+  }
+  frameCnt++;
+
+  frameStart += PWM_FRAME_PS;
+  halSimAt(frameStart, frameEnd, NULL);
+}
+
+static uint16 benchStart(void)
+{
+  halSimInit();
+  halSimPinHook(pinHook);
+  frameCnt = 0;
+
+  P1DIR |= BV(5) | BV(6) | BV(7);
+  HalTimerInit();
+  (void)HalTimerPwmInit(pwmPins, PWM_CH);
+  HAL_ENABLE_INTERRUPTS();
+
+  // The pins are off from here.
+  for (uint8 ch = 0; ch < PWM_CH; ch++)
+  {
+    riseAt[ch] = halSimTime();
+    onPs[ch] = 0;
+  }
+
+  // Timer1 started at the access that followed the write of T1CTL, just before the return.
+  frameStart = halSimTime() + PWM_FRAME_PS;
+  halSimAt(frameStart, frameEnd, NULL);
+
+  return frameCnt;
+}
+
+// Run to the end of 'frames' more frames; returns the index of the first of them.
+static uint16 benchFrames(uint16 frames)
+{
+  uint16 first = frameCnt;
+
+  while ((uint16)(frameCnt - first) < frames)
+  {
+    halSimRun(HAL_SIM_US(100));
+  }
+  return first;
+}
+
+/*********************************************************************
+ * CHECKS
+ */
+
+static double gammaDuty(double level)
+{
+  if (level <= 0)
+  {
+    return 0;
+  }
+  if (level >= HAL_TIMER_PWM_LEVEL_MAX)
+  {
+    return PWM_DUTY_FULL;
+  }
+  return pow(level / HAL_TIMER_PWM_LEVEL_MAX, 2.2) * PWM_DUTY_FULL;
+}
+
+static uint8 dutyNear(uint16 d, double lo, double hi)
+{
+  double tol = CURVE_TOL_TICKS + hi * CURVE_TOL_PCT / 100.0;
+
+  return (d + tol >= lo) && (d <= hi + tol);
+}
+
+static void check(uint8 ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("  FAIL: %s\n", what);
+    fails++;
+  }
+}
+
+/*
+ * Checks the frames of a fade from level 'from' to 'to' over 'frames' frames, the first of which
+ * is 'first'. The level set at an overflow is driven from the next frame, so frame k of the fade
+ * is between the levels of steps k - 2 and k, and the first two frames can still be those of a
+ * fade that was running.
+ */
+static void checkFade(uint8 ch, uint16 first, uint8 from, uint8 to, uint16 frames,
+                      const char *what)
+{
+  char msg[128];
+  int dir = (to > from) ? 1 : -1;
+  uint16 last = duty[ch][first + frames + 2];
+  uint16 end = 0;
+
+  for (uint16 k = 0; k <= frames + 2; k++)
+  {
+    uint16 d = duty[ch][first + k];
+    double l0 = from + (double)(to - from) * ((k < 2) ? 0 : (k - 2)) / frames;
+    double l1 = from + (double)(to - from) * ((k > frames) ? frames : k) / frames;
+    double lo = gammaDuty((dir > 0) ? l0 : l1);
+    double hi = gammaDuty((dir > 0) ? l1 : l0);
+
+    if (!dutyNear(d, lo, hi))
+    {
+      snprintf(msg, sizeof(msg), "%s: frame %u duty %u not in %.1f..%.1f", what, k, d, lo, hi);
+      check(FALSE, msg);
+      return;
+    }
+    if ((k > 2) && ((int)d - (int)duty[ch][first + k - 1]) * dir < 0)
+    {
+      snprintf(msg, sizeof(msg), "%s: frame %u duty %u goes back from %u", what, k, d,
+               duty[ch][first + k - 1]);
+      check(FALSE, msg);
+      return;
+    }
+    if ((end == 0) && (d == last))
+    {
+      end = k;
+    }
+  }
+
+  // The last steps of a fade can round to the same duty, so it may look done a few frames early.
+  snprintf(msg, sizeof(msg), "%s: ends at frame %u, not %u", what, end, frames + 1);
+  check((end + 4 >= frames) && (end <= frames + 2), msg);
+}
+
+static void testStatic(void)
+{
+  static const uint8 levels[] = { 0, 1, 4, 16, 64, 100, 128, 200, 254, 255 };
+  char msg[64];
+
+  benchStart();
+  for (uint8 i = 0; i < sizeof(levels); i++)
+  {
+    uint16 first;
+
+    (void)HalTimerPwmSet(0, levels[i], 0);
+    first = benchFrames(3);
+    snprintf(msg, sizeof(msg), "level %u duty %u, gamma %.1f", levels[i], duty[0][first + 2],
+             gammaDuty(levels[i]));
+    check(dutyNear(duty[0][first + 2], gammaDuty(levels[i]), gammaDuty(levels[i])) &&
+          ((levels[i] == 0) == (duty[0][first + 2] == 0)), msg);
+    check(HalTimerPwmGet(0) == levels[i], "HalTimerPwmGet");
+  }
+}
+
+static void testFade(void)
+{
+  uint16 first;
+
+  benchStart();
+  (void)HalTimerPwmSet(0, 255, 1000);
+  first = benchFrames(210);
+  checkFade(0, first, 0, 255, 1000 / HAL_TIMER_PWM_FRAME_MS, "fade 0-255 in 1 s");
+
+  (void)HalTimerPwmSet(0, 0, 500);
+  first = benchFrames(110);
+  checkFade(0, first, 255, 0, 500 / HAL_TIMER_PWM_FRAME_MS, "fade 255-0 in 0.5 s");
+  check(duty[0][first + 105] == 0, "fade to 0 ends off");
+}
+
+static void testRetarget(void)
+{
+  uint16 first;
+  uint16 at;
+  char msg[96];
+
+  benchStart();
+  (void)HalTimerPwmSet(0, 255, 1000);
+  first = benchFrames(100);
+  (void)HalTimerPwmSet(0, 0, 500);
+  at = benchFrames(110);
+
+  // The level half way is 127; the new fade starts there.
+  checkFade(0, at, 127, 0, 500 / HAL_TIMER_PWM_FRAME_MS, "fade 0-255 turned to 0 half way");
+  snprintf(msg, sizeof(msg), "jump at the new fade: %u then %u", duty[0][at - 1], duty[0][at]);
+  check(abs((int)duty[0][at] - (int)duty[0][at - 1]) <= 2 * (duty[0][at - 1] -
+        duty[0][at - 2]) + CURVE_TOL_TICKS, msg);
+  (void)first;
+}
+
+static void testChannels(void)
+{
+  uint16 first;
+
+  benchStart();
+  (void)HalTimerPwmSet(2, 255, 0);
+  (void)benchFrames(3);
+  (void)HalTimerPwmSet(0, 255, 400);
+  (void)HalTimerPwmSet(1, 128, 800);
+  (void)HalTimerPwmSet(2, 0, 600);
+  first = benchFrames(170);
+  checkFade(0, first, 0, 255, 400 / HAL_TIMER_PWM_FRAME_MS, "3 lights: 0-255 in 0.4 s");
+  checkFade(1, first, 0, 128, 800 / HAL_TIMER_PWM_FRAME_MS, "3 lights: 0-128 in 0.8 s");
+  checkFade(2, first, 255, 0, 600 / HAL_TIMER_PWM_FRAME_MS, "3 lights: 255-0 in 0.6 s");
+}
+
+/*********************************************************************
+ * BENCH
+ */
+
+static void benchIsr(uint8 fade)
+{
+  uint64_t t0;
+  uint64_t ps;
+  uint32 cnt;
+
+  benchStart();
+  for (uint8 ch = 0; ch < PWM_CH; ch++)
+  {
+    (void)HalTimerPwmSet(ch, fade ? ((ch & 1) ? 0 : 255) : 100 + 20 * ch, 0);
+  }
+  (void)benchFrames(3);
+  for (uint8 ch = 0; ch < PWM_CH && fade; ch++)
+  {
+    (void)HalTimerPwmSet(ch, (ch & 1) ? 255 : 0, 1000);
+  }
+
+  t0 = halSimTime();
+  cnt = halSimStats.isrCnt[T1_VECTOR];
+  ps = halSimStats.isrPs[T1_VECTOR];
+  (void)benchFrames(200);
+  t0 = halSimTime() - t0;
+  cnt = halSimStats.isrCnt[T1_VECTOR] - cnt;
+  ps = halSimStats.isrPs[T1_VECTOR] - ps;
+
+  printf("%-12s %8.0f %10.2f %8.3f\n", fade ? "3 fading" : "3 at mid", cnt * 1e12 / t0,
+         cnt ? ps / 1e6 / cnt : 0.0, ps * 100.0 / t0);
+}
+
+static void benchCurve(void)
+{
+  benchStart();
+  printf("%5s %6s %8s\n", "level", "duty", "gamma");
+  for (uint16 level = 0; level <= 255; level += (level < 32) ? 4 : 32)
+  {
+    uint16 first;
+
+    (void)HalTimerPwmSet(0, (uint8)level, 0);
+    first = benchFrames(3);
+    printf("%5u %6u %8.1f\n", level, duty[0][first + 2], gammaDuty(level));
+    if (level == 255)
+    {
+      break;
+    }
+    if (level == 224)
+    {
+      level = 223;
+    }
+  }
+
+  benchStart();
+  (void)HalTimerPwmSet(0, 255, 1000);
+  (void)benchFrames(202);
+  printf("fade 0-255 in 1 s, duty every 100 ms:");
+  for (uint16 k = 0; k <= 200; k += 20)
+  {
+    printf(" %u", duty[0][k]);
+  }
+  printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+  uint8 test = (argc > 1) && (strcmp(argv[1], "-t") == 0);
+
+  printf("pwm frame=%u ms ticks=%u channels=%u\n", HAL_TIMER_PWM_FRAME_MS, PWM_TICKS, PWM_CH);
+
+  if (test)
+  {
+    testStatic();
+    testFade();
+    testRetarget();
+    testChannels();
+  }
+  else
+  {
+    benchCurve();
+  }
+
+  printf("%-12s %8s %10s %8s\n", "Timer1 ISR", "per s", "us each", "cpu %");
+  benchIsr(FALSE);
+  benchIsr(TRUE);
+
+  if (test)
+  {
+    printf("%s\n", fails ? "FAIL" : "PASS");
+  }
+  return fails ? 1 : 0;
+}
@@ -0,0 +1,496 @@
+/**************************************************************************************************
+  Filename:       uart_bench.c
+
+  Description:
+
+  Runs the UART drivers of Components/hal/target/CC2540EB (_hal_uart_dma.c or _hal_uart_isr.c,
+  as built) on the register model of hal_sim.c, against a peer on USART 0 that streams a
+  counting sequence into the target while the target application streams one back:
+
+    uart_bench        Sweeps baud rate, write pattern and flow control and prints one line each.
+    uart_bench -t     Integrity test: with flow control every byte must arrive, in order, in both
+                      directions at every baud rate and write pattern. Fails otherwise.
+
+  Options:
+    -n <bytes>   Bytes to stream in each direction (4096 by default).
+    -s <bytes>   Bytes that the peer still sends after the target de-asserts RTS (0 by default).
+    -b <baud>    Lowest baud rate to run. The Tx by DMA of _hal_uart_dma.c re-triggers on an
+                 idle time (HAL_UART_TX_TICK_MIN) of one byte at 38400 baud and overwrites
+                 UxDBUF below that, so its test is run with -b 38400.
+
+  The driver, its queue sizes and HAL_UART_TX_BY_ISR are compile time options, so the Makefile
+  builds one binary for each variant. The application loop polls the driver every
+  APP_LOOP_US and stalls for APP_STALL_US every APP_STALL_PERIOD_US as the radio would.
+
+  Reported for each run:
+    tx B/s    Bytes/s from the target to the peer, until the last one arrived.
+    rx B/s    Bytes/s from the peer read by the application, until the last one was read.
+    wr max    Worst time from the first HalUARTWrite() attempt of a chunk until its last byte
+              arrived at the peer, in msecs.
+    ovr       Rx overruns counted by the driver plus bytes overwritten in the USART.
+    lost      Bytes missing in the sequence read by the application.
+**************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "hal_dma.h"
+#include "hal_mcu.h"
+#include "hal_uart.h"
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#if !defined APP_LOOP_US
+#define APP_LOOP_US               250
+#endif
+#if !defined APP_STALL_US
+#define APP_STALL_US              3000
+#endif
+#if !defined APP_STALL_PERIOD_US
+#define APP_STALL_PERIOD_US       20000
+#endif
+
+#define APP_READ_MAX              32
+#define APP_RUN_LIMIT_MS          60000
+
+// The queue sizes as the drivers default them.
+#if HAL_UART_DMA
+#if !defined HAL_UART_DMA_RX_MAX
+#define HAL_UART_DMA_RX_MAX       128
+#endif
+#if !defined HAL_UART_DMA_TX_MAX
+#define HAL_UART_DMA_TX_MAX       HAL_UART_DMA_RX_MAX
+#endif
+#if !defined HAL_UART_TX_BY_ISR
+#define HAL_UART_TX_BY_ISR        1
+#endif
+#define APP_RX_MAX                HAL_UART_DMA_RX_MAX
+#define APP_TX_MAX                HAL_UART_DMA_TX_MAX
+#define APP_DRIVER                "dma"
+#else
+#if !defined HAL_UART_ISR_RX_MAX
+#define HAL_UART_ISR_RX_MAX       128
+#endif
+#if !defined HAL_UART_ISR_TX_MAX
+#define HAL_UART_ISR_TX_MAX       HAL_UART_ISR_RX_MAX
+#endif
+#undef  HAL_UART_TX_BY_ISR
+#define HAL_UART_TX_BY_ISR        1
+#define APP_RX_MAX                HAL_UART_ISR_RX_MAX
+#define APP_TX_MAX                HAL_UART_ISR_TX_MAX
+#define APP_DRIVER                "isr"
+#endif
+
+enum
+{
+  PATTERN_BULK,    // Chunks of half the Tx queue.
+  PATTERN_SMALL,   // 4-byte chunks.
+  PATTERN_RANDOM,  // Chunks of 1 to 64 bytes.
+  PATTERN_CNT
+};
+
+static const char *const patternName[PATTERN_CNT] = { "bulk", "small", "random" };
+
+static const struct
+{
+  uint8 br;
+  uint32 baud;
+} baudTbl[] =
+{
+  { HAL_UART_BR_9600,   9600 },
+  { HAL_UART_BR_19200,  19200 },
+  { HAL_UART_BR_38400,  38400 },
+  { HAL_UART_BR_57600,  57600 },
+  { HAL_UART_BR_115200, 115200 },
+};
+
+#define BAUD_CNT                  (sizeof(baudTbl) / sizeof(baudTbl[0]))
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+
+typedef struct
+{
+  double txBps;
+  double rxBps;
+  double wrMaxMs;
+  uint32 overruns;
+  uint32 lost;
+  uint32 txBad;
+  uint8 done;
+} benchResult_t;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+static uint32 streamLen = 4096;
+static uint32 baudMin;
+static uint8 peerSkid;
+
+// Peer side.
+static uint32 peerTxCnt;        // Bytes shifted into the target.
+static uint32 peerRxCnt;        // Bytes received from the target.
+static uint32 peerRxBad;        // Received bytes out of sequence.
+static uint8 peerSkidLeft;
+static uint64_t peerRxLast;
+
+// Application side.
+static uint32 appRxCnt;
+static uint32 appRxLost;
+static uint8 appRxSeq;
+static uint64_t appRxLast;
+static uint32 appTxCnt;         // Bytes accepted by HalUARTWrite().
+static uint32 wrEnd;            // Stream index after the last byte of the oldest timed chunk.
+static uint64_t wrStart;        // First write attempt of that chunk.
+static uint8 wrTimed;
+static uint64_t wrMax;
+
+static uint32 rndState = 0x2545F491;
+
+/*********************************************************************
+ * HOST STUBS
+ */
+
+uint32 osal_GetSystemClock(void)
+{
+  return (uint32)(halSimTime() / HAL_SIM_MS(1));
+}
+
+void halAssertHandler(void)
+{
+  fprintf(stderr, "uart_bench: HAL_ASSERT failed\n");
+  exit(2);
+}
+
+/*********************************************************************
+ * PEER
+ */
+
+static uint32 rnd(void)
+{
+  rndState ^= rndState << 13;
+  rndState ^= rndState >> 17;
+  rndState ^= rndState << 5;
+  return rndState;
+}
+
+static void peerRx(uint8_t port, uint8_t byte)
+{
+  (void)port;
+
+  if (byte != (uint8)peerRxCnt)
+  {
+    peerRxBad++;
+  }
+  peerRxCnt++;
+  peerRxLast = halSimTime();
+
+  // Only one chunk is timed at a time; its last byte ends the measurement.
+  if (wrTimed && (peerRxCnt >= wrEnd))
+  {
+    uint64_t lat = peerRxLast - wrStart;
+
+    wrTimed = FALSE;
+    if (lat > wrMax)
+    {
+      wrMax = lat;
+    }
+  }
+}
+
+static int peerTx(uint8_t port, uint8_t rts)
+{
+  (void)port;
+
+  if (peerTxCnt >= streamLen)
+  {
+    return -1;
+  }
+
+  if (rts)
+  {
+    peerSkidLeft = peerSkid;
+  }
+  else if (peerSkidLeft != 0)
+  {
+    peerSkidLeft--;
+  }
+  else
+  {
+    return -1;
+  }
+
+  return (uint8)peerTxCnt++;
+}
+
+static const halSimUartPeer_t peer = { peerRx, peerTx };
+
+/*********************************************************************
+ * APPLICATION
+ */
+
+static void appRead(void)
+{
+  uint8 buf[APP_READ_MAX];
+  uint16 cnt;
+
+  while ((cnt = HalUARTRead(HAL_UART_PORT_0, buf, sizeof(buf))) != 0)
+  {
+    for (uint16 i = 0; i < cnt; i++)
+    {
+      appRxLost += (uint8)(buf[i] - appRxSeq);
+      appRxSeq = buf[i] + 1;
+    }
+    appRxCnt += cnt;
+    appRxLast = halSimTime();
+  }
+}
+
+static uint16 appChunk(uint8 pattern)
+{
+  uint16 len;
+
+  switch (pattern)
+  {
+  case PATTERN_BULK:
+    len = APP_TX_MAX / 2;
+    break;
+  case PATTERN_SMALL:
+    len = 4;
+    break;
+  default:
+    len = 1 + rnd() % 64;
+    break;
+  }
+
+  if (len > APP_TX_MAX / 2)
+  {
+    len = APP_TX_MAX / 2;
+  }
+  if (len > streamLen - appTxCnt)
+  {
+    len = (uint16)(streamLen - appTxCnt);
+  }
+  return len;
+}
+
+static void appWrite(uint8 pattern)
+{
+  static uint8 buf[APP_TX_MAX];
+  static uint16 len;
+  static uint64_t start;
+
+  while (appTxCnt < streamLen)
+  {
+    if (len == 0)
+    {
+      len = appChunk(pattern);
+      start = halSimTime();
+      for (uint16 i = 0; i < len; i++)
+      {
+        buf[i] = (uint8)(appTxCnt + i);
+      }
+    }
+
+    if (HalUARTWrite(HAL_UART_PORT_0, buf, len) == 0)
+    {
+      break;  // All or none: retry the same chunk at the next loop.
+    }
+
+    appTxCnt += len;
+    len = 0;
+    if (!wrTimed)
+    {
+      wrTimed = TRUE;
+      wrStart = start;
+      wrEnd = appTxCnt;
+    }
+  }
+}
+
+static void appCback(uint8 port, uint8 event)
+{
+  (void)port;
+
+  if (event & (HAL_UART_RX_TIMEOUT | HAL_UART_RX_ABOUT_FULL | HAL_UART_RX_FULL))
+  {
+    appRead();
+  }
+}
+
+/*********************************************************************
+ * BENCH
+ */
+
+static benchResult_t benchRun(uint8 br, uint8 pattern, uint8 flow)
+{
+  halUARTCfg_t cfg;
+  benchResult_t res;
+  uint64_t stall = HAL_SIM_US(APP_STALL_PERIOD_US);
+  uint64_t end;
+#if HAL_UART_STATS
+  halUARTStats_t stats;
+#endif
+
+  halSimInit();
+  halSimUartPeer(HAL_UART_PORT_0, &peer);
+  halSimPinSet(0, 4, 0);  // The peer is always ready for the target's data (CTS asserted).
+
+#if HAL_DMA
+  HalDmaInit();
+#endif
+  HalUARTInit();
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.configured = TRUE;
+  cfg.baudRate = br;
+  cfg.flowControl = flow;
+  cfg.callBackFunc = appCback;
+  (void)HalUARTOpen(HAL_UART_PORT_0, &cfg);
+  HAL_ENABLE_INTERRUPTS();
+  halSimUartKick(HAL_UART_PORT_0);
+
+  end = halSimTime() + HAL_SIM_MS(APP_RUN_LIMIT_MS);
+  while (((peerRxCnt < streamLen) || (appRxCnt + appRxLost < streamLen)) && (halSimTime() < end))
+  {
+    HalUARTPoll();
+    appRead();
+    appWrite(pattern);
+
+    if (halSimTime() >= stall)
+    {
+      stall += HAL_SIM_US(APP_STALL_PERIOD_US);
+      halSimRun(HAL_SIM_US(APP_STALL_US));
+    }
+    else
+    {
+      halSimRun(HAL_SIM_US(APP_LOOP_US));
+    }
+  }
+
+  memset(&res, 0, sizeof(res));
+  res.done = (peerRxCnt >= streamLen) && (appRxCnt + appRxLost >= streamLen);
+  res.txBps = (peerRxLast != 0) ? peerRxCnt * 1e12 / peerRxLast : 0;
+  res.rxBps = (appRxLast != 0) ? appRxCnt * 1e12 / appRxLast : 0;
+  res.wrMaxMs = wrMax / 1e9;
+  res.overruns = halSimStats.rxLost[0];
+#if HAL_UART_STATS
+  HalUARTGetStats(HAL_UART_PORT_0, &stats, FALSE);
+  res.overruns += stats.rxOverruns;
+#endif
+  res.lost = appRxLost + (streamLen - appRxCnt - appRxLost);
+  res.txBad = peerRxBad;
+
+  return res;
+}
+
+// Each run is in a child process, so that the driver and the model start from their reset state.
+static int benchFork(uint8 br, uint8 pattern, uint8 flow, benchResult_t *pRes)
+{
+  int fd[2];
+  pid_t pid;
+  int status;
+
+  fflush(stdout);
+  if (pipe(fd) != 0 || (pid = fork()) < 0)
+  {
+    perror("uart_bench");
+    exit(2);
+  }
+
+  if (pid == 0)
+  {
+    benchResult_t res = benchRun(br, pattern, flow);
+
+    close(fd[0]);
+    if (write(fd[1], &res, sizeof(res)) != sizeof(res))
+    {
+      _exit(2);
+    }
+    _exit(0);
+  }
+
+  close(fd[1]);
+  if (read(fd[0], pRes, sizeof(*pRes)) != sizeof(*pRes))
+  {
+    memset(pRes, 0, sizeof(*pRes));
+  }
+  close(fd[0]);
+  (void)waitpid(pid, &status, 0);
+
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 2;
+}
+
+int main(int argc, char **argv)
+{
+  uint8 test = FALSE;
+  int fails = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "tn:s:b:")) != -1)
+  {
+    switch (opt)
+    {
+    case 't':
+      test = TRUE;
+      break;
+    case 'n':
+      streamLen = (uint32)strtoul(optarg, NULL, 0);
+      break;
+    case 's':
+      peerSkid = (uint8)strtoul(optarg, NULL, 0);
+      break;
+    case 'b':
+      baudMin = (uint32)strtoul(optarg, NULL, 0);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-t] [-n bytes] [-s skid] [-b baud]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  printf("driver=%s rx_max=%u tx_max=%u tx_by_isr=%u stream=%u skid=%u\n", APP_DRIVER,
+         APP_RX_MAX, APP_TX_MAX, HAL_UART_TX_BY_ISR, streamLen, peerSkid);
+  printf("%7s %-6s %-4s %9s %9s %8s %6s %6s\n",
+         "baud", "write", "flow", "tx B/s", "rx B/s", "wr max", "ovr", "lost");
+
+  for (uint8 flow = test ? 1 : 0; flow < 2; flow++)
+  {
+    for (uint8 b = 0; b < BAUD_CNT; b++)
+    {
+      if (baudTbl[b].baud < baudMin)
+      {
+        continue;
+      }
+
+      for (uint8 p = 0; p < PATTERN_CNT; p++)
+      {
+        benchResult_t res;
+        int status = benchFork(baudTbl[b].br, p, flow, &res);
+        uint8 bad = (status != 0) || !res.done || (res.txBad != 0) ||
+                    (res.lost != 0) || (res.overruns != 0);
+
+        printf("%7u %-6s %-4s %9.0f %9.0f %8.2f %6u %6u%s\n", baudTbl[b].baud, patternName[p],
+               flow ? "on" : "off", res.txBps, res.rxBps, res.wrMaxMs, res.overruns, res.lost,
+               (status != 0) ? "  CRASH" : (!res.done ? "  STALL" : ""));
+
+        if (test && bad)
+        {
+          fails++;
+        }
+      }
+    }
+  }
+
+  if (test)
+  {
+    printf("%s\n", fails ? "FAIL" : "PASS");
+  }
+  return fails ? 1 : 0;
+}
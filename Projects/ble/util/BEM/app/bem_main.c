@@ -78,6 +78,16 @@ static const uint8 aesKey[KEY_BLENGTH] = {
 // The OAD image is encrypted using the BootLoader-Encrypter PC tool with the EBL.
 #define SBL_RW_BUF_LEN        64
 
+// Feed the AES by DMA and write each decrypted page to flash by DMA while the next page is read
+// and decrypted into the other page buffer.
+#if !defined BEM_AES_DMA
+#define BEM_AES_DMA           TRUE
+#endif
+
+#if BEM_AES_DMA && (!defined HAL_AES_DMA || (HAL_AES_DMA == FALSE))
+#error "BEM_AES_DMA requires the AesDmaSetup() of hal_aes.c built with HAL_AES_DMA=TRUE."
+#endif
+
 /* ------------------------------------------------------------------------------------------------
  *                                          Typedefs
  * ------------------------------------------------------------------------------------------------
@@ -131,6 +141,7 @@ typedef struct {
  */
 
 __no_init halDMADesc_t dmaCh0;  // Locally setup for use by HalFlashWrite().
+__no_init halDMADesc_t dmaCh1234[4];  // Only Channels 1 & 2 are used by hal_aes.c: AES in & out.
 
 /* ------------------------------------------------------------------------------------------------
  *                                       Local Variables
@@ -138,6 +149,9 @@ __no_init halDMADesc_t dmaCh0;  // Locally setup for use by HalFlashWrite().
  */
 
 __no_init uint8 pageBuf[HAL_FLASH_PAGE_SIZE];
+#if BEM_AES_DMA
+__no_init uint8 pageBuf2[HAL_FLASH_PAGE_SIZE];  // Crypted while pageBuf is written, & vice versa.
+#endif
 
 __no_init __data uint8 JumpToImageAorB @ 0x09;
 
@@ -292,6 +306,25 @@ static void aesCrypt(uint8 skipCnt, uint8 *pBuf)
   }
   while ((ENCCS & BV(3)) == 0);
 
+#if BEM_AES_DMA
+  // The skipped blocks do not advance the counter, so just crypt the remainder in one DMA run.
+  uint16 len = SBL_RW_BUF_LEN - (uint16)KEY_BLENGTH * skipCnt;
+  pBuf += (uint16)KEY_BLENGTH * skipCnt;
+  AesDmaSetup(pBuf, len, pBuf, len);
+
+  for (uint8 cnt = skipCnt; cnt < (SBL_RW_BUF_LEN / KEY_BLENGTH); cnt++)
+  {
+    ENCCS = CTR | AES_ENCRYPT | 0x01;
+
+    // 'while ((ENCCS & BV(3)) == 0)' was seen to hang without #pragma optimize=none.
+    // So proactively adding this wait after every 'ENCCS = ' which empirically seems to work.
+    ASM_NOP; ASM_NOP; ASM_NOP; ASM_NOP; ASM_NOP; ASM_NOP; ASM_NOP; ASM_NOP;
+
+    while ((ENCCS & BV(3)) == 0);  // With DMA, RDY goes hi once the output block is read out.
+  }
+
+  while (!HAL_DMA_CHECK_IRQ(HAL_DMA_AES_OUT));
+#else
   for (uint8 cnt = 0; cnt < (SBL_RW_BUF_LEN / KEY_BLENGTH); cnt++)
   {
     if (skipCnt == 0)
@@ -325,6 +358,7 @@ static void aesCrypt(uint8 skipCnt, uint8 *pBuf)
       pBuf += KEY_BLENGTH;
     }
   }
+#endif
 }
 
 /**************************************************************************************************
@@ -478,6 +512,8 @@ static uint8 imgAuth(uint8 imgSel, img_hdr_t *imgHdr)
  */
 static void imgCrypt(uint8 imgSel, img_hdr_t *imgHdr)
 {
+  uint8 *pBuf = pageBuf;
+
   aesLoadKey();
 
   uint8 pgEnd = imgHdr->res[0] + ImgPageBeg[imgSel];
@@ -489,23 +525,32 @@ static void imgCrypt(uint8 imgSel, img_hdr_t *imgHdr)
 
   for (uint8 pgNum = ImgPageBeg[imgSel]; pgNum < pgEnd; )
   {
-    BEM_NVM_GET(pgNum, pageBuf, HAL_FLASH_PAGE_SIZE);
+    BEM_NVM_GET(pgNum, pBuf, HAL_FLASH_PAGE_SIZE);
 
     // EBL is used to encrypt the image in SBL_RW_BUF_LEN blocks, so it must be decrypted likewise.
     for (uint8 blk = 0; blk < (HAL_FLASH_PAGE_SIZE / SBL_RW_BUF_LEN); blk++)
     {
       if ((pgNum == ImgPageBeg[imgSel]) && (blk == 0))
       {
-        aesCrypt(1, pageBuf + ((uint16)SBL_RW_BUF_LEN * blk));
+        aesCrypt(1, pBuf + ((uint16)SBL_RW_BUF_LEN * blk));
       }
       else
       {
-        aesCrypt(0, pageBuf + ((uint16)SBL_RW_BUF_LEN * blk));
+        aesCrypt(0, pBuf + ((uint16)SBL_RW_BUF_LEN * blk));
       }
     }
 
+#if BEM_AES_DMA
+    while (FCTL & 0x80);  // The previous page must be written before this one is erased.
+    HalFlashErase(pgNum);
+    while (FCTL & 0x80);
+    // Written by DMA while the next page is read and decrypted into the other page buffer.
+    HalFlashWriteStart(pgNum * BEM_PAGE_LEN, pBuf, BEM_PAGE_LEN);
+    pBuf = (pBuf == pageBuf) ? pageBuf2 : pageBuf;
+#else
     HalFlashErase(pgNum);
-    BEM_NVM_SET(pgNum, pageBuf, HAL_FLASH_PAGE_SIZE);
+    BEM_NVM_SET(pgNum, pBuf, HAL_FLASH_PAGE_SIZE);
+#endif
 
     pgNum++;
 
@@ -514,6 +559,10 @@ static void imgCrypt(uint8 imgSel, img_hdr_t *imgHdr)
       pgNum += ImgPageLen[1];
     }
   }
+
+#if BEM_AES_DMA
+  while (FCTL & 0x80);  // Wait until the last page is written.
+#endif
 }
 
 /**************************************************************************************************
@@ -682,6 +731,10 @@ void main(void)
    * descriptors in addition to just Channel 0.
    */
   HAL_DMA_SET_ADDR_DESC0(&dmaCh0);
+#if BEM_AES_DMA
+  HAL_DMA_SET_ADDR_DESC1234(dmaCh1234);
+  HalAesInit();
+#endif
 
   // Map flash bank #7 into XDATA for access to "ROM mapped as data".
   MEMCTR = (MEMCTR & 0xF8) | 0x07;
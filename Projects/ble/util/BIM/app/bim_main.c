@@ -61,6 +61,18 @@
 
 #define BIM_CRC_OSET          0x00
 #define BIM_HDR_OSET          0x00
+#define BIM_RES_OSET          0x0C
+
+// An image that fails its check is marked in the reserved word of its header, so that a corrupt
+// image is not checked over again on every boot before the other one is run. Any new download of
+// the image erases the header page and so the mark with it. The word lies inside the CRC, so the
+// OAD target writes crc0 only after the last block: a partial download, whose header page a
+// resumed download keeps, is no image to the BIM and never marked.
+#if !defined BIM_CHECK_CACHE
+#define BIM_CHECK_CACHE       TRUE
+#endif
+
+#define BIM_CHECK_FAILED      0x00000000
 
 /* ------------------------------------------------------------------------------------------------
  *                                          Typedefs
@@ -93,7 +105,11 @@ __no_init halDMADesc_t dmaCh0;  // Locally setup for use by HalFlashWrite().
 
 __no_init uint8 pgBuf[HAL_FLASH_PAGE_SIZE];
 
+#if defined __IAR_SYSTEMS_ICC__
 __no_init __data uint8 JumpToImageAorB @ 0x09;
+#else
+uint8 JumpToImageAorB;
+#endif
 
 #pragma location = "ALIGNED_CODE"
 void halSleepExec(void);
@@ -162,8 +178,8 @@ static uint16 crcCalcDMA(uint8 page)
   // One page is used for BIM, so we move this image's last page forward
   pageEnd += pageBeg;
   
-  // If image A, set last page to be ImgA size + ImgB size
-  if (pageBeg == BIM_IMG_A_PAGE)
+  // If image A reaches the Image-B area, set last page to be ImgA size + ImgB size
+  if ((pageBeg == BIM_IMG_A_PAGE) && (pageEnd > BIM_IMG_B_PAGE))
   {
     pageEnd += BIM_IMG_B_AREA;
   }
@@ -263,10 +279,36 @@ static uint16 crcCalc(uint8 page)
 }
 #endif
 
+/**************************************************************************************************
+ * @fn          crcFailed
+ *
+ * @brief       Check whether the image has failed its CRC check before.
+ *
+ * input parameters
+ *
+ * @param       page - Flash page on which the image begins.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      TRUE if the image is marked as failed; FALSE otherwise.
+ **************************************************************************************************
+ */
+static uint8 crcFailed(uint8 page)
+{
+  uint32 res;
+
+  HalFlashRead(page, BIM_RES_OSET, (uint8 *)&res, 4);
+
+  return (BIM_CHECK_CACHE && (res == BIM_CHECK_FAILED));
+}
+
 /**************************************************************************************************
  * @fn          crcCheck
  *
- * @brief       Calculate the image CRC and set it ready-to-run if it is good.
+ * @brief       Calculate the image CRC and set it ready-to-run if it is good, or mark it as
+ *              failed if it is not.
  *
  * input parameters
  *
@@ -305,6 +347,16 @@ static void crcCheck(uint8 page, uint16 *crc)
     HalFlashWrite(addr, (uint8 *)crc, 1);
     HAL_SYSTEM_RESET();
   }
+  else if (BIM_CHECK_CACHE)
+  {
+    // The reserved word is still 0xFFFFFFFF from the image, so it can be written once.
+    uint16 addr = page * (HAL_FLASH_PAGE_SIZE / HAL_FLASH_WORD_SIZE) +
+                                 BIM_RES_OSET / HAL_FLASH_WORD_SIZE;
+    uint32 res = BIM_CHECK_FAILED;
+
+    HAL_DMA_SET_ADDR_DESC0(&dmaCh0);
+    HalFlashWrite(addr, (uint8 *)&res, 1);
+  }
 }
 
 /**************************************************************************************************
@@ -342,10 +394,10 @@ void main(void)
     /* This check is disruptive when an OAD process to Image-A is interrupted - this check must
      * complete before the still good Image-A is run.
     else if (crc[1] == 0xFFFF)  // If first run of an image that was physically downloaded.*/
+    else if (!crcFailed(BIM_IMG_B_PAGE))  // An interrupted OAD to Image-B is only checked once.
     {
       crcCheck(BIM_IMG_B_PAGE, crc);
     }
-    /**/
   }
 
   HalFlashRead(BIM_IMG_A_PAGE, BIM_CRC_OSET, (uint8 *)crc, 4);
@@ -359,7 +411,8 @@ void main(void)
       asm("LJMP 0x0830");
       HAL_SYSTEM_RESET();  // Should not get here.
     }
-    else if (crc[1] == 0xFFFF)  // If first run of an image that was physically downloaded.
+    else if ((crc[1] == 0xFFFF) &&  // If first run of an image that was physically downloaded.
+             !crcFailed(BIM_IMG_A_PAGE))
     {
       crcCheck(BIM_IMG_A_PAGE, crc);
     }
@@ -63,6 +63,8 @@
 #define SBL_READ_CMD                 0x02
 #define SBL_ENABLE_CMD               0x03
 #define SBL_HANDSHAKE_CMD            0x04
+#define SBL_STREAM_CMD               0x05
+#define SBL_STREAM_WRITE_CMD         0x06
 
 // Commands to Target Application
 #define SBL_TGT_BOOTLOAD             0x10  // Erase the image valid signature & jump to bootloader.
@@ -102,6 +104,26 @@
 #define SBL_CALC_CRC  FALSE
 #endif
 
+/* Streamed download, for factory programming. SBL_STREAM_CMD carries an (unused) address, the
+ * frame length requested and the image length in flash words (2, LE; the whole image area if 0 or
+ * left out). It erases the pages of the image, and of the rest of the image area only those that
+ * are not blank already, since calcCRC() runs over all of it. It answers with the frame length
+ * granted and the number of frames the host may send ahead of the acks. Each SBL_STREAM_WRITE_CMD
+ * then carries the next address and up to a frame of data; its ack holds the address expected
+ * next, so any ack covers all the frames before it, and a frame lost to a bad FCS is resent from
+ * there. The frame is written to flash by DMA while the next one is received. SBL_ENABLE_CMD then
+ * runs calcCRC() once over the image instead of the host reading every block back.
+ * Like the CRC, only a boot loader with room left on its page can take the code size.
+ */
+#if !defined SBL_STREAM
+#define SBL_STREAM  FALSE
+#endif
+
+// A multiple of the flash word size that still fits an RPC frame with the address.
+#define SBL_STREAM_MAX_LEN           240
+// One frame being written to flash and one being received.
+#define SBL_STREAM_WINDOW            2
+
 // Buffer size - it has to be big enough for the largest RPC packet and overhead.
 #define SBL_BUF_SIZE                 256
 #define SBL_MAX_SIZE                (SBL_BUF_SIZE - RPC_FRAME_HDR_SZ - RPC_UART_FRAME_OVHD)
@@ -132,6 +154,14 @@ static uint8 rpcBuf[SBL_BUF_SIZE], sbFcs, sbIdx, sbLen;
 static uint8 *const sbBuf = rpcBuf+1;
 static rpcSte_t rpcSte;
 
+#if SBL_STREAM
+// Responses go out of their own buffer while the next frame is received into rpcBuf.
+static uint8 sbTxBuf[SBL_BUF_SIZE];
+static uint8 sbWrBuf[SBL_STREAM_MAX_LEN];
+static uint8 sbFrameLen;
+static uint16 sbNextAddr, sbStreamEnd;
+#endif
+
 /* ------------------------------------------------------------------------------------------------
  *                                     Local Functions
  * ------------------------------------------------------------------------------------------------
@@ -142,6 +172,9 @@ static uint8  sblResp(void);
 static uint16 calcCRC(void);
 static uint8  checkRC(void);
 static uint16 crc16(uint16 crc, uint8 val);
+#if SBL_STREAM
+static uint8  flashBlank(uint8 pg);
+#endif
 
 /**************************************************************************************************
  * @fn          sblInit
@@ -277,9 +310,21 @@ static void sblProc(void)
     break;
 
   case SBL_ENABLE_CMD:
+#if SBL_STREAM
+    while (FCTL & 0x80);  // Wait until the last frame is written.
+#endif
     HalFlashRead(HAL_SBL_IMG_CRC / SBL_PAGE_SIZE,
                 (HAL_SBL_IMG_CRC % SBL_PAGE_SIZE) << 2, (uint8 *)crc, sizeof(crc));
 
+#if SBL_STREAM
+    // A streamed image was never read back, so check it here in one pass.
+    if ((sbStreamEnd != 0) && (calcCRC() != crc[0]))
+    {
+      rsp = SBL_VALIDATE_FAILED;
+      break;
+    }
+#endif
+
     // Bootload master must have verified extra checks to be issuing the SBL_ENABLE_CMD.
     //if ((crc[0] != crc[1]) && (crc[0] != 0xFFFF) && (crc[0] != 0x0000))
     if (crc[1] != crc[0])
@@ -302,6 +347,77 @@ static void sblProc(void)
   case SBL_HANDSHAKE_CMD:
     break;
 
+#if SBL_STREAM
+  case SBL_STREAM_CMD:
+    while (FCTL & 0x80);  // A frame of a stream restarted may still be written from sbWrBuf.
+
+    sbStreamEnd = HAL_SBL_IMG_END;
+    if (sbBuf[RPC_POS_LEN] >= (SBL_REQ_DAT0 - SBL_REQ_ADDR_LSB) + 3)
+    {
+      t16 = BUILD_UINT16(sbBuf[SBL_REQ_DAT0 + 1], sbBuf[SBL_REQ_DAT0 + 2]);
+      if ((t16 != 0) && (t16 < (HAL_SBL_IMG_END - HAL_SBL_IMG_BEG)))
+      {
+        sbStreamEnd = HAL_SBL_IMG_BEG + t16;
+      }
+    }
+
+    // Some 20 ms a page, so a page past the image is erased only if an older image left code.
+    for (uint8 pg = HAL_SBL_IMG_BEG / SBL_PAGE_SIZE; pg < HAL_SBL_IMG_END / SBL_PAGE_SIZE; pg++)
+    {
+      if ((pg < (sbStreamEnd + SBL_PAGE_SIZE - 1) / SBL_PAGE_SIZE) || !flashBlank(pg))
+      {
+        HalFlashErase(pg);
+      }
+    }
+
+    sbFrameLen = sbBuf[SBL_REQ_DAT0] & ~(HAL_FLASH_WORD_SIZE - 1);
+    if (sbFrameLen > SBL_STREAM_MAX_LEN)
+    {
+      sbFrameLen = SBL_STREAM_MAX_LEN;
+    }
+    else if (sbFrameLen < SBL_RW_BUF_LEN)
+    {
+      sbFrameLen = SBL_RW_BUF_LEN;
+    }
+    sbNextAddr = HAL_SBL_IMG_BEG;
+
+    len = 3;
+    sbBuf[SBL_RSP_STATUS+1] = sbFrameLen;
+    sbBuf[SBL_RSP_STATUS+2] = SBL_STREAM_WINDOW;
+    break;
+
+  case SBL_STREAM_WRITE_CMD:
+  {
+    uint8 cnt = sbBuf[RPC_POS_LEN] - (SBL_REQ_DAT0 - SBL_REQ_ADDR_LSB);
+
+    if (t16 != sbNextAddr)
+    {
+      rsp = SBL_IGNORED;  // Out of order after a lost frame: the ack tells where to resume.
+    }
+    else if ((cnt == 0) || (cnt > sbFrameLen) || (cnt % HAL_FLASH_WORD_SIZE) ||
+             ((sbStreamEnd - t16) < (cnt / HAL_FLASH_WORD_SIZE)))
+    {
+      rsp = SBL_FAILURE;
+    }
+    else
+    {
+      while (FCTL & 0x80);  // The previous frame has long been written while this one came in.
+
+      for (uint8 idx = 0; idx < cnt; idx++)
+      {
+        sbWrBuf[idx] = sbBuf[SBL_REQ_DAT0 + idx];
+      }
+      HalFlashWriteStart(t16, sbWrBuf, cnt / HAL_FLASH_WORD_SIZE);
+      sbNextAddr += cnt / HAL_FLASH_WORD_SIZE;
+    }
+
+    len = SBL_READ_HDR_LEN;
+    sbBuf[SBL_RSP_ADDR_LSB] = LO_UINT16(sbNextAddr - HAL_SBL_IMG_BEG);
+    sbBuf[SBL_RSP_ADDR_MSB] = HI_UINT16(sbNextAddr - HAL_SBL_IMG_BEG);
+    break;
+  }
+#endif
+
   default:
     rsp = SBL_FAILURE;
     break;
@@ -346,7 +462,15 @@ static uint8 sblResp(void)
   }
 
   rpcBuf[0] = RPC_UART_SOF;
+#if SBL_STREAM
+  for (uint8 idx = 0; idx < len + RPC_UART_FRAME_OVHD; idx++)
+  {
+    sbTxBuf[idx] = rpcBuf[idx];
+  }
+  (void)HalUARTWrite(0, sbTxBuf, len + RPC_UART_FRAME_OVHD);
+#else
   (void)HalUARTWrite(0, rpcBuf, len + RPC_UART_FRAME_OVHD);
+#endif
 
   return rtrn;
 }
@@ -464,5 +588,40 @@ static uint16 crc16(uint16 crc, uint8 val)
   return crc;
 }
 
+#if SBL_STREAM
+/**************************************************************************************************
+ * @fn          flashBlank
+ *
+ * @brief       Check whether a flash page is erased.
+ *
+ * input parameters
+ *
+ * @param       pg - A valid flash page number.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      TRUE if every byte of the page is 0xFF; FALSE otherwise.
+ **************************************************************************************************
+ */
+static uint8 flashBlank(uint8 pg)
+{
+  for (uint16 oset = 0; oset < HAL_FLASH_PAGE_SIZE; oset += SBL_RW_BUF_LEN)
+  {
+    HalFlashRead(pg, oset, sbWrBuf, SBL_RW_BUF_LEN);
+    for (uint8 idx = 0; idx < SBL_RW_BUF_LEN; idx++)
+    {
+      if (sbWrBuf[idx] != 0xFF)
+      {
+        return FALSE;
+      }
+    }
+  }
+
+  return TRUE;
+}
+#endif
+
 /**************************************************************************************************
 */
@@ -92,6 +92,11 @@ static const uint8 unlockedSecKey[32] =
 #define UBL_SECURE                   FALSE
 #endif
 
+// Feed the AES by DMA in order to crypt a whole page with one arming of the DMA channels.
+#if !defined UBL_AES_DMA
+#define UBL_AES_DMA                  TRUE
+#endif
+
 #if UBL_SECURE
 static const uint8 aesKey[KEY_BLENGTH] = {
   // This dummy key must be replaced by a randomly generated key that is kept secret.
@@ -143,6 +148,9 @@ const uint8 UBL_RC_IMG_PG_END = UBL_PAGE_LAST;
 
 __no_init uint8 pgBuf[HAL_FLASH_PAGE_SIZE];  // RAM (XDATA) buffer for an Rx/Tx flash page.
 __no_init ublMetaData_t ublMD;
+#if UBL_SECURE && UBL_AES_DMA
+__no_init halDMADesc_t dmaCh1234[4];  // Only Channels 1 & 2 are used: the AES input & output.
+#endif
 
 /* ------------------------------------------------------------------------------------------------
  *                                       Local Variables
@@ -169,6 +177,15 @@ static bool signMode;
 static uint8 aesCheckCtrl(void *pBuf);
 static void  aesLoadKey(void);
 static void  aesInitSig(void);
+#if UBL_AES_DMA
+/* AesDmaSetup() & HalAesInit() of hal_aes.c, built here on the UBL hal headers. They leave
+ * HAL_AES_DMA undefined, as the CPU-fed AES code below needs HAL_AES_DELAY() of hal_aes.h, so it
+ * is set only past hal_aes.h.
+ */
+#define HAL_DMA                      TRUE
+#define HAL_AES_DMA                  TRUE
+#include "hal_aes.c"
+#endif
 #endif
 
 static bool cntDnForcedDecr(void);
@@ -324,6 +341,10 @@ uint8 ublAesCrypt(uint8 pgNum, uint8 *pgBuf)
     }
     while ((ENCCS & BV(3)) == 0);
 
+#if UBL_AES_DMA
+    AesDmaSetup(pBuf, HAL_FLASH_PAGE_SIZE, pBuf, HAL_FLASH_PAGE_SIZE);
+#endif
+
     for (uint8 cnt = 0; cnt < (HAL_FLASH_PAGE_SIZE / KEY_BLENGTH); cnt++)
     {
       ENCCS = CTR | AES_ENCRYPT | 0x01;
@@ -332,6 +353,12 @@ uint8 ublAesCrypt(uint8 pgNum, uint8 *pgBuf)
       // So proactively adding this wait after every 'ENCCS = ' which empirically seems to work.
       ASM_NOP; ASM_NOP; ASM_NOP; ASM_NOP; ASM_NOP; ASM_NOP; ASM_NOP; ASM_NOP;
 
+#if UBL_AES_DMA
+      while ((ENCCS & BV(3)) == 0);  // With DMA, RDY goes hi once the output block is read out.
+    }
+
+    while (!HAL_DMA_CHECK_IRQ(HAL_DMA_AES_OUT));
+#else
       for (uint8 blk = 0; blk < 4; blk++)
       {
         for (uint8 idx = 0; idx < 4; idx++)
@@ -349,6 +376,7 @@ uint8 ublAesCrypt(uint8 pgNum, uint8 *pgBuf)
         pBuf += 4;
       }
     }
+#endif
 
     if ((pgNum == UBL_PAGE_FIRST) && !aesCheckCtrl(pgBuf))
     {
@@ -466,6 +494,8 @@ void ublExec(void)
     }
   }
 
+  HalFlashFlush();  // Finish any deferred erase and background write before leaving UBL mode.
+
   if (UBL_RC_VALID)
   {
     usb_msd_uninit();
@@ -522,6 +552,10 @@ void ublInit(void)
   vddWait();  // Stricter wait then in main, looking for safe Vdd for writing flash.
 
 #if UBL_SECURE
+#if UBL_AES_DMA
+  HAL_DMA_SET_ADDR_DESC1234(dmaCh1234);
+  HalAesInit();
+#endif
   aesLoadKey();
 
   aes_ctrl_blk_t ctrlBlk;
@@ -569,6 +603,8 @@ void ublJump(void)
  * @fn          ublMassErase
  *
  * @brief       Erase all pages enabled for mass-erase (not including UBL pages or lock bits page).
+ *              Unless forced, the image pages are only marked to be erased as they are re-written
+ *              (or on HalFlashFlush()); the page with the filename is always erased at once.
  *
  * input parameters
  *
@@ -584,16 +620,18 @@ void ublMassErase(bool eraseAll)
 {
   for (uint8 pg = UBL_RC_IMG_PG_BEG+1; pg <= UBL_PAGE_LAST; pg++)
   {
-    if (eraseAll || GET_BIT(ublMD.eraseEn, pg))
+    if (eraseAll)
+    {
+      HalFlashErase(pg);
+    }
+    else if (GET_BIT(ublMD.eraseEn, pg))
     {
-      FADDRH = pg * (HAL_FLASH_PAGE_SIZE / HAL_FLASH_WORD_SIZE / 256);
-      FCTL |= 0x01;
+      HalFlashEraseDefer(pg);
     }
   }
 
   // Now erase the page with the filename.
-  FADDRH = UBL_RC_IMG_PG_BEG * (HAL_FLASH_PAGE_SIZE / HAL_FLASH_WORD_SIZE / 256);
-  FCTL |= 0x01;
+  HalFlashErase(UBL_RC_IMG_PG_BEG);
 }
 
 #if UBL_SECURE
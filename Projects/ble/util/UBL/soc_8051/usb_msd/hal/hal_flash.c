@@ -42,12 +42,43 @@
  * ------------------------------------------------------------------------------------------------
  */
 
+#include <string.h>
+
 #include "hal_board_cfg.h"
 #include "hal_dma.h"
 #include "hal_flash.h"
 #include "hal_mcu.h"
 #include "hal_types.h"
 
+#if HAL_FLASH_DEFER
+/* ------------------------------------------------------------------------------------------------
+ *                                          Constants
+ * ------------------------------------------------------------------------------------------------
+ */
+
+#define HAL_FLASH_PAGE_CNT           128
+#define HAL_FLASH_PAGE_WORDS        (HAL_FLASH_PAGE_SIZE / HAL_FLASH_WORD_SIZE)
+
+#define FLASH_CMP_SAME               0
+#define FLASH_CMP_BLANK              1
+#define FLASH_CMP_DIFF               2
+
+/* ------------------------------------------------------------------------------------------------
+ *                                       Local Variables
+ * ------------------------------------------------------------------------------------------------
+ */
+
+static uint8 eraseDue[HAL_FLASH_PAGE_CNT / 8];  // Bit per page marked by HalFlashEraseDefer().
+static __no_init uint8 wrBuf[HAL_FLASH_PAGE_SIZE];  // Source of a whole-page background write.
+
+/* ------------------------------------------------------------------------------------------------
+ *                                       Local Functions
+ * ------------------------------------------------------------------------------------------------
+ */
+
+static uint8 flashCmp(uint8 pg, uint8 *buf);
+#endif
+
 /**************************************************************************************************
  * @fn          HalFlashRead
  *
@@ -78,6 +109,16 @@ void HalFlashRead(uint8 pg, uint16 offset, uint8 *buf, uint16 cnt)
   halIntState_t is;
 #endif
 
+#if HAL_FLASH_DEFER
+  while (FCTL & 0x80);  // Wait until a background write is done.
+
+  if (GET_BIT(eraseDue, pg))
+  {
+    (void)memset(buf, 0xFF, cnt);
+    return;
+  }
+#endif
+
   pg /= HAL_FLASH_PAGE_PER_BANK;  // Calculate the flash bank from the flash page.
 
 #if (!defined HAL_OAD_BOOT_CODE) && (!defined HAL_OTA_BOOT_CODE)
@@ -121,6 +162,36 @@ void HalFlashWrite(uint16 addr, uint8 *buf, uint16 cnt)
 {
   halDMADesc_t *ch = HAL_NV_DMA_GET_DESC();
 
+#if HAL_FLASH_DEFER
+  uint8 pg = (uint8)(addr / HAL_FLASH_PAGE_WORDS);
+  uint8 wholePg = ((cnt == HAL_FLASH_PAGE_WORDS) && ((addr % HAL_FLASH_PAGE_WORDS) == 0));
+
+  while (FCTL & 0x80);  // Wait until a background write is done.
+
+  if (GET_BIT(eraseDue, pg))
+  {
+    uint8 cmp = (wholePg) ? flashCmp(pg, buf) : FLASH_CMP_DIFF;
+
+    CLR_BIT(eraseDue, pg);
+
+    if (cmp == FLASH_CMP_SAME)
+    {
+      return;  // The page already holds this content, so neither erase nor write it.
+    }
+    else if (cmp == FLASH_CMP_DIFF)
+    {
+      HalFlashErase(pg);
+    }
+  }
+
+  // Write a whole page from wrBuf so that the caller can refill its buffer during the write.
+  if (wholePg)
+  {
+    (void)memcpy(wrBuf, buf, HAL_FLASH_PAGE_SIZE);
+    buf = wrBuf;
+  }
+#endif
+
   HAL_DMA_SET_SOURCE(ch, buf);
   HAL_DMA_SET_DEST(ch, &FWDATA);
   HAL_DMA_SET_VLEN(ch, HAL_DMA_VLEN_USE_LEN);
@@ -140,6 +211,14 @@ void HalFlashWrite(uint16 addr, uint8 *buf, uint16 cnt)
   FADDRL = (uint8)addr;
   FADDRH = (uint8)(addr >> 8);
   FCTL |= 0x02;         // Trigger the DMA writes.
+
+#if HAL_FLASH_DEFER
+  if (buf == wrBuf)
+  {
+    return;  // Left to finish in the background.
+  }
+#endif
+
   while (FCTL & 0x80);  // Wait until writing is done.
 }
 
@@ -161,9 +240,129 @@ void HalFlashWrite(uint16 addr, uint8 *buf, uint16 cnt)
  */
 void HalFlashErase(uint8 pg)
 {
+#if HAL_FLASH_DEFER
+  while (FCTL & 0x80);  // Wait until a background write is done.
+  CLR_BIT(eraseDue, pg);
+#endif
+
   FADDRH = pg * (HAL_FLASH_PAGE_SIZE / HAL_FLASH_WORD_SIZE / 256);
   FCTL |= 0x01;
 }
 
+/**************************************************************************************************
+ * @fn          HalFlashEraseDefer
+ *
+ * @brief       This function marks a page of the internal flash to be erased before it is next
+ *              written; until then it reads back as erased.
+ *
+ * input parameters
+ *
+ * @param       pg - A valid flash page number to erase.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ **************************************************************************************************
+ */
+void HalFlashEraseDefer(uint8 pg)
+{
+#if HAL_FLASH_DEFER
+  SET_BIT(eraseDue, pg);
+#else
+  HalFlashErase(pg);
+#endif
+}
+
+/**************************************************************************************************
+ * @fn          HalFlashFlush
+ *
+ * @brief       This function erases all pages still marked by HalFlashEraseDefer() and waits for
+ *              a background write to finish.
+ *
+ * input parameters
+ *
+ * None.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ **************************************************************************************************
+ */
+void HalFlashFlush(void)
+{
+#if HAL_FLASH_DEFER
+  for (uint8 pg = 0; pg < HAL_FLASH_PAGE_CNT; pg++)
+  {
+    if (GET_BIT(eraseDue, pg))
+    {
+      HalFlashErase(pg);
+    }
+  }
+
+  while (FCTL & 0x80);  // Wait until a background write is done.
+#endif
+}
+
+#if HAL_FLASH_DEFER
+/**************************************************************************************************
+ * @fn          flashCmp
+ *
+ * @brief       This function compares a whole page of the internal flash to a page buffer.
+ *
+ * input parameters
+ *
+ * @param       pg - A valid flash page number.
+ * @param       buf - A valid buffer space of HAL_FLASH_PAGE_SIZE bytes.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      FLASH_CMP_SAME if the page holds the buffer content, FLASH_CMP_BLANK if it is
+ *              erased and FLASH_CMP_DIFF otherwise.
+ **************************************************************************************************
+ */
+static uint8 flashCmp(uint8 pg, uint8 *buf)
+{
+  // Calculate the start of the page as it gets mapped into XDATA.
+  uint8 *pData = (uint8 *)HAL_FLASH_PAGE_MAP + ((pg % HAL_FLASH_PAGE_PER_BANK) * HAL_FLASH_PAGE_SIZE);
+  uint8 memctr = MEMCTR;  // Save to restore.
+  uint8 same = TRUE, blank = TRUE;
+  uint16 cnt;
+
+#if (!defined HAL_OAD_BOOT_CODE) && (!defined HAL_OTA_BOOT_CODE)
+  halIntState_t is;
+  HAL_ENTER_CRITICAL_SECTION(is);
+#endif
+
+  // Calculate and map the containing flash bank into XDATA.
+  MEMCTR = (MEMCTR & 0xF8) | (pg / HAL_FLASH_PAGE_PER_BANK);
+
+  for (cnt = 0; (cnt < HAL_FLASH_PAGE_SIZE) && (same || blank); cnt++)
+  {
+    if (pData[cnt] != buf[cnt])
+    {
+      same = FALSE;
+    }
+    if (pData[cnt] != 0xFF)
+    {
+      blank = FALSE;
+    }
+  }
+
+  MEMCTR = memctr;
+
+#if (!defined HAL_OAD_BOOT_CODE) && (!defined HAL_OTA_BOOT_CODE)
+  HAL_EXIT_CRITICAL_SECTION(is);
+#endif
+
+  return (same) ? FLASH_CMP_SAME : ((blank) ? FLASH_CMP_BLANK : FLASH_CMP_DIFF);
+}
+#endif
+
 /**************************************************************************************************
 */
@@ -53,6 +53,18 @@ extern "C"
 #include "hal_board.h"
 #include "hal_types.h"
 
+/* ------------------------------------------------------------------------------------------------
+ *                                          Constants
+ * ------------------------------------------------------------------------------------------------
+ */
+
+// Defer the erase of pages marked by HalFlashEraseDefer() until they are first written, skip it
+// for pages already blank or already holding the written content, and let a whole-page write
+// run in the background from a second page buffer while the caller refills its own.
+#if !defined HAL_FLASH_DEFER
+#define HAL_FLASH_DEFER              TRUE
+#endif
+
 /**************************************************************************************************
  * @fn          HalFlashRead
  *
@@ -112,6 +124,44 @@ void HalFlashWrite(uint16 addr, uint8 *buf, uint16 cnt);
  */
 void HalFlashErase(uint8 pg);
 
+/**************************************************************************************************
+ * @fn          HalFlashEraseDefer
+ *
+ * @brief       This function marks a page of the internal flash to be erased before it is next
+ *              written; until then it reads back as erased.
+ *
+ * input parameters
+ *
+ * @param       pg - Valid HAL flash page number (ie < 128) to erase.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ **************************************************************************************************
+ */
+void HalFlashEraseDefer(uint8 pg);
+
+/**************************************************************************************************
+ * @fn          HalFlashFlush
+ *
+ * @brief       This function erases all pages still marked by HalFlashEraseDefer() and waits for
+ *              a background write to finish.
+ *
+ * input parameters
+ *
+ * None.
+ *
+ * output parameters
+ *
+ * None.
+ *
+ * @return      None.
+ **************************************************************************************************
+ */
+void HalFlashFlush(void);
+
 #ifdef __cplusplus
 };
 #endif